@@ -29,6 +29,7 @@
 #include "inc/hw_ints.h"
 #include "inc/hw_i2c.h"
 #include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
 
 #include "driverlib/fpu.h"
 #include "driverlib/gpio.h"
@@ -37,10 +38,12 @@
 #include "driverlib/pin_map.h"
 #include "driverlib/rom.h"
 #include "driverlib/sysctl.h"
+#include "driverlib/systick.h"
 #include "driverlib/uart.h"
 
 #include "utils/uartstdio.h"
 
+#include "i2cLib.h"
 #include "bmpLib.h"
 
 
@@ -49,13 +52,28 @@
 #define LED_BLUE GPIO_PIN_2
 #define LED_GREEN GPIO_PIN_3
 
+// Cortex-M4 debug cycle counter, used to time the compensation math
+#define CORE_DEMCR 0xE000EDFC
+#define CORE_DEMCR_TRCENA 0x01000000
+#define DWT_CTRL 0xE0001000
+#define DWT_CTRL_CYCCNTENA 0x00000001
+#define DWT_CYCCNT 0xE0001004
+
+#define BENCH_SAMPLES 32
+
 
 
 // Variables -----------------------------------------------------------------------------------------
+volatile uint32_t g_ui32Ms = 0;		// Milliseconds since SysTick was started
 
 
 
 // Functions -----------------------------------------------------------------------------------------
+void SysTickIntHandler(void){
+	g_ui32Ms++;
+	I2CLibTick();
+}
+
 void ConfigureUART(void){
 
 	// Enable the peripherals used by UART
@@ -86,7 +104,8 @@ void ConfigureI2C3(bool fastMode){
 	ROM_GPIOPinConfigure(GPIO_PD0_I2C3SCL);
 	ROM_GPIOPinConfigure(GPIO_PD1_I2C3SDA);
 
-	// Initialize as master - 'true' for fastmode, 'false' for regular
+	// Initialize as master - 'true' for fastmode, 'false' for regular. Devices on i2cLib retime the
+	// bus to their own speed, see I2CLibDevSpeedSet
 	if (fastMode){
 		ROM_I2CMasterInitExpClk(I2C3_BASE, ROM_SysCtlClockGet(), true);
 	}
@@ -96,6 +115,29 @@ void ConfigureI2C3(bool fastMode){
 
 }
 
+// Time the pressure compensation over BENCH_SAMPLES readings sharing one temperature. Build with and
+// without BMP180_DIV_FREE to compare the two paths
+uint32_t CompensationCycles(tBMP180Cals *calInst, uint8_t oss){
+	uint16_t UT[BENCH_SAMPLES];
+	uint32_t UP[BENCH_SAMPLES];
+	int32_t pressure[BENCH_SAMPLES];
+	uint32_t i, start;
+
+	// Datasheet example readings, spread around the example pressure
+	for(i = 0; i < BENCH_SAMPLES; i++){
+		UT[i] = 27898;
+		UP[i] = (23843 + i*97) << oss;
+	}
+
+	// Already running if i2cLib enabled it. Never reset, I2CLibBusyCycles times the bus with it
+	HWREG(CORE_DEMCR) |= CORE_DEMCR_TRCENA;
+	HWREG(DWT_CTRL) |= DWT_CTRL_CYCCNTENA;
+
+	start = HWREG(DWT_CYCCNT);
+	BMP180ConvertBatch(calInst, oss, UT, UP, pressure, 0, BENCH_SAMPLES);
+	return (HWREG(DWT_CYCCNT) - start) / BENCH_SAMPLES;
+}
+
 void FloatToPrint(float floatValue, uint32_t splitValue[2]){
 	int32_t i32IntegerPart;
 	int32_t i32FractionPart;
@@ -136,6 +178,12 @@ int main(void){
 	// Enable I2C3
 	ConfigureI2C3(true);
 
+	// Start interrupt driven I2C transactions. Pass &g_sI2CPollBackend to run without them
+	tI2CBus SensHubBus;
+	I2CLibBusInit(&SensHubBus, I2C3_BASE, &g_sI2CIntBackend);
+	I2CLibBusPinsSet(&SensHubBus, GPIO_PORTD_BASE, GPIO_PIN_0, GPIO_PIN_1, GPIO_PD0_I2C3SCL, GPIO_PD1_I2C3SDA);
+	ROM_IntMasterEnable();
+
 	// Create printing variable
 	uint32_t printValue[2];
 
@@ -143,31 +191,68 @@ int main(void){
 	tBMP180 BmpSensHub;
 	tBMP180Cals BmpSensHubCals;
 	
-	BMP180Initialize(&BmpSensHub, 3);
-	BMP180GetCalVals(&BmpSensHub, &BmpSensHubCals);
+	BMP180Initialize(&BmpSensHub, &SensHubBus, 3);
+	while(BMP180GetCalVals(&BmpSensHub, &BmpSensHubCals) != BMP180_STATUS_OK){
+		// Conversions divide by calibration terms, so don't start without a good set
+		UARTprintf("BMP180 calibration read failed, retrying\n");
+		ROM_GPIOPinWrite(GPIO_PORTF_BASE, LED_RED|LED_GREEN|LED_BLUE, LED_RED);
+		ROM_SysCtlDelay(ROM_SysCtlClockGet()/3);
+	}
+	ROM_GPIOPinWrite(GPIO_PORTF_BASE, LED_RED, 0);
+	UARTprintf("Calibration read in %d bus transaction(s)\n", I2CLibTransactionCount());
+	UARTprintf("Compensation takes %d cycles per sample\n", CompensationCycles(&BmpSensHubCals, 3));
+
+	// Temperature drifts slowly, refresh it every 10 pressure readings or 10 seconds
+	BMP180SetTempCache(&BmpSensHub, 10, 10000);
 
 	// Malloc testing
 	// tBMP180 *structTest = malloc(sizeof(tBMP180));
 	// BMP180Initialize(structTest, 3);
 
-	while(1){
-
-		// Get & print temperature
-		BMP180GetTemp(&BmpSensHub, &BmpSensHubCals);
-		FloatToPrint(BmpSensHub.temp, printValue);
-		UARTprintf("%d.%03d, ",printValue[0], printValue[1]);
+	// Start 1ms SysTick used to time conversions
+	ROM_SysTickPeriodSet(ROM_SysCtlClockGet()/1000);
+	ROM_SysTickIntEnable();
+	ROM_SysTickEnable();
 
-		// Get & print pressure
-		BMP180GetPressure(&BmpSensHub, &BmpSensHubCals);
-		UARTprintf("%d\n", BmpSensHub.pressure);
+	// Conversions run in the background; the loop only handles results
+	uint32_t nextSample = g_ui32Ms;
+	uint32_t ledOff = 0;
 
-		// Blink LED
-		ROM_GPIOPinWrite(GPIO_PORTF_BASE, LED_RED|LED_GREEN|LED_BLUE, LED_GREEN);
-		ROM_SysCtlDelay(ROM_SysCtlClockGet()/3/10);	// Delay for 100ms (1/10s) :: ClockGet()/3 = 1second
-		ROM_GPIOPinWrite(GPIO_PORTF_BASE, LED_RED|LED_GREEN|LED_BLUE, 0);
+	while(1){
 
-		// Delay for second
-		ROM_SysCtlDelay(ROM_SysCtlClockGet()/3);
+		// Clears the bus if a transaction had to be abandoned
+		I2CLibService();
+
+		switch(BMP180Service(&BmpSensHub, &BmpSensHubCals, g_ui32Ms)){
+			case BMP180_EVENT_PRESSURE:
+				// Print temperature of last refresh, pressure, and blink LED
+				FloatToPrint(BmpSensHub.temp, printValue);
+				UARTprintf("%d.%03d, ",printValue[0], printValue[1]);
+				UARTprintf("%d\n", BmpSensHub.pressure);
+				ROM_GPIOPinWrite(GPIO_PORTF_BASE, LED_RED|LED_GREEN|LED_BLUE, LED_GREEN);
+				ledOff = g_ui32Ms + 100;
+				break;
+
+			case BMP180_EVENT_ERROR:
+				UARTprintf("BMP180 bus error\n");
+				ROM_GPIOPinWrite(GPIO_PORTF_BASE, LED_RED|LED_GREEN|LED_BLUE, LED_RED);
+				break;
+
+			default:
+				break;
+		}
+
+		if((int32_t)(g_ui32Ms - ledOff) >= 0){
+			ROM_GPIOPinWrite(GPIO_PORTF_BASE, LED_GREEN, 0);
+		}
+
+		// Start next sample every second
+		if((int32_t)(g_ui32Ms - nextSample) >= 0 && BMP180StartSample(&BmpSensHub, g_ui32Ms)){
+			nextSample += 1000;
+		}
+
+		// Nothing to do until the next SysTick or I2C interrupt
+		ROM_SysCtlSleep();
 	}
 
 }
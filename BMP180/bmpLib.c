@@ -15,7 +15,7 @@
 //
 // Notes:
 //	See bmpLib.h
-//	Designed to be used with I2C3
+//	Designed to be used with I2C3 through i2cLib
 //	
 //****************************************************************************************************
 
@@ -28,148 +28,382 @@
 #include "driverlib/rom.h"
 #include "inc/hw_i2c.h"
 #include "inc/hw_memmap.h"
+#include "i2cLib.h"
 #include "bmpLib.h"
 
 
-// Functions -----------------------------------------------------------------------------------------
+// Variables -----------------------------------------------------------------------------------------
+
+// Build fails here if tBMP180 outgrows its SRAM budget. The budget assumes 32 bit pointers, so
+// the check is skipped in host builds
+#if UINTPTR_MAX == 0xFFFFFFFF
+typedef char tBMP180SizeCheck[(sizeof(tBMP180) <= BMP180_INST_BUDGET) ? 1 : -1];
+#endif
+
+// Commands for the non-blocking API, queued straight from flash
+static const uint8_t g_pui8TempCmd[2] = {BMP180_REG_CONTROL, BMP180_READ_TEMP};
+static const uint8_t g_ppui8PresCmd[4][2] = {
+	{BMP180_REG_CONTROL, BMP180_READ_PRES_BASE + (0 << 6)},
+	{BMP180_REG_CONTROL, BMP180_READ_PRES_BASE + (1 << 6)},
+	{BMP180_REG_CONTROL, BMP180_READ_PRES_BASE + (2 << 6)},
+	{BMP180_REG_CONTROL, BMP180_READ_PRES_BASE + (3 << 6)}
+};
+static const uint8_t g_ui8TempReg = BMP180_REG_TEMPDATA;
+static const uint8_t g_ui8PresReg = BMP180_REG_PRESSUREDATA;
+
+// Conversion waits in ms for the non-blocking API. Datasheet maximum rounded up, plus one tick
+// because the caller's millisecond counter may be about to roll over when the wait starts
+static const uint8_t g_ui8TempWaitMs = 6;				// 4.5 ms
+static const uint8_t g_pui8PresWaitMs[4] = {6, 9, 15, 27};		// 4.5, 7.5, 13.5, 25.5 ms
+
+// Barometric formula tables, replace powf in the altitude functions. Sampled evenly from
+// BMP180_ALT_*_MIN in steps of 1/BMP180_ALT_*_SCALE
+#define BMP180_ALT_RATIO_MIN 0.25f		// p / p0, covers 300 hPa at a 1200 hPa sea level
+#define BMP180_ALT_RATIO_SCALE 64.0f
+#define BMP180_ALT_RATIO_LEN 65
+#define BMP180_ALT_HEIGHT_MIN 0.75f		// 1 - h / 44330, covers -2770 m to 11080 m
+#define BMP180_ALT_HEIGHT_SCALE 256.0f
+#define BMP180_ALT_HEIGHT_LEN 81
+
+// (p / p0) ^ (1 / 5.255)
+static const float g_pfAltRatioPow[BMP180_ALT_RATIO_LEN] = {
+	0.7681234f, 0.7770363f, 0.7855342f, 0.7936580f,
+	0.8014428f, 0.8089184f, 0.8161112f, 0.8230439f,
+	0.8297367f, 0.8362074f, 0.8424718f, 0.8485440f,
+	0.8544368f, 0.8601615f, 0.8657286f, 0.8711474f,
+	0.8764265f, 0.8815737f, 0.8865960f, 0.8915002f,
+	0.8962921f, 0.9009775f, 0.9055614f, 0.9100487f,
+	0.9144438f, 0.9187507f, 0.9229735f, 0.9271156f,
+	0.9311804f, 0.9351711f, 0.9390906f, 0.9429417f,
+	0.9467271f, 0.9504491f, 0.9541101f, 0.9577123f,
+	0.9612577f, 0.9647484f, 0.9681861f, 0.9715727f,
+	0.9749098f, 0.9781989f, 0.9814417f, 0.9846395f,
+	0.9877938f, 0.9909057f, 0.9939766f, 0.9970077f,
+	1.0000000f, 1.0029547f, 1.0058729f, 1.0087554f,
+	1.0116034f, 1.0144176f, 1.0171990f, 1.0199484f,
+	1.0226666f, 1.0253544f, 1.0280126f, 1.0306418f,
+	1.0332428f, 1.0358163f, 1.0383628f, 1.0408830f,
+	1.0433775f
+};
+
+// (1 - h / 44330) ^ 5.255
+static const float g_pfAltHeightPow[BMP180_ALT_HEIGHT_LEN] = {
+	0.2205195f, 0.2266223f, 0.2328612f, 0.2392384f,
+	0.2457563f, 0.2524172f, 0.2592236f, 0.2661778f,
+	0.2732824f, 0.2805397f, 0.2879522f, 0.2955226f,
+	0.3032533f, 0.3111469f, 0.3192061f, 0.3274335f,
+	0.3358318f, 0.3444036f, 0.3531518f, 0.3620790f,
+	0.3711880f, 0.3804817f, 0.3899630f, 0.3996346f,
+	0.4094996f, 0.4195608f, 0.4298212f, 0.4402839f,
+	0.4509518f, 0.4618281f, 0.4729158f, 0.4842181f,
+	0.4957381f, 0.5074790f, 0.5194441f, 0.5316366f,
+	0.5440598f, 0.5567169f, 0.5696115f, 0.5827469f,
+	0.5961264f, 0.6097536f, 0.6236319f, 0.6377649f,
+	0.6521561f, 0.6668091f, 0.6817276f, 0.6969152f,
+	0.7123756f, 0.7281126f, 0.7441299f, 0.7604312f,
+	0.7770206f, 0.7939017f, 0.8110787f, 0.8285552f,
+	0.8463355f, 0.8644235f, 0.8828232f, 0.9015387f,
+	0.9205743f, 0.9399339f, 0.9596219f, 0.9796425f,
+	1.0000000f, 1.0206987f, 1.0417429f, 1.0631370f,
+	1.0848856f, 1.1069929f, 1.1294637f, 1.1523023f,
+	1.1755135f, 1.1991018f, 1.2230719f, 1.2474285f,
+	1.2721764f, 1.2973203f, 1.3228651f, 1.3488157f,
+	1.3751769f
+};
+
+
+
+// "Private" Functions ------------------------------------------------------------------------------
+
+// Look up x in a table sampled from xMin in steps of 1/scale. Linear interpolation for
+// BMP180_ALT_FAST, quadratic through three neighbouring points for BMP180_ALT_FINE. Values outside
+// the table are extrapolated from the end segment
+static float BMP180Interp(const float *table, int32_t len, float xMin, float scale, float x, uint8_t mode){
+	float u = (x - xMin) * scale;
+	int32_t i = (int32_t)u;
+	int32_t last = (mode == BMP180_ALT_FINE) ? len - 3 : len - 2;
+	float t, d1;
+
+	if(u < 0.0f){
+		i = 0;
+	} else if(i > last){
+		i = last;
+	}
+	t = u - (float)i;
+	d1 = table[i + 1] - table[i];
 
-void BMP180Initialize(tBMP180 *psInst, uint8_t oss){
-	if(oss > 3){
-		oss = 3;	
+	if(mode == BMP180_ALT_FINE){
+		// Newton forward difference
+		float d2 = table[i + 2] - 2.0f*table[i + 1] + table[i];
+		return table[i] + t*d1 + 0.5f*t*(t - 1.0f)*d2;
 	}
-	psInst->oversamplingSetting = oss;
 
-	psInst->calRegs[0] = BMP180_REG_CAL_AC1;
-	psInst->calRegs[1] = BMP180_REG_CAL_AC2;
-	psInst->calRegs[2] = BMP180_REG_CAL_AC3;
-	psInst->calRegs[3] = BMP180_REG_CAL_AC4;
-	psInst->calRegs[4] = BMP180_REG_CAL_AC5;
-	psInst->calRegs[5] = BMP180_REG_CAL_AC6;
-	psInst->calRegs[6] = BMP180_REG_CAL_B1;
-	psInst->calRegs[7] = BMP180_REG_CAL_B2;
-	psInst->calRegs[8] = BMP180_REG_CAL_MB;
-	psInst->calRegs[9] = BMP180_REG_CAL_MC;
-	psInst->calRegs[10] = BMP180_REG_CAL_MD;
+	return table[i] + t*d1;
+}
+
+// Temperature compensation, shared by temperature and pressure
+static int32_t BMP180CalcB5(int32_t UT, const tBMP180Cals *calInst){
+	// Calculate X1
+	int32_t X1 = (UT - (int32_t)calInst->ac6) * ((int32_t)calInst->ac5) / 32768;
+
+	// Calculate X2
+	int32_t X2 = ((int32_t)calInst->mc * 2048) / (X1 + (int32_t)calInst->md);
 
+	// Calculate B5
+	return X1 + X2;
 }
 
+// True if B5 must be refreshed before the next pressure reading. The age limit only applies when
+// the caller supplies a time (bTimed)
+static bool BMP180TempStale(tBMP180 *psInst, uint32_t now, bool bTimed){
+	// Nothing cached yet, or caching disabled
+	if(!psInst->B5Valid || (psInst->cacheSamples == 0 && (!bTimed || psInst->cacheMs == 0))){
+		return true;
+	}
+
+	// Sample limit reached
+	if(psInst->cacheSamples != 0 && psInst->cacheCount >= psInst->cacheSamples){
+		return true;
+	}
+
+	// Age limit reached
+	if(bTimed && psInst->cacheMs != 0 && (uint32_t)(now - psInst->tempStamp) >= psInst->cacheMs){
+		return true;
+	}
 
-void BMP180GetCalVals(tBMP180 *psInst, tBMP180Cals *calInst){
-	for(int i = 0; i < 11; i++){
-		// Configure to write, set register to send, send
-		ROM_I2CMasterSlaveAddrSet(I2C3_BASE, BMP180_I2C_ADDRESS, false);
-		ROM_I2CMasterDataPut(I2C3_BASE, psInst->calRegs[i]);
-		ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_SEND_START);
-
-		// Wait for bus to free
-		while(ROM_I2CMasterBusy(I2C3_BASE)){}
-
-		// Send restart
-		ROM_I2CMasterSlaveAddrSet(I2C3_BASE, BMP180_I2C_ADDRESS, true);
-
-		// Read MSB
-		ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_START);
-		while(ROM_I2CMasterBusy(I2C3_BASE)){}
-		psInst->calRawVals[2*i] = ROM_I2CMasterDataGet(I2C3_BASE);
-		
-		// Read LSB
-		ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_FINISH);
-		while(ROM_I2CMasterBusy(I2C3_BASE)){}
-		psInst->calRawVals[2*i+1] = ROM_I2CMasterDataGet(I2C3_BASE);
-	}
-	calInst->ac1 = (int16_t) ( (psInst->calRawVals[0] << 8) | psInst->calRawVals[1] );
-	calInst->ac2 = (int16_t) ( (psInst->calRawVals[2] << 8) | psInst->calRawVals[3] );
-	calInst->ac3 = (int16_t) ( (psInst->calRawVals[4] << 8) | psInst->calRawVals[5] );
-	calInst->ac4 = (uint16_t)( (psInst->calRawVals[6] << 8) | psInst->calRawVals[7] );
-	calInst->ac5 = (uint16_t)( (psInst->calRawVals[8] << 8) | psInst->calRawVals[9] );
-	calInst->ac6 = (uint16_t)( (psInst->calRawVals[10] << 8) | psInst->calRawVals[11] );
-	calInst->b1 =  (int16_t) ( (psInst->calRawVals[12] << 8) | psInst->calRawVals[13] );
-	calInst->b2 =  (int16_t) ( (psInst->calRawVals[14] << 8) | psInst->calRawVals[15] );
-	calInst->mb =  (int16_t) ( (psInst->calRawVals[16] << 8) | psInst->calRawVals[17] );
-	calInst->mc =  (int16_t) ( (psInst->calRawVals[18] << 8) | psInst->calRawVals[19] );
-	calInst->md =  (int16_t) ( (psInst->calRawVals[20] << 8) | psInst->calRawVals[21] );
-	
+	return false;
 }
 
+static float BMP180CalcTemp(int32_t B5){
+#ifdef BMP180_DIV_FREE
+	return ((float)B5 + 8.0f) * 0.00625f;		// 1/16 * 1/10, may differ from the divide in the last bit
+#else
+	return ( ((float)B5 + 8.0f)/16.0f )/10.0f;	// Divide by 10 because temp is in 0.1C, see datasheet
+#endif
+}
 
-void BMP180GetRawTemp(tBMP180 *psInst){
-	// Configure to write, send control register
-	ROM_I2CMasterSlaveAddrSet(I2C3_BASE, BMP180_I2C_ADDRESS, false);
-	ROM_I2CMasterDataPut(I2C3_BASE, BMP180_REG_CONTROL);
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_SEND_START);
+// Pressure terms that depend only on temperature. Split from BMP180CalcPressure so they can be
+// reused across pressure readings that share a B5
+static void BMP180CalcPresTerms(int32_t B5, const tBMP180Cals *calInst, tBMP180PresTerms *psTerms){
+	// Calculate B6
+	int32_t B6 = B5 - 4000;
 
-	// Wait for bus to free
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
+	// Calculate X1
+	int32_t X1 = ((int32_t)calInst->b2 * ((B6 * B6) / 4096)) / 2048;
 
-	// Send temperature command
-	ROM_I2CMasterDataPut(I2C3_BASE, BMP180_READ_TEMP);
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_SEND_FINISH);
+	// Calculate X2
+	int32_t X2 = (int32_t)calInst->ac2 * B6 / 2048;
 
-	// Wait for bus to free
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
+	// Calculate X3
+	int32_t X3 = X1 + X2;
 
-	// Delay for 4.5 ms
-	ROM_SysCtlDelay(ROM_SysCtlClockGet()/3/222);
+	// B3 before the oversampling shift
+	psTerms->B3Base = (int32_t)calInst->ac1*4 + X3;
 
-	// Configure to write, send tempdata register
-	ROM_I2CMasterSlaveAddrSet(I2C3_BASE, BMP180_I2C_ADDRESS, false);
-	ROM_I2CMasterDataPut(I2C3_BASE, BMP180_REG_TEMPDATA);
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_SEND_START);
+	// Recalculate X1
+	X1 = (int32_t)calInst->ac3 * B6 / 8192;
 
-	// Wait for bus to free
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
+	// Recalculate X2
+	X2 = ((int32_t)calInst->b1 * ((B6*B6) / 4096)) / 65536;
 
-	// Send restart
-	ROM_I2CMasterSlaveAddrSet(I2C3_BASE, BMP180_I2C_ADDRESS, true);
+	// Recalculate X3
+	X3 = ((X1 + X2) + 2) / 4;
 
-	// Read MSB
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_START);
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
-	psInst->tempRawVals[0] = ROM_I2CMasterDataGet(I2C3_BASE);
+	// Calculate B4
+	psTerms->B4 = (uint32_t)calInst->ac4 * (uint32_t)(X3 + 32768) / 32768;
 
-	// Read LSB
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_FINISH);
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
-	psInst->tempRawVals[1] = ROM_I2CMasterDataGet(I2C3_BASE);
-	
+#ifdef BMP180_DIV_FREE
+	// Rounded down so the quotient estimate in BMP180DivB4 is never too large
+	psTerms->B4Recip = psTerms->B4 ? 0xFFFFFFFF / psTerms->B4 : 0;
+#endif
 }
 
-void BMP180GetTemp(tBMP180 *psInst, tBMP180Cals *calInst){
-	// Get raw temperature
-	BMP180GetRawTemp(psInst);
+#ifdef BMP180_DIV_FREE
+// n / B4 using the precomputed reciprocal. The estimate is at most two short of the true
+// quotient, the remainder check corrects it
+static uint32_t BMP180DivB4(uint32_t n, const tBMP180PresTerms *psTerms){
+	uint32_t q, r;
 
-	// Calculate UT
-	int32_t UT = (int32_t)((psInst->tempRawVals[0]<<8) + psInst->tempRawVals[1]);
+	// Matches the Cortex-M4 UDIV result for a zero divisor
+	if(psTerms->B4 == 0){
+		return 0;
+	}
 
-	// Calculate X1
-	int32_t X1 = (UT - (int32_t)calInst->ac6) * ((int32_t)calInst->ac5) / 32768;
+	q = (uint32_t)(((uint64_t)n * psTerms->B4Recip) >> 32);
+	r = n - q*psTerms->B4;
+	while(r >= psTerms->B4){
+		q++;
+		r -= psTerms->B4;
+	}
+	return q;
+}
+#endif
 
-	// Calculate X2
-	int32_t X2 = ((int32_t)calInst->mc * 2048) / (X1 + (int32_t)calInst->md);
+// Pressure from UP once the temperature terms are known
+static int32_t BMP180CalcPresFinal(int32_t UP, const tBMP180PresTerms *psTerms, uint8_t oss){
+	// Calculate B3
+	int32_t B3 = ( (psTerms->B3Base << oss) + 2 ) / 4;
 
-	// Calculate B5
-	int32_t B5 = X1 + X2;
+	// Calculate B7
+	uint32_t B7 = ((uint32_t)UP - B3)*(50000 >> oss);
+
+	// Calculate p
+	int32_t p;
+#ifdef BMP180_DIV_FREE
+	if (B7 < 0x80000000){
+		p = BMP180DivB4(B7 * 2, psTerms);
+	} else{
+		p = BMP180DivB4(B7, psTerms) * 2;
+	}
+#else
+	if (B7 < 0x80000000){
+		p = (B7 * 2) / psTerms->B4;
+	} else{
+		p = (B7 / psTerms->B4) * 2;
+	}
+#endif
+
+	// Recalculate X1
+	int32_t X1 = (p / 256) * (p / 256);
+	X1 = (X1 * 3038) / 65536;
+
+	// Recalculate X2
+	int32_t X2 = (-7357 * p) / 65536;
+
+	// Recalculate p
+	return p + (X1 + X2 + 3791) / 16;
+}
+
+static int32_t BMP180CalcPressure(tBMP180 *psInst, int32_t UP, uint8_t oss, const tBMP180Cals *calInst){
+#ifdef BMP180_DIV_FREE
+	// Terms were cached when B5 was refreshed
+	return BMP180CalcPresFinal(UP, &psInst->terms, oss);
+#else
+	tBMP180PresTerms sTerms;
+
+	BMP180CalcPresTerms(psInst->B5, calInst, &sTerms);
+	return BMP180CalcPresFinal(UP, &sTerms, oss);
+#endif
+}
+
+
+static void BMP180TempRefreshed(tBMP180 *psInst, int32_t UT, tBMP180Cals *calInst){
+	psInst->B5 = BMP180CalcB5(UT, calInst);
+#ifdef BMP180_DIV_FREE
+	BMP180CalcPresTerms(psInst->B5, calInst, &psInst->terms);
+#endif
+	psInst->B5Valid = true;
+	psInst->cacheCount = 0;
+}
+
+
+
+// Functions -----------------------------------------------------------------------------------------
+
+// psBus must already be initialized with I2CLibBusInit
+void BMP180Initialize(tBMP180 *psInst, tI2CBus *psBus, uint8_t oss){
+	I2CLibDevInit(&psInst->dev, psBus, BMP180_I2C_ADDRESS);
+	if(oss > 3){
+		oss = 3;	
+	}
+	psInst->oversamplingSetting = oss;
+	psInst->state = BMP180_STATE_IDLE;
+	psInst->B5 = 0;
+	psInst->B5Valid = false;
+	psInst->chainPres = false;
+
+	// Refresh temperature before every pressure reading unless BMP180SetTempCache says otherwise
+	psInst->cacheSamples = 0;
+	psInst->cacheMs = 0;
+	psInst->cacheCount = 0;
+	psInst->tempStamp = 0;
+}
+
+
+// Read the calibration block. calInst is left unchanged if the read fails or a word is 0x0000 or
+// 0xFFFF, which the datasheet rules out for a working part
+uint8_t BMP180GetCalVals(tBMP180 *psInst, tBMP180Cals *calInst){
+	uint8_t calData[BMP180_CAL_LEN];
+	uint16_t word;
+	uint8_t reg;
+
+	// AC1..MD are consecutive, so fetch all of them in one auto-incrementing burst
+	if(I2CLibDevReadRegs(&psInst->dev, BMP180_REG_CAL_AC1, calData, BMP180_CAL_LEN) != I2C_STATUS_DONE){
+		return BMP180_STATUS_BUS_ERROR;
+	}
+
+	for(reg = BMP180_REG_CAL_AC1; reg <= BMP180_REG_CAL_MD; reg += 2){
+		word = BMP180_CAL_WORD(calData, reg);
+		if(word == 0x0000 || word == 0xFFFF){
+			return BMP180_STATUS_CAL_ERROR;
+		}
+	}
+
+	calInst->ac1 = (int16_t) BMP180_CAL_WORD(calData, BMP180_REG_CAL_AC1);
+	calInst->ac2 = (int16_t) BMP180_CAL_WORD(calData, BMP180_REG_CAL_AC2);
+	calInst->ac3 = (int16_t) BMP180_CAL_WORD(calData, BMP180_REG_CAL_AC3);
+	calInst->ac4 = (uint16_t)BMP180_CAL_WORD(calData, BMP180_REG_CAL_AC4);
+	calInst->ac5 = (uint16_t)BMP180_CAL_WORD(calData, BMP180_REG_CAL_AC5);
+	calInst->ac6 = (uint16_t)BMP180_CAL_WORD(calData, BMP180_REG_CAL_AC6);
+	calInst->b1 =  (int16_t) BMP180_CAL_WORD(calData, BMP180_REG_CAL_B1);
+	calInst->b2 =  (int16_t) BMP180_CAL_WORD(calData, BMP180_REG_CAL_B2);
+	calInst->mb =  (int16_t) BMP180_CAL_WORD(calData, BMP180_REG_CAL_MB);
+	calInst->mc =  (int16_t) BMP180_CAL_WORD(calData, BMP180_REG_CAL_MC);
+	calInst->md =  (int16_t) BMP180_CAL_WORD(calData, BMP180_REG_CAL_MD);
+
+	return BMP180_STATUS_OK;
+}
+
+
+// Raw temperature into psInst->rxData, unchanged on failure
+uint8_t BMP180GetRawTemp(tBMP180 *psInst){
+	uint8_t command = BMP180_READ_TEMP;
+	uint8_t tempData[2];
 
-	psInst->temp = ( ((float)B5 + 8.0f)/16.0f )/10.0f;	// Divide by 10 because temp is in 0.1C, see datasheet
+	// Write temperature command to control register
+	if(I2CLibDevWriteRegs(&psInst->dev, BMP180_REG_CONTROL, &command, 1) != I2C_STATUS_DONE){
+		return BMP180_STATUS_BUS_ERROR;
+	}
+
+	// Delay for 4.5 ms
+	ROM_SysCtlDelay(ROM_SysCtlClockGet()/3/222);
+
+	// Read MSB and LSB
+	if(I2CLibDevReadRegs(&psInst->dev, BMP180_REG_TEMPDATA, tempData, 2) != I2C_STATUS_DONE){
+		return BMP180_STATUS_BUS_ERROR;
+	}
+	psInst->rxData[0] = tempData[0];
+	psInst->rxData[1] = tempData[1];
 
+	return BMP180_STATUS_OK;
 }
 
+// Read and convert temperature. B5 and the result are left unchanged on failure
+uint8_t BMP180GetTemp(tBMP180 *psInst, tBMP180Cals *calInst){
+	// Get raw temperature
+	if(BMP180GetRawTemp(psInst) != BMP180_STATUS_OK){
+		return BMP180_STATUS_BUS_ERROR;
+	}
+
+	// Calculate UT
+	int32_t UT = (int32_t)((psInst->rxData[0]<<8) + psInst->rxData[1]);
 
-void BMP180GetRawPressure(tBMP180 *psInst, int oss){
-	// Configure to write, send control register
-	ROM_I2CMasterSlaveAddrSet(I2C3_BASE, BMP180_I2C_ADDRESS, false);
-	ROM_I2CMasterDataPut(I2C3_BASE, BMP180_REG_CONTROL);
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_SEND_START);
+	BMP180TempRefreshed(psInst, UT, calInst);
+	psInst->temp = BMP180CalcTemp(psInst->B5);
 
-	// Wait for bus to free
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
+	return BMP180_STATUS_OK;
+}
 
-	// Send pressure command
-	ROM_I2CMasterDataPut(I2C3_BASE, BMP180_READ_PRES_BASE + (oss << 6));
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_SEND_FINISH);
 
-	// Wait for bus to free
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
+// Raw pressure into psInst->rxData, unchanged on failure
+uint8_t BMP180GetRawPressure(tBMP180 *psInst, int oss){
+	uint8_t command = BMP180_READ_PRES_BASE + (oss << 6);
+	uint8_t presData[3];
+
+	// Write pressure command to control register
+	if(I2CLibDevWriteRegs(&psInst->dev, BMP180_REG_CONTROL, &command, 1) != I2C_STATUS_DONE){
+		return BMP180_STATUS_BUS_ERROR;
+	}
 
 	// Delay based on oversampling setting
 	switch(oss){
@@ -183,7 +417,7 @@ void BMP180GetRawPressure(tBMP180 *psInst, int oss){
 			break;
 		case 2:
 			// High resolution - 13.5 ms
-			ROM_SysCtlDelay(ROM_SysCtlClockGet()/3/76);
+			ROM_SysCtlDelay(ROM_SysCtlClockGet()/3/74);
 			break;
 		case 3:
 			// Ultra high resolution - 25.5 ms
@@ -193,102 +427,227 @@ void BMP180GetRawPressure(tBMP180 *psInst, int oss){
 			break;
 	}
 
-	// Configure to write, send presdata register
-	ROM_I2CMasterSlaveAddrSet(I2C3_BASE, BMP180_I2C_ADDRESS, false);
-	ROM_I2CMasterDataPut(I2C3_BASE, BMP180_REG_PRESSUREDATA);
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_SEND_START);
+	// Read MSB, LSB and XLSB
+	if(I2CLibDevReadRegs(&psInst->dev, BMP180_REG_PRESSUREDATA, presData, 3) != I2C_STATUS_DONE){
+		return BMP180_STATUS_BUS_ERROR;
+	}
+	psInst->rxData[0] = presData[0];
+	psInst->rxData[1] = presData[1];
+	psInst->rxData[2] = presData[2];
 
-	// Wait for bus to free
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
+	return BMP180_STATUS_OK;
+}
 
-	// Send restart
-	ROM_I2CMasterSlaveAddrSet(I2C3_BASE, BMP180_I2C_ADDRESS, true);
 
-	// Read MSB
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_START);
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
-	psInst->presRawVals[0] = ROM_I2CMasterDataGet(I2C3_BASE);
+// Read and convert pressure, refreshing temperature first if needed. The pressure is left
+// unchanged on failure; a failed temperature refresh also leaves B5 and the temperature alone
+uint8_t BMP180GetPressure(tBMP180 *psInst, tBMP180Cals *calInst){
+	// Refresh temperature compensation unless the cached B5 may still be used
+	if(BMP180TempStale(psInst, 0, false) && BMP180GetTemp(psInst, calInst) != BMP180_STATUS_OK){
+		return BMP180_STATUS_BUS_ERROR;
+	}
 
-	// Read LSB
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_CONT);
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
-	psInst->presRawVals[1] = ROM_I2CMasterDataGet(I2C3_BASE);
+	// Get raw pressure
+	if(BMP180GetRawPressure(psInst, psInst->oversamplingSetting) != BMP180_STATUS_OK){
+		return BMP180_STATUS_BUS_ERROR;
+	}
 
-	// Read XLSB
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_FINISH);
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
-	psInst->presRawVals[2] = ROM_I2CMasterDataGet(I2C3_BASE);
+	// Calculate UP
+	int32_t UP = ( ((int32_t)psInst->rxData[0] << 16) + ((int32_t)psInst->rxData[1] << 8) + (int32_t)psInst->rxData[2]) >> (8 - psInst->oversamplingSetting);
+
+	// Store result
+	psInst->pressure = BMP180CalcPressure(psInst, UP, psInst->oversamplingSetting, calInst);
+	if(psInst->cacheCount < 255){
+		psInst->cacheCount++;
+	}
+
+	return BMP180_STATUS_OK;
 }
 
 
-void BMP180GetPressure(tBMP180 *psInst, tBMP180Cals *calInst){
-	// Get raw temp, pressure
-	BMP180GetRawTemp(psInst);
-	BMP180GetRawPressure(psInst, psInst->oversamplingSetting);
-	
-	// Calculate UT
-	int32_t UT = (int32_t)((psInst->tempRawVals[0]<<8) + psInst->tempRawVals[1]);
+// Reuse B5 for up to samples pressure readings or ms milliseconds, whichever comes first. Zero
+// disables a limit; both zero refreshes temperature before every reading. The blocking
+// BMP180GetPressure has no time base, so it only honours the sample limit
+void BMP180SetTempCache(tBMP180 *psInst, uint8_t samples, uint16_t ms){
+	psInst->cacheSamples = samples;
+	psInst->cacheMs = ms;
+}
 
-	// Calculate UP
-	int32_t UP = ( ((int32_t)psInst->presRawVals[0] << 16) + ((int32_t)psInst->presRawVals[1] << 8) + (int32_t)psInst->presRawVals[2]) >> (8 - psInst->oversamplingSetting);
 
-	// Calculate X1
-	int32_t X1 = (UT - (int32_t)calInst->ac6) * ((int32_t)calInst->ac5) / 32768;
+// Convert count logged (UT, UP) pairs taken at oversampling setting oss without touching the bus.
+// UP is the value after the >> (8 - oss) shift, as used in the datasheet. Results are identical
+// to BMP180GetPressure. temp receives the datasheet integer temperature in 0.1 C, rounded toward
+// zero, and may be 0. Temperature dependent terms are only recomputed when UT changes, so logs
+// that reuse a temperature reading for several pressure readings avoid most of the divisions
+void BMP180ConvertBatch(const tBMP180Cals *calInst, uint8_t oss, const uint16_t *UT, const uint32_t *UP, int32_t *pressure, int16_t *temp, uint32_t count){
+	uint32_t i;
+	int32_t lastUT = -1;
+	int32_t B5 = 0;
+	tBMP180PresTerms sTerms;
 
-	// Calculate X2
-	int32_t X2 = ((int32_t)calInst->mc * 2048) / (X1 + (int32_t)calInst->md);
+	if(oss > 3){
+		oss = 3;
+	}
 
-	// Calculate B5
-	int32_t B5 = X1 + X2;
+	for(i = 0; i < count; i++){
+		if((int32_t)UT[i] != lastUT){
+			lastUT = UT[i];
+			B5 = BMP180CalcB5(lastUT, calInst);
+			BMP180CalcPresTerms(B5, calInst, &sTerms);
+		}
+
+		pressure[i] = BMP180CalcPresFinal((int32_t)UP[i], &sTerms, oss);
+		if(temp){
+			temp[i] = (int16_t)((B5 + 8) / 16);
+		}
+	}
+}
 
-	// Calculate B6
-	int32_t B6 = B5 - 4000;
 
-	// Recalculate X1
-	X1 = ((int32_t)calInst->b2 * ((B6 * B6) / 4096)) / 2048;
+// Non-blocking API ----------------------------------------------------------------------------------
 
-	// Recalculate X2
-	X2 = (int32_t)calInst->ac2 * B6 / 2048;
+// Start a temperature conversion. Returns false if a conversion is already in progress
+bool BMP180StartTemp(tBMP180 *psInst){
+	if(psInst->state != BMP180_STATE_IDLE){
+		return false;
+	}
 
-	// Calculate X3
-	int32_t X3 = X1 + X2;
+	if(!I2CLibDevQueue(&psInst->dev, &psInst->trans, g_pui8TempCmd, 2, 0, 0)){
+		return false;
+	}
 
-	// Calculate B3
-	int32_t B3 = ( ( ((int32_t)calInst->ac1*4 + X3) << psInst->oversamplingSetting) + 2 ) / 4;
+	psInst->state = BMP180_STATE_TEMP_START;
+	return true;
+}
 
-	// Recalculate X1
-	X1 = (int32_t)calInst->ac3 * B6 / 8192;
+// Start a pressure conversion. Uses the B5 from the most recent temperature result
+bool BMP180StartPressure(tBMP180 *psInst, uint8_t oss){
+	if(psInst->state != BMP180_STATE_IDLE){
+		return false;
+	}
+	if(oss > 3){
+		oss = 3;
+	}
 
-	// Recalculate X2
-	X2 = ((int32_t)calInst->b1 * ((B6*B6) / 4096)) / 65536;
+	psInst->convOss = oss;
+	if(!I2CLibDevQueue(&psInst->dev, &psInst->trans, g_ppui8PresCmd[oss], 2, 0, 0)){
+		return false;
+	}
 
-	// Recalculate X3
-	X3 = ((X1 + X2) + 2) / 4;
+	psInst->state = BMP180_STATE_PRES_START;
+	return true;
+}
 
-	// Calculate B4
-	uint32_t B4 = (uint32_t)calInst->ac4 * (uint32_t)(X3 + 32768) / 32768;
+// Start a pressure sample, preceded by a temperature conversion if the cached B5 is stale.
+// BMP180Service reports BMP180_EVENT_TEMP first when the temperature was refreshed
+bool BMP180StartSample(tBMP180 *psInst, uint32_t now){
+	if(psInst->state != BMP180_STATE_IDLE || psInst->chainPres){
+		return false;
+	}
 
-	// Calculate B7
-	uint32_t B7 = ((uint32_t)UP - B3)*(50000 >> psInst->oversamplingSetting);
+	if(BMP180TempStale(psInst, now, true)){
+		if(!BMP180StartTemp(psInst)){
+			return false;
+		}
+		psInst->chainPres = true;
+		return true;
+	}
 
-	// Calculate p
-	int32_t p;
-	if (B7 < 0x80000000){
-		p = (B7 * 2) / B4;
-	} else{
-		p = (B7 / B4) * 2;
+	return BMP180StartPressure(psInst, psInst->oversamplingSetting);
+}
+
+// Advance a started conversion. now is a free running millisecond count supplied by the caller.
+// Never blocks. Returns BMP180_EVENT_TEMP or BMP180_EVENT_PRESSURE when psInst->temp or
+// psInst->pressure has just been updated
+uint8_t BMP180Service(tBMP180 *psInst, tBMP180Cals *calInst, uint32_t now){
+	uint8_t status = psInst->trans.status;
+	bool queued;
+
+	// Pressure half of BMP180StartSample that couldn't be queued straight after the temperature
+	if(psInst->state == BMP180_STATE_IDLE){
+		if(psInst->chainPres && BMP180StartPressure(psInst, psInst->oversamplingSetting)){
+			psInst->chainPres = false;
+		}
+		return BMP180_EVENT_NONE;
 	}
 
-	// Recalculate X1
-	X1 = (p / 256) * (p / 256);
-	X1 = (X1 * 3038) / 65536;
+	if(status == I2C_STATUS_PENDING){
+		return BMP180_EVENT_NONE;
+	}
+	if(status != I2C_STATUS_DONE){
+		psInst->state = BMP180_STATE_IDLE;
+		psInst->chainPres = false;
+		return BMP180_EVENT_ERROR;
+	}
 
-	// Recalculate X2
-	X2 = (-7357 * p) / 65536;
+	switch(psInst->state){
+		case BMP180_STATE_TEMP_START:
+		case BMP180_STATE_PRES_START:
+			// Command is on the sensor, conversion time counts from here
+			psInst->deadline = now + ((psInst->state == BMP180_STATE_TEMP_START) ? g_ui8TempWaitMs : g_pui8PresWaitMs[psInst->convOss]);
+			psInst->state++;
+			break;
 
-	// Recalculate p
-	p = p + (X1 + X2 + 3791) / 16;
+		case BMP180_STATE_TEMP_WAIT:
+		case BMP180_STATE_PRES_WAIT:
+			if((int32_t)(now - psInst->deadline) < 0){
+				break;
+			}
+
+			// Conversion finished, queue read of result. Retried on the next call if the queue is full
+			if(psInst->state == BMP180_STATE_TEMP_WAIT){
+				queued = I2CLibDevQueue(&psInst->dev, &psInst->trans, &g_ui8TempReg, 1, psInst->rxData, 2);
+			} else{
+				queued = I2CLibDevQueue(&psInst->dev, &psInst->trans, &g_ui8PresReg, 1, psInst->rxData, 3);
+			}
+			if(queued){
+				psInst->state++;
+			}
+			break;
 
-	// Store result
-	psInst->pressure = p;
-} 
+		case BMP180_STATE_TEMP_READ:
+			psInst->state = BMP180_STATE_IDLE;
+			BMP180TempRefreshed(psInst, (int32_t)((psInst->rxData[0] << 8) + psInst->rxData[1]), calInst);
+			psInst->tempStamp = now;
+			psInst->temp = BMP180CalcTemp(psInst->B5);
+
+			// Interleave the pressure conversion requested by BMP180StartSample
+			if(psInst->chainPres && BMP180StartPressure(psInst, psInst->oversamplingSetting)){
+				psInst->chainPres = false;
+			}
+			return BMP180_EVENT_TEMP;
+
+		case BMP180_STATE_PRES_READ:
+			psInst->state = BMP180_STATE_IDLE;
+			psInst->pressure = BMP180CalcPressure(psInst, (( ((int32_t)psInst->rxData[0] << 16) + ((int32_t)psInst->rxData[1] << 8) + (int32_t)psInst->rxData[2]) >> (8 - psInst->convOss)), psInst->convOss, calInst);
+			if(psInst->cacheCount < 255){
+				psInst->cacheCount++;
+			}
+			return BMP180_EVENT_PRESSURE;
+
+		default:
+			psInst->state = BMP180_STATE_IDLE;
+			break;
+	}
+
+	return BMP180_EVENT_NONE;
+}
+
+
+
+// Altitude ------------------------------------------------------------------------------------------
+
+// Altitude in m of the last pressure reading, for a sea level pressure in Pa (101325 for the
+// standard atmosphere). mode is BMP180_ALT_FAST or BMP180_ALT_FINE
+float BMP180GetAltitude(tBMP180 *psInst, float seaLevel, uint8_t mode){
+	float ratio = (float)psInst->pressure / seaLevel;
+
+	return 44330.0f * (1.0f - BMP180Interp(g_pfAltRatioPow, BMP180_ALT_RATIO_LEN, BMP180_ALT_RATIO_MIN, BMP180_ALT_RATIO_SCALE, ratio, mode));
+}
+
+// Sea level pressure in Pa for the last pressure reading taken at a known altitude in m
+float BMP180GetSeaLevel(tBMP180 *psInst, float altitude, uint8_t mode){
+	float x = 1.0f - altitude / 44330.0f;
+
+	return (float)psInst->pressure / BMP180Interp(g_pfAltHeightPow, BMP180_ALT_HEIGHT_LEN, BMP180_ALT_HEIGHT_MIN, BMP180_ALT_HEIGHT_SCALE, x, mode);
+}
@@ -14,10 +14,15 @@
 // 	Interface with Bosch BMP180
 //
 // Notes:
-//	
+//	Include i2cLib.h before this file
+//	BMP180Start*/BMP180Service and the blocking BMP180Get* functions must not be mixed while a
+//	non-blocking conversion is in progress
+//	The blocking BMP180Get* functions return a BMP180_STATUS_* and leave their results unchanged on
+//	failure. Check BMP180GetCalVals before converting anything, the formulas divide by
+//	calibration dependent terms
+//
 // Todo:
-//	Implement altitude
-//	Make more durable, timeouts, testing, etc.
+//	More testing
 //****************************************************************************************************
 
 
@@ -45,21 +50,91 @@
 #define BMP180_REG_TEMPDATA 0xF6
 #define BMP180_REG_PRESSUREDATA 0xF6
 
+// Define BMP180_DIV_FREE (see Makefile) to cache the temperature dependent pressure terms with B5
+// and replace the per-reading B7 / B4 division with a multiply by a reciprocal. Pressure results
+// are unchanged
+#ifdef BMP180_DIV_FREE
+#define BMP180_INST_BUDGET 84
+#else
+#define BMP180_INST_BUDGET 72
+#endif
+
+// Calibration block is 11 big-endian words starting at AC1
+#define BMP180_CAL_LEN 22
+#define BMP180_CAL_WORD(data, reg) ( ((uint16_t)(data)[(reg) - BMP180_REG_CAL_AC1] << 8) | (data)[(reg) - BMP180_REG_CAL_AC1 + 1] )
+
+
+
+// Non-blocking conversion states
+#define BMP180_STATE_IDLE 0
+#define BMP180_STATE_TEMP_START 1	// Temperature command queued
+#define BMP180_STATE_TEMP_WAIT 2	// Waiting for conversion time
+#define BMP180_STATE_TEMP_READ 3	// Result read queued
+#define BMP180_STATE_PRES_START 4
+#define BMP180_STATE_PRES_WAIT 5
+#define BMP180_STATE_PRES_READ 6
+
+// Altitude accuracy modes. Worst case error against the exact barometric formula between 300 and
+// 1100 hPa: about 2 m / 7 Pa sea level for FAST, about 0.1 m / 0.1 Pa for FINE
+#define BMP180_ALT_FAST 0		// Linear interpolation
+#define BMP180_ALT_FINE 1		// Quadratic interpolation
+
+// Values returned by the blocking BMP180Get* functions
+#define BMP180_STATUS_OK 0
+#define BMP180_STATUS_BUS_ERROR 1	// NACK, arbitration lost or timeout
+#define BMP180_STATUS_CAL_ERROR 2	// A calibration word read as 0x0000 or 0xFFFF
+
+// Values returned by BMP180Service
+#define BMP180_EVENT_NONE 0
+#define BMP180_EVENT_TEMP 1
+#define BMP180_EVENT_PRESSURE 2
+#define BMP180_EVENT_ERROR 3
+
 
 
 // Variables -----------------------------------------------------------------------------------------
 
+// Pressure compensation terms that only change with B5
 typedef struct
 {
-	uint8_t oversamplingSetting;
-	uint8_t calRegs[11];
-	uint32_t calRawVals[22];
-	uint32_t tempRawVals[2];
-	uint32_t presRawVals[3];
+	int32_t B3Base;		// B3 before the oversampling shift
+	uint32_t B4;
+#ifdef BMP180_DIV_FREE
+	uint32_t B4Recip;	// 0xFFFFFFFF / B4, rounded down
+#endif
+} tBMP180PresTerms;
 
+// Fields are grouped by alignment, words first, so the only padding is inside tI2CDevice. Checked
+// against BMP180_INST_BUDGET in bmpLib.c
+typedef struct
+{
 	int32_t pressure;
-
+	int32_t B5;		// Temperature compensation term from the last temperature reading
 	float temp;
+#ifdef BMP180_DIV_FREE
+	tBMP180PresTerms terms;	// Computed with B5
+#endif
+	uint32_t tempStamp;	// Time of last B5 refresh, non-blocking API only
+	uint32_t deadline;	// End of the conversion wait, non-blocking API only
+
+	tI2CDevice dev;		// Bus and slave address
+	tI2CTransaction trans;	// Non-blocking API only, commands come from flash tables
+
+	// Temperature compensation caching, see BMP180SetTempCache
+	uint16_t cacheMs;
+	uint8_t cacheSamples;
+	uint8_t cacheCount;	// Pressure readings since last B5 refresh
+
+	// Raw bytes of the last reading, MSB first. Two for temperature, three for pressure
+	uint8_t rxData[3];
+
+	// Non-blocking conversion state
+	uint8_t state;
+	uint8_t convOss;
+	bool chainPres;		// Pressure conversion follows the current temperature conversion
+
+	uint8_t oversamplingSetting;
+	bool B5Valid;
 } tBMP180;
 
 typedef struct
@@ -80,10 +155,18 @@ typedef struct
 
 
 // Function Prototypes -------------------------------------------------------------------------------
-extern void BMP180Initialize(tBMP180 *psInst, uint8_t oss);
-extern void BMP180GetCalVals(tBMP180 *psInst, tBMP180Cals *calInst);
-extern void BMP180GetRawTemp(tBMP180 *psInst);
-extern void BMP180GetTemp(tBMP180 *psInst, tBMP180Cals *calInst);
-extern void BMP180GetRawPressure(tBMP180 *psInst, int oss);
-extern void BMP180GetPressure(tBMP180 *psInst, tBMP180Cals *calInst);
+extern void BMP180Initialize(tBMP180 *psInst, tI2CBus *psBus, uint8_t oss);
+extern uint8_t BMP180GetCalVals(tBMP180 *psInst, tBMP180Cals *calInst);
+extern uint8_t BMP180GetRawTemp(tBMP180 *psInst);
+extern uint8_t BMP180GetTemp(tBMP180 *psInst, tBMP180Cals *calInst);
+extern uint8_t BMP180GetRawPressure(tBMP180 *psInst, int oss);
+extern uint8_t BMP180GetPressure(tBMP180 *psInst, tBMP180Cals *calInst);
+extern void BMP180SetTempCache(tBMP180 *psInst, uint8_t samples, uint16_t ms);
+extern void BMP180ConvertBatch(const tBMP180Cals *calInst, uint8_t oss, const uint16_t *UT, const uint32_t *UP, int32_t *pressure, int16_t *temp, uint32_t count);
+extern bool BMP180StartTemp(tBMP180 *psInst);
+extern bool BMP180StartPressure(tBMP180 *psInst, uint8_t oss);
+extern bool BMP180StartSample(tBMP180 *psInst, uint32_t now);
+extern uint8_t BMP180Service(tBMP180 *psInst, tBMP180Cals *calInst, uint32_t now);
+extern float BMP180GetAltitude(tBMP180 *psInst, float seaLevel, uint8_t mode);
+extern float BMP180GetSeaLevel(tBMP180 *psInst, float altitude, uint8_t mode);
 
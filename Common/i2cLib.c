@@ -0,0 +1,813 @@
+// i2cLib.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	Command sequencing follows the TivaWare I2C master examples
+//
+// Requirements:
+// 	Requires Texas Instruments' TivaWare.
+//
+// Description:
+// 	Interrupt driven transaction engine for the I2C3 master, and the register-map device layer
+//	the sensor drivers are written against
+//
+// Notes:
+//	See i2cLib.h
+//	The master interrupt fires once per byte. The handler issues the next command so the CPU only
+//	touches the bus between bytes instead of spinning on ROM_I2CMasterBusy
+//	The polling backend issues the same command sequence, spinning between bytes instead
+//	The TM4C123 I2C master has no FIFO or uDMA requests, so a byte per interrupt is the floor.
+//	Both paths access the master registers directly to keep the time spent per byte small
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "inc/hw_i2c.h"
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+
+#include "driverlib/i2c.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/rom.h"
+#include "driverlib/sysctl.h"
+
+#include "i2cLib.h"
+
+
+
+// Defines -------------------------------------------------------------------------------------------
+
+// Master register access for the per-byte path. These are the writes the ROM_I2CMaster* calls make,
+// without a ROM call and its argument checks for every byte
+#define I2C_ADDR_SET(base, addr, receive) (HWREG((base) + I2C_O_MSA) = ((addr) << 1) | ((receive) ? 1 : 0))
+#define I2C_CONTROL(base, command) (HWREG((base) + I2C_O_MCS) = (command))
+#define I2C_DATA_PUT(base, data) (HWREG((base) + I2C_O_MDR) = (data))
+#define I2C_DATA_GET(base) ((uint8_t)HWREG((base) + I2C_O_MDR))
+#define I2C_BUSY(base) (HWREG((base) + I2C_O_MCS) & I2C_MCS_BUSY)
+#define I2C_STATUS_REG(base) (HWREG((base) + I2C_O_MCS))
+#define I2C_INT_CLEAR(base) (HWREG((base) + I2C_O_MICR) = I2C_MICR_IC | I2C_MICR_CLKIC)
+
+// Bus clear timing, about 100 kHz
+#define I2C_CLEAR_CLOCKS 9		// Enough for a slave to finish any byte and its ACK
+#define I2C_CLEAR_HALF_US 5
+
+// Cortex-M4 debug cycle counter, used to time how long the bus is held
+#define I2C_DEMCR 0xE000EDFC
+#define I2C_DEMCR_TRCENA 0x01000000
+#define I2C_DWT_CTRL 0xE0001000
+#define I2C_DWT_CTRL_CYCCNTENA 0x00000001
+#define I2C_DWT_CYCCNT 0xE0001004
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+static tI2CTransaction *g_psQueue[I2C_QUEUE_SIZE];	// Ring buffer of waiting transactions
+static volatile uint8_t g_ui8QueueHead;			// Next transaction to start
+static volatile uint8_t g_ui8QueueTail;			// Next free slot
+static tI2CTransaction * volatile g_psActive;		// Transaction on the bus, 0 if idle
+static uint8_t g_ui8Index;				// Byte index within current phase
+static bool g_bReading;					// True once the restart has been sent
+static bool g_bBurst;					// True if current phase holds the bus
+static volatile uint32_t g_ui32TransCount;		// Transactions put on the bus since init
+static volatile uint32_t g_ui32BusyCycles;		// Cycles the interrupt engine has held the bus since init
+static uint32_t g_ui32BusyStart;			// Cycle count when the bus was last taken
+static volatile uint8_t g_ui8ActiveMs;			// Ticks the active transaction has been on the bus
+static volatile bool g_bTimedOut;			// Set by I2CLibTick, handled in the interrupt
+static tI2CBus *g_psIntBus;				// Bus using the interrupt backend, for recovery
+static volatile bool g_bStopping;			// Error stop on the bus, next start waits for its interrupt
+static volatile bool g_bRecoverPending;			// Bus clear left to I2CLibService, queue held until then
+
+// SCL rate of each I2C_SPEED_*, and the MTPR value for it at the current system clock
+static const uint32_t g_pui32SpeedHz[I2C_SPEED_COUNT] = {0, 100000, 400000};
+static uint32_t g_pui32SpeedTpr[I2C_SPEED_COUNT];
+
+// Master peripherals indexed by (base - I2C0_BASE) >> 12
+static const uint32_t g_pui32I2CPeriph[4] = {SYSCTL_PERIPH_I2C0, SYSCTL_PERIPH_I2C1, SYSCTL_PERIPH_I2C2, SYSCTL_PERIPH_I2C3};
+
+
+
+// "Private" Functions ------------------------------------------------------------------------------
+
+// Fill in the MTPR values for each speed, same formula as I2CMasterInitExpClk
+static void I2CLibSpeedInit(void){
+	uint32_t clock = ROM_SysCtlClockGet();
+	uint8_t i;
+
+	for(i = I2C_SPEED_STD; i < I2C_SPEED_COUNT; i++){
+		g_pui32SpeedTpr[i] = ((clock + 2 * 10 * g_pui32SpeedHz[i] - 1) / (2 * 10 * g_pui32SpeedHz[i])) - 1;
+	}
+}
+
+// Set the master to the transaction's device speed. Only called between transactions
+static void I2CLibRetime(uint32_t base, tI2CTransaction *psTrans){
+	uint32_t tpr;
+
+	if(psTrans->dev == 0 || psTrans->dev->speed == I2C_SPEED_KEEP){
+		return;
+	}
+
+	tpr = g_pui32SpeedTpr[psTrans->dev->speed];
+	if(HWREG(base + I2C_O_MTPR) != tpr){
+		HWREG(base + I2C_O_MTPR) = tpr;
+	}
+}
+
+// Drop a device to the next slower speed once it keeps failing on the bus, or keeps returning bad
+// data. Runs in the interrupt for the interrupt backend, so main loop callers must mask interrupts
+// around it
+static void I2CLibDevFailed(tI2CDevice *psDev, bool bData){
+	uint8_t *pui8Streak = bData ? &psDev->faultStreak : &psDev->failStreak;
+
+	if(++*pui8Streak < I2C_FALLBACK_ERRORS){
+		return;
+	}
+
+	psDev->failStreak = 0;
+	psDev->faultStreak = 0;
+	if(psDev->speed > I2C_SPEED_STD){
+		psDev->speed--;
+	}
+}
+
+// Update the counters of the device a finished transaction belongs to
+static void I2CLibDevAccount(tI2CTransaction *psTrans, uint8_t status){
+	tI2CDevice *psDev = psTrans->dev;
+
+	if(psDev == 0){
+		return;
+	}
+
+	switch(status){
+		case I2C_STATUS_DONE:
+			psDev->bytes += psTrans->txLen + psTrans->rxLen;
+			psDev->failStreak = 0;
+			return;
+		case I2C_STATUS_ERROR:
+			psDev->nacks++;
+			break;
+		case I2C_STATUS_ARB_LOST:
+			psDev->arbLost++;
+			break;
+		case I2C_STATUS_TIMEOUT:
+			psDev->timeouts++;
+			break;
+		default:
+			return;
+	}
+	I2CLibDevFailed(psDev, false);
+}
+
+// Send restart and begin reading
+static void I2CLibStartRead(tI2CTransaction *psTrans){
+	g_bReading = true;
+	g_ui8Index = 0;
+
+	I2C_ADDR_SET(I2C3_BASE, psTrans->addr, true);
+	if(psTrans->rxLen == 1){
+		g_bBurst = false;
+		I2C_CONTROL(I2C3_BASE, I2C_MASTER_CMD_SINGLE_RECEIVE);
+	} else{
+		g_bBurst = true;
+		I2C_CONTROL(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_START);
+	}
+}
+
+// The bus has been released, by a stop or by giving up on it
+static void I2CLibBusyEnd(void){
+	g_ui32BusyCycles += HWREG(I2C_DWT_CYCCNT) - g_ui32BusyStart;
+}
+
+// Put a transaction on the bus. Called with the I2C3 interrupt masked or from the handler
+static void I2CLibStart(tI2CTransaction *psTrans){
+	I2CLibRetime(I2C3_BASE, psTrans);
+	g_ui8ActiveMs = 0;
+	g_psActive = psTrans;
+	g_ui8Index = 0;
+	g_ui32TransCount++;
+	g_ui32BusyStart = HWREG(I2C_DWT_CYCCNT);
+
+	if(psTrans->txLen == 0){
+		I2CLibStartRead(psTrans);
+		return;
+	}
+
+	// Configure to write, buffer first byte
+	g_bReading = false;
+	I2C_ADDR_SET(I2C3_BASE, psTrans->addr, false);
+	I2C_DATA_PUT(I2C3_BASE, psTrans->txBuf[0]);
+
+	// Single byte writes with nothing to read can release the bus straight away
+	if(psTrans->txLen == 1 && psTrans->rxLen == 0){
+		g_bBurst = false;
+		I2C_CONTROL(I2C3_BASE, I2C_MASTER_CMD_SINGLE_SEND);
+	} else{
+		g_bBurst = true;
+		I2C_CONTROL(I2C3_BASE, I2C_MASTER_CMD_BURST_SEND_START);
+	}
+}
+
+// Start the next queued transaction unless the bus isn't ready for one yet
+static void I2CLibNext(void){
+	if(g_bStopping || g_bRecoverPending){
+		return;
+	}
+	if(g_ui8QueueHead != g_ui8QueueTail){
+		I2CLibStart(g_psQueue[g_ui8QueueHead]);
+		g_ui8QueueHead = (g_ui8QueueHead + 1) % I2C_QUEUE_SIZE;
+	}
+}
+
+// Retire the active transaction and start the next one
+static void I2CLibFinish(uint8_t status){
+	tI2CTransaction *psTrans = g_psActive;
+
+	// Counted first so a speed fallback applies to the next transaction
+	I2CLibDevAccount(psTrans, status);
+
+	// An error stop still holds the bus, its time ends with the stop's interrupt
+	if(!g_bStopping){
+		I2CLibBusyEnd();
+	}
+
+	g_psActive = 0;
+	I2CLibNext();
+
+	// Status is set last so a waiting caller can reuse the descriptor immediately
+	psTrans->status = status;
+	if(psTrans->callback){
+		psTrans->callback(psTrans);
+	}
+}
+
+
+
+// Reset a master that may be stuck mid-transaction. Clock rate and interrupt setup are kept
+static void I2CLibMasterReset(uint32_t base){
+	uint32_t tpr = HWREG(base + I2C_O_MTPR);
+	uint32_t imr = HWREG(base + I2C_O_MIMR);
+	uint32_t clkocnt = HWREG(base + I2C_O_MCLKOCNT);
+
+	ROM_SysCtlPeripheralReset(g_pui32I2CPeriph[(base - I2C0_BASE) >> 12]);
+	ROM_I2CMasterEnable(base);
+	HWREG(base + I2C_O_MTPR) = tpr;
+	HWREG(base + I2C_O_MCLKOCNT) = clkocnt;
+	HWREG(base + I2C_O_MIMR) = imr;
+}
+
+static void I2CLibClearDelay(void){
+	ROM_SysCtlDelay(ROM_SysCtlClockGet() / 3 / (1000000 / I2C_CLEAR_HALF_US));
+}
+
+
+
+// Bus recovery --------------------------------------------------------------------------------------
+
+// Give I2CLibBusRecover the pins the master uses, e.g. GPIO_PORTD_BASE, GPIO_PIN_0, GPIO_PIN_1,
+// GPIO_PD0_I2C3SCL, GPIO_PD1_I2C3SDA for I2C3 on the SensorHub BoosterPack
+void I2CLibBusPinsSet(tI2CBus *psBus, uint32_t gpioBase, uint8_t sclPin, uint8_t sdaPin, uint32_t sclConfig, uint32_t sdaConfig){
+	psBus->gpioBase = gpioBase;
+	psBus->sclPin = sclPin;
+	psBus->sdaPin = sdaPin;
+	psBus->sclConfig = sclConfig;
+	psBus->sdaConfig = sdaConfig;
+}
+
+// Free a bus whose slave is holding SDA low by clocking SCL by hand until it lets go, then send a
+// stop and reset the master. Without pins only the master is reset. Returns true if SDA is free
+bool I2CLibBusRecover(tI2CBus *psBus){
+	uint32_t gpio = psBus->gpioBase;
+	uint8_t scl = psBus->sclPin;
+	uint8_t sda = psBus->sdaPin;
+	uint8_t i;
+	bool released;
+
+	if(gpio == 0){
+		I2CLibMasterReset(psBus->base);
+		return false;
+	}
+	psBus->recoveries++;
+
+	// Take the pins from the master. SCL is driven open drain, SDA only watched
+	ROM_GPIOPinWrite(gpio, scl, scl);
+	ROM_GPIOPinTypeGPIOOutputOD(gpio, scl);
+	ROM_GPIOPinTypeGPIOInput(gpio, sda);
+	I2CLibClearDelay();
+
+	for(i = 0; i < I2C_CLEAR_CLOCKS && !ROM_GPIOPinRead(gpio, sda); i++){
+		ROM_GPIOPinWrite(gpio, scl, 0);
+		I2CLibClearDelay();
+		ROM_GPIOPinWrite(gpio, scl, scl);
+		I2CLibClearDelay();
+	}
+	released = (ROM_GPIOPinRead(gpio, sda) != 0);
+
+	// Stop condition, SDA rising while SCL is high
+	ROM_GPIOPinWrite(gpio, scl, 0);
+	ROM_GPIOPinWrite(gpio, sda, 0);
+	ROM_GPIOPinTypeGPIOOutputOD(gpio, sda);
+	I2CLibClearDelay();
+	ROM_GPIOPinWrite(gpio, scl, scl);
+	I2CLibClearDelay();
+	ROM_GPIOPinWrite(gpio, sda, sda);
+	I2CLibClearDelay();
+
+	// Hand the pins back
+	ROM_GPIOPinConfigure(psBus->sclConfig);
+	ROM_GPIOPinConfigure(psBus->sdaConfig);
+	ROM_GPIOPinTypeI2CSCL(gpio, scl);
+	ROM_GPIOPinTypeI2C(gpio, sda);
+
+	I2CLibMasterReset(psBus->base);
+	return released;
+}
+
+
+
+// "Public" Functions -------------------------------------------------------------------------------
+
+// Must be called after the I2C3 master has been configured
+void I2CLibInit(void){
+	g_ui8QueueHead = 0;
+	g_ui8QueueTail = 0;
+	g_psActive = 0;
+	g_ui32TransCount = 0;
+	g_ui32BusyCycles = 0;
+	g_bTimedOut = false;
+	g_psIntBus = 0;
+	g_bStopping = false;
+	g_bRecoverPending = false;
+	I2CLibSpeedInit();
+
+	// Bus time is measured in system clock cycles
+	HWREG(I2C_DEMCR) |= I2C_DEMCR_TRCENA;
+	HWREG(I2C_DWT_CTRL) |= I2C_DWT_CTRL_CYCCNTENA;
+
+	// Interrupt on each byte and on SCL held low too long
+	HWREG(I2C3_BASE + I2C_O_MCLKOCNT) = I2C_CLOCK_TIMEOUT;
+	I2C_INT_CLEAR(I2C3_BASE);
+	ROM_I2CMasterIntEnableEx(I2C3_BASE, I2C_MASTER_INT_DATA | I2C_MASTER_INT_TIMEOUT);
+	ROM_IntEnable(INT_I2C3);
+}
+
+void I2CLibTransactionSet(tI2CTransaction *psTrans, uint8_t addr, const uint8_t *txBuf, uint8_t txLen, uint8_t *rxBuf, uint8_t rxLen, tI2CCallback callback){
+	psTrans->dev = 0;
+	psTrans->addr = addr;
+	psTrans->txBuf = txBuf;
+	psTrans->txLen = txLen;
+	psTrans->rxBuf = rxBuf;
+	psTrans->rxLen = rxLen;
+	psTrans->callback = callback;
+	psTrans->status = I2C_STATUS_IDLE;
+}
+
+// Returns false if the queue is full or the transaction is empty. Safe to call from a callback
+bool I2CLibQueue(tI2CTransaction *psTrans){
+	uint8_t next;
+
+	if(psTrans->txLen == 0 && psTrans->rxLen == 0){
+		return false;
+	}
+
+	ROM_IntDisable(INT_I2C3);
+
+	next = (g_ui8QueueTail + 1) % I2C_QUEUE_SIZE;
+	if(next == g_ui8QueueHead){
+		ROM_IntEnable(INT_I2C3);
+		return false;
+	}
+
+	psTrans->status = I2C_STATUS_PENDING;
+	if(g_psActive == 0 && !g_bStopping && !g_bRecoverPending){
+		I2CLibStart(psTrans);
+	} else{
+		g_psQueue[g_ui8QueueTail] = psTrans;
+		g_ui8QueueTail = next;
+	}
+
+	ROM_IntEnable(INT_I2C3);
+	return true;
+}
+
+// Block until a queued transaction finishes. Sleeps between interrupts instead of polling the bus.
+// Must not be called from an interrupt
+uint8_t I2CLibWait(tI2CTransaction *psTrans){
+	// Interrupts are masked around the check so a completion can't slip in before the sleep.
+	// A pending interrupt still wakes the core from WFI while masked.
+	ROM_IntMasterDisable();
+	while(psTrans->status == I2C_STATUS_PENDING){
+		if(g_bRecoverPending){
+			// The queue is held for a bus clear, which only happens here or in I2CLibService
+			ROM_IntMasterEnable();
+			I2CLibService();
+			ROM_IntMasterDisable();
+			continue;
+		}
+		ROM_SysCtlSleep();
+		ROM_IntMasterEnable();
+		ROM_IntMasterDisable();
+	}
+	ROM_IntMasterEnable();
+
+	return psTrans->status;
+}
+
+// Queue a transaction and wait for it
+uint8_t I2CLibTransfer(uint8_t addr, const uint8_t *txBuf, uint8_t txLen, uint8_t *rxBuf, uint8_t rxLen){
+	tI2CTransaction sTrans;
+
+	if(txLen == 0 && rxLen == 0){
+		return I2C_STATUS_ERROR;
+	}
+
+	// A full queue drains from the interrupt, so retrying always makes progress
+	I2CLibTransactionSet(&sTrans, addr, txBuf, txLen, rxBuf, rxLen, 0);
+	while(!I2CLibQueue(&sTrans)){}
+
+	return I2CLibWait(&sTrans);
+}
+
+// Read len consecutive registers starting at reg in a single transaction
+uint8_t I2CLibReadRegs(uint8_t addr, uint8_t reg, uint8_t *data, uint8_t len){
+	return I2CLibTransfer(addr, &reg, 1, data, len);
+}
+
+bool I2CLibIdle(void){
+	return (g_psActive == 0);
+}
+
+// Call from the main loop. Clears the bus after the interrupt engine gave up on a transaction, then
+// restarts the queue. Clearing takes about 100 us of delays, so it is kept out of the interrupt
+void I2CLibService(void){
+	if(!g_bRecoverPending){
+		return;
+	}
+
+	I2CLibBusRecover(g_psIntBus);
+
+	ROM_IntDisable(INT_I2C3);
+	g_bRecoverPending = false;
+	if(g_psActive == 0){
+		I2CLibNext();
+	}
+	ROM_IntEnable(INT_I2C3);
+}
+
+// Number of START conditions issued, used to compare bus traffic between drivers
+uint32_t I2CLibTransactionCount(void){
+	return g_ui32TransCount;
+}
+
+// System clock cycles the interrupt engine has held the bus since init, including error stops.
+// Wraps after 2^32 cycles, so take the difference of two readings less than that far apart
+uint32_t I2CLibBusyCycles(void){
+	return g_ui32BusyCycles;
+}
+
+// Call every 1 ms, usually from the SysTick handler. Abandons a transaction, or an error stop, that
+// has been on the bus for I2C_TIMEOUT_MS. The abort itself runs in the I2C3 interrupt
+void I2CLibTick(void){
+	if((g_psActive == 0 && !g_bStopping) || g_bTimedOut){
+		return;
+	}
+	if(++g_ui8ActiveMs >= I2C_TIMEOUT_MS){
+		g_bTimedOut = true;
+		ROM_IntPendSet(INT_I2C3);
+	}
+}
+
+// I2C3 master interrupt, one per byte
+void I2CLibIntHandler(void){
+	tI2CTransaction *psTrans = g_psActive;
+	uint32_t mcs;
+	uint8_t status;
+
+	I2C_INT_CLEAR(I2C3_BASE);
+
+	// Error stop finished (or timed out), the bus is free for the next transaction
+	if(g_bStopping){
+		g_bStopping = false;
+		g_bTimedOut = false;
+		I2CLibBusyEnd();
+		if(g_psActive == 0){
+			I2CLibNext();
+		}
+		return;
+	}
+
+	if(psTrans == 0){
+		g_bTimedOut = false;
+		return;
+	}
+
+	// Abandon a stuck bus. The master is reset here, clearing the bus waits for I2CLibService
+	mcs = I2C_STATUS_REG(I2C3_BASE);
+	if(g_bTimedOut || (mcs & (I2C_MCS_CLKTO | I2C_MCS_ARBLST))){
+		status = (g_bTimedOut || (mcs & I2C_MCS_CLKTO)) ? I2C_STATUS_TIMEOUT : I2C_STATUS_ARB_LOST;
+		g_bTimedOut = false;
+		I2CLibMasterReset(I2C3_BASE);
+		if(g_psIntBus && g_psIntBus->gpioBase){
+			g_bRecoverPending = true;
+		}
+		I2CLibFinish(status);
+		return;
+	}
+
+	// Abandon on NACK. A burst still holds the bus and needs a stop, and the next transaction is
+	// started from the interrupt that marks the end of the stop
+	if(mcs & I2C_MCS_ERROR){
+		if(g_bBurst){
+			I2C_CONTROL(I2C3_BASE, g_bReading ? I2C_MASTER_CMD_BURST_RECEIVE_ERROR_STOP : I2C_MASTER_CMD_BURST_SEND_ERROR_STOP);
+			g_bStopping = true;
+			g_ui8ActiveMs = 0;
+		}
+		I2CLibFinish(I2C_STATUS_ERROR);
+		return;
+	}
+
+	if(!g_bReading){
+		// Write phase
+		g_ui8Index++;
+		if(g_ui8Index < psTrans->txLen){
+			I2C_DATA_PUT(I2C3_BASE, psTrans->txBuf[g_ui8Index]);
+			if(g_ui8Index == psTrans->txLen - 1 && psTrans->rxLen == 0){
+				I2C_CONTROL(I2C3_BASE, I2C_MASTER_CMD_BURST_SEND_FINISH);
+			} else{
+				I2C_CONTROL(I2C3_BASE, I2C_MASTER_CMD_BURST_SEND_CONT);
+			}
+		} else if(psTrans->rxLen){
+			I2CLibStartRead(psTrans);
+		} else{
+			I2CLibFinish(I2C_STATUS_DONE);
+		}
+	} else{
+		// Read phase
+		psTrans->rxBuf[g_ui8Index++] = I2C_DATA_GET(I2C3_BASE);
+		if(g_ui8Index < psTrans->rxLen){
+			if(g_ui8Index == psTrans->rxLen - 1){
+				I2C_CONTROL(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_FINISH);
+			} else{
+				I2C_CONTROL(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_CONT);
+			}
+		} else{
+			I2CLibFinish(I2C_STATUS_DONE);
+		}
+	}
+}
+
+
+
+// Backends ------------------------------------------------------------------------------------------
+
+// Interrupt backend, the engine above. It always drives I2C3
+static void I2CLibIntBusInit(tI2CBus *psBus){
+	I2CLibInit();
+	g_psIntBus = psBus;
+}
+
+static bool I2CLibIntBusQueue(tI2CBus *psBus, tI2CTransaction *psTrans){
+	return I2CLibQueue(psTrans);
+}
+
+static uint8_t I2CLibIntBusWait(tI2CBus *psBus, tI2CTransaction *psTrans){
+	return I2CLibWait(psTrans);
+}
+
+const tI2CBackend g_sI2CIntBackend = {I2CLibIntBusInit, I2CLibIntBusQueue, I2CLibIntBusWait};
+
+// Send one byte command on a polled master and wait a bounded time for it. A stuck bus is cleared,
+// a NACK in a burst still holds the bus and needs a stop
+static uint8_t I2CLibPollByte(tI2CBus *psBus, uint32_t command, bool burst, bool reading){
+	uint32_t base = psBus->base;
+	uint32_t loops = I2C_POLL_LOOPS;
+	uint32_t mcs;
+
+	I2C_CONTROL(base, command);
+	while(I2C_BUSY(base)){
+		if(--loops == 0){
+			I2CLibBusRecover(psBus);
+			return I2C_STATUS_TIMEOUT;
+		}
+	}
+
+	mcs = I2C_STATUS_REG(base);
+	if(mcs & (I2C_MCS_CLKTO | I2C_MCS_ARBLST)){
+		I2CLibBusRecover(psBus);
+		return (mcs & I2C_MCS_ARBLST) ? I2C_STATUS_ARB_LOST : I2C_STATUS_TIMEOUT;
+	}
+	if(mcs & I2C_MCS_ERROR){
+		if(burst){
+			I2C_CONTROL(base, reading ? I2C_MASTER_CMD_BURST_RECEIVE_ERROR_STOP : I2C_MASTER_CMD_BURST_SEND_ERROR_STOP);
+		}
+		return I2C_STATUS_ERROR;
+	}
+	return I2C_STATUS_DONE;
+}
+
+// Polling backend. The whole transaction runs inside the queue call, so wait only reports status
+static void I2CLibPollBusInit(tI2CBus *psBus){
+	I2CLibSpeedInit();
+}
+
+static bool I2CLibPollBusQueue(tI2CBus *psBus, tI2CTransaction *psTrans){
+	uint32_t base = psBus->base;
+	uint32_t command;
+	uint8_t status = I2C_STATUS_DONE;
+	uint8_t i;
+	bool burst;
+
+	if(psTrans->txLen == 0 && psTrans->rxLen == 0){
+		return false;
+	}
+
+	psTrans->status = I2C_STATUS_PENDING;
+	g_ui32TransCount++;
+	I2CLibRetime(base, psTrans);
+
+	// Write phase. Single byte writes with nothing to read release the bus straight away
+	if(psTrans->txLen){
+		burst = !(psTrans->txLen == 1 && psTrans->rxLen == 0);
+		I2C_ADDR_SET(base, psTrans->addr, false);
+		for(i = 0; i < psTrans->txLen; i++){
+			if(!burst){
+				command = I2C_MASTER_CMD_SINGLE_SEND;
+			} else if(i == 0){
+				command = I2C_MASTER_CMD_BURST_SEND_START;
+			} else if(i == psTrans->txLen - 1 && psTrans->rxLen == 0){
+				command = I2C_MASTER_CMD_BURST_SEND_FINISH;
+			} else{
+				command = I2C_MASTER_CMD_BURST_SEND_CONT;
+			}
+
+			I2C_DATA_PUT(base, psTrans->txBuf[i]);
+			status = I2CLibPollByte(psBus, command, burst, false);
+			if(status != I2C_STATUS_DONE){
+				break;
+			}
+		}
+	}
+
+	// Restart and read phase
+	if(status == I2C_STATUS_DONE && psTrans->rxLen){
+		burst = (psTrans->rxLen > 1);
+		I2C_ADDR_SET(base, psTrans->addr, true);
+		for(i = 0; i < psTrans->rxLen; i++){
+			if(!burst){
+				command = I2C_MASTER_CMD_SINGLE_RECEIVE;
+			} else if(i == 0){
+				command = I2C_MASTER_CMD_BURST_RECEIVE_START;
+			} else if(i == psTrans->rxLen - 1){
+				command = I2C_MASTER_CMD_BURST_RECEIVE_FINISH;
+			} else{
+				command = I2C_MASTER_CMD_BURST_RECEIVE_CONT;
+			}
+
+			status = I2CLibPollByte(psBus, command, burst, true);
+			if(status != I2C_STATUS_DONE){
+				break;
+			}
+			psTrans->rxBuf[i] = I2C_DATA_GET(base);
+		}
+	}
+
+	I2CLibDevAccount(psTrans, status);
+	psTrans->status = status;
+	if(psTrans->callback){
+		psTrans->callback(psTrans);
+	}
+	return true;
+}
+
+static uint8_t I2CLibPollBusWait(tI2CBus *psBus, tI2CTransaction *psTrans){
+	return psTrans->status;
+}
+
+const tI2CBackend g_sI2CPollBackend = {I2CLibPollBusInit, I2CLibPollBusQueue, I2CLibPollBusWait};
+
+
+
+// Device layer --------------------------------------------------------------------------------------
+
+// The master must already be configured. Starts the backend
+void I2CLibBusInit(tI2CBus *psBus, uint32_t base, const tI2CBackend *psBackend){
+	psBus->base = base;
+	psBus->backend = psBackend;
+	psBus->gpioBase = 0;
+	psBus->recoveries = 0;
+	psBackend->init(psBus);
+}
+
+void I2CLibDevInit(tI2CDevice *psDev, tI2CBus *psBus, uint8_t addr){
+	psDev->bus = psBus;
+	psDev->addr = addr;
+	psDev->bytes = 0;
+	psDev->nacks = 0;
+	psDev->arbLost = 0;
+	psDev->timeouts = 0;
+	psDev->faults = 0;
+	psDev->speed = I2C_SPEED_FAST;
+	psDev->failStreak = 0;
+	psDev->faultStreak = 0;
+}
+
+// Set the device's bus speed (one of I2C_SPEED_*), e.g. to restore it after a fallback
+void I2CLibDevSpeedSet(tI2CDevice *psDev, uint8_t speed){
+	bool wasDisabled = ROM_IntMasterDisable();
+
+	psDev->speed = (speed < I2C_SPEED_COUNT) ? speed : I2C_SPEED_FAST;
+	psDev->failStreak = 0;
+	psDev->faultStreak = 0;
+	if(!wasDisabled){
+		ROM_IntMasterEnable();
+	}
+}
+
+// Report a transfer that completed but carried bad data, e.g. a CRC mismatch. I2C_FALLBACK_ERRORS
+// of these without I2CLibDevDataGood in between step the speed down
+void I2CLibDevFault(tI2CDevice *psDev){
+	// The interrupt engine updates the same fields as transactions finish
+	bool wasDisabled = ROM_IntMasterDisable();
+
+	psDev->faults++;
+	I2CLibDevFailed(psDev, true);
+	if(!wasDisabled){
+		ROM_IntMasterEnable();
+	}
+}
+
+// Report data that passed the driver's checks, ending a run of I2CLibDevFault calls
+void I2CLibDevDataGood(tI2CDevice *psDev){
+	bool wasDisabled = ROM_IntMasterDisable();
+
+	psDev->faultStreak = 0;
+	if(!wasDisabled){
+		ROM_IntMasterEnable();
+	}
+}
+
+// Fill in a transaction for the device and queue it. Buffers must stay valid until it finishes
+bool I2CLibDevQueue(tI2CDevice *psDev, tI2CTransaction *psTrans, const uint8_t *txBuf, uint8_t txLen, uint8_t *rxBuf, uint8_t rxLen){
+	I2CLibTransactionSet(psTrans, psDev->addr, txBuf, txLen, rxBuf, rxLen, 0);
+	psTrans->dev = psDev;
+	return psDev->bus->backend->queue(psDev->bus, psTrans);
+}
+
+// Queue a transaction for the device and wait for it. Timeouts and lost arbitration are retried
+// on the cleared bus
+uint8_t I2CLibDevTransfer(tI2CDevice *psDev, const uint8_t *txBuf, uint8_t txLen, uint8_t *rxBuf, uint8_t rxLen){
+	tI2CTransaction sTrans;
+	uint8_t status;
+	uint8_t attempt;
+
+	if(txLen == 0 && rxLen == 0){
+		return I2C_STATUS_ERROR;
+	}
+
+	for(attempt = 0; ; attempt++){
+		// A full queue drains on its own, so retrying always makes progress
+		while(!I2CLibDevQueue(psDev, &sTrans, txBuf, txLen, rxBuf, rxLen)){}
+
+		status = psDev->bus->backend->wait(psDev->bus, &sTrans);
+		if(status == I2C_STATUS_DONE || status == I2C_STATUS_ERROR || attempt == I2C_RETRIES){
+			return status;
+		}
+	}
+}
+
+// Read len consecutive registers starting at reg in a single transaction
+uint8_t I2CLibDevReadRegs(tI2CDevice *psDev, uint8_t reg, uint8_t *data, uint8_t len){
+	return I2CLibDevTransfer(psDev, &reg, 1, data, len);
+}
+
+// Write len consecutive registers starting at reg in a single transaction
+uint8_t I2CLibDevWriteRegs(tI2CDevice *psDev, uint8_t reg, const uint8_t *data, uint8_t len){
+	uint8_t txData[I2C_WRITE_MAX + 1];
+	uint8_t i;
+
+	if(len > I2C_WRITE_MAX){
+		return I2C_STATUS_ERROR;
+	}
+
+	txData[0] = reg;
+	for(i = 0; i < len; i++){
+		txData[i + 1] = data[i];
+	}
+	return I2CLibDevTransfer(psDev, txData, len + 1, 0, 0);
+}
+
+// Write a single command byte
+uint8_t I2CLibDevCommand(tI2CDevice *psDev, uint8_t command){
+	return I2CLibDevTransfer(psDev, &command, 1, 0, 0);
+}
+
+// Read len bytes without addressing a register first
+uint8_t I2CLibDevRead(tI2CDevice *psDev, uint8_t *data, uint8_t len){
+	return I2CLibDevTransfer(psDev, 0, 0, data, len);
+}
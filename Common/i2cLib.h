@@ -0,0 +1,176 @@
+// i2cLib.h
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	Command sequencing follows the TivaWare I2C master examples
+//
+// Requirements:
+// 	Requires Texas Instruments' TivaWare.
+//
+// Description:
+// 	Interrupt driven transaction engine for the I2C3 master, and the register-map device layer
+//	the sensor drivers are written against
+//
+// Notes:
+//	I2CLibIntHandler must be placed in the I2C3 slot of the vector table in startup_gcc.c
+//	Transactions are put on the bus in the order they are queued
+//	A transaction writes txLen bytes, then (if rxLen != 0) sends a restart and reads rxLen bytes
+//	I2CLibReadRegs relies on the slave auto-incrementing its register pointer during a burst read
+//	A tI2CBus pairs a master base with a backend. g_sI2CIntBackend is the engine above and only
+//	drives I2C3; g_sI2CPollBackend busy-waits on any master and finishes a transaction inside
+//	the queue call. Only one backend may be used per master
+//	A tI2CDevice is a slave address on a bus. Drivers keep one per instance and only use the
+//	I2CLibDev* functions, so they run unchanged on either backend
+//	No wait is unbounded. The interrupt engine gives up when SCL is held low for I2C_CLOCK_TIMEOUT
+//	or, if I2CLibTick is called from a 1 ms SysTick, after I2C_TIMEOUT_MS. The polling backend
+//	gives up after I2C_POLL_LOOPS. After a timeout or lost arbitration the bus is cleared with
+//	I2CLibBusRecover if I2CLibBusPinsSet has been called for it. The interrupt engine holds its
+//	queue until I2CLibService does the clear, so code using the non-blocking driver APIs must call
+//	I2CLibService from its main loop (I2CLibWait calls it itself)
+//	After a NACK in a burst the next transaction is started once the error stop has finished
+//	I2CLibBusyCycles times bus use with the DWT cycle counter, which I2CLibInit enables. Don't
+//	reset the counter while transactions are running
+//	Blocking I2CLibDev* calls retry timeouts and lost arbitration I2C_RETRIES times. A NACK is
+//	returned at once since the slave is present but not ready
+//	Each device has its own bus speed. The master is retimed between transactions when the next
+//	device's speed differs. After I2C_FALLBACK_ERRORS bus failures in a row, or as many data errors
+//	reported with I2CLibDevFault, a device drops to the next slower speed and stays there. A
+//	transaction that finishes ends a run of bus failures; only I2CLibDevDataGood ends a run of data
+//	errors, since the transfers around a bad CRC usually go through
+//
+// Todo:
+//
+//****************************************************************************************************
+
+#ifndef I2CLIB_H
+#define I2CLIB_H
+
+
+// Defines -------------------------------------------------------------------------------------------
+
+// Maximum number of transactions waiting behind the one on the bus
+#define I2C_QUEUE_SIZE 8
+
+// Longest register block I2CLibDevWriteRegs will send
+#define I2C_WRITE_MAX 8
+
+// Transaction status
+#define I2C_STATUS_IDLE 0		// Never queued
+#define I2C_STATUS_PENDING 1		// Queued or on the bus
+#define I2C_STATUS_DONE 2		// Completed successfully
+#define I2C_STATUS_ERROR 3		// NACK, transaction abandoned
+#define I2C_STATUS_ARB_LOST 4		// Arbitration lost, usually SDA held low
+#define I2C_STATUS_TIMEOUT 5		// SCL held low or transaction never finished
+
+// Bus error handling, see notes
+#define I2C_RETRIES 2
+#define I2C_TIMEOUT_MS 10		// Longest transaction, 22 bytes at 100 kHz, is about 2.5 ms
+#define I2C_CLOCK_TIMEOUT 0x7D		// MCLKOCNT, 2000 SCL periods
+#define I2C_POLL_LOOPS 100000		// Busy checks per byte, about 10 ms at 80 MHz
+
+// Device bus speeds, slowest first
+#define I2C_SPEED_KEEP 0		// Leave the master at its current rate
+#define I2C_SPEED_STD 1			// 100 kHz
+#define I2C_SPEED_FAST 2		// 400 kHz
+#define I2C_SPEED_COUNT 3
+
+#define I2C_FALLBACK_ERRORS 3
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+
+typedef struct tI2CTransaction tI2CTransaction;
+typedef struct tI2CDevice tI2CDevice;
+
+// Completion callback, runs in interrupt context
+typedef void (*tI2CCallback)(tI2CTransaction *psTrans);
+
+struct tI2CTransaction
+{
+	const uint8_t *txBuf;		// Bytes written first, usually a register address
+	uint8_t *rxBuf;			// Bytes read after the restart
+	tI2CCallback callback;		// Called when the transaction finishes, may be 0
+	tI2CDevice *dev;		// Device speed and counters, 0 if queued by address only
+	uint8_t addr;			// 7-bit slave address
+	uint8_t txLen;
+	uint8_t rxLen;
+	volatile uint8_t status;	// One of I2C_STATUS_*
+};
+
+typedef struct tI2CBus tI2CBus;
+
+// Bus backend. queue returns false if the transaction can't be accepted yet, wait blocks until a
+// queued transaction finishes and returns its status
+typedef struct
+{
+	void (*init)(tI2CBus *psBus);
+	bool (*queue)(tI2CBus *psBus, tI2CTransaction *psTrans);
+	uint8_t (*wait)(tI2CBus *psBus, tI2CTransaction *psTrans);
+} tI2CBackend;
+
+struct tI2CBus
+{
+	uint32_t base;			// I2Cn_BASE of the master, already configured
+	const tI2CBackend *backend;
+
+	// Pins used by I2CLibBusRecover, see I2CLibBusPinsSet. gpioBase is 0 if not set
+	uint32_t gpioBase;
+	uint32_t sclConfig;		// GPIO_Pxn_I2CnSCL
+	uint32_t sdaConfig;		// GPIO_Pxn_I2CnSDA
+	uint8_t sclPin;
+	uint8_t sdaPin;
+	uint16_t recoveries;		// Bus clears performed
+};
+
+// Counters are updated as each of the device's transactions finishes
+struct tI2CDevice
+{
+	tI2CBus *bus;
+	uint32_t bytes;			// Bytes moved by successful transactions
+	uint16_t nacks;
+	uint16_t arbLost;
+	uint16_t timeouts;
+	uint16_t faults;		// Data errors reported by the driver, see I2CLibDevFault
+	uint8_t addr;			// 7-bit slave address
+	uint8_t speed;			// One of I2C_SPEED_*
+	uint8_t failStreak;		// Bus failures since the last transaction that finished
+	uint8_t faultStreak;		// Data errors since the driver last reported good data
+};
+
+extern const tI2CBackend g_sI2CIntBackend;
+extern const tI2CBackend g_sI2CPollBackend;
+
+
+
+// Function Prototypes -------------------------------------------------------------------------------
+extern void I2CLibInit(void);
+extern void I2CLibTransactionSet(tI2CTransaction *psTrans, uint8_t addr, const uint8_t *txBuf, uint8_t txLen, uint8_t *rxBuf, uint8_t rxLen, tI2CCallback callback);
+extern bool I2CLibQueue(tI2CTransaction *psTrans);
+extern uint8_t I2CLibWait(tI2CTransaction *psTrans);
+extern uint8_t I2CLibTransfer(uint8_t addr, const uint8_t *txBuf, uint8_t txLen, uint8_t *rxBuf, uint8_t rxLen);
+extern uint8_t I2CLibReadRegs(uint8_t addr, uint8_t reg, uint8_t *data, uint8_t len);
+extern bool I2CLibIdle(void);
+extern void I2CLibService(void);
+extern uint32_t I2CLibTransactionCount(void);
+extern uint32_t I2CLibBusyCycles(void);
+extern void I2CLibIntHandler(void);
+extern void I2CLibTick(void);
+extern void I2CLibBusInit(tI2CBus *psBus, uint32_t base, const tI2CBackend *psBackend);
+extern void I2CLibBusPinsSet(tI2CBus *psBus, uint32_t gpioBase, uint8_t sclPin, uint8_t sdaPin, uint32_t sclConfig, uint32_t sdaConfig);
+extern bool I2CLibBusRecover(tI2CBus *psBus);
+extern void I2CLibDevInit(tI2CDevice *psDev, tI2CBus *psBus, uint8_t addr);
+extern void I2CLibDevSpeedSet(tI2CDevice *psDev, uint8_t speed);
+extern void I2CLibDevFault(tI2CDevice *psDev);
+extern void I2CLibDevDataGood(tI2CDevice *psDev);
+extern bool I2CLibDevQueue(tI2CDevice *psDev, tI2CTransaction *psTrans, const uint8_t *txBuf, uint8_t txLen, uint8_t *rxBuf, uint8_t rxLen);
+extern uint8_t I2CLibDevTransfer(tI2CDevice *psDev, const uint8_t *txBuf, uint8_t txLen, uint8_t *rxBuf, uint8_t rxLen);
+extern uint8_t I2CLibDevReadRegs(tI2CDevice *psDev, uint8_t reg, uint8_t *data, uint8_t len);
+extern uint8_t I2CLibDevWriteRegs(tI2CDevice *psDev, uint8_t reg, const uint8_t *data, uint8_t len);
+extern uint8_t I2CLibDevCommand(tI2CDevice *psDev, uint8_t command);
+extern uint8_t I2CLibDevRead(tI2CDevice *psDev, uint8_t *data, uint8_t len);
+
+#endif
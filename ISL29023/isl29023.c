@@ -36,6 +36,7 @@
 #include "driverlib/sysctl.h"
 #include "driverlib/uart.h"
 
+#include "i2cLib.h"
 #include "islLib.h"
 
 #include "utils/uartstdio.h"
@@ -47,13 +48,39 @@
 #define LED_BLUE GPIO_PIN_2
 #define LED_GREEN GPIO_PIN_3
 
+// ISL29023 INT on the SensorHub BoosterPack
+#define ISL_INT_PORT GPIO_PORTE_BASE
+#define ISL_INT_PIN GPIO_PIN_5
+
+// Light must change by this many raw counts (about 100 lux at 64k/16 bit) to wake the loop
+#define LIGHT_BAND 100
+
 
 // Variables -----------------------------------------------------------------------------------------
+volatile bool g_bLightEvent = false;	// Set when the ISL29023 pulls INT low
 
 
 
 
 // Functions -----------------------------------------------------------------------------------------
+void GPIOEIntHandler(void){
+	GPIOIntClear(ISL_INT_PORT, GPIO_INT_PIN_5);
+	g_bLightEvent = true;
+}
+
+void ConfigureISLInt(void){
+
+	// INT is open drain and active low
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOE);
+	ROM_GPIOPinTypeGPIOInput(ISL_INT_PORT, ISL_INT_PIN);
+	ROM_GPIOPadConfigSet(ISL_INT_PORT, ISL_INT_PIN, GPIO_STRENGTH_2MA, GPIO_PIN_TYPE_STD_WPU);
+
+	GPIOIntTypeSet(ISL_INT_PORT, ISL_INT_PIN, GPIO_FALLING_EDGE);
+	GPIOIntClear(ISL_INT_PORT, GPIO_INT_PIN_5);
+	GPIOIntEnable(ISL_INT_PORT, GPIO_INT_PIN_5);
+	ROM_IntEnable(INT_GPIOE);
+}
+
 void ConfigureUART(void){
 
 	// Enable the peripherals used by UART
@@ -89,6 +116,7 @@ void ConfigureI2C3(void){
 
 }
 
+#ifndef ISL29023_FIXED_POINT
 void FloatToPrint(float floatValue, uint32_t splitValue[2]){
 	int32_t i32IntegerPart;
 	int32_t i32FractionPart;
@@ -104,6 +132,7 @@ void FloatToPrint(float floatValue, uint32_t splitValue[2]){
 	splitValue[0] = i32IntegerPart;
 	splitValue[1] = i32FractionPart;
 }
+#endif
 
 
 
@@ -111,8 +140,10 @@ void FloatToPrint(float floatValue, uint32_t splitValue[2]){
 // Main ----------------------------------------------------------------------------------------------
 int main(void){
 
+#ifndef ISL29023_FIXED_POINT
 	// Enable lazy stacking
 	ROM_FPULazyStackingEnable();
+#endif
 
 	// Set the system clock to run at 40Mhz off PLL with external crystal as reference.
 	ROM_SysCtlClockSet(SYSCTL_SYSDIV_5 | SYSCTL_USE_PLL | SYSCTL_XTAL_16MHZ | SYSCTL_OSC_MAIN);
@@ -128,32 +159,82 @@ int main(void){
 	// Enable I2C3
 	ConfigureI2C3();
 
+	// Start interrupt driven I2C transactions. Pass &g_sI2CPollBackend to run without them
+	tI2CBus SensHubBus;
+	I2CLibBusInit(&SensHubBus, I2C3_BASE, &g_sI2CIntBackend);
+	I2CLibBusPinsSet(&SensHubBus, GPIO_PORTD_BASE, GPIO_PIN_0, GPIO_PIN_1, GPIO_PD0_I2C3SCL, GPIO_PD1_I2C3SDA);
+	ROM_IntMasterEnable();
+
 	// Create struct
 	tISL29023 islSensHub;
 
+#ifndef ISL29023_FIXED_POINT
 	// Create print variables
 	uint32_t printValue[2];
+#endif
 
+	ISL29023Initialize(&islSensHub, &SensHubBus);
 	ISL29023ChangeSettings(ISL29023_COMMANDII_RANGE64k, ISL29023_COMMANDII_RES16, &islSensHub);
 
+	// One-shot readings to start from. The interrupt window is set around the first, so don't go on
+	// without it
+	while(ISL29023GetALS(&islSensHub) != ISL29023_STATUS_OK || ISL29023GetIR(&islSensHub) != ISL29023_STATUS_OK){
+		UARTprintf("ISL29023 read failed, retrying\n");
+		ROM_GPIOPinWrite(GPIO_PORTF_BASE, LED_RED|LED_GREEN|LED_BLUE, LED_RED);
+		ROM_SysCtlDelay(ROM_SysCtlClockGet()/3);
+	}
+	ROM_GPIOPinWrite(GPIO_PORTF_BASE, LED_RED, 0);
+#ifdef ISL29023_FIXED_POINT
+	UARTprintf("ALS: %d.%03d |.| ", islSensHub.alsMilli / 1000, islSensHub.alsMilli % 1000);
+	UARTprintf("IR: %d.%03d\n", islSensHub.irMilli / 1000, islSensHub.irMilli % 1000);
+#else
+	FloatToPrint(islSensHub.alsVal, printValue);
+	UARTprintf("ALS: %d.%03d |.| ",printValue[0],printValue[1]);
+	FloatToPrint(islSensHub.irVal, printValue);
+	UARTprintf("IR: %d.%03d\n",printValue[0],printValue[1]);
+#endif
+
+	// Only wake when light moves LIGHT_BAND counts away from the last reading for 4 conversions
+	uint32_t raw = (islSensHub.rawVals[0] << 8) | islSensHub.rawVals[1];
+	ConfigureISLInt();
+	ISL29023SetThresholds(&islSensHub, (raw > LIGHT_BAND) ? raw - LIGHT_BAND : 0, (raw + LIGHT_BAND < 0xFFFF) ? raw + LIGHT_BAND : 0xFFFF);
+	ISL29023StartContinuous(&islSensHub, ISL29023_COMMANDI_PERSIST4, LIGHT_BAND);
+
 	while(1){
-		// Get ALS
-		ISL29023GetALS(&islSensHub);
+		// Nothing to do until INT fires. Masked around the check so the edge can't be missed
+		ROM_IntMasterDisable();
+		while(!g_bLightEvent){
+			ROM_SysCtlSleep();
+			ROM_IntMasterEnable();
+			ROM_IntMasterDisable();
+		}
+		g_bLightEvent = false;
+		ROM_IntMasterEnable();
+
+		switch(ISL29023HandleInterrupt(&islSensHub)){
+			case ISL29023_EVENT_ALS:
+				break;
+			case ISL29023_EVENT_ERROR:
+				// INT is still low and won't give another falling edge, so go round again
+				g_bLightEvent = true;
+				continue;
+			default:
+				continue;
+		}
+
+		// Print new level and bus transactions used so far
+#ifdef ISL29023_FIXED_POINT
+		UARTprintf("ALS: %d.%03d |.| ", islSensHub.alsMilli / 1000, islSensHub.alsMilli % 1000);
+#else
 		FloatToPrint(islSensHub.alsVal, printValue);
 		UARTprintf("ALS: %d.%03d |.| ",printValue[0],printValue[1]);
-
-		// Get IR
-		ISL29023GetIR(&islSensHub);
-		FloatToPrint(islSensHub.irVal, printValue);
-		UARTprintf("IR: %d.%03d\n",printValue[0],printValue[1]);
+#endif
+		UARTprintf("I2C transactions: %d\n", I2CLibTransactionCount());
 
 		// Blink LED
 		ROM_GPIOPinWrite(GPIO_PORTF_BASE, LED_RED|LED_GREEN|LED_BLUE, LED_GREEN);
 		ROM_SysCtlDelay(ROM_SysCtlClockGet()/3/10);	// Delay for 100ms (1/10s) :: ClockGet()/3 = 1second
 		ROM_GPIOPinWrite(GPIO_PORTF_BASE, LED_RED|LED_GREEN|LED_BLUE, 0);
-
-		// Delay for second
-		ROM_SysCtlDelay(ROM_SysCtlClockGet()/3);
 	}
 
 }
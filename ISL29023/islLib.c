@@ -16,7 +16,6 @@
 // Notes:
 //
 // Todo:
-//	Get infrared readings accurate
 //	
 //
 //****************************************************************************************************
@@ -33,33 +32,42 @@
 #include "inc/hw_i2c.h"
 #include "inc/hw_memmap.h"
 
+#include "i2cLib.h"
 #include "islLib.h"
 
 
 
 
-// Functions -----------------------------------------------------------------------------------------
-void ISL29023ChangeSettings(uint8_t range, uint8_t resolution, tISL29023 *psInst){
+// Variables -----------------------------------------------------------------------------------------
 
-	// The input range and resolution should have defines from above passed into them
-	// Example: ISL29023ChangeSettings(ISL29023_COMMANDII_RES16, ISL29023_COMMANDII_RANGE64k);
-	// Must be called before starting measurements
+// Command II codes indexed by rangeIndex, and resolution codes from fastest to slowest
+static const uint8_t g_pui8RangeCodes[ISL29023_RANGE_COUNT] = {ISL29023_COMMANDII_RANGE1k, ISL29023_COMMANDII_RANGE4k, ISL29023_COMMANDII_RANGE16k, ISL29023_COMMANDII_RANGE64k};
+static const uint16_t g_pui16RangeLux[ISL29023_RANGE_COUNT] = {1000, 4000, 16000, 64000};
+static const uint8_t g_pui8ResCodes[4] = {ISL29023_COMMANDII_RES4, ISL29023_COMMANDII_RES8, ISL29023_COMMANDII_RES12, ISL29023_COMMANDII_RES16};
 
-	// Configure to write, send control register
-	ROM_I2CMasterSlaveAddrSet(I2C3_BASE, ISL29023_I2C_ADDRESS, false);
-	ROM_I2CMasterDataPut(I2C3_BASE, ISL29023_REG_COMMANDII);
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_SEND_START);
+// IR counts per unit for each range at 16 bit resolution, from the TI driver
+#ifdef ISL29023_FIXED_POINT
+static const uint32_t g_pui32IRScale[ISL29023_RANGE_COUNT] = {688129, 2752457, 11010753, 44102288};	// 1000 / beta, 16.16
+#else
+static const float g_pfBeta[ISL29023_RANGE_COUNT] = {95.238f, 23.810f, 5.952f, 1.486f};
+#endif
 
-	// Wait for bus to free
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
 
-	// Send data byte
-	ROM_I2CMasterDataPut(I2C3_BASE, (range | resolution));
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_SEND_FINISH);
 
-	// Wait for bus to free
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
+// "Private" Functions ------------------------------------------------------------------------------
+
+// Reading held in rawVals
+static uint32_t ISL29023Raw(tISL29023 *psInst){
+	return (psInst->rawVals[0] << 8) | psInst->rawVals[1];
+}
+
+static void ISL29023RawSet(tISL29023 *psInst, uint32_t raw){
+	psInst->rawVals[0] = raw >> 8;
+	psInst->rawVals[1] = raw & 0xFF;
+}
 
+// Range and resolution fields for command II settings the sensor has accepted
+static void ISL29023Settings(tISL29023 *psInst, uint8_t range, uint8_t resolution){
 	// Change resSetting in structure
 	switch(resolution){
 		case ISL29023_COMMANDII_RES16:
@@ -81,40 +89,68 @@ void ISL29023ChangeSettings(uint8_t range, uint8_t resolution, tISL29023 *psInst
 	switch(range){
 		case ISL29023_COMMANDII_RANGE64k:
 			psInst->rangeSetting = 64000;
+			psInst->rangeIndex = 3;
 			break;
 		case ISL29023_COMMANDII_RANGE16k:
 			psInst->rangeSetting = 16000;
+			psInst->rangeIndex = 2;
 			break;
 		case ISL29023_COMMANDII_RANGE4k:
 			psInst->rangeSetting = 4000;
+			psInst->rangeIndex = 1;
 			break;
 		case ISL29023_COMMANDII_RANGE1k:
 			psInst->rangeSetting = 1000;
+			psInst->rangeIndex = 0;
 			break;
 		default:
 			break;
 	}
 
+	// resSetting is a power of two, so dividing by it is a shift
+	psInst->resShift = 0;
+	while((1UL << psInst->resShift) < psInst->resSetting){
+		psInst->resShift++;
+	}
+
+#ifdef ISL29023_FIXED_POINT
+	psInst->irScale = g_pui32IRScale[psInst->rangeIndex];
+#else
 	psInst->alpha = (float)psInst->rangeSetting / (float)psInst->resSetting;
-	psInst->beta = 95.238;
+	psInst->beta = g_pfBeta[psInst->rangeIndex] * (float)psInst->resSetting / 65536.0f;
+#endif
 }
 
-void ISL29023GetRawALS(tISL29023 *psInst){
-
-	// Configure to write, send control register
-	ROM_I2CMasterSlaveAddrSet(I2C3_BASE, ISL29023_I2C_ADDRESS, false);
-	ROM_I2CMasterDataPut(I2C3_BASE, ISL29023_REG_COMMANDI);
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_SEND_START);
+// Convert an ALS reading in counts at the current settings to lux
+static void ISL29023ConvertALS(tISL29023 *psInst, uint32_t raw){
+#ifdef ISL29023_FIXED_POINT
+	// range * 1000 * raw / resSetting, rounded to nearest. Needs 42 bits before the shift
+	uint64_t milli = (uint64_t)psInst->rangeSetting * 1000 * raw;
+	psInst->alsMilli = (uint32_t)((milli + ((1ULL << psInst->resShift) >> 1)) >> psInst->resShift);
+#else
+	psInst->alsVal = psInst->alpha * (float)raw;
+#endif
+}
 
-	// Wait for bus to free
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
+static void ISL29023ConvertIR(tISL29023 *psInst, uint32_t raw){
+#ifdef ISL29023_FIXED_POINT
+	// irScale * raw * (65536 / resSetting) >> 16, rounded to nearest
+	psInst->irMilli = (uint32_t)(((uint64_t)psInst->irScale * raw + ((1ULL << psInst->resShift) >> 1)) >> psInst->resShift);
+#else
+	psInst->irVal = (float)raw / psInst->beta;
+#endif
+}
 
-	// Send data byte
-	ROM_I2CMasterDataPut(I2C3_BASE, ISL29023_COMMANDI_ONEALS | ISL29023_COMMANDI_PERSIST1);
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_SEND_FINISH);
+// Trigger a one-shot conversion in mode (ISL29023_COMMANDI_ONEALS or ONEIR), wait for it and
+// read the result into raw. raw is left alone if either transaction fails
+static uint8_t ISL29023OneShot(tISL29023 *psInst, uint8_t mode, uint32_t *raw){
+	uint8_t command = mode | ISL29023_COMMANDI_PERSIST1;
+	uint8_t islData[2];
 
-	// Wait for bus to free
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
+	// Write one-shot command to command register I
+	if(I2CLibDevWriteRegs(&psInst->dev, ISL29023_REG_COMMANDI, &command, 1) != I2C_STATUS_DONE){
+		return ISL29023_STATUS_BUS_ERROR;
+	}
 
 	// Wait for measurement to complete
 	switch(psInst->resSetting){
@@ -135,92 +171,308 @@ void ISL29023GetRawALS(tISL29023 *psInst){
 			break;
 	}
 
-	// Send start, configure to write, send LSB register
-	ROM_I2CMasterSlaveAddrSet(I2C3_BASE, ISL29023_I2C_ADDRESS, false);
-	ROM_I2CMasterDataPut(I2C3_BASE, ISL29023_REG_DATALSB);
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_SEND_START);
-	
-	// Wait for bus to free
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
+	// Read LSB and MSB
+	if(I2CLibDevReadRegs(&psInst->dev, ISL29023_REG_DATALSB, islData, 2) != I2C_STATUS_DONE){
+		return ISL29023_STATUS_BUS_ERROR;
+	}
+	*raw = (islData[1] << 8) | islData[0];
+	return ISL29023_STATUS_OK;
+}
 
-	// Send restart, configure to read
-	ROM_I2CMasterSlaveAddrSet(I2C3_BASE, ISL29023_I2C_ADDRESS, true);
 
-	// Read LSB
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_START);
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
-	psInst->rawVals[1] = ROM_I2CMasterDataGet(I2C3_BASE);
 
-	// Read MSB
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_FINISH);
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
-	psInst->rawVals[0] = ROM_I2CMasterDataGet(I2C3_BASE);
+// Functions -----------------------------------------------------------------------------------------
+
+// psBus must already be initialized with I2CLibBusInit. Call before any other function
+void ISL29023Initialize(tISL29023 *psInst, tI2CBus *psBus){
+	I2CLibDevInit(&psInst->dev, psBus, ISL29023_I2C_ADDRESS);
+	psInst->reading = false;
+	psInst->band = 0;
+	psInst->commandI = ISL29023_COMMANDI_NOPOW;
+
+	// No compensation until ISL29023SetIRCompensation, but a valid IR resolution so the call works
+	psInst->irResolution = ISL29023_COMMANDII_RES8;
+	psInst->irWeight = 0;
+
+	// Finest step until ISL29023SetAutoRange
+	psInst->precisionMilli = 0;
+	psInst->clipCount = 0;
+
+	// Power-on settings, so the conversions and ISL29023GetCompensatedALS work before the caller
+	// picks their own. They're the sensor's own after power up, so they hold even if the write fails
+	ISL29023Settings(psInst, ISL29023_COMMANDII_RANGE1k, ISL29023_COMMANDII_RES16);
+	ISL29023ChangeSettings(ISL29023_COMMANDII_RANGE1k, ISL29023_COMMANDII_RES16, psInst);
 }
 
-void ISL29023GetALS(tISL29023 *psInst){
-	ISL29023GetRawALS(psInst);
-	psInst->alsVal = psInst->alpha * ((float)((psInst->rawVals[0] << 8) | psInst->rawVals[1]));
+// Returns an ISL29023_STATUS_*. The settings only change if the sensor took them
+uint8_t ISL29023ChangeSettings(uint8_t range, uint8_t resolution, tISL29023 *psInst){
+
+	// The input range and resolution should have defines from above passed into them
+	// Example: ISL29023ChangeSettings(ISL29023_COMMANDII_RES16, ISL29023_COMMANDII_RANGE64k);
+	// Must be called before starting measurements
+
+	uint8_t command = range | resolution;
+
+	// Write range and resolution to command register II
+	if(I2CLibDevWriteRegs(&psInst->dev, ISL29023_REG_COMMANDII, &command, 1) != I2C_STATUS_DONE){
+		return ISL29023_STATUS_BUS_ERROR;
+	}
+
+	ISL29023Settings(psInst, range, resolution);
+	return ISL29023_STATUS_OK;
 }
 
-void ISL29023GetRawIR(tISL29023 *psInst){
+uint8_t ISL29023GetRawALS(tISL29023 *psInst){
+	uint32_t raw;
+	uint8_t status = ISL29023OneShot(psInst, ISL29023_COMMANDI_ONEALS, &raw);
 
-	// Configure to write, send control register
-	ROM_I2CMasterSlaveAddrSet(I2C3_BASE, ISL29023_I2C_ADDRESS, false);
-	ROM_I2CMasterDataPut(I2C3_BASE, ISL29023_REG_COMMANDI);
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_SEND_START);
+	if(status == ISL29023_STATUS_OK){
+		ISL29023RawSet(psInst, raw);
+	}
+	return status;
+}
 
-	// Wait for bus to free
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
+uint8_t ISL29023GetALS(tISL29023 *psInst){
+	uint8_t status = ISL29023GetRawALS(psInst);
 
-	// Send data byte
-	ROM_I2CMasterDataPut(I2C3_BASE, ISL29023_COMMANDI_ONEIR | ISL29023_COMMANDI_PERSIST1);
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_SEND_FINISH);
+	if(status == ISL29023_STATUS_OK){
+		ISL29023ConvertALS(psInst, ISL29023Raw(psInst));
+	}
+	return status;
+}
 
-	// Wait for bus to free
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
+uint8_t ISL29023GetRawIR(tISL29023 *psInst){
+	uint32_t raw;
+	uint8_t status = ISL29023OneShot(psInst, ISL29023_COMMANDI_ONEIR, &raw);
 
-	// Wait for measurement to complete
-	switch(psInst->resSetting){
-		case 65536:
-			ROM_SysCtlDelay(ROM_SysCtlClockGet()/3/11);
-			break;
-		case 4096:
-			ROM_SysCtlDelay(ROM_SysCtlClockGet()/3/166);
-			break;
-		case 256:
-			ROM_SysCtlDelay(ROM_SysCtlClockGet()/3/250);
-			break;
-		case 16:
-			ROM_SysCtlDelay(ROM_SysCtlClockGet()/3/250);
-			break;
-		default:
-			ROM_SysCtlDelay(ROM_SysCtlClockGet()/3/11);
-			break;
+	if(status == ISL29023_STATUS_OK){
+		ISL29023RawSet(psInst, raw);
 	}
+	return status;
+}
+
+uint8_t ISL29023GetIR(tISL29023 *psInst){
+	uint8_t status = ISL29023GetRawIR(psInst);
 
-	// Send start, configure to write, send LSB register
-	ROM_I2CMasterSlaveAddrSet(I2C3_BASE, ISL29023_I2C_ADDRESS, false);
-	ROM_I2CMasterDataPut(I2C3_BASE, ISL29023_REG_DATALSB);
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_SEND_START);
-	
-	// Wait for bus to free
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
+	if(status == ISL29023_STATUS_OK){
+		ISL29023ConvertIR(psInst, ISL29023Raw(psInst));
+	}
+	return status;
+}
 
-	// Send restart, configure to read
-	ROM_I2CMasterSlaveAddrSet(I2C3_BASE, ISL29023_I2C_ADDRESS, true);
 
-	// Read LSB
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_START);
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
-	psInst->rawVals[1] = ROM_I2CMasterDataGet(I2C3_BASE);
+// IR compensation -----------------------------------------------------------------------------------
 
-	// Read MSB
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_FINISH);
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
-	psInst->rawVals[0] = ROM_I2CMasterDataGet(I2C3_BASE);
+// Configure ISL29023GetCompensatedALS. irResolution (ISL29023_COMMANDII_RES*) is used for the IR
+// conversion only, so a coarse setting keeps the extra time small: 8 bit adds ~4 ms to a 16 bit
+// ALS conversion. irWeight is the fraction of the IR reading subtracted, 256 = 1.0
+void ISL29023SetIRCompensation(tISL29023 *psInst, uint8_t irResolution, uint16_t irWeight){
+	psInst->irResolution = irResolution;
+	psInst->irWeight = irWeight;
 }
 
-void ISL29023GetIR(tISL29023 *psInst){
-	ISL29023GetRawIR(psInst);
-	psInst->irVal = ((float)((psInst->rawVals[0] << 8) | psInst->rawVals[1])) / psInst->beta;
+// IR reading followed by an ALS reading at the current range and resolution. The lux result has
+// the weighted IR removed; the IR result is scaled to ALS counts before converting. rawVals holds
+// the uncompensated ALS reading afterwards. On a bus error no result changes, and the caller's
+// resolution is put back unless that write failed too
+uint8_t ISL29023GetCompensatedALS(tISL29023 *psInst){
+	uint8_t range = g_pui8RangeCodes[psInst->rangeIndex];
+	uint8_t alsResolution = g_pui8ResCodes[(psInst->resShift >> 2) - 1];
+	uint8_t irShift = 0;
+	uint8_t status;
+	uint32_t ir = 0, als, weighted;
+
+	// IR at the faster resolution
+	status = ISL29023ChangeSettings(range, psInst->irResolution, psInst);
+	if(status == ISL29023_STATUS_OK){
+		status = ISL29023OneShot(psInst, ISL29023_COMMANDI_ONEIR, &ir);
+		irShift = psInst->resShift;
+	}
+
+	// ALS at the caller's resolution
+	if(ISL29023ChangeSettings(range, alsResolution, psInst) != ISL29023_STATUS_OK){
+		status = ISL29023_STATUS_BUS_ERROR;
+	}
+	if(status == ISL29023_STATUS_OK){
+		status = ISL29023OneShot(psInst, ISL29023_COMMANDI_ONEALS, &als);
+	}
+	if(status != ISL29023_STATUS_OK){
+		return status;
+	}
+	ISL29023RawSet(psInst, als);
+
+	// Bring IR to ALS counts
+	if(irShift < psInst->resShift){
+		ir <<= psInst->resShift - irShift;
+	} else{
+		ir >>= irShift - psInst->resShift;
+	}
+
+	weighted = (ir * psInst->irWeight) >> 8;
+	ISL29023ConvertALS(psInst, (als > weighted) ? als - weighted : 0);
+	ISL29023ConvertIR(psInst, ir);
+	return ISL29023_STATUS_OK;
+}
+
+
+// Continuous mode -----------------------------------------------------------------------------------
+
+// Set the interrupt window in raw counts. INT asserts when a reading is below low or above high.
+// Returns an ISL29023_STATUS_*
+uint8_t ISL29023SetThresholds(tISL29023 *psInst, uint16_t low, uint16_t high){
+	uint8_t thresholds[4] = {low & 0xFF, low >> 8, high & 0xFF, high >> 8};
+
+	// The four threshold registers are consecutive, so write them in one transaction
+	if(I2CLibDevWriteRegs(&psInst->dev, ISL29023_REG_LOWINTLSB, thresholds, 4) != I2C_STATUS_DONE){
+		return ISL29023_STATUS_BUS_ERROR;
+	}
+	return ISL29023_STATUS_OK;
+}
+
+// Convert ALS continuously and only raise INT when light leaves the threshold window for persist
+// (ISL29023_COMMANDI_PERSIST*) consecutive readings. If band is non-zero the window is moved to
+// +/- band counts around each reading that raised INT, so the bus is only used when light changes
+// by more than band. Set the initial window with ISL29023SetThresholds before calling this.
+// Returns an ISL29023_STATUS_*
+uint8_t ISL29023StartContinuous(tISL29023 *psInst, uint8_t persist, uint16_t band){
+	psInst->commandI = ISL29023_COMMANDI_CONTALS | (persist & ISL29023_COMMANDI_PERSIST16);
+	psInst->band = band;
+	psInst->reading = false;
+
+	if(I2CLibDevWriteRegs(&psInst->dev, ISL29023_REG_COMMANDI, &psInst->commandI, 1) != I2C_STATUS_DONE){
+		return ISL29023_STATUS_BUS_ERROR;
+	}
+	return ISL29023_STATUS_OK;
+}
+
+// Call after INT has been seen low. Reads the reading that crossed the window, moves the window if
+// a band was set and clears the sensor's interrupt flag. Returns ISL29023_EVENT_ALS with the new
+// reading converted, ISL29023_EVENT_NONE if the flag wasn't set, or ISL29023_EVENT_ERROR after a
+// bus error. On an error the results are unchanged and INT stays low, so call again
+uint8_t ISL29023HandleInterrupt(tISL29023 *psInst){
+	uint8_t islData[4];
+	uint32_t raw;
+
+	// Command I, command II, data LSB and data MSB in one read
+	if(I2CLibDevReadRegs(&psInst->dev, ISL29023_REG_COMMANDI, islData, 4) != I2C_STATUS_DONE){
+		return ISL29023_EVENT_ERROR;
+	}
+	if(!(islData[0] & ISL29023_COMMANDI_INTFLAG)){
+		return ISL29023_EVENT_NONE;
+	}
+	raw = (islData[3] << 8) | islData[2];
+
+	// Track the light level
+	if(psInst->band && ISL29023SetThresholds(psInst, (raw > psInst->band) ? raw - psInst->band : 0, (raw + psInst->band < 0xFFFF) ? raw + psInst->band : 0xFFFF) != ISL29023_STATUS_OK){
+		return ISL29023_EVENT_ERROR;
+	}
+
+	// Rewriting the mode with the flag bit clear releases INT
+	if(I2CLibDevWriteRegs(&psInst->dev, ISL29023_REG_COMMANDI, &psInst->commandI, 1) != I2C_STATUS_DONE){
+		return ISL29023_EVENT_ERROR;
+	}
+
+	ISL29023RawSet(psInst, raw);
+	ISL29023ConvertALS(psInst, raw);
+	return ISL29023_EVENT_ALS;
+}
+
+
+// Queue a read of the latest continuous ALS conversion and return at once. Returns false if a read
+// is already in progress or the I2C queue is full
+bool ISL29023StartRead(tISL29023 *psInst){
+	if(psInst->reading){
+		return false;
+	}
+
+	psInst->txData[0] = ISL29023_REG_DATALSB;
+	if(!I2CLibDevQueue(&psInst->dev, &psInst->trans, psInst->txData, 1, psInst->rxData, 2)){
+		return false;
+	}
+
+	psInst->reading = true;
+	return true;
+}
+
+// Never blocks. Returns ISL29023_EVENT_ALS once a read started by ISL29023StartRead has updated
+// the lux result
+uint8_t ISL29023Service(tISL29023 *psInst){
+	if(!psInst->reading || psInst->trans.status == I2C_STATUS_PENDING){
+		return ISL29023_EVENT_NONE;
+	}
+
+	psInst->reading = false;
+	if(psInst->trans.status != I2C_STATUS_DONE){
+		return ISL29023_EVENT_ERROR;
+	}
+
+	psInst->rawVals[1] = psInst->rxData[0];
+	psInst->rawVals[0] = psInst->rxData[1];
+	ISL29023ConvertALS(psInst, ISL29023Raw(psInst));
+	return ISL29023_EVENT_ALS;
+}
+
+
+// Auto-ranging --------------------------------------------------------------------------------------
+
+// Switch to a range and the fastest resolution whose lux per count meets precisionMilli
+static uint8_t ISL29023AutoApply(tISL29023 *psInst, uint8_t rangeIndex){
+	uint8_t res;
+
+	// Resolutions are 2^4, 2^8, 2^12 and 2^16 counts
+	for(res = 0; res < 3; res++){
+		if((uint32_t)g_pui16RangeLux[rangeIndex] * 1000 <= ((uint64_t)psInst->precisionMilli << (4*res + 4))){
+			break;
+		}
+	}
+
+	return ISL29023ChangeSettings(g_pui8RangeCodes[rangeIndex], g_pui8ResCodes[res], psInst);
+}
+
+// Let ISL29023GetALSAuto choose range and resolution. precisionMilli is the coarsest acceptable
+// step in milli-lux; larger values allow shorter conversions (16 bit takes ~90 ms, 12 bit ~6 ms).
+// Returns an ISL29023_STATUS_*
+uint8_t ISL29023SetAutoRange(tISL29023 *psInst, uint32_t precisionMilli){
+	psInst->precisionMilli = precisionMilli;
+	psInst->clipCount = 0;
+
+	// Start at the widest range so the first reading can't saturate
+	return ISL29023AutoApply(psInst, ISL29023_RANGE_COUNT - 1);
+}
+
+// One-shot ALS reading with auto-ranging. A saturated reading is repeated at the next higher range
+// straight away; a dim reading moves the next one to a lower range. Returns
+// ISL29023_STATUS_SATURATED if the reading saturated even at 64k, and leaves the results unchanged
+// on a bus error
+uint8_t ISL29023GetALSAuto(tISL29023 *psInst){
+	uint32_t raw;
+	uint8_t status;
+
+	status = ISL29023OneShot(psInst, ISL29023_COMMANDI_ONEALS, &raw);
+	while(status == ISL29023_STATUS_OK && raw >= psInst->resSetting - (psInst->resSetting >> 4) && psInst->rangeIndex < ISL29023_RANGE_COUNT - 1){
+		status = ISL29023AutoApply(psInst, psInst->rangeIndex + 1);
+		if(status == ISL29023_STATUS_OK){
+			status = ISL29023OneShot(psInst, ISL29023_COMMANDI_ONEALS, &raw);
+		}
+	}
+	if(status != ISL29023_STATUS_OK){
+		return status;
+	}
+
+	ISL29023RawSet(psInst, raw);
+	ISL29023ConvertALS(psInst, raw);
+
+	if(raw >= psInst->resSetting - (psInst->resSetting >> 4)){
+		if(psInst->clipCount < 0xFFFF){
+			psInst->clipCount++;
+		}
+		return ISL29023_STATUS_SATURATED;
+	}
+
+	// If this write fails the range stays where it is, which still reads correctly
+	if(raw < (psInst->resSetting * 3) >> 4 && psInst->rangeIndex > 0){
+		ISL29023AutoApply(psInst, psInst->rangeIndex - 1);
+	}
+
+	return ISL29023_STATUS_OK;
 }
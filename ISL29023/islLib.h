@@ -14,9 +14,15 @@
 //	Interfaces with Intersil ISL29023 ambient light sensor
 //
 // Notes:
+//	Include i2cLib.h before this file
+//	Call ISL29023Initialize before any other function
+//	The blocking functions return an ISL29023_STATUS_* and leave their results unchanged on
+//	failure
+//	In continuous mode the sensor pulls its INT pin low when the ALS reading stays outside the
+//	threshold window for the persistence count. INT stays low until ISL29023HandleInterrupt
+//	clears the flag. On the SensorHub BoosterPack INT is wired to PE5
 //
 // Todo:
-//	Get infrared readings accurate
 //	
 //
 //****************************************************************************************************
@@ -44,16 +50,35 @@
 #define ISL29023_COMMANDI_ONEIR 0x40
 #define ISL29023_COMMANDI_CONTALS 0xA0
 #define ISL29023_COMMANDI_CONTIR 0xC0
+#define ISL29023_COMMANDI_INTFLAG 0x04
+
+// Values returned by the blocking functions
+#define ISL29023_STATUS_OK 0
+#define ISL29023_STATUS_BUS_ERROR 1	// NACK, arbitration lost or timeout
+#define ISL29023_STATUS_SATURATED 2	// ISL29023GetALSAuto only, saturated even at the 64k range
+
+// Values returned by ISL29023Service and ISL29023HandleInterrupt
+#define ISL29023_EVENT_NONE 0
+#define ISL29023_EVENT_ALS 1
+#define ISL29023_EVENT_ERROR 2
 
 #define ISL29023_COMMANDII_RANGE1k 0x00
-#define ISL29023_COMMANDII_RANGE4k 0x02
-#define ISL29023_COMMANDII_RANGE16k 0x01
+#define ISL29023_COMMANDII_RANGE4k 0x01
+#define ISL29023_COMMANDII_RANGE16k 0x02
 #define ISL29023_COMMANDII_RANGE64k 0x03
 #define ISL29023_COMMANDII_RES16 0x00
 #define ISL29023_COMMANDII_RES12 0x04
 #define ISL29023_COMMANDII_RES8 0x08
 #define ISL29023_COMMANDII_RES4 0xC
 
+// Auto-ranging. Readings at or above 15/16 of full scale count as saturated, readings below 3/16
+// of full scale move to the next lower range (about 3/4 of its full scale, so the two don't
+// oscillate)
+#define ISL29023_RANGE_COUNT 4
+
+// Define ISL29023_FIXED_POINT (see Makefile) to report alsMilli/irMilli, integer results in
+// thousandths, instead of the float alsVal/irVal. No floating point is used in that case
+
 
 
 
@@ -63,18 +88,56 @@ typedef struct
 	uint32_t resSetting;
 	uint16_t rangeSetting;
 	uint32_t rawVals[2];
+	uint8_t resShift;	// log2(resSetting)
+#ifdef ISL29023_FIXED_POINT
+	uint32_t alsMilli;	// Ambient light in milli-lux
+	uint32_t irMilli;	// IR reading, in thousandths of irVal's units
+	uint32_t irScale;	// 1000 / beta at 16 bit in 16.16 fixed point, scaled by resSetting on conversion
+#else
 	float alpha;
-	float beta;	// TI Code has following four possible values: 95.238, 23.810, 5.952, 1.486 - all based on range
+	float beta;	// IR counts per unit, 95.238, 23.810, 5.952, 1.486 for 1k to 64k at 16 bit, scaled by resSetting
 	float alsVal;
 	float irVal;
+#endif
+
+	// IR compensation, see ISL29023SetIRCompensation
+	uint16_t irWeight;	// Fraction of the IR reading removed from ALS, 8.8 fixed point
+	uint8_t irResolution;	// ISL29023_COMMANDII_RES* used for the IR half
+
+	// Auto-ranging, see ISL29023SetAutoRange
+	uint32_t precisionMilli;	// Largest acceptable lux per count, in milli-lux
+	uint16_t clipCount;		// Readings saturated even at the 64k range
+	uint8_t rangeIndex;		// 0 (1k) to 3 (64k), set by ISL29023ChangeSettings
+
+	// Continuous mode, see ISL29023StartContinuous
+	uint8_t commandI;	// Operation mode and persistence written to command register I
+	uint16_t band;		// Half width of the window kept around the last reading, 0 for fixed thresholds
+
+	tI2CDevice dev;		// Bus and slave address
+
+	// Non-blocking read of the latest continuous conversion, see ISL29023StartRead
+	tI2CTransaction trans;
+	uint8_t txData[1];
+	uint8_t rxData[2];
+	bool reading;
 } tISL29023;
 
 
 
 
 // Functions -----------------------------------------------------------------------------------------
-extern void ISL29023ChangeSettings(uint8_t range, uint8_t resolution, tISL29023 *psInst);
-extern void ISL29023GetRawALS(tISL29023 *psInst);
-extern void ISL29023GetALS(tISL29023 *psInst);
-extern void ISL29023GetRawIR(tISL29023 *psInst);
-extern void ISL29023GetIR(tISL29023 *psInst);
+extern void ISL29023Initialize(tISL29023 *psInst, tI2CBus *psBus);
+extern uint8_t ISL29023ChangeSettings(uint8_t range, uint8_t resolution, tISL29023 *psInst);
+extern uint8_t ISL29023GetRawALS(tISL29023 *psInst);
+extern uint8_t ISL29023GetALS(tISL29023 *psInst);
+extern uint8_t ISL29023GetRawIR(tISL29023 *psInst);
+extern uint8_t ISL29023GetIR(tISL29023 *psInst);
+extern void ISL29023SetIRCompensation(tISL29023 *psInst, uint8_t irResolution, uint16_t irWeight);
+extern uint8_t ISL29023GetCompensatedALS(tISL29023 *psInst);
+extern uint8_t ISL29023SetAutoRange(tISL29023 *psInst, uint32_t precisionMilli);
+extern uint8_t ISL29023GetALSAuto(tISL29023 *psInst);
+extern uint8_t ISL29023SetThresholds(tISL29023 *psInst, uint16_t low, uint16_t high);
+extern uint8_t ISL29023StartContinuous(tISL29023 *psInst, uint8_t persist, uint16_t band);
+extern uint8_t ISL29023HandleInterrupt(tISL29023 *psInst);
+extern bool ISL29023StartRead(tISL29023 *psInst);
+extern uint8_t ISL29023Service(tISL29023 *psInst);
@@ -22,6 +22,25 @@
 //
 // Notes:
 //	Specific to SD cards as of right now
+//	512 byte data blocks are moved by uDMA (SSI0 RX on channel 10, TX on channel 11). The CPU only
+//	handles tokens, CRC and responses, and runs the hook set with disk_idle_set while a block is on
+//	the wire. disk_dmaproc must be placed in the SSI0 slot of the vector table in startup_gcc.c
+//	While the card is busy programming, wait_ready polls it once per call of the same hook. A hook
+//	that sleeps until the next interrupt turns this into one poll per tick. The hook is called with
+//	interrupts masked right after the wait condition is checked, so an interrupt that ends the wait
+//	can't slip in before a sleep; it still wakes the core and is taken when the hook returns
+//	disk_timerproc must be called every 10ms or no wait will time out. The card-busy time of each
+//	wait is kept as a histogram, read it with disk_ioctl(MMC_GET_BUSYHIST)
+//	Writes of fewer than SDC_CACHE_SECTORS sectors go to a write-behind cache. Dirty sectors are
+//	written, adjacent ones merged into one CMD25, when the cache is full, when the oldest dirty data
+//	is SDC_CACHE_AGE ticks old (checked by disk_cache_service and each read or write), or on
+//	CTRL_SYNC (f_sync, f_close) and disk_ioctl(MMC_FLUSH_CACHE). Between disk_ioctl(MMC_SYNC_DEFER)
+//	set and clear, CTRL_SYNC only waits for the card, so a caller that syncs often (LogSync) leaves
+//	up to SDC_CACHE_AGE of data in RAM. disk_initialize flushes before dropping the cache, and fails
+//	if it can't. Define SDC_CACHE_SECTORS as 0 to write straight through
+//	The uDMA control table is owned by this file. Define SDC_NO_DMA to leave uDMA alone; data blocks
+//	are then moved with xmit_spi_multi/rcvr_spi_multi, which keep the SSI FIFO busy instead of waiting
+//	out a round trip per byte
 //
 //
 //****************************************************************************************************
@@ -32,13 +51,18 @@
 // Includes ------------------------------------------------------------------------------------------
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
+#include "inc/hw_ints.h"
 #include "inc/hw_memmap.h"
+#include "inc/hw_ssi.h"
 #include "inc/hw_types.h"
 #include "driverlib/gpio.h"
+#include "driverlib/interrupt.h"
 #include "driverlib/rom.h"
 #include "driverlib/rom_map.h"
 #include "driverlib/ssi.h"
 #include "driverlib/sysctl.h"
+#include "driverlib/udma.h"
 #include "diskio.h"
 
 
@@ -69,6 +93,21 @@
 // SSI port
 #define SDC_SSI_BASE            SSI0_BASE
 #define SDC_SSI_SYSCTL_PERIPH   SYSCTL_PERIPH_SSI0
+#define SDC_SSI_FIFO_DEPTH      8       /* Frames the TX and RX FIFOs each hold */
+#define SDC_SSI_INT             INT_SSI0
+
+// uDMA channels for the SSI port
+#define SDC_DMA_RX              UDMA_CHANNEL_SSI0RX
+#define SDC_DMA_TX              UDMA_CHANNEL_SSI0TX
+#define SDC_DMA_MIN             64      /* Shorter blocks (CSD, CID) are moved by the CPU */
+
+// Write-behind cache
+#ifndef SDC_CACHE_SECTORS
+#define SDC_CACHE_SECTORS       4       /* 512 bytes of RAM each */
+#endif
+#define SDC_CACHE_AGE           100     /* Longest a sector stays dirty, in 10ms ticks */
+#define CACHE_VALID             0x01
+#define CACHE_DIRTY             0x02
 
 // GPIO for SSI pins
 #define SDC_GPIO_PORT_BASE      GPIO_PORTA_BASE
@@ -99,6 +138,26 @@ static volatile DSTATUS Stat = STA_NOINIT;    	/* Disk status */
 static volatile BYTE Timer1, Timer2;    	/* 100Hz decrement timer */
 static BYTE CardType;            		/* b0:MMC, b1:SDC, b2:Block addressing */
 static BYTE PowerFlag = 0;     			/* Indicates if "power" is on */
+static void (*IdleHook)(void);			/* Called while waiting on the card, see disk_idle_set */
+static DWORD BusyHist[BUSY_HIST_BINS];		/* Card-busy waits by length, see busy_record */
+static DWORD WritesLogical, WritesPhysical;	/* Sectors passed to disk_write / sent to the card */
+
+#if SDC_CACHE_SECTORS
+static BYTE CacheBuf[SDC_CACHE_SECTORS][512];	/* Cached sector data */
+static DWORD CacheLba[SDC_CACHE_SECTORS];	/* Sector number of each slot */
+static BYTE CacheState[SDC_CACHE_SECTORS];	/* CACHE_VALID, CACHE_DIRTY */
+static BYTE CacheNext;				/* Round-robin replacement pointer */
+static BOOL CacheDirty;				/* Any slot dirty */
+static BOOL CacheDefer;				/* CTRL_SYNC doesn't flush, see MMC_SYNC_DEFER */
+static volatile WORD CacheTimer;		/* 100Hz decrement timer, flush when it expires */
+#endif
+
+#ifndef SDC_NO_DMA
+static volatile BYTE DmaBusy;			/* Set while a block is on uDMA, cleared by disk_dmaproc */
+static BYTE DmaFill = 0xFF;			/* TX source when reading */
+static BYTE DmaSink;				/* RX destination when writing */
+static uint8_t DmaControlTable[1024] __attribute__ ((aligned(1024)));	/* uDMA channel control table */
+#endif
 
 /* Transmit a byte to MMC via SPI  (Platform dependent)                  */
 static void xmit_spi(BYTE dat){
@@ -117,21 +176,146 @@ static BYTE rcvr_spi (void){
 }
 
 
-static void rcvr_spi_m (BYTE *dst){
-    *dst = rcvr_spi();
+#ifdef SDC_NO_DMA
+/* Transmit a block of bytes to MMC via SPI  (Platform dependent)       */
+/* The TX FIFO is kept topped up and RX drained as it arrives, so the   */
+/* clock runs without gaps. At most SDC_SSI_FIFO_DEPTH frames are in    */
+/* flight so the RX FIFO can never overflow.                            */
+static void xmit_spi_multi (const BYTE *buff, UINT btx){
+    UINT sent = 0, rcvd = 0;
+
+    while (rcvd < btx) {
+        while (sent < btx && (sent - rcvd) < SDC_SSI_FIFO_DEPTH && (HWREG(SDC_SSI_BASE + SSI_O_SR) & SSI_SR_TNF)) {
+            HWREG(SDC_SSI_BASE + SSI_O_DR) = buff[sent++];
+        }
+        while (HWREG(SDC_SSI_BASE + SSI_O_SR) & SSI_SR_RNE) {
+            (void)HWREG(SDC_SSI_BASE + SSI_O_DR);    /* Flush data read during the write */
+            rcvd++;
+        }
+    }
+}
+#endif /* SDC_NO_DMA */
+
+
+/* Receive a block of bytes from MMC via SPI  (Platform dependent)      */
+/* Same pipelining as xmit_spi_multi with 0xFF as the dummy data        */
+static void rcvr_spi_multi (BYTE *buff, UINT btr){
+    UINT sent = 0, rcvd = 0;
+
+    while (rcvd < btr) {
+        while (sent < btr && (sent - rcvd) < SDC_SSI_FIFO_DEPTH && (HWREG(SDC_SSI_BASE + SSI_O_SR) & SSI_SR_TNF)) {
+            HWREG(SDC_SSI_BASE + SSI_O_DR) = 0xFF;
+            sent++;
+        }
+        while (HWREG(SDC_SSI_BASE + SSI_O_SR) & SSI_SR_RNE) {
+            buff[rcvd++] = (BYTE)HWREG(SDC_SSI_BASE + SSI_O_DR);
+        }
+    }
+}
+
+
+#ifndef SDC_NO_DMA
+/* Set up uDMA for the SSI port  (Platform dependent)                   */
+static void dma_init (void){
+    ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_UDMA);
+    ROM_uDMAEnable();
+    ROM_uDMAControlBaseSet(DmaControlTable);
+
+    ROM_uDMAChannelAssign(UDMA_CH10_SSI0RX);
+    ROM_uDMAChannelAssign(UDMA_CH11_SSI0TX);
+    ROM_uDMAChannelAttributeDisable(SDC_DMA_RX, UDMA_ATTR_ALL);
+    ROM_uDMAChannelAttributeDisable(SDC_DMA_TX, UDMA_ATTR_ALL);
+    ROM_uDMAChannelAttributeEnable(SDC_DMA_RX, UDMA_ATTR_HIGH_PRIORITY);    /* Keep RX drained ahead of TX */
+
+    ROM_IntEnable(SDC_SSI_INT);        	/* uDMA completion is signalled on the SSI vector */
+}
+
+
+/* Move a block of bytes via uDMA  (Platform dependent)                 */
+/* Both channels run in basic mode for the whole block. RX finishes     */
+/* last, so its completion interrupt ends the transfer                  */
+static BOOL dma_block (
+    BYTE *rbuff,        		/* Buffer for received data, 0 to discard */
+    const BYTE *tbuff,        		/* Data to send, 0 to send 0xFF */
+    UINT len        			/* Byte count (1..1024) */
+){
+    ROM_uDMAChannelControlSet(SDC_DMA_RX | UDMA_PRI_SELECT,
+        UDMA_SIZE_8 | UDMA_SRC_INC_NONE | (rbuff ? UDMA_DST_INC_8 : UDMA_DST_INC_NONE) | UDMA_ARB_4);
+    ROM_uDMAChannelTransferSet(SDC_DMA_RX | UDMA_PRI_SELECT, UDMA_MODE_BASIC,
+        (void *)(SDC_SSI_BASE + SSI_O_DR), rbuff ? rbuff : &DmaSink, len);
+    ROM_uDMAChannelControlSet(SDC_DMA_TX | UDMA_PRI_SELECT,
+        UDMA_SIZE_8 | (tbuff ? UDMA_SRC_INC_8 : UDMA_SRC_INC_NONE) | UDMA_DST_INC_NONE | UDMA_ARB_4);
+    ROM_uDMAChannelTransferSet(SDC_DMA_TX | UDMA_PRI_SELECT, UDMA_MODE_BASIC,
+        tbuff ? (void *)tbuff : &DmaFill, (void *)(SDC_SSI_BASE + SSI_O_DR), len);
+
+    DmaBusy = 1;
+    ROM_uDMAChannelEnable(SDC_DMA_RX);
+    ROM_uDMAChannelEnable(SDC_DMA_TX);
+    ROM_SSIDMAEnable(SDC_SSI_BASE, SSI_DMA_RX | SSI_DMA_TX);
+
+    Timer1 = 5;                        	/* Timeout of 50ms, a block takes 10ms even at 400kHz */
+    ROM_IntMasterDisable();            	/* Masked so the completion can't land between check and hook */
+    while (DmaBusy && Timer1) {
+        if (IdleHook) IdleHook();
+        ROM_IntMasterEnable();        	/* Take whatever woke the hook */
+        ROM_IntMasterDisable();
+    }
+    ROM_IntMasterEnable();
+
+    ROM_SSIDMADisable(SDC_SSI_BASE, SSI_DMA_RX | SSI_DMA_TX);
+    if (DmaBusy) {                    	/* Timed out, stop both channels and flush RX */
+        ROM_uDMAChannelDisable(SDC_DMA_RX);
+        ROM_uDMAChannelDisable(SDC_DMA_TX);
+        while (ROM_SSIBusy(SDC_SSI_BASE));
+        while (HWREG(SDC_SSI_BASE + SSI_O_SR) & SSI_SR_RNE) (void)HWREG(SDC_SSI_BASE + SSI_O_DR);
+        DmaBusy = 0;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+#endif /* SDC_NO_DMA */
+
+
+/* Count a card-busy wait of the given number of 10ms ticks            */
+/* Bin 0 is under 10ms, bin n is 2^(n-1) to 2^n ticks, the last bin     */
+/* counts timeouts                                                       */
+static void busy_record (BYTE ticks, BOOL timedout){
+    BYTE b = 0;
+
+    if (timedout) {
+        b = BUSY_HIST_BINS - 1;
+    } else {
+        while (ticks && b < BUSY_HIST_BINS - 2) {
+            b++;
+            ticks >>= 1;
+        }
+    }
+    BusyHist[b]++;
 }
 
 
 /* Wait for card ready                                                   */
+/* The card only holds DO low while programming after a write, so the   */
+/* first poll normally returns ready and nothing is recorded             */
 static BYTE wait_ready (void){
     BYTE res;
 
     Timer2 = 50;    				/* Wait for ready in timeout of 500ms */
     rcvr_spi();
-    do
+    res = rcvr_spi();
+    if (res == 0xFF) return res;
+
+    ROM_IntMasterDisable();    			/* Masked so the timeout tick can't land between check and hook */
+    do {
+        if (IdleHook) IdleHook();    		/* Let the application run while the card programs */
+        ROM_IntMasterEnable();
+        ROM_IntMasterDisable();
         res = rcvr_spi();
-    while ((res != 0xFF) && Timer2);
+    } while ((res != 0xFF) && Timer2);
+    ROM_IntMasterEnable();
 
+    busy_record(50 - Timer2, res != 0xFF);
     return res;
 }
 
@@ -194,6 +378,10 @@ static void power_on (void){
     ROM_SSIConfigSetExpClk(SDC_SSI_BASE, ROM_SysCtlClockGet(), SSI_FRF_MOTO_MODE_0, SSI_MODE_MASTER, 400000, 8);
     ROM_SSIEnable(SDC_SSI_BASE);
 
+#ifndef SDC_NO_DMA
+    dma_init();
+#endif
+
     /* Set DI and CS high and apply more than 74 pulses to SCLK for the card */
     /* to be able to accept a native command. */
     send_initial_clock_train();
@@ -248,10 +436,12 @@ static BOOL rcvr_datablock (
     } while ((token == 0xFF) && Timer1);
     if(token != 0xFE) return FALSE;    	/* If not valid data token, retutn with error */
 
-    do {                            	/* Receive the data block into buffer */
-        rcvr_spi_m(buff++);
-        rcvr_spi_m(buff++);
-    } while (btr -= 2);
+#ifndef SDC_NO_DMA
+    if (btr >= SDC_DMA_MIN) {            	/* Receive the data block into buffer */
+        if (!dma_block(buff, 0, btr)) return FALSE;
+    } else
+#endif
+    rcvr_spi_multi(buff, btr);
     rcvr_spi();                        	/* Discard CRC */
     rcvr_spi();
 
@@ -265,18 +455,19 @@ static BOOL xmit_datablock (
     const BYTE *buff,    		/* 512 byte data block to be transmitted */
     BYTE token            		/* Data/Stop token */
 ){
-    BYTE resp, wc;
+    BYTE resp;
 
 
     if (wait_ready() != 0xFF) return FALSE;
 
     xmit_spi(token);                    /* Xmit data token */
     if (token != 0xFD) {    		/* Is data token */
-        wc = 0;
-        do {                            /* Xmit the 512 byte data block to MMC */
-            xmit_spi(*buff++);
-            xmit_spi(*buff++);
-        } while (--wc);
+#ifndef SDC_NO_DMA
+        if (!dma_block(0, buff, 512))   /* Xmit the 512 byte data block to MMC */
+            return FALSE;
+#else
+        xmit_spi_multi(buff, 512);      /* Xmit the 512 byte data block to MMC */
+#endif
         xmit_spi(0xFF);                 /* CRC (Dummy) */
         xmit_spi(0xFF);
         resp = rcvr_spi();              /* Reveive data response */
@@ -367,6 +558,158 @@ static BYTE send_cmd12 (void){
 
 
 
+/* Read sector(s) from the card */
+static DRESULT mmc_read (
+    BYTE *buff,            		/* Pointer to the data buffer to store read data */
+    DWORD sector,       	  	/* Start sector number (LBA) */
+    UINT count            		/* Sector count (1..255) */
+){
+    if (!(CardType & 4)) sector *= 512;    	/* Convert to byte address if needed */
+
+    SELECT();            		   	/* CS = L */
+
+    if (count == 1) {    		   	/* Single block read */
+        if ((send_cmd(CMD17, sector) == 0) 	/* READ_SINGLE_BLOCK */
+            && rcvr_datablock(buff, 512))
+            count = 0;
+    }
+    else {               			/* Multiple block read */
+        if (send_cmd(CMD18, sector) == 0) {    	/* READ_MULTIPLE_BLOCK */
+            do {
+                if (!rcvr_datablock(buff, 512)) break;
+                buff += 512;
+            } while (--count);
+            send_cmd12();                	/* STOP_TRANSMISSION */
+        }
+    }
+
+    DESELECT();            			/* CS = H */
+    rcvr_spi();            			/* Idle (Release DO) */
+
+    return count ? RES_ERROR : RES_OK;
+}
+
+
+/* Write sector(s) to the card */
+#if _READONLY == 0
+static DRESULT mmc_write (
+    const BYTE *buff,    			/* Pointer to the data to be written */
+    const BYTE **list,    			/* Pointer to each sector's data instead of buff, or 0 */
+    DWORD sector,       			/* Start sector number (LBA) */
+    UINT count           			/* Sector count (1..255) */
+){
+    if (Stat & STA_NOINIT) return RES_NOTRDY;
+    if (Stat & STA_PROTECT) return RES_WRPRT;
+
+    WritesPhysical += count;
+    if (!(CardType & 4)) sector *= 512;    	/* Convert to byte address if needed */
+
+    SELECT();           		 	/* CS = L */
+
+    if (count == 1) {    			/* Single block write */
+        if ((send_cmd(CMD24, sector) == 0)    	/* WRITE_BLOCK */
+            && xmit_datablock(list ? list[0] : buff, 0xFE))
+            count = 0;
+    }
+    else {                			/* Multiple block write */
+        if (CardType & 2) {
+            send_cmd(CMD55, 0); send_cmd(CMD23, count);    /* ACMD23 */
+        }
+        if (send_cmd(CMD25, sector) == 0) {    	/* WRITE_MULTIPLE_BLOCK */
+            do {
+                if (!xmit_datablock(list ? *list++ : buff, 0xFC)) break;
+                if (!list) buff += 512;
+            } while (--count);
+            if (!xmit_datablock(0, 0xFD))    	/* STOP_TRAN token */
+                count = 1;
+        }
+    }
+
+    DESELECT();            			/* CS = H */
+    rcvr_spi();            			/* Idle (Release DO) */
+
+    return count ? RES_ERROR : RES_OK;
+}
+#endif /* _READONLY */
+
+
+#if SDC_CACHE_SECTORS
+/* Find the cache slot holding a sector, -1 if none */
+static int cache_find (DWORD sector){
+    int i;
+
+    for (i = 0; i < SDC_CACHE_SECTORS; i++)
+        if ((CacheState[i] & CACHE_VALID) && CacheLba[i] == sector) return i;
+    return -1;
+}
+
+
+/* Write all dirty sectors to the card                                  */
+/* Starting from the lowest dirty sector, each run of consecutive dirty */
+/* sectors goes out as one multiple block write                         */
+static DRESULT cache_flush (void){
+    const BYTE *list[SDC_CACHE_SECTORS];
+    BYTE run[SDC_CACHE_SECTORS];
+    DWORD start = 0;
+    BYTE i, n;
+
+    for (;;) {
+        n = 0;
+        for (i = 0; i < SDC_CACHE_SECTORS; i++) {    	/* Lowest dirty sector starts the run */
+            if ((CacheState[i] & CACHE_DIRTY) && (!n || CacheLba[i] < start)) {
+                start = CacheLba[i];
+                run[0] = i;
+                n = 1;
+            }
+        }
+        if (!n) break;
+
+        for (;;) {                    		/* Extend it with the sectors that follow */
+            for (i = 0; i < SDC_CACHE_SECTORS; i++)
+                if ((CacheState[i] & CACHE_DIRTY) && CacheLba[i] == start + n) break;
+            if (i == SDC_CACHE_SECTORS) break;
+            run[n++] = i;
+        }
+
+        for (i = 0; i < n; i++) list[i] = CacheBuf[run[i]];
+        if (mmc_write(0, list, start, n) != RES_OK) return RES_ERROR;
+        for (i = 0; i < n; i++) CacheState[run[i]] &= ~CACHE_DIRTY;
+    }
+
+    CacheDirty = FALSE;
+    return RES_OK;
+}
+
+
+/* Put a sector in the cache, flushing first if every slot is dirty */
+static DRESULT cache_write (const BYTE *buff, DWORD sector){
+    int i;
+    BYTE n;
+
+    i = cache_find(sector);
+    if (i < 0) {
+        for (n = 0; n < SDC_CACHE_SECTORS && (CacheState[CacheNext] & CACHE_DIRTY); n++)
+            CacheNext = (CacheNext + 1) % SDC_CACHE_SECTORS;
+        if (n == SDC_CACHE_SECTORS && cache_flush() != RES_OK) return RES_ERROR;
+        i = CacheNext;
+        CacheNext = (CacheNext + 1) % SDC_CACHE_SECTORS;
+        CacheLba[i] = sector;
+    }
+
+    memcpy(CacheBuf[i], buff, 512);
+    CacheState[i] = CACHE_VALID | CACHE_DIRTY;
+    if (!CacheDirty) {                    	/* Age runs from the first dirty sector */
+        CacheDirty = TRUE;
+        CacheTimer = SDC_CACHE_AGE;
+    }
+
+    return RES_OK;
+}
+#endif /* SDC_CACHE_SECTORS */
+
+
+
+
 // "Public" Functions -------------------------------------------------------------------------------
 
 
@@ -381,6 +724,11 @@ DSTATUS disk_initialize (
     if (drv) return STA_NOINIT;            	/* Supports only single drive */
     if (Stat & STA_NODISK) return Stat;    	/* No card in the socket */
 
+#if SDC_CACHE_SECTORS
+    if (CacheDirty && cache_flush() != RES_OK)	/* Sectors FatFs counts as written must reach the card */
+        return Stat | STA_NOINIT;        	/* first. Kept, so a later call can retry */
+#endif
+
     power_on();                            	/* Force socket power on */
     send_initial_clock_train();            	/* Ensure the card is in SPI mode */
 
@@ -416,6 +764,11 @@ DSTATUS disk_initialize (
     DESELECT();            			/* CS = H */
     rcvr_spi();           			/* Idle (Release DO) */
 
+#if SDC_CACHE_SECTORS
+    for (n = 0; n < SDC_CACHE_SECTORS; n++)    	/* The card may have been swapped, nothing is dirty */
+        CacheState[n] = 0;
+#endif
+
     if (ty) {           		 	/* Initialization succeded */
         Stat &= ~STA_NOINIT;        		/* Clear STA_NOINIT */
         set_max_speed();
@@ -444,32 +797,29 @@ DRESULT disk_read (
     DWORD sector,       	  	/* Start sector number (LBA) */
     UINT count            		/* Sector count (1..255) */
 ){
+#if SDC_CACHE_SECTORS
+    BYTE i, hits;
+#endif
+
     if (drv || !count) return RES_PARERR;
     if (Stat & STA_NOINIT) return RES_NOTRDY;
 
-    if (!(CardType & 4)) sector *= 512;    	/* Convert to byte address if needed */
+#if SDC_CACHE_SECTORS
+    disk_cache_service();
 
-    SELECT();            		   	/* CS = L */
+    hits = 0;                            	/* Only go to the card if a sector isn't cached */
+    for (i = 0; i < SDC_CACHE_SECTORS; i++)
+        if ((CacheState[i] & CACHE_VALID) && CacheLba[i] - sector < count) hits++;
+    if (hits < count && mmc_read(buff, sector, count) != RES_OK) return RES_ERROR;
 
-    if (count == 1) {    		   	/* Single block read */
-        if ((send_cmd(CMD17, sector) == 0) 	/* READ_SINGLE_BLOCK */
-            && rcvr_datablock(buff, 512))
-            count = 0;
-    }
-    else {               			/* Multiple block read */
-        if (send_cmd(CMD18, sector) == 0) {    	/* READ_MULTIPLE_BLOCK */
-            do {
-                if (!rcvr_datablock(buff, 512)) break;
-                buff += 512;
-            } while (--count);
-            send_cmd12();                	/* STOP_TRANSMISSION */
-        }
-    }
+    for (i = 0; i < SDC_CACHE_SECTORS; i++)    	/* Cached copies are never older than the card's */
+        if ((CacheState[i] & CACHE_VALID) && CacheLba[i] - sector < count)
+            memcpy(buff + (CacheLba[i] - sector) * 512, CacheBuf[i], 512);
 
-    DESELECT();            			/* CS = H */
-    rcvr_spi();            			/* Idle (Release DO) */
-
-    return count ? RES_ERROR : RES_OK;
+    return RES_OK;
+#else
+    return mmc_read(buff, sector, count);
+#endif
 }
 
 
@@ -482,37 +832,33 @@ DRESULT disk_write (
     DWORD sector,       			/* Start sector number (LBA) */
     UINT count           			/* Sector count (1..255) */
 ){
+#if SDC_CACHE_SECTORS
+    BYTE i;
+#endif
+
     if (drv || !count) return RES_PARERR;
     if (Stat & STA_NOINIT) return RES_NOTRDY;
     if (Stat & STA_PROTECT) return RES_WRPRT;
 
-    if (!(CardType & 4)) sector *= 512;    	/* Convert to byte address if needed */
+    WritesLogical += count;
 
-    SELECT();           		 	/* CS = L */
+#if SDC_CACHE_SECTORS
+    disk_cache_service();
 
-    if (count == 1) {    			/* Single block write */
-        if ((send_cmd(CMD24, sector) == 0)    	/* WRITE_BLOCK */
-            && xmit_datablock(buff, 0xFE))
-            count = 0;
-    }
-    else {                			/* Multiple block write */
-        if (CardType & 2) {
-            send_cmd(CMD55, 0); send_cmd(CMD23, count);    /* ACMD23 */
-        }
-        if (send_cmd(CMD25, sector) == 0) {    	/* WRITE_MULTIPLE_BLOCK */
-            do {
-                if (!xmit_datablock(buff, 0xFC)) break;
-                buff += 512;
-            } while (--count);
-            if (!xmit_datablock(0, 0xFD))    	/* STOP_TRAN token */
-                count = 1;
-        }
+    if (count < SDC_CACHE_SECTORS) {    	/* Small writes are held back */
+        do {
+            if (cache_write(buff, sector++) != RES_OK) return RES_ERROR;
+            buff += 512;
+        } while (--count);
+        return RES_OK;
     }
 
-    DESELECT();            			/* CS = H */
-    rcvr_spi();            			/* Idle (Release DO) */
+    for (i = 0; i < SDC_CACHE_SECTORS; i++)    	/* Large writes go to the card, drop the copies they replace */
+        if ((CacheState[i] & CACHE_VALID) && CacheLba[i] - sector < count)
+            CacheState[i] = 0;
+#endif
 
-    return count ? RES_ERROR : RES_OK;
+    return mmc_write(buff, 0, sector, count);
 }
 #endif /* _READONLY */
 
@@ -533,11 +879,47 @@ DRESULT disk_ioctl (
 
     res = RES_ERROR;
 
+    if (ctrl == MMC_GET_WRITES) {    		/* Sectors written by FatFs and sent to the card (DWORD[2]) */
+        ((DWORD*)buff)[0] = WritesLogical;
+        ((DWORD*)buff)[1] = WritesPhysical;
+        return RES_OK;
+    }
+
+    if (ctrl == MMC_FLUSH_CACHE) {    		/* Write all cached sectors to the card */
+#if SDC_CACHE_SECTORS
+        return cache_flush();
+#else
+        return RES_OK;
+#endif
+    }
+
+    if (ctrl == MMC_SYNC_DEFER) {    		/* Make CTRL_SYNC leave the cache alone, or flush again (BYTE) */
+#if SDC_CACHE_SECTORS
+        CacheDefer = *ptr ? TRUE : FALSE;
+#endif
+        return RES_OK;
+    }
+
+#if SDC_CACHE_SECTORS
+    if (ctrl == CTRL_SYNC && !CacheDefer && cache_flush() != RES_OK)	/* Sync is the explicit flush */
+        return RES_ERROR;
+#endif
+
+    if (ctrl == MMC_GET_BUSYHIST) {    	/* Copy out card-busy histogram (DWORD[BUSY_HIST_BINS]) */
+        for (n = 0; n < BUSY_HIST_BINS; n++)
+            ((DWORD*)buff)[n] = BusyHist[n];
+        return RES_OK;
+    }
+
     if (ctrl == CTRL_POWER) {
         switch (*ptr) {
         case 0:        				/* Sub control code == 0 (POWER_OFF) */
-            if (chk_power())
+            if (chk_power()) {
+#if SDC_CACHE_SECTORS
+                cache_flush();        		/* Don't lose cached sectors */
+#endif
                 power_off();        		/* Power off */
+            }
             res = RES_OK;
             break;
         case 1:        				/* Sub control code == 1 (POWER_ON) */
@@ -577,7 +959,7 @@ DRESULT disk_ioctl (
             res = RES_OK;
             break;
 
-        case CTRL_SYNC :    			/* Make sure that data has been written */
+        case CTRL_SYNC :    			/* Make sure that data has been written, cache flushed above */
             if (wait_ready() == 0xFF)
                 res = RES_OK;
             break;
@@ -619,6 +1001,38 @@ DRESULT disk_ioctl (
 
 
 
+/* Write the cache out if its oldest dirty sector has expired           */
+/* Call from the main loop, disk_read and disk_write call it too         */
+void disk_cache_service (void){
+#if SDC_CACHE_SECTORS
+    if (CacheDirty && !CacheTimer) cache_flush();
+#endif
+}
+
+
+
+/* Set the function run while a data block is on uDMA or the card is    */
+/* busy, 0 to spin. It runs with CS asserted, so it must not use SSI0.   */
+/* It is called with interrupts masked: sleeping until one arrives is    */
+/* fine and is how it should wait, but no handler runs until it returns  */
+void disk_idle_set (void (*func)(void)){
+    IdleHook = func;
+}
+
+
+
+/* SSI Interrupt Procedure  (Platform dependent)                         */
+/* Signals the end of a uDMA data block                                  */
+void disk_dmaproc (void){
+    ROM_SSIIntClear(SDC_SSI_BASE, ROM_SSIIntStatus(SDC_SSI_BASE, true));
+#ifndef SDC_NO_DMA
+    if (!ROM_uDMAChannelIsEnabled(SDC_DMA_RX) && !ROM_uDMAChannelIsEnabled(SDC_DMA_TX))
+        DmaBusy = 0;
+#endif
+}
+
+
+
 /* Device Timer Interrupt Procedure  (Platform dependent)                */
 /* This function must be called in period of 10ms                        */
 void disk_timerproc (void){
@@ -630,6 +1044,9 @@ void disk_timerproc (void){
     if (n) Timer1 = --n;
     n = Timer2;
     if (n) Timer2 = --n;
+#if SDC_CACHE_SECTORS
+    if (CacheTimer) CacheTimer--;
+#endif
 
 }
 
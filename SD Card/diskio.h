@@ -38,6 +38,9 @@ DSTATUS disk_status (BYTE drv);
 DRESULT disk_read (BYTE drv, BYTE* buff, DWORD sector, UINT count);
 DRESULT disk_write (BYTE drv, const BYTE* buff, DWORD sector, UINT count);
 DRESULT disk_ioctl (BYTE drv, BYTE ctrl, void* buff);
+void disk_idle_set (void (*func)(void));
+void disk_timerproc (void);
+void disk_cache_service (void);
 
 
 /* Disk Status Bits (DSTATUS) */
@@ -68,6 +71,12 @@ DRESULT disk_ioctl (BYTE drv, BYTE ctrl, void* buff);
 #define MMC_GET_CID			12	/* Get CID */
 #define MMC_GET_OCR			13	/* Get OCR */
 #define MMC_GET_SDSTAT		14	/* Get SD status */
+#define MMC_GET_BUSYHIST	15	/* Get card-busy time histogram (DWORD[BUSY_HIST_BINS]) */
+#define MMC_FLUSH_CACHE		16	/* Write out the write-behind cache */
+#define MMC_GET_WRITES		17	/* Get sectors written by FatFs and sent to the card (DWORD[2]) */
+#define MMC_SYNC_DEFER		18	/* While set, CTRL_SYNC leaves cached sectors to the age flush (BYTE, 1 = set, 0 = clear) */
+
+#define BUSY_HIST_BINS		8	/* <10ms, 10-20ms, 20-40ms ... 320ms and over, timeouts */
 
 /* ATA/CF specific ioctl command */
 #define ATA_GET_REV			20	/* Get F/W revision */
@@ -0,0 +1,229 @@
+// logLib.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	Sector handling follows ChaN's notes on FatFs performance
+//
+// Requirements:
+// 	Requires Texas Instruments' TivaWare.
+//	Also requires FatFS, an SD library from ChaN
+//
+// Description:
+// 	Append-only record logger on top of FatFs
+//
+// Notes:
+//	See logLib.h
+//	LogAppend must only be called from one context (main loop or one interrupt). The other
+//	functions must be called from the main loop
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "driverlib/rom.h"
+#include "ff.h"
+#include "diskio.h"
+#include "logLib.h"
+
+
+
+
+// "Private" Functions -------------------------------------------------------------------------------
+
+// Record the result of a FatFs call, returns the matching LOG_STATUS_*
+static uint8_t LogResult(tLog *psLog, FRESULT res){
+	if(res != FR_OK){
+		psLog->fsResult = res;
+		return LOG_STATUS_FS_ERROR;
+	}
+	return LOG_STATUS_OK;
+}
+
+// Write everything appended so far through FatFs and sync the file. With defer set the driver keeps
+// the sectors in its write-behind cache until they age out
+static uint8_t LogWriteOut(tLog *psLog, bool defer){
+	const uint8_t *buf;
+	uint16_t fill;
+	DWORD pos;
+	UINT bw;
+	BYTE deferSync = 1;
+	FRESULT res;
+	bool wasDisabled;
+
+	// Take the partial buffer with interrupts masked. If LogAppend filled one since LogService ran,
+	// the file pointer is still at that buffer's sector, so write it and look again. LogAppend may
+	// add to the partial buffer once unmasked but never changes these bytes
+	for(;;){
+		if(LogService(psLog) != LOG_STATUS_OK){
+			return LOG_STATUS_FS_ERROR;
+		}
+		wasDisabled = ROM_IntMasterDisable();
+		if(!psLog->full){
+			break;
+		}
+		if(!wasDisabled){
+			ROM_IntMasterEnable();
+		}
+	}
+	buf = psLog->buf[psLog->active];
+	fill = psLog->fill;
+	if(!wasDisabled){
+		ROM_IntMasterEnable();
+	}
+
+	// Write it, then step back so the sector is written whole once it fills
+	pos = f_tell(&psLog->file);
+	if(fill && LogResult(psLog, f_write(&psLog->file, buf, fill, &bw)) != LOG_STATUS_OK){
+		return LOG_STATUS_FS_ERROR;
+	}
+
+	// Sync, with LogSync asking the driver to leave the sectors in its cache
+	if(defer){
+		disk_ioctl(0, MMC_SYNC_DEFER, &deferSync);
+	}
+	res = f_sync(&psLog->file);
+	if(defer){
+		deferSync = 0;
+		disk_ioctl(0, MMC_SYNC_DEFER, &deferSync);
+	}
+	if(LogResult(psLog, res) != LOG_STATUS_OK
+			|| LogResult(psLog, f_lseek(&psLog->file, pos)) != LOG_STATUS_OK){
+		return LOG_STATUS_FS_ERROR;
+	}
+
+	// f_sync only reaches the driver if the file changed, so sectors left by LogSync go out here
+	if(!defer && disk_ioctl(0, MMC_FLUSH_CACHE, 0) != RES_OK){
+		psLog->fsResult = FR_DISK_ERR;
+		return LOG_STATUS_FS_ERROR;
+	}
+
+	return LOG_STATUS_OK;
+}
+
+
+
+
+// Functions -----------------------------------------------------------------------------------------
+
+// Open or create a log file and position it for appending
+uint8_t LogOpen(tLog *psLog, const char *path){
+	DWORD tail;
+	UINT br;
+
+	psLog->fill = 0;
+	psLog->active = 0;
+	psLog->full = 0;
+	psLog->fsResult = FR_OK;
+	psLog->records = 0;
+	psLog->dropped = 0;
+	psLog->sectors = 0;
+
+	if(LogResult(psLog, f_open(&psLog->file, path, FA_READ | FA_WRITE | FA_OPEN_ALWAYS)) != LOG_STATUS_OK){
+		return LOG_STATUS_FS_ERROR;
+	}
+
+	// Start on the last sector boundary, carrying a partial last sector in the buffer
+	tail = f_size(&psLog->file) % LOG_BUF_SIZE;
+	if(LogResult(psLog, f_lseek(&psLog->file, f_size(&psLog->file) - tail)) != LOG_STATUS_OK){
+		f_close(&psLog->file);
+		return LOG_STATUS_FS_ERROR;
+	}
+	if(tail){
+		if(LogResult(psLog, f_read(&psLog->file, psLog->buf[0], tail, &br)) != LOG_STATUS_OK || br != tail
+				|| LogResult(psLog, f_lseek(&psLog->file, f_size(&psLog->file) - tail)) != LOG_STATUS_OK){
+			f_close(&psLog->file);
+			return LOG_STATUS_FS_ERROR;
+		}
+		psLog->fill = tail;
+	}
+
+	return LOG_STATUS_OK;
+}
+
+
+// Copy a record into the buffers. Never touches the file system
+uint8_t LogAppend(tLog *psLog, const void *record, uint16_t len){
+	const uint8_t *src = record;
+	uint16_t part;
+
+	if(len > LOG_BUF_SIZE){
+		return LOG_STATUS_TOO_LONG;
+	}
+
+	// Record fills the buffer, finish it and hand it to LogService
+	part = LOG_BUF_SIZE - psLog->fill;
+	if(len >= part){
+		if(psLog->full){
+			psLog->dropped++;
+			return LOG_STATUS_FULL;
+		}
+		memcpy(&psLog->buf[psLog->active][psLog->fill], src, part);
+		psLog->fill = 0;
+		psLog->active ^= 1;
+		psLog->full = 1;		// Set last, LogService may run as soon as it is
+		src += part;
+		len -= part;
+	}
+
+	memcpy(&psLog->buf[psLog->active][psLog->fill], src, len);
+	psLog->fill += len;
+	psLog->records++;
+
+	return LOG_STATUS_OK;
+}
+
+
+// Write the full buffer, if there is one, as one whole sector
+uint8_t LogService(tLog *psLog){
+	UINT bw;
+
+	if(!psLog->full){
+		return LOG_STATUS_OK;
+	}
+
+	if(LogResult(psLog, f_write(&psLog->file, psLog->buf[psLog->active ^ 1], LOG_BUF_SIZE, &bw)) != LOG_STATUS_OK){
+		return LOG_STATUS_FS_ERROR;
+	}
+	if(bw != LOG_BUF_SIZE){			// Volume full
+		psLog->fsResult = FR_DENIED;
+		return LOG_STATUS_FS_ERROR;
+	}
+
+	psLog->sectors++;
+	psLog->full = 0;
+
+	return LOG_STATUS_OK;
+}
+
+
+// Write everything appended so far to the card
+uint8_t LogFlush(tLog *psLog){
+	return LogWriteOut(psLog, false);
+}
+
+
+// Bring the file size and directory entry up to date without waiting for the card. The sectors
+// reach the card within SDC_CACHE_AGE, or at the next LogFlush
+uint8_t LogSync(tLog *psLog){
+	return LogWriteOut(psLog, true);
+}
+
+
+// Flush and close the log file
+uint8_t LogClose(tLog *psLog){
+	uint8_t status;
+
+	status = LogFlush(psLog);
+	if(LogResult(psLog, f_close(&psLog->file)) != LOG_STATUS_OK){
+		return LOG_STATUS_FS_ERROR;
+	}
+
+	return status;
+}
@@ -0,0 +1,66 @@
+// logLib.h
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	Sector handling follows ChaN's notes on FatFs performance
+//
+// Requirements:
+// 	Requires Texas Instruments' TivaWare.
+//	Also requires FatFS, an SD library from ChaN
+//
+// Description:
+// 	Append-only record logger on top of FatFs
+//
+// Notes:
+//	Include ff.h before this file
+//	Records are collected in two sector sized buffers. LogAppend only copies into RAM, so it may be
+//	called from an interrupt. LogService writes a full buffer with one 512 byte f_write while the
+//	other fills, and must be called from the main loop often enough to keep up
+//	The file pointer is kept on a sector boundary, so every f_write from LogService goes straight
+//	from the buffer to disk_write without a copy through the FatFs window
+//	LogFlush also writes the partly filled buffer, then seeks back so that the sector is rewritten
+//	whole once it fills. LogOpen reads an existing partial last sector back in for the same reason
+//	LogSync does the same as LogFlush but leaves the sectors in the driver's write-behind cache
+//	(MMC_SYNC_DEFER), so it can be called often without a card write each time
+//	A record that doesn't fit while both buffers are waiting to be written is dropped and counted
+//
+// Todo:
+//	More testing
+//****************************************************************************************************
+
+
+// Defines -------------------------------------------------------------------------------------------
+#define LOG_BUF_SIZE 512		// One sector, f_write is only called with this many bytes
+
+// Values returned by the Log* functions
+#define LOG_STATUS_OK 0
+#define LOG_STATUS_FULL 1		// Both buffers full, record dropped
+#define LOG_STATUS_TOO_LONG 2		// Record longer than LOG_BUF_SIZE
+#define LOG_STATUS_FS_ERROR 3		// FatFs call failed, see fsResult
+
+// Structure used to store logger state
+typedef struct
+{
+	FIL file;
+	uint8_t buf[2][LOG_BUF_SIZE];
+	volatile uint16_t fill;		// Bytes in the buffer being filled
+	volatile uint8_t active;	// Buffer being filled
+	volatile uint8_t full;		// Other buffer is full and waiting for LogService
+	FRESULT fsResult;		// Result of the last FatFs call that failed
+	uint32_t records;		// Records appended
+	uint32_t dropped;		// Records lost to LOG_STATUS_FULL
+	uint32_t sectors;		// Whole sectors written
+} tLog;
+
+
+
+// Function Prototypes -------------------------------------------------------------------------------
+extern uint8_t LogOpen(tLog *psLog, const char *path);
+extern uint8_t LogAppend(tLog *psLog, const void *record, uint16_t len);
+extern uint8_t LogService(tLog *psLog);
+extern uint8_t LogFlush(tLog *psLog);
+extern uint8_t LogSync(tLog *psLog);
+extern uint8_t LogClose(tLog *psLog);
@@ -15,7 +15,11 @@
 //	Interface Tiva with SD Card
 //
 // Notes:
-//	
+//	SysTick runs disk_timerproc every 10ms, which the SD driver needs for its timeouts
+//	The CPU sleeps while the SD card is busy or a sector is on uDMA
+//	The record is written through logLib, which keeps the file sector aligned and flushes the SD
+//	driver's write-behind cache on LogClose. The main loop runs disk_cache_service so anything left
+//	in the cache is written once it reaches the driver's age limit
 //
 //****************************************************************************************************
 
@@ -42,6 +46,7 @@
 
 #include "ff.h"
 #include "diskio.h"
+#include "logLib.h"
 
 
 // Defines -------------------------------------------------------------------------------------------
@@ -54,13 +59,21 @@
 
 // Variables -----------------------------------------------------------------------------------------
 FATFS sdVolume;			// FatFs work area needed for each volume
-FIL logfile;			// File object needed for each open file
+tLog sdLog;			// Log file and its sector buffers
 uint16_t fp;			// Used for sizeof
 
 
 
 
 // Functions -----------------------------------------------------------------------------------------
+void SysTickIntHandler(void){
+	disk_timerproc();
+}
+
+void SDIdle(void){
+	ROM_SysCtlSleep();		// Called masked; SysTick or the uDMA completion still wakes us
+}
+
 void ConfigureUART(void){
 
 	// Enable the peripherals used by UART
@@ -120,10 +133,14 @@ int main(void){
 	ROM_GPIOPinTypeGPIOOutput(GPIO_PORTF_BASE, LED_RED|LED_BLUE|LED_GREEN);
 	ROM_GPIOPinWrite(GPIO_PORTF_BASE, LED_RED|LED_GREEN|LED_BLUE, 0);
 
-	// Start SD Card Stuff - Borrowed from examples
+	// Start 10ms SysTick for the SD driver timeouts
+	ROM_SysTickPeriodSet(ROM_SysCtlClockGet()/100);
+	ROM_SysTickIntEnable();
+	ROM_SysTickEnable();
+	ROM_IntMasterEnable();
+	disk_idle_set(SDIdle);
 
-	// Initialize result variable
-	UINT bw;
+	// Start SD Card Stuff - Borrowed from examples
 
 	// Mount the SD Card
 	switch(f_mount(&sdVolume, "", 0)){
@@ -147,17 +164,28 @@ int main(void){
 			break;
 	}
 
-	if(f_open(&logfile, "newfile.txt", FA_WRITE | FA_OPEN_ALWAYS) == FR_OK) {	// Open file - If nonexistent, create
-		f_lseek(&logfile, logfile.fsize);					// Move forward by filesize; logfile.fsize+1 is not needed in this application
-		f_write(&logfile, "Parachutes\n", 11, &bw);				// Append word
-		UARTprintf("File size is %u\n",logfile.fsize);				// Print size
-		f_close(&logfile);							// Close the file
-		if (bw == 11) {
+	if(LogOpen(&sdLog, "newfile.txt") == LOG_STATUS_OK) {			// Open file - If nonexistent, create
+		LogAppend(&sdLog, "Parachutes\n", 11);					// Append word
+		uint8_t status = LogClose(&sdLog);					// Write it out and close the file
+		UARTprintf("File size is %u\n", f_size(&sdLog.file));			// Print size
+		DWORD writes[2];
+		if (disk_ioctl(0, MMC_GET_WRITES, writes) == RES_OK) {
+			UARTprintf("Sectors written %u, sent to card %u\n", writes[0], writes[1]);
+		}
+		DWORD busyHist[BUSY_HIST_BINS];
+		if (disk_ioctl(0, MMC_GET_BUSYHIST, busyHist) == RES_OK) {
+			UARTprintf("Card busy <10ms: %u, 10-20ms: %u, 20-40ms: %u, 40-80ms: %u\n", busyHist[0], busyHist[1], busyHist[2], busyHist[3]);
+			UARTprintf("80-160ms: %u, 160-320ms: %u, >320ms: %u, timeouts: %u\n", busyHist[4], busyHist[5], busyHist[6], busyHist[7]);
+		}
+		if (status == LOG_STATUS_OK) {
 			ROM_GPIOPinWrite(GPIO_PORTF_BASE, LED_RED|LED_GREEN|LED_BLUE, LED_GREEN); // Lights green LED if data written well
 		}
 	}
 
-	// Wait Forever
-	while(1);
+	// Write out cached sectors as they age, sleeping between SysTicks
+	while(1){
+		disk_cache_service();
+		ROM_SysCtlSleep();
+	}
 
 }
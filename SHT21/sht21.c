@@ -22,6 +22,7 @@
 // Includes ------------------------------------------------------------------------------------------
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 
 #include "inc/hw_ints.h"
 #include "inc/hw_memmap.h"
@@ -34,10 +35,12 @@
 #include "driverlib/pin_map.h"
 #include "driverlib/rom.h"
 #include "driverlib/sysctl.h"
+#include "driverlib/systick.h"
 #include "driverlib/uart.h"
 
 #include "utils/uartstdio.h"
 
+#include "i2cLib.h"
 #include "shtLib.h"
 
 
@@ -48,9 +51,15 @@
 
 
 // Variables -----------------------------------------------------------------------------------------
+volatile uint32_t g_ui32Ms = 0;		// Milliseconds since SysTick was started
 
 
 // Functions -----------------------------------------------------------------------------------------
+void SysTickIntHandler(void){
+	g_ui32Ms++;
+	I2CLibTick();
+}
+
 void ConfigureUART(void){
 
 	// Enable the peripherals used by UART
@@ -86,6 +95,12 @@ void ConfigureI2C3(void){
 
 }
 
+#ifdef SHT21_FIXED_POINT
+// Print a value held in hundredths
+void CentiPrint(int32_t value){
+	UARTprintf("%s%d.%02d", (value < 0) ? "-" : "", abs(value) / 100, abs(value) % 100);
+}
+#else
 void FloatToPrint(float floatValue, uint32_t splitValue[2]){
 	int32_t i32IntegerPart;
 	int32_t i32FractionPart;
@@ -101,14 +116,17 @@ void FloatToPrint(float floatValue, uint32_t splitValue[2]){
 	splitValue[0] = i32IntegerPart;
 	splitValue[1] = i32FractionPart;
 }
+#endif
 
 
 
 // Main ----------------------------------------------------------------------------------------------
 int main(void){
 
+#ifndef SHT21_FIXED_POINT
 	// Enable lazy stacking
 	ROM_FPULazyStackingEnable();
+#endif
 
 	// Set the system clock to run at 40Mhz off PLL with external crystal as reference.
 	ROM_SysCtlClockSet(SYSCTL_SYSDIV_5 | SYSCTL_USE_PLL | SYSCTL_XTAL_16MHZ | SYSCTL_OSC_MAIN);
@@ -124,33 +142,84 @@ int main(void){
 	// Enable I2C3
 	ConfigureI2C3();
 
+	// Start interrupt driven I2C transactions. Pass &g_sI2CPollBackend to run without them
+	tI2CBus SensHubBus;
+	I2CLibBusInit(&SensHubBus, I2C3_BASE, &g_sI2CIntBackend);
+	I2CLibBusPinsSet(&SensHubBus, GPIO_PORTD_BASE, GPIO_PIN_0, GPIO_PIN_1, GPIO_PD0_I2C3SCL, GPIO_PD1_I2C3SDA);
+	ROM_IntMasterEnable();
+
 	// Create SHT instance
 	tSHT2x ShtSensHub;
+	SHT21Initialize(&ShtSensHub, &SensHubBus);
+
+	// Full resolution, heater off. Lower resolutions shorten the conversion waits
+	if(SHT21SetUserReg(&ShtSensHub, SHT21_RES_RH12_T14, false) != SHT21_STATUS_OK){
+		UARTprintf("SHT21 user register write failed\n");
+	}
 
+#ifndef SHT21_FIXED_POINT
 	// Create print variables
 	uint32_t printValue[2];
+#endif
+
+	// Start 1ms SysTick used to time conversions
+	ROM_SysTickPeriodSet(ROM_SysCtlClockGet()/1000);
+	ROM_SysTickIntEnable();
+	ROM_SysTickEnable();
+
+	// Measurements run in the background; the loop only handles results
+	uint32_t nextSample = g_ui32Ms;
+	uint32_t ledOff = 0;
 
 	while(1){
-		// Read temperature and Humidity
-		SHT21ReadTemperature(&ShtSensHub);
-		SHT21ReadHumidity(&ShtSensHub);
-
-		// Print
-		//UARTprintf("Hum Raw: %x  ||  ", ShtSensHub.humRaw);
-		//UARTprintf("Temp Raw: %x\n", ShtSensHub.tempRaw);
-		FloatToPrint(ShtSensHub.hum, printValue);
-		UARTprintf("Humidity: %d.%03d  ||  ",printValue[0],printValue[1]);
-		FloatToPrint(ShtSensHub.temp, printValue);
-		UARTprintf("Temperature: %d.%03d\n",printValue[0],printValue[1]);
-
-		// Blink LED
-		ROM_GPIOPinWrite(GPIO_PORTF_BASE, LED_RED|LED_GREEN|LED_BLUE, LED_GREEN);
-		ROM_SysCtlDelay(ROM_SysCtlClockGet()/3/10);	// Delay for 100ms (1/10s) :: ClockGet()/3 = 1second
-		ROM_GPIOPinWrite(GPIO_PORTF_BASE, LED_RED|LED_GREEN|LED_BLUE, 0);
-
-		// Delay for second
+
+		// Clears the bus if a transaction had to be abandoned
+		I2CLibService();
+
+		switch(SHT21Service(&ShtSensHub, g_ui32Ms)){
+			case SHT21_EVENT_HUMIDITY:
+				// Print both once the pair is complete, and blink LED
+				//UARTprintf("Hum Raw: %x  ||  ", ShtSensHub.humRaw);
+				//UARTprintf("Temp Raw: %x\n", ShtSensHub.tempRaw);
+#ifdef SHT21_FIXED_POINT
+				UARTprintf("Humidity: ");
+				CentiPrint(ShtSensHub.humCenti);
+				UARTprintf("  ||  Temperature: ");
+				CentiPrint(ShtSensHub.tempCenti);
+				UARTprintf("\n");
+#else
+				FloatToPrint(ShtSensHub.hum, printValue);
+				UARTprintf("Humidity: %d.%03d  ||  ",printValue[0],printValue[1]);
+				FloatToPrint(ShtSensHub.temp, printValue);
+				UARTprintf("Temperature: %d.%03d\n",printValue[0],printValue[1]);
+#endif
+				ROM_GPIOPinWrite(GPIO_PORTF_BASE, LED_RED|LED_GREEN|LED_BLUE, LED_GREEN);
+				ledOff = g_ui32Ms + 100;
+				break;
+
+			case SHT21_EVENT_ERROR:
+				// Bus error or every attempt failed the CRC, reading is not printed
+				UARTprintf("SHT21 read failed\n");
+				ROM_GPIOPinWrite(GPIO_PORTF_BASE, LED_RED|LED_GREEN|LED_BLUE, LED_RED);
+				ledOff = g_ui32Ms + 100;
+				break;
+
+			default:
+				break;
+		}
+
+		if((int32_t)(g_ui32Ms - ledOff) >= 0){
+			ROM_GPIOPinWrite(GPIO_PORTF_BASE, LED_RED|LED_GREEN|LED_BLUE, 0);
+		}
+
+		// Start next pair every second
 		// Don't want to go much faster than this to reduce self heating
-		ROM_SysCtlDelay(ROM_SysCtlClockGet()/3);
+		if((int32_t)(g_ui32Ms - nextSample) >= 0 && SHT21StartSample(&ShtSensHub)){
+			nextSample += 1000;
+		}
+
+		// Nothing to do until the next SysTick or I2C interrupt
+		ROM_SysCtlSleep();
 	}
 
 }
@@ -15,7 +15,7 @@
 //
 // Notes:
 //	See shtLib.h
-//	Designed to be used with I2C3
+//	Designed to be used with I2C3 through i2cLib
 //	
 //****************************************************************************************************
 
@@ -28,83 +28,303 @@
 #include "driverlib/rom.h"
 #include "inc/hw_i2c.h"
 #include "inc/hw_memmap.h"
+#include "i2cLib.h"
 #include "shtLib.h"
 
 
-// Functions -----------------------------------------------------------------------------------------
+// Variables -----------------------------------------------------------------------------------------
 
-// Used to read and convert temperature from SHT21
-void SHT21ReadTemperature(tSHT2x *psInst){
-	
-	// Configure to write, buffer command, and initiate send
-	ROM_I2CMasterSlaveAddrSet(I2C3_BASE, SHT21_I2C_ADDRESS, false);
-	ROM_I2CMasterDataPut(I2C3_BASE, SHT21_TEMP_NOBLOCK);
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_SINGLE_SEND);
-
-	// Wait for transmission to finish
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
-
-	// Wait for temperature measurement to finish
-	ROM_SysCtlDelay(ROM_SysCtlClockGet()/3/11);	// Temp maximum gather time
-
-	// Configure to read
-	ROM_I2CMasterSlaveAddrSet(I2C3_BASE, SHT21_I2C_ADDRESS, true);
-	
-	// Master read burst byte 1 (MSB)
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_START);
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
-	psInst->i2cData[0] = ROM_I2CMasterDataGet(I2C3_BASE);
-
-	// Master read burst byte 2 (LSB)
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_CONT);
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
-	psInst->i2cData[1] = ROM_I2CMasterDataGet(I2C3_BASE);
-
-	// Master read burst byte 3 (CRC)
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_FINISH);
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
-	psInst->i2cData[2] = ROM_I2CMasterDataGet(I2C3_BASE);
+// CRC-8, polynomial x^8 + x^5 + x^4 + 1 (0x31), initial value 0. Entry i is the CRC of byte i
+static const uint8_t g_pui8Crc8Table[256] = {
+	0x00, 0x31, 0x62, 0x53, 0xC4, 0xF5, 0xA6, 0x97, 0xB9, 0x88, 0xDB, 0xEA, 0x7D, 0x4C, 0x1F, 0x2E,
+	0x43, 0x72, 0x21, 0x10, 0x87, 0xB6, 0xE5, 0xD4, 0xFA, 0xCB, 0x98, 0xA9, 0x3E, 0x0F, 0x5C, 0x6D,
+	0x86, 0xB7, 0xE4, 0xD5, 0x42, 0x73, 0x20, 0x11, 0x3F, 0x0E, 0x5D, 0x6C, 0xFB, 0xCA, 0x99, 0xA8,
+	0xC5, 0xF4, 0xA7, 0x96, 0x01, 0x30, 0x63, 0x52, 0x7C, 0x4D, 0x1E, 0x2F, 0xB8, 0x89, 0xDA, 0xEB,
+	0x3D, 0x0C, 0x5F, 0x6E, 0xF9, 0xC8, 0x9B, 0xAA, 0x84, 0xB5, 0xE6, 0xD7, 0x40, 0x71, 0x22, 0x13,
+	0x7E, 0x4F, 0x1C, 0x2D, 0xBA, 0x8B, 0xD8, 0xE9, 0xC7, 0xF6, 0xA5, 0x94, 0x03, 0x32, 0x61, 0x50,
+	0xBB, 0x8A, 0xD9, 0xE8, 0x7F, 0x4E, 0x1D, 0x2C, 0x02, 0x33, 0x60, 0x51, 0xC6, 0xF7, 0xA4, 0x95,
+	0xF8, 0xC9, 0x9A, 0xAB, 0x3C, 0x0D, 0x5E, 0x6F, 0x41, 0x70, 0x23, 0x12, 0x85, 0xB4, 0xE7, 0xD6,
+	0x7A, 0x4B, 0x18, 0x29, 0xBE, 0x8F, 0xDC, 0xED, 0xC3, 0xF2, 0xA1, 0x90, 0x07, 0x36, 0x65, 0x54,
+	0x39, 0x08, 0x5B, 0x6A, 0xFD, 0xCC, 0x9F, 0xAE, 0x80, 0xB1, 0xE2, 0xD3, 0x44, 0x75, 0x26, 0x17,
+	0xFC, 0xCD, 0x9E, 0xAF, 0x38, 0x09, 0x5A, 0x6B, 0x45, 0x74, 0x27, 0x16, 0x81, 0xB0, 0xE3, 0xD2,
+	0xBF, 0x8E, 0xDD, 0xEC, 0x7B, 0x4A, 0x19, 0x28, 0x06, 0x37, 0x64, 0x55, 0xC2, 0xF3, 0xA0, 0x91,
+	0x47, 0x76, 0x25, 0x14, 0x83, 0xB2, 0xE1, 0xD0, 0xFE, 0xCF, 0x9C, 0xAD, 0x3A, 0x0B, 0x58, 0x69,
+	0x04, 0x35, 0x66, 0x57, 0xC0, 0xF1, 0xA2, 0x93, 0xBD, 0x8C, 0xDF, 0xEE, 0x79, 0x48, 0x1B, 0x2A,
+	0xC1, 0xF0, 0xA3, 0x92, 0x05, 0x34, 0x67, 0x56, 0x78, 0x49, 0x1A, 0x2B, 0xBC, 0x8D, 0xDE, 0xEF,
+	0x82, 0xB3, 0xE0, 0xD1, 0x46, 0x77, 0x24, 0x15, 0x3B, 0x0A, 0x59, 0x68, 0xFF, 0xCE, 0x9D, 0xAC
+};
 
-	// Convert to temperature
+
+
+// Maximum conversion times in ms from the datasheet plus one tick, since the caller's millisecond
+// counter may be about to roll over when the wait starts. Indexed by SHT21ResIndex
+static const uint8_t g_pui8TempWaitMs[4] = {86, 23, 44, 12};	// 14, 12, 13, 11 bit: 85, 22, 43, 11 ms
+static const uint8_t g_pui8HumWaitMs[4] = {30, 5, 10, 16};	// 12, 8, 10, 11 bit: 29, 4, 9, 15 ms
+
+
+
+// "Private" Functions ------------------------------------------------------------------------------
+
+// Map the two resolution bits (7 and 0) onto 0..3
+static uint8_t SHT21ResIndex(tSHT2x *psInst){
+	return ((psInst->resolution >> 6) & 0x02) | (psInst->resolution & 0x01);
+}
+
+// SysCtlDelay loop count for ms milliseconds
+static uint32_t SHT21DelayLoops(uint8_t ms){
+	return ROM_SysCtlClockGet()/3/1000 * ms;
+}
+
+// CRC of the two measurement bytes, one table lookup per byte
+static uint8_t SHT21Crc(uint8_t msb, uint8_t lsb){
+	return g_pui8Crc8Table[g_pui8Crc8Table[msb] ^ lsb];
+}
+
+static void SHT21ConvertTemp(tSHT2x *psInst){
 	psInst->tempRaw = ((uint16_t)(psInst->i2cData[0]) << 8) | (uint16_t)(psInst->i2cData[1]);
+#ifdef SHT21_FIXED_POINT
+	// -46.85 + 175.72 * S / 2^16 in 0.01 C, rounded to nearest
+	psInst->tempCenti = (int16_t)((int32_t)((17572UL * (psInst->tempRaw & 0xFFFC) + 32768) >> 16) - 4685);
+#else
 	psInst->temp = (float)(psInst->tempRaw & 0xFFFC);
 	psInst->temp = -46.85f + 175.72f * (psInst->temp/65536.0f);
+#endif
 }
 
-// Used to read and convert humidity from SHT21
-void SHT21ReadHumidity(tSHT2x *psInst){
-	
-	// Configure to write, buffer command, and initiate send
-	ROM_I2CMasterSlaveAddrSet(I2C3_BASE, SHT21_I2C_ADDRESS, false);
-	ROM_I2CMasterDataPut(I2C3_BASE, SHT21_HUM_NOBLOCK);
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_SINGLE_SEND);
-
-	// Wait for transmission to finish
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
-
-	// Wait for humidity measurement to finish
-	ROM_SysCtlDelay(ROM_SysCtlClockGet()/3/34);	// Hum maximum gather time
-
-	// Configure to read
-	ROM_I2CMasterSlaveAddrSet(I2C3_BASE, SHT21_I2C_ADDRESS, true);
-	
-	// Master read burst byte 1 (MSB)
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_START);
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
-	psInst->i2cData[0] = ROM_I2CMasterDataGet(I2C3_BASE);
-
-	// Master read burst byte 2 (LSB)
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_CONT);
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
-	psInst->i2cData[1] = ROM_I2CMasterDataGet(I2C3_BASE);
-
-	// Master read burst byte 3 (CRC)
-	ROM_I2CMasterControl(I2C3_BASE, I2C_MASTER_CMD_BURST_RECEIVE_FINISH);
-	while(ROM_I2CMasterBusy(I2C3_BASE)){}
-	psInst->i2cData[2] = ROM_I2CMasterDataGet(I2C3_BASE);
-
-	// Convert to humidity
+static void SHT21ConvertHum(tSHT2x *psInst){
 	psInst->humRaw = ((uint16_t)(psInst->i2cData[0]) << 8) | (uint16_t)(psInst->i2cData[1]);
+#ifdef SHT21_FIXED_POINT
+	// -6 + 125 * S / 2^16 in 0.01 %RH, rounded to nearest
+	psInst->humCenti = (int16_t)((int32_t)((12500UL * (psInst->humRaw & 0xFFFC) + 32768) >> 16) - 600);
+#else
 	psInst->hum = (float)(psInst->humRaw & 0xFFFC);
 	psInst->hum = -6.0f + 125.0f * (psInst->hum/65536.0f);
+#endif
+}
+
+// Queue a measurement command for the non-blocking API
+static bool SHT21QueueCommand(tSHT2x *psInst, uint8_t command){
+	psInst->txData[0] = command;
+	return I2CLibDevQueue(&psInst->dev, &psInst->trans, psInst->txData, 1, 0, 0);
+}
+
+// Trigger a measurement, wait delay SysCtlDelay loops, and read MSB, LSB and CRC into
+// psInst->i2cData. Measurements failing the CRC are repeated up to SHT21_RETRIES times
+static uint8_t SHT21Measure(tSHT2x *psInst, uint8_t command, uint32_t delay){
+	uint8_t shtData[3];
+	uint8_t status = SHT21_STATUS_BUS_ERROR;
+	uint8_t attempt;
+
+	for(attempt = 0; attempt <= SHT21_RETRIES; attempt++){
+		// Write measurement command
+		if(I2CLibDevCommand(&psInst->dev, command) != I2C_STATUS_DONE){
+			status = SHT21_STATUS_BUS_ERROR;
+			continue;
+		}
+
+		// Wait for measurement to finish
+		ROM_SysCtlDelay(delay);
+
+		// Read MSB, LSB and CRC
+		if(I2CLibDevRead(&psInst->dev, shtData, 3) != I2C_STATUS_DONE){
+			status = SHT21_STATUS_BUS_ERROR;
+			continue;
+		}
+
+		if(SHT21Crc(shtData[0], shtData[1]) != shtData[2]){
+			I2CLibDevFault(&psInst->dev);
+			status = SHT21_STATUS_CRC_ERROR;
+			continue;
+		}
+
+		I2CLibDevDataGood(&psInst->dev);
+		psInst->i2cData[0] = shtData[0];
+		psInst->i2cData[1] = shtData[1];
+		psInst->i2cData[2] = shtData[2];
+		return SHT21_STATUS_OK;
+	}
+
+	return status;
+}
+
+
+
+// Functions -----------------------------------------------------------------------------------------
+
+// psBus must already be initialized with I2CLibBusInit
+void SHT21Initialize(tSHT2x *psInst, tI2CBus *psBus){
+	I2CLibDevInit(&psInst->dev, psBus, SHT21_I2C_ADDRESS);
+	psInst->state = SHT21_STATE_IDLE;
+	psInst->attempts = 0;
+	psInst->chainHum = false;
+
+	// Power on default, SHT21SetUserReg changes it
+	psInst->resolution = SHT21_RES_RH12_T14;
+}
+
+// Set measurement resolution (one of SHT21_RES_*) and the on-chip heater. The register is read
+// first so the reserved bits keep their values. Conversion waits follow the new resolution
+uint8_t SHT21SetUserReg(tSHT2x *psInst, uint8_t resolution, bool heater){
+	uint8_t regData;
+
+	if(I2CLibDevReadRegs(&psInst->dev, SHT21_READ_USER_REG, &regData, 1) != I2C_STATUS_DONE){
+		return SHT21_STATUS_BUS_ERROR;
+	}
+
+	regData &= ~(SHT21_RES_MASK | SHT21_HEATER);
+	regData |= (resolution & SHT21_RES_MASK) | (heater ? SHT21_HEATER : 0);
+	if(I2CLibDevWriteRegs(&psInst->dev, SHT21_WRITE_USER_REG, &regData, 1) != I2C_STATUS_DONE){
+		return SHT21_STATUS_BUS_ERROR;
+	}
+
+	psInst->resolution = resolution & SHT21_RES_MASK;
+	return SHT21_STATUS_OK;
+}
+
+// Used to read and convert temperature from SHT21. The result is left unchanged on failure
+uint8_t SHT21ReadTemperature(tSHT2x *psInst){
+	uint8_t status = SHT21Measure(psInst, SHT21_TEMP_NOBLOCK, SHT21DelayLoops(g_pui8TempWaitMs[SHT21ResIndex(psInst)]));
+	if(status != SHT21_STATUS_OK){
+		return status;
+	}
+
+	// Convert to temperature
+	SHT21ConvertTemp(psInst);
+
+	return SHT21_STATUS_OK;
+}
+
+// Used to read and convert humidity from SHT21. The result is left unchanged on failure
+uint8_t SHT21ReadHumidity(tSHT2x *psInst){
+	uint8_t status = SHT21Measure(psInst, SHT21_HUM_NOBLOCK, SHT21DelayLoops(g_pui8HumWaitMs[SHT21ResIndex(psInst)]));
+	if(status != SHT21_STATUS_OK){
+		return status;
+	}
+
+	// Convert to humidity
+	SHT21ConvertHum(psInst);
+
+	return SHT21_STATUS_OK;
+}
+
+
+// Non-blocking API ----------------------------------------------------------------------------------
+
+// Start a temperature measurement. Returns false if a measurement is already in progress
+bool SHT21StartTemp(tSHT2x *psInst){
+	if(psInst->state != SHT21_STATE_IDLE || !SHT21QueueCommand(psInst, SHT21_TEMP_NOBLOCK)){
+		return false;
+	}
+
+	psInst->state = SHT21_STATE_TEMP_START;
+	return true;
+}
+
+// Start a humidity measurement. Returns false if a measurement is already in progress
+bool SHT21StartHumidity(tSHT2x *psInst){
+	if(psInst->state != SHT21_STATE_IDLE || !SHT21QueueCommand(psInst, SHT21_HUM_NOBLOCK)){
+		return false;
+	}
+
+	psInst->state = SHT21_STATE_HUM_START;
+	return true;
+}
+
+// Start a temperature measurement followed by a humidity measurement. SHT21Service reports
+// SHT21_EVENT_TEMP and then SHT21_EVENT_HUMIDITY
+bool SHT21StartSample(tSHT2x *psInst){
+	if(psInst->chainHum || !SHT21StartTemp(psInst)){
+		return false;
+	}
+
+	psInst->chainHum = true;
+	return true;
+}
+
+// Advance a started measurement. now is a free running millisecond count supplied by the caller.
+// Never blocks, so other sensors on the bus can be serviced during the conversion time. Returns
+// SHT21_EVENT_TEMP or SHT21_EVENT_HUMIDITY when the temperature or humidity has just been updated
+uint8_t SHT21Service(tSHT2x *psInst, uint32_t now){
+	uint8_t status = psInst->trans.status;
+	bool bTemp = (psInst->state <= SHT21_STATE_TEMP_READ);
+
+	// Humidity half of SHT21StartSample that couldn't be queued straight after the temperature
+	if(psInst->state == SHT21_STATE_IDLE){
+		if(psInst->chainHum && SHT21StartHumidity(psInst)){
+			psInst->chainHum = false;
+		}
+		return SHT21_EVENT_NONE;
+	}
+
+	if(status == I2C_STATUS_PENDING){
+		return SHT21_EVENT_NONE;
+	}
+	if(status != I2C_STATUS_DONE){
+		psInst->state = SHT21_STATE_IDLE;
+		psInst->attempts = 0;
+		psInst->chainHum = false;
+		return SHT21_EVENT_ERROR;
+	}
+
+	switch(psInst->state){
+		case SHT21_STATE_TEMP_START:
+		case SHT21_STATE_HUM_START:
+			// Command is on the sensor, conversion time counts from here
+			psInst->deadline = now + (bTemp ? g_pui8TempWaitMs[SHT21ResIndex(psInst)] : g_pui8HumWaitMs[SHT21ResIndex(psInst)]);
+			psInst->state++;
+			break;
+
+		case SHT21_STATE_TEMP_WAIT:
+		case SHT21_STATE_HUM_WAIT:
+			if((int32_t)(now - psInst->deadline) < 0){
+				break;
+			}
+
+			// Conversion finished, queue read of MSB, LSB and CRC. Retried on the next call if the queue is full
+			if(I2CLibDevQueue(&psInst->dev, &psInst->trans, 0, 0, psInst->rxData, 3)){
+				psInst->state++;
+			}
+			break;
+
+		case SHT21_STATE_TEMP_READ:
+		case SHT21_STATE_HUM_READ:
+			// Measure again on a CRC mismatch
+			if(SHT21Crc(psInst->rxData[0], psInst->rxData[1]) != psInst->rxData[2]){
+				I2CLibDevFault(&psInst->dev);
+				if(psInst->attempts < SHT21_RETRIES && SHT21QueueCommand(psInst, bTemp ? SHT21_TEMP_NOBLOCK : SHT21_HUM_NOBLOCK)){
+					psInst->attempts++;
+					psInst->state = bTemp ? SHT21_STATE_TEMP_START : SHT21_STATE_HUM_START;
+					break;
+				}
+				psInst->state = SHT21_STATE_IDLE;
+				psInst->attempts = 0;
+				psInst->chainHum = false;
+				return SHT21_EVENT_ERROR;
+			}
+
+			I2CLibDevDataGood(&psInst->dev);
+			psInst->state = SHT21_STATE_IDLE;
+			psInst->attempts = 0;
+			psInst->i2cData[0] = psInst->rxData[0];
+			psInst->i2cData[1] = psInst->rxData[1];
+			psInst->i2cData[2] = psInst->rxData[2];
+			if(!bTemp){
+				SHT21ConvertHum(psInst);
+				return SHT21_EVENT_HUMIDITY;
+			}
+
+			SHT21ConvertTemp(psInst);
+
+			// Queue the humidity measurement requested by SHT21StartSample
+			if(psInst->chainHum && SHT21StartHumidity(psInst)){
+				psInst->chainHum = false;
+			}
+			return SHT21_EVENT_TEMP;
+
+		default:
+			psInst->state = SHT21_STATE_IDLE;
+			break;
+	}
+
+	return SHT21_EVENT_NONE;
 }
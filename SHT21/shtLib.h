@@ -14,10 +14,13 @@
 // 	Interface with Sensirion SHT21
 //
 // Notes:
-//	
+//	Include i2cLib.h before this file
+//	Call SHT21Initialize before any other function
+//	SHT21Start*/SHT21Service and the blocking SHT21Read* functions must not be mixed while a
+//	non-blocking measurement is in progress
+//
 // Todo:
-//	Implement CRC checking
-//	Make more durable, timeouts, testing, etc.
+//	More testing
 //****************************************************************************************************
 
 
@@ -25,6 +28,42 @@
 #define SHT21_I2C_ADDRESS  0x40
 #define SHT21_TEMP_NOBLOCK 0xF3
 #define SHT21_HUM_NOBLOCK  0xF5
+#define SHT21_WRITE_USER_REG 0xE6
+#define SHT21_READ_USER_REG 0xE7
+
+// User register fields. Bits 3-5 are reserved and preserved by SHT21SetUserReg
+#define SHT21_RES_MASK 0x81
+#define SHT21_RES_RH12_T14 0x00		// Default
+#define SHT21_RES_RH8_T12 0x01
+#define SHT21_RES_RH10_T13 0x80
+#define SHT21_RES_RH11_T11 0x81
+#define SHT21_HEATER 0x04
+
+// Define SHT21_FIXED_POINT (see Makefile) to report tempCenti/humCenti, integer results in
+// 0.01 C and 0.01 %RH, instead of the float temp/hum. No floating point is used in that case
+
+// Measurement attempts after the first when the CRC doesn't match
+#define SHT21_RETRIES 2
+
+// Values returned by SHT21ReadTemperature/SHT21ReadHumidity
+#define SHT21_STATUS_OK 0
+#define SHT21_STATUS_BUS_ERROR 1	// NACK or arbitration lost
+#define SHT21_STATUS_CRC_ERROR 2	// Every attempt failed the checksum
+
+// Non-blocking measurement states
+#define SHT21_STATE_IDLE 0
+#define SHT21_STATE_TEMP_START 1	// Measurement command queued
+#define SHT21_STATE_TEMP_WAIT 2		// Waiting for conversion time
+#define SHT21_STATE_TEMP_READ 3		// Result read queued
+#define SHT21_STATE_HUM_START 4
+#define SHT21_STATE_HUM_WAIT 5
+#define SHT21_STATE_HUM_READ 6
+
+// Values returned by SHT21Service
+#define SHT21_EVENT_NONE 0
+#define SHT21_EVENT_TEMP 1
+#define SHT21_EVENT_HUMIDITY 2
+#define SHT21_EVENT_ERROR 3
 
 // Structure used to store SHT data
 typedef struct
@@ -32,11 +71,35 @@ typedef struct
 	uint32_t i2cData[3];	// Array to hold bytes received by I2C
 	uint16_t tempRaw;	// Raw temperature
 	uint16_t humRaw;	// Raw humidity
+#ifdef SHT21_FIXED_POINT
+	int16_t tempCenti;	// Temperature in 0.01 C
+	int16_t humCenti;	// Humidity in 0.01 %RH
+#else
 	float temp;		// Temperature
 	float hum;		// Humidity
+#endif
+
+	tI2CDevice dev;		// Bus and slave address
+
+	// Non-blocking measurement state
+	tI2CTransaction trans;
+	uint32_t deadline;
+	uint8_t txData[1];
+	uint8_t rxData[3];
+	uint8_t state;
+	uint8_t attempts;	// Measurements of the current quantity that failed the CRC
+	bool chainHum;		// Humidity measurement follows the current temperature measurement
+
+	uint8_t resolution;	// One of SHT21_RES_*, selects the conversion waits
 } tSHT2x;
 
 
 // Function prototypes
-extern void SHT21ReadTemperature(tSHT2x *psInst);
-extern void SHT21ReadHumidity(tSHT2x *psInst);
+extern void SHT21Initialize(tSHT2x *psInst, tI2CBus *psBus);
+extern uint8_t SHT21SetUserReg(tSHT2x *psInst, uint8_t resolution, bool heater);
+extern uint8_t SHT21ReadTemperature(tSHT2x *psInst);
+extern uint8_t SHT21ReadHumidity(tSHT2x *psInst);
+extern bool SHT21StartTemp(tSHT2x *psInst);
+extern bool SHT21StartHumidity(tSHT2x *psInst);
+extern bool SHT21StartSample(tSHT2x *psInst);
+extern uint8_t SHT21Service(tSHT2x *psInst, uint32_t now);
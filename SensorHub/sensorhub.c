@@ -0,0 +1,367 @@
+// sensorhub.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	Combines the BMP180, SHT21 and ISL29023 projects
+//
+// Requirements:
+// 	Requires Texas Instruments' TivaWare.
+//
+// Description:
+// 	Samples every sensor on the SensorHub boosterpack at its own rate and prints one timestamped
+//	stream
+//
+// Notes:
+//	All three drivers share one I2C3 bus through i2cLib's interrupt backend. Conversions are started as soon as a sensor is due
+//	and its driver is idle, so one sensor's conversion time is spent on the others' bus traffic
+//	instead of in SysCtlDelay. The ISL29023 converts continuously and is only read.
+//	Output lines are "ms,P,pressure Pa,temp C", "ms,H,humidity %RH,temp C" and "ms,L,lux".
+//	Every STATS_PERIOD_MS a "ms,S,..." line gives the samples taken per sensor, the I2C
+//	transactions and the bus utilisation (time the bus was held, as a percentage of the time since
+//	the last stats line) in that period, then the failed transfers per sensor and bus clears since
+//	start.
+//	A stuck bus is cleared and sampling carries on. A "ms,T,..." line follows with the bytes moved
+//	and the bus speed (I2C_SPEED_*) of each sensor. Each sensor starts at 400 kHz and drops to
+//	100 kHz on its own if it keeps failing
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "inc/hw_ints.h"
+#include "inc/hw_i2c.h"
+#include "inc/hw_memmap.h"
+
+#include "driverlib/fpu.h"
+#include "driverlib/gpio.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/i2c.h"
+#include "driverlib/pin_map.h"
+#include "driverlib/rom.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/systick.h"
+#include "driverlib/uart.h"
+
+#include "utils/uartstdio.h"
+
+#include "i2cLib.h"
+#include "bmpLib.h"
+#include "shtLib.h"
+#include "islLib.h"
+
+
+// Defines -------------------------------------------------------------------------------------------
+#define LED_RED GPIO_PIN_1
+#define LED_BLUE GPIO_PIN_2
+#define LED_GREEN GPIO_PIN_3
+
+// Sample periods in ms
+#define PRES_PERIOD_MS 100		// 10 Hz
+#define HUM_PERIOD_MS 1000		// 1 Hz, faster causes self heating
+#define LIGHT_PERIOD_MS 200		// 5 Hz
+#define STATS_PERIOD_MS 10000
+
+// Sensors in the scheduler
+#define SENSOR_PRES 0
+#define SENSOR_HUM 1
+#define SENSOR_LIGHT 2
+#define SENSOR_COUNT 3
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+volatile uint32_t g_ui32Ms = 0;		// Milliseconds since SysTick was started
+
+// Per sensor schedule
+static const uint32_t g_pui32Period[SENSOR_COUNT] = {PRES_PERIOD_MS, HUM_PERIOD_MS, LIGHT_PERIOD_MS};
+static uint32_t g_pui32NextDue[SENSOR_COUNT];
+static uint32_t g_pui32Samples[SENSOR_COUNT];	// Samples since last stats line
+
+// Sensor instances, all on I2C3
+static tI2CBus g_sBus;
+static tBMP180 g_sBmp;
+static tBMP180Cals g_sBmpCals;
+static bool g_bBmpCalsValid;	// Pressure isn't started until the calibration read succeeds
+static tSHT2x g_sSht;
+static tISL29023 g_sIsl;
+
+
+
+// Functions -----------------------------------------------------------------------------------------
+void SysTickIntHandler(void){
+	g_ui32Ms++;
+	I2CLibTick();
+}
+
+void ConfigureUART(void){
+
+	// Enable the peripherals used by UART
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOA);
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_UART0);
+
+	// Set GPIO A0 and A1 as UART pins.
+	GPIOPinConfigure(GPIO_PA0_U0RX);
+	GPIOPinConfigure(GPIO_PA1_U0TX);
+	ROM_GPIOPinTypeUART(GPIO_PORTA_BASE, GPIO_PIN_0 | GPIO_PIN_1);
+
+	// Configure UART clock using UART utils
+	UARTClockSourceSet(UART0_BASE, UART_CLOCK_PIOSC);
+	UARTStdioConfig(0, 115200, 16000000);
+}
+
+void ConfigureI2C3(void){
+
+	// Enable peripherals used by I2C
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOD);
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_I2C3);
+
+	// Setup GPIO
+	ROM_GPIOPinTypeI2CSCL(GPIO_PORTD_BASE, GPIO_PIN_0);
+	ROM_GPIOPinTypeI2C(GPIO_PORTD_BASE, GPIO_PIN_1);
+
+	// Set GPIO D0 and D1 as SCL and SDA
+	ROM_GPIOPinConfigure(GPIO_PD0_I2C3SCL);
+	ROM_GPIOPinConfigure(GPIO_PD1_I2C3SDA);
+
+	// Initialize as master in fast mode
+	ROM_I2CMasterInitExpClk(I2C3_BASE, ROM_SysCtlClockGet(), true);
+}
+
+void FloatToPrint(float floatValue, uint32_t splitValue[2]){
+	int32_t i32IntegerPart;
+	int32_t i32FractionPart;
+
+	i32IntegerPart = (int32_t) floatValue;
+	i32FractionPart = (int32_t) (floatValue * 1000.0f);
+	i32FractionPart = i32FractionPart - (i32IntegerPart * 1000);
+	if(i32FractionPart < 0)
+	{
+		i32FractionPart *= -1;
+	}
+
+	splitValue[0] = i32IntegerPart;
+	splitValue[1] = i32FractionPart;
+}
+
+// Failed transfers of any kind on one sensor
+uint32_t DevErrors(tI2CDevice *psDev){
+	return psDev->nacks + psDev->arbLost + psDev->timeouts + psDev->faults;
+}
+
+// Print a float as ",x.xxx"
+void PrintField(float value){
+	uint32_t printValue[2];
+
+	FloatToPrint(value, printValue);
+	UARTprintf(",%s%d.%03d", (value < 0.0f && printValue[0] == 0) ? "-" : "", printValue[0], printValue[1]);
+}
+
+#if defined(SHT21_FIXED_POINT) || defined(ISL29023_FIXED_POINT)
+// Print a value in thousandths as ",x.xxx", for the fixed point driver results
+void PrintMilli(int32_t value){
+	uint32_t magnitude = (value < 0) ? -(uint32_t)value : (uint32_t)value;
+
+	UARTprintf(",%s%d.%03d", (value < 0) ? "-" : "", magnitude / 1000, magnitude % 1000);
+}
+#endif
+
+// Start a conversion for one sensor. Returns false if its driver is still busy
+bool StartSensor(uint8_t sensor, uint32_t now){
+	switch(sensor){
+		case SENSOR_PRES:
+			// Retry a calibration read that failed at startup, the sensor stays due until it works
+			if(!g_bBmpCalsValid){
+				g_bBmpCalsValid = (BMP180GetCalVals(&g_sBmp, &g_sBmpCals) == BMP180_STATUS_OK);
+				if(!g_bBmpCalsValid){
+					return false;
+				}
+			}
+			return BMP180StartSample(&g_sBmp, now);
+		case SENSOR_HUM:
+			return SHT21StartSample(&g_sSht);
+		case SENSOR_LIGHT:
+			return ISL29023StartRead(&g_sIsl);
+		default:
+			return false;
+	}
+}
+
+// Start every sensor that is due. A sensor whose driver is still busy stays due and is retried on
+// the next pass; one that fell more than a period behind skips the missed samples
+void RunSchedule(uint32_t now){
+	uint8_t sensor;
+
+	for(sensor = 0; sensor < SENSOR_COUNT; sensor++){
+		if((int32_t)(now - g_pui32NextDue[sensor]) < 0 || !StartSensor(sensor, now)){
+			continue;
+		}
+
+		g_pui32NextDue[sensor] += g_pui32Period[sensor];
+		if((int32_t)(now - g_pui32NextDue[sensor]) >= 0){
+			g_pui32NextDue[sensor] = now + g_pui32Period[sensor];
+		}
+	}
+}
+
+// Collect finished conversions and print them
+void ServiceSensors(uint32_t now){
+	bool error = false;
+
+	switch(BMP180Service(&g_sBmp, &g_sBmpCals, now)){
+		case BMP180_EVENT_PRESSURE:
+			UARTprintf("%d,P,%d", now, g_sBmp.pressure);
+			PrintField(g_sBmp.temp);
+			UARTprintf("\n");
+			g_pui32Samples[SENSOR_PRES]++;
+			break;
+		case BMP180_EVENT_ERROR:
+			error = true;
+			break;
+		default:
+			break;
+	}
+
+	switch(SHT21Service(&g_sSht, now)){
+		case SHT21_EVENT_HUMIDITY:
+			UARTprintf("%d,H", now);
+#ifdef SHT21_FIXED_POINT
+			PrintMilli(g_sSht.humCenti * 10);
+			PrintMilli(g_sSht.tempCenti * 10);
+#else
+			PrintField(g_sSht.hum);
+			PrintField(g_sSht.temp);
+#endif
+			UARTprintf("\n");
+			g_pui32Samples[SENSOR_HUM]++;
+			break;
+		case SHT21_EVENT_ERROR:
+			error = true;
+			break;
+		default:
+			break;
+	}
+
+	switch(ISL29023Service(&g_sIsl)){
+		case ISL29023_EVENT_ALS:
+			UARTprintf("%d,L", now);
+#ifdef ISL29023_FIXED_POINT
+			PrintMilli(g_sIsl.alsMilli);
+#else
+			PrintField(g_sIsl.alsVal);
+#endif
+			UARTprintf("\n");
+			g_pui32Samples[SENSOR_LIGHT]++;
+			break;
+		case ISL29023_EVENT_ERROR:
+			error = true;
+			break;
+		default:
+			break;
+	}
+
+	// Red LED latches on any bus error
+	if(error){
+		UARTprintf("%d,E\n", now);
+		ROM_GPIOPinWrite(GPIO_PORTF_BASE, LED_RED, LED_RED);
+	}
+}
+
+
+
+
+// Main ----------------------------------------------------------------------------------------------
+int main(void){
+
+	// Enable lazy stacking
+	ROM_FPUEnable();
+	ROM_FPULazyStackingEnable();
+
+	// Set the system clock to run at 40Mhz off PLL with external crystal as reference.
+	ROM_SysCtlClockSet(SYSCTL_SYSDIV_5 | SYSCTL_USE_PLL | SYSCTL_XTAL_16MHZ | SYSCTL_OSC_MAIN);
+
+	// Initialize the UART and write status.
+	ConfigureUART();
+	UARTprintf("SensorHub Example\n");
+
+	// Enable LEDs
+	ROM_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOF);
+	ROM_GPIOPinTypeGPIOOutput(GPIO_PORTF_BASE, LED_RED|LED_BLUE|LED_GREEN);
+
+	// Enable I2C3 and start interrupt driven I2C transactions
+	ConfigureI2C3();
+	I2CLibBusInit(&g_sBus, I2C3_BASE, &g_sI2CIntBackend);
+	I2CLibBusPinsSet(&g_sBus, GPIO_PORTD_BASE, GPIO_PIN_0, GPIO_PIN_1, GPIO_PD0_I2C3SCL, GPIO_PD1_I2C3SDA);
+	ROM_IntMasterEnable();
+
+	// BMP180 at ultra high resolution, temperature refreshed every 10 readings or second
+	BMP180Initialize(&g_sBmp, &g_sBus, 3);
+	g_bBmpCalsValid = (BMP180GetCalVals(&g_sBmp, &g_sBmpCals) == BMP180_STATUS_OK);
+	if(!g_bBmpCalsValid){
+		UARTprintf("BMP180 calibration read failed\n");
+	}
+	BMP180SetTempCache(&g_sBmp, 10, 1000);
+
+	// SHT21 at full resolution
+	SHT21Initialize(&g_sSht, &g_sBus);
+	SHT21SetUserReg(&g_sSht, SHT21_RES_RH12_T14, false);
+
+	// ISL29023 converting continuously, interrupt window left wide open
+	ISL29023Initialize(&g_sIsl, &g_sBus);
+	ISL29023ChangeSettings(ISL29023_COMMANDII_RANGE64k, ISL29023_COMMANDII_RES16, &g_sIsl);
+	ISL29023SetThresholds(&g_sIsl, 0, 0xFFFF);
+	ISL29023StartContinuous(&g_sIsl, ISL29023_COMMANDI_PERSIST1, 0);
+
+	// Start 1ms SysTick used for timestamps and conversion waits
+	ROM_SysTickPeriodSet(ROM_SysCtlClockGet()/1000);
+	ROM_SysTickIntEnable();
+	ROM_SysTickEnable();
+
+	uint32_t now = g_ui32Ms;
+	uint32_t nextStats = now + STATS_PERIOD_MS;
+	uint32_t statsStart = now;
+	uint32_t transStart = I2CLibTransactionCount();
+	uint32_t busyStart = I2CLibBusyCycles();
+	uint32_t busyPermille;
+	uint8_t sensor;
+
+	for(sensor = 0; sensor < SENSOR_COUNT; sensor++){
+		g_pui32NextDue[sensor] = now;
+		g_pui32Samples[sensor] = 0;
+	}
+
+	// The ISL29023's first continuous conversion takes 90ms at 16 bits, until then it reads zero
+	g_pui32NextDue[SENSOR_LIGHT] = now + LIGHT_PERIOD_MS;
+
+	while(1){
+		now = g_ui32Ms;
+
+		I2CLibService();
+		ServiceSensors(now);
+		RunSchedule(now);
+
+		// Achieved rates and bus use. Busy time in us over elapsed ms is the utilisation in permille
+		if((int32_t)(now - nextStats) >= 0){
+			busyPermille = ((I2CLibBusyCycles() - busyStart) / (ROM_SysCtlClockGet() / 1000000)) / (now - statsStart);
+			UARTprintf("%d,S,%d,%d,%d,%d,%d.%d", now, g_pui32Samples[SENSOR_PRES], g_pui32Samples[SENSOR_HUM], g_pui32Samples[SENSOR_LIGHT], I2CLibTransactionCount() - transStart, busyPermille / 10, busyPermille % 10);
+			UARTprintf(",%d,%d,%d,%d\n", DevErrors(&g_sBmp.dev), DevErrors(&g_sSht.dev), DevErrors(&g_sIsl.dev), g_sBus.recoveries);
+			UARTprintf("%d,T,%d,%d,%d,%d,%d,%d\n", now, g_sBmp.dev.bytes, g_sBmp.dev.speed, g_sSht.dev.bytes, g_sSht.dev.speed, g_sIsl.dev.bytes, g_sIsl.dev.speed);
+			for(sensor = 0; sensor < SENSOR_COUNT; sensor++){
+				g_pui32Samples[sensor] = 0;
+			}
+			transStart = I2CLibTransactionCount();
+			busyStart = I2CLibBusyCycles();
+			statsStart = now;
+			nextStats += STATS_PERIOD_MS;
+		}
+
+		// Nothing to do until the next SysTick or I2C interrupt
+		ROM_SysCtlSleep();
+	}
+
+}
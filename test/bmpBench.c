@@ -0,0 +1,111 @@
+// bmpBench.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	Example calibration from the Bosch BMP180 datasheet
+//
+// Requirements:
+// 	See host.h
+//
+// Description:
+// 	Times BMP180ConvertBatch against converting each logged sample on its own
+//
+// Notes:
+//	Run with 'make bench'. Host timings only show how the two compare, the cycle counts printed
+//	by bmp180.c are the numbers for the target. Built plain and with BMP180_DIV_FREE
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include <time.h>
+
+#include "host.h"
+#include "../BMP180/bmpLib.c"
+
+
+// Defines -------------------------------------------------------------------------------------------
+#define BENCH_LEN 100000
+#define BENCH_RUNS 20
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+static const tBMP180Cals g_sExampleCal = {408, -72, -14383, 32741, 32757, 23153, 6190, 4, -32768, -8711, 2868};
+
+static uint16_t g_pui16UT[BENCH_LEN];
+static uint32_t g_pui32UP[BENCH_LEN];
+static int32_t g_pi32Pres[BENCH_LEN];
+static int16_t g_pi16Temp[BENCH_LEN];
+
+
+
+// Functions -----------------------------------------------------------------------------------------
+
+static uint64_t Now(void){
+	struct timespec sTime;
+
+	clock_gettime(CLOCK_MONOTONIC, &sTime);
+	return (uint64_t)sTime.tv_sec * 1000000000 + sTime.tv_nsec;
+}
+
+// What a logger without the batch call does: every sample converted from scratch
+static void ConvertEach(uint8_t oss){
+	tBMP180PresTerms sTerms;
+	int32_t B5;
+	uint32_t i;
+
+	for(i = 0; i < BENCH_LEN; i++){
+		B5 = BMP180CalcB5(g_pui16UT[i], &g_sExampleCal);
+		BMP180CalcPresTerms(B5, &g_sExampleCal, &sTerms);
+		g_pi32Pres[i] = BMP180CalcPresFinal(g_pui32UP[i], &sTerms, oss);
+		g_pi16Temp[i] = (int16_t)((B5 + 8) / 16);
+	}
+}
+
+// Best of BENCH_RUNS, in ns per sample
+static double Time(bool bBatch, uint8_t oss){
+	uint64_t best = ~0ULL, start, took;
+	uint32_t run;
+
+	for(run = 0; run < BENCH_RUNS; run++){
+		start = Now();
+		if(bBatch){
+			BMP180ConvertBatch(&g_sExampleCal, oss, g_pui16UT, g_pui32UP, g_pi32Pres, g_pi16Temp, BENCH_LEN);
+		} else{
+			ConvertEach(oss);
+		}
+		took = Now() - start;
+		if(took < best){
+			best = took;
+		}
+	}
+	return (double)best / BENCH_LEN;
+}
+
+int main(void){
+	static const uint8_t pui8Share[3] = {1, 10, 100};
+	uint32_t i, check = 0;
+	uint8_t s;
+
+#ifdef BMP180_DIV_FREE
+	printf("bmpBenchDivFree: ns per sample on this host, oss 3\n");
+#else
+	printf("bmpBench: ns per sample on this host, oss 3\n");
+#endif
+	printf("  samples per UT   each     batch\n");
+	for(s = 0; s < 3; s++){
+		for(i = 0; i < BENCH_LEN; i++){
+			g_pui16UT[i] = 26000 + (i / pui8Share[s]) % 3000;
+			g_pui32UP[i] = (20000 + (i * 37) % 20000) << 3;
+		}
+		printf("  %13u %8.1f %9.1f\n", pui8Share[s], Time(false, 3), Time(true, 3));
+		check += g_pi32Pres[BENCH_LEN - 1];
+	}
+
+	// Keeps the results live
+	return check == 0;
+}
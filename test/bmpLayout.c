@@ -0,0 +1,51 @@
+// bmpLayout.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	None
+//
+// Requirements:
+// 	A gcc that accepts -m32. Only compiled, never linked, so no 32 bit C library is needed
+//
+// Description:
+// 	Checks the tBMP180 layout the size budget in bmpLib.c is based on
+//
+// Notes:
+//	Compiled by the Makefile with -m32, which lays these types out as the Cortex-M4 EABI does,
+//	with and without BMP180_DIV_FREE. Any failure stops the build. The size check in bmpLib.c
+//	itself is also active in this build
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include <stddef.h>
+
+#include "../BMP180/bmpLib.c"
+
+
+// Checks --------------------------------------------------------------------------------------------
+
+#ifdef BMP180_DIV_FREE
+#define LAYOUT_TERMS 12
+#else
+#define LAYOUT_TERMS 0
+#endif
+
+// The budget is exact, so a saving shows up here and the budget can be tightened
+_Static_assert(sizeof(tBMP180) == BMP180_INST_BUDGET, "tBMP180 size differs from its budget");
+
+// Words first: five 32 bit fields, plus the cached pressure terms
+_Static_assert(offsetof(tBMP180, dev) == 20 + LAYOUT_TERMS, "tBMP180 words are not first");
+
+// The device handle is the only padded member
+_Static_assert(sizeof(tI2CDevice) == 20 && sizeof(tI2CTransaction) == 20, "i2cLib handle sizes changed");
+_Static_assert(offsetof(tBMP180, trans) == offsetof(tBMP180, dev) + sizeof(tI2CDevice), "padding before trans");
+_Static_assert(offsetof(tBMP180, cacheMs) == offsetof(tBMP180, trans) + sizeof(tI2CTransaction), "padding before cacheMs");
+_Static_assert(offsetof(tBMP180, B5Valid) + sizeof(bool) == sizeof(tBMP180), "tBMP180 has tail padding");
+
+// Raw bytes fit the longest reading
+_Static_assert(sizeof(((tBMP180 *)0)->rxData) == 3, "rxData is not three bytes");
@@ -0,0 +1,510 @@
+// bmpTest.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	Example calibration and readings from the Bosch BMP180 datasheet
+//
+// Requirements:
+// 	See host.h
+//
+// Description:
+// 	Checks bmpLib against the BMP180 model on the host I2C backend
+//
+// Notes:
+//	bmpLib.c is included so the checks can reach its helpers. Built twice by the Makefile, as
+//	bmpTest and with BMP180_DIV_FREE as bmpTestDivFree
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include <math.h>
+#include <string.h>
+
+#include "host.h"
+#include "../BMP180/bmpLib.c"
+#include "i2cModel.h"
+#include "sensorModel.h"
+
+
+// Defines -------------------------------------------------------------------------------------------
+
+// Datasheet example readings at oss 0, and its results: 15.0 C and 69964 Pa
+#define EXAMPLE_UT 27898
+#define EXAMPLE_UP 23843
+#define EXAMPLE_T 150
+#define EXAMPLE_P 69964
+
+// Samples converted by CheckBatch at each oss
+#define BATCH_LEN 600
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+static const int16_t g_pi16ExampleCal[11] = {408, -72, -14383, (int16_t)32741, (int16_t)32757, (int16_t)23153, 6190, 4, -32768, -8711, 2868};
+
+static tI2CBus g_sBus;
+static tBmpModel g_sModel;
+static tBMP180 g_sBmp;
+
+
+
+// Functions -----------------------------------------------------------------------------------------
+
+// Fresh bus, model and instance at oversampling setting oss. UP gains a bit per oss step
+static void Setup(uint8_t oss){
+	HostBusReset();
+	BmpModelInit(&g_sModel, g_pi16ExampleCal, EXAMPLE_UT, (uint32_t)EXAMPLE_UP << oss);
+	HostSlaveAdd(&g_sModel.slave);
+	I2CLibBusInit(&g_sBus, I2C3_BASE, &g_sHostBackend);
+	BMP180Initialize(&g_sBmp, &g_sBus, oss);
+}
+
+// One 22 byte burst from AC1, decoded with the datasheet signs. Failed or blank reads leave the
+// struct alone
+static void CheckCal(void){
+	tBMP180Cals sCal, sBefore;
+	const tHostTrans *psLast;
+	uint8_t i;
+
+	Setup(0);
+	CHECK(BMP180GetCalVals(&g_sBmp, &sCal) == BMP180_STATUS_OK);
+	psLast = HostBusLast(0);
+	CHECK(g_ui32HostLogCount == 1);
+	CHECK(psLast->addr == BMP180_I2C_ADDRESS && psLast->txLen == 1 && psLast->tx[0] == BMP180_REG_CAL_AC1 && psLast->rxLen == BMP180_CAL_LEN);
+	CHECK(sCal.ac1 == 408 && sCal.ac2 == -72 && sCal.ac3 == -14383 && sCal.ac4 == 32741 && sCal.ac5 == 32757 && sCal.ac6 == 23153);
+	CHECK(sCal.b1 == 6190 && sCal.b2 == 4 && sCal.mb == -32768 && sCal.mc == -8711 && sCal.md == 2868);
+
+	// NACK, and a timeout that outlasts the retries
+	memset(&sBefore, 0x5A, sizeof(sBefore));
+	sCal = sBefore;
+	HostBusFault(I2C_STATUS_ERROR, 0, 1);
+	CHECK(BMP180GetCalVals(&g_sBmp, &sCal) == BMP180_STATUS_BUS_ERROR);
+	HostBusFault(I2C_STATUS_TIMEOUT, 0, I2C_RETRIES + 1);
+	CHECK(BMP180GetCalVals(&g_sBmp, &sCal) == BMP180_STATUS_BUS_ERROR);
+	CHECK(memcmp(&sCal, &sBefore, sizeof(sCal)) == 0);
+
+	// A blank word in any position, 0x0000 for AC4 would make B4 zero
+	for(i = 0; i < 11; i++){
+		g_sModel.cal[i] = (i & 1) ? 0xFFFF : 0x0000;
+		CHECK(BMP180GetCalVals(&g_sBmp, &sCal) == BMP180_STATUS_CAL_ERROR);
+		g_sModel.cal[i] = (uint16_t)g_pi16ExampleCal[i];
+	}
+	CHECK(memcmp(&sCal, &sBefore, sizeof(sCal)) == 0);
+}
+
+// Datasheet results through the blocking reads. A failure in either transfer leaves the results
+// alone
+static void CheckBlocking(void){
+	tBMP180Cals sCal;
+
+	Setup(0);
+	CHECK(BMP180GetCalVals(&g_sBmp, &sCal) == BMP180_STATUS_OK);
+
+	g_sBmp.temp = -99.0f;
+	g_sBmp.B5 = 1234;
+	HostBusFault(I2C_STATUS_ERROR, 0, 1);
+	CHECK(BMP180GetTemp(&g_sBmp, &sCal) == BMP180_STATUS_BUS_ERROR);
+	HostBusFault(I2C_STATUS_ERROR, 1, 1);
+	CHECK(BMP180GetTemp(&g_sBmp, &sCal) == BMP180_STATUS_BUS_ERROR);
+	CHECK(g_sBmp.temp == -99.0f && g_sBmp.B5 == 1234 && !g_sBmp.B5Valid);
+
+	CHECK(BMP180GetTemp(&g_sBmp, &sCal) == BMP180_STATUS_OK);
+	CHECK(g_sBmp.B5Valid && (g_sBmp.B5 + 8) / 16 == EXAMPLE_T);
+	CHECK(g_sBmp.temp >= 15.0f && g_sBmp.temp < 15.1f);		// Not truncated to 0.1 C
+	CHECK(g_sModel.earlyReads == 0);
+
+	// Temperature refresh fails, then the pressure read after a good refresh
+	g_sBmp.pressure = -1;
+	g_sBmp.B5Valid = false;
+	HostBusFault(I2C_STATUS_ERROR, 1, 1);
+	CHECK(BMP180GetPressure(&g_sBmp, &sCal) == BMP180_STATUS_BUS_ERROR);
+	CHECK(g_sBmp.pressure == -1 && !g_sBmp.B5Valid);
+	HostBusFault(I2C_STATUS_ERROR, 3, 1);
+	CHECK(BMP180GetPressure(&g_sBmp, &sCal) == BMP180_STATUS_BUS_ERROR);
+	CHECK(g_sBmp.pressure == -1 && g_sBmp.B5Valid);
+
+	// The TI formulas truncate where the datasheet example floors, which costs it 1 Pa here
+	CHECK(BMP180GetPressure(&g_sBmp, &sCal) == BMP180_STATUS_OK);
+	CHECK(g_sBmp.pressure == EXAMPLE_P + 1);
+	CHECK(g_sModel.earlyReads == 0);
+}
+
+// Run the non-blocking API until an event other than TEMP, servicing every 100 us with the bus
+// finishing queued transactions in between. Returns the event, BMP180_EVENT_NONE after a second
+static uint8_t RunSample(tBMP180Cals *psCal, uint8_t *pui8Temps){
+	uint32_t start = HostMs();
+	uint8_t event;
+
+	*pui8Temps = 0;
+	while(HostMs() - start < 1000){
+		HostBusRun();
+		event = BMP180Service(&g_sBmp, psCal, HostMs());
+		if(event == BMP180_EVENT_TEMP){
+			(*pui8Temps)++;
+		} else if(event != BMP180_EVENT_NONE){
+			return event;
+		}
+		HostAdvance(100000);
+	}
+	return BMP180_EVENT_NONE;
+}
+
+// The non-blocking sample puts F4 2E, F6, F4 cmd, F6 on the bus, reads each result once its
+// conversion has finished and no more than a tick and a service period after the wait, and
+// matches the blocking read
+static void CheckNonBlocking(void){
+	static const uint32_t pui32ConvNs[4] = {4500000, 7500000, 13500000, 25500000};
+	tBMP180Cals sCal;
+	const tHostTrans *psTrans[4];
+	int32_t blockingP, blockingB5;
+	uint8_t oss, temps, i;
+
+	for(oss = 0; oss < 4; oss++){
+		Setup(oss);
+		CHECK(BMP180GetCalVals(&g_sBmp, &sCal) == BMP180_STATUS_OK);
+		CHECK(BMP180GetPressure(&g_sBmp, &sCal) == BMP180_STATUS_OK);
+		CHECK(g_sModel.earlyReads == 0);
+		blockingP = g_sBmp.pressure;
+		blockingB5 = g_sBmp.B5;
+
+		Setup(oss);
+		g_bHostBusDefer = true;
+		CHECK(BMP180GetCalVals(&g_sBmp, &sCal) == BMP180_STATUS_OK);
+		g_ui32HostLogCount = 0;
+		CHECK(BMP180StartSample(&g_sBmp, HostMs()));
+		CHECK(!BMP180StartSample(&g_sBmp, HostMs()) && !BMP180StartTemp(&g_sBmp));
+		CHECK(RunSample(&sCal, &temps) == BMP180_EVENT_PRESSURE && temps == 1);
+		CHECK(g_sBmp.pressure == blockingP && g_sBmp.B5 == blockingB5);
+
+		CHECK(g_ui32HostLogCount == 4);
+		for(i = 0; i < 4; i++){
+			psTrans[i] = HostBusLast(3 - i);
+		}
+		CHECK(psTrans[0]->txLen == 2 && psTrans[0]->tx[0] == 0xF4 && psTrans[0]->tx[1] == 0x2E && psTrans[0]->rxLen == 0);
+		CHECK(psTrans[1]->txLen == 1 && psTrans[1]->tx[0] == 0xF6 && psTrans[1]->rxLen == 2);
+		CHECK(psTrans[2]->txLen == 2 && psTrans[2]->tx[0] == 0xF4 && psTrans[2]->tx[1] == (0x34 | (oss << 6)) && psTrans[2]->rxLen == 0);
+		CHECK(psTrans[3]->txLen == 1 && psTrans[3]->tx[0] == 0xF6 && psTrans[3]->rxLen == 3);
+		CHECK(g_sModel.earlyReads == 0);
+		CHECK(psTrans[1]->ns - psTrans[0]->ns <= (g_ui8TempWaitMs + 1) * 1000000ULL + 200000);
+		CHECK(psTrans[3]->ns - psTrans[2]->ns >= pui32ConvNs[oss]);
+		CHECK(psTrans[3]->ns - psTrans[2]->ns <= (g_pui8PresWaitMs[oss] + 1) * 1000000ULL + 200000);
+
+		// Service never puts anything on the bus itself, so it can't block
+		CHECK(g_ui32HostLogCount == 4 && HostBusPending() == 0);
+	}
+
+	// A failed result read ends the sample with an error and the driver can start again
+	Setup(0);
+	g_bHostBusDefer = true;
+	CHECK(BMP180GetCalVals(&g_sBmp, &sCal) == BMP180_STATUS_OK);
+	CHECK(BMP180StartSample(&g_sBmp, HostMs()));
+	HostBusFault(I2C_STATUS_ERROR, 1, 1);
+	CHECK(RunSample(&sCal, &temps) == BMP180_EVENT_ERROR && temps == 0);
+	CHECK(g_sBmp.state == BMP180_STATE_IDLE && !g_sBmp.chainPres);
+	CHECK(BMP180StartSample(&g_sBmp, HostMs()));
+	CHECK(RunSample(&sCal, &temps) == BMP180_EVENT_PRESSURE && temps == 1);
+}
+
+// Temperature conversions started in the last count logged transactions
+static uint32_t TempCommands(uint32_t count){
+	const tHostTrans *psTrans;
+	uint32_t found = 0;
+	uint32_t i;
+
+	for(i = 0; i < count; i++){
+		psTrans = HostBusLast(i);
+		if(psTrans && psTrans->txLen == 2 && psTrans->tx[0] == 0xF4 && psTrans->tx[1] == 0x2E){
+			found++;
+		}
+	}
+	return found;
+}
+
+// B5 is reused for the sample count and age set with BMP180SetTempCache, whichever runs out first.
+// The blocking read has no time base and only follows the count
+static void CheckTempCache(void){
+	tBMP180Cals sCal;
+	int32_t oldB5 = 0;
+	uint8_t temps, i;
+
+	// Default refreshes before every reading
+	Setup(0);
+	CHECK(BMP180GetCalVals(&g_sBmp, &sCal) == BMP180_STATUS_OK);
+	g_ui32HostLogCount = 0;
+	for(i = 0; i < 3; i++){
+		CHECK(BMP180GetPressure(&g_sBmp, &sCal) == BMP180_STATUS_OK);
+	}
+	CHECK(g_ui32HostLogCount == 12 && TempCommands(12) == 3);
+
+	// Blocking, every 4th reading refreshes. A cached B5 is used even though the part has warmed
+	BMP180SetTempCache(&g_sBmp, 4, 0);
+	g_ui32HostLogCount = 0;
+	for(i = 0; i < 8; i++){
+		CHECK(BMP180GetPressure(&g_sBmp, &sCal) == BMP180_STATUS_OK);
+		if(i == 1){
+			oldB5 = g_sBmp.B5;
+			g_sModel.ut = EXAMPLE_UT + 500;
+		}
+		if(i == 2){
+			CHECK(g_sBmp.B5 == oldB5);
+		}
+	}
+	CHECK(TempCommands(g_ui32HostLogCount) == 2 && g_sBmp.B5 != oldB5);
+
+	// Blocking with only an age limit refreshes every time
+	BMP180SetTempCache(&g_sBmp, 0, 1000);
+	g_ui32HostLogCount = 0;
+	for(i = 0; i < 3; i++){
+		CHECK(BMP180GetPressure(&g_sBmp, &sCal) == BMP180_STATUS_OK);
+	}
+	CHECK(TempCommands(g_ui32HostLogCount) == 3);
+
+	// Non-blocking, a sample every 20 ms and a 50 ms age limit: refreshed at 0, 60, 120 ms
+	Setup(0);
+	g_bHostBusDefer = true;
+	CHECK(BMP180GetCalVals(&g_sBmp, &sCal) == BMP180_STATUS_OK);
+	BMP180SetTempCache(&g_sBmp, 0, 50);
+	g_ui32HostLogCount = 0;
+	for(i = 0; i < 7; i++){
+		uint32_t start = HostMs();
+
+		CHECK(BMP180StartSample(&g_sBmp, start));
+		CHECK(RunSample(&sCal, &temps) == BMP180_EVENT_PRESSURE);
+		CHECK(temps == ((i % 3) == 0));
+		HostAdvance((uint64_t)(start + 20 - HostMs()) * 1000000);
+	}
+
+	// Both limits, two samples 20 ms apart use up the count first
+	Setup(0);
+	g_bHostBusDefer = true;
+	CHECK(BMP180GetCalVals(&g_sBmp, &sCal) == BMP180_STATUS_OK);
+	BMP180SetTempCache(&g_sBmp, 2, 50);
+	for(i = 0; i < 6; i++){
+		uint32_t start = HostMs();
+
+		CHECK(BMP180StartSample(&g_sBmp, start));
+		CHECK(RunSample(&sCal, &temps) == BMP180_EVENT_PRESSURE);
+		CHECK(temps == ((i % 2) == 0));
+		HostAdvance((uint64_t)(start + 20 - HostMs()) * 1000000);
+	}
+}
+
+// BMP180ConvertBatch against the blocking read of the same raw values, at every oss and across
+// 0 C, where B5 turns negative and the rounding of the 0.1 C temperature matters
+static void CheckBatch(void){
+	static uint16_t pui16UT[BATCH_LEN];
+	static uint32_t pui32UP[BATCH_LEN];
+	static int32_t pi32Pres[BATCH_LEN];
+	static int32_t pi32B5[BATCH_LEN];
+	static int32_t pi32BatchPres[BATCH_LEN];
+	static int16_t pi16BatchTemp[BATCH_LEN];
+	tBMP180Cals sCal;
+	uint32_t i, rounded = 0;
+	uint8_t oss;
+
+	for(oss = 0; oss < 4; oss++){
+		Setup(oss);
+		CHECK(BMP180GetCalVals(&g_sBmp, &sCal) == BMP180_STATUS_OK);
+
+		// UT from about -5 C to 33 C, every step near 0 C, each used for three pressure readings
+		for(i = 0; i < BATCH_LEN; i++){
+			pui16UT[i] = (i < BATCH_LEN / 2) ? 26100 + i / 3 : 24000 + (i / 3) * 11;
+			pui32UP[i] = (uint32_t)(15000 + (i % 3) * 9000 + i * 7) << oss;
+
+			g_sModel.ut = pui16UT[i];
+			g_sModel.up = pui32UP[i];
+			CHECK(BMP180GetPressure(&g_sBmp, &sCal) == BMP180_STATUS_OK);
+			pi32Pres[i] = g_sBmp.pressure;
+			pi32B5[i] = g_sBmp.B5;
+		}
+
+		BMP180ConvertBatch(&sCal, oss, pui16UT, pui32UP, pi32BatchPres, pi16BatchTemp, BATCH_LEN);
+		for(i = 0; i < BATCH_LEN; i++){
+			CHECK(pi32BatchPres[i] == pi32Pres[i]);
+			CHECK(pi16BatchTemp[i] == (pi32B5[i] + 8) / 16);
+			if(((pi32B5[i] + 8) >> 4) != (pi32B5[i] + 8) / 16){
+				rounded++;
+			}
+		}
+	}
+
+	// The sweep has to reach the readings where a shift would round the wrong way
+	CHECK(rounded != 0);
+}
+
+// Datasheet pressure formula written out with plain divides. Returns false for inputs where it
+// divides by zero
+static bool ReferencePressure(const tBMP180Cals *psCal, int32_t UT, int32_t UP, uint8_t oss, int32_t *pi32P){
+	int32_t X1, X2, X3, B3, B5, B6, p;
+	uint32_t B4, B7;
+
+	X1 = (UT - (int32_t)psCal->ac6) * (int32_t)psCal->ac5 / 32768;
+	if(X1 + psCal->md == 0){
+		return false;
+	}
+	X2 = (int32_t)psCal->mc * 2048 / (X1 + psCal->md);
+	B5 = X1 + X2;
+
+	B6 = B5 - 4000;
+	X1 = (psCal->b2 * (B6 * B6 / 4096)) / 2048;
+	X2 = psCal->ac2 * B6 / 2048;
+	X3 = X1 + X2;
+	B3 = ((((int32_t)psCal->ac1 * 4 + X3) << oss) + 2) / 4;
+	X1 = psCal->ac3 * B6 / 8192;
+	X2 = (psCal->b1 * (B6 * B6 / 4096)) / 65536;
+	X3 = ((X1 + X2) + 2) / 4;
+	B4 = (uint32_t)psCal->ac4 * (uint32_t)(X3 + 32768) / 32768;
+	if(B4 == 0){
+		return false;
+	}
+	B7 = ((uint32_t)UP - B3) * (50000 >> oss);
+	p = (B7 < 0x80000000) ? (int32_t)((B7 * 2) / B4) : (int32_t)((B7 / B4) * 2);
+	X1 = (p / 256) * (p / 256);
+	X1 = (X1 * 3038) / 65536;
+	X2 = (-7357 * p) / 65536;
+	*pi32P = p + (X1 + X2 + 3791) / 16;
+	return true;
+}
+
+// Random calibrations around the datasheet example, any UT and UP, against the reference
+static void CheckReference(void){
+	tBMP180Cals sCal;
+	uint32_t random = 7, tried = 0, mismatches = 0, i;
+	uint16_t UT;
+	uint32_t UP;
+	int32_t p, ref;
+	uint8_t oss;
+
+	for(i = 0; i < 2000000; i++){
+		random = random * 1664525 + 1013904223;
+		sCal.ac1 = 408 + (int16_t)(random % 2000) - 1000;
+		sCal.ac2 = -72 + (int16_t)((random >> 11) % 400) - 200;
+		sCal.ac3 = -14383 + (int16_t)((random >> 19) % 4000) - 2000;
+		random = random * 1664525 + 1013904223;
+		sCal.ac4 = 20000 + random % 20000;
+		sCal.ac5 = 20000 + (random >> 15) % 20000;
+		random = random * 1664525 + 1013904223;
+		sCal.ac6 = 15000 + random % 20000;
+		sCal.b1 = 4000 + (random >> 16) % 4000;
+		random = random * 1664525 + 1013904223;
+		sCal.b2 = random % 100;
+		sCal.mb = -32768;
+		sCal.mc = -(int16_t)((random >> 8) % 12000);
+		sCal.md = 1000 + (random >> 20) % 4000;
+		random = random * 1664525 + 1013904223;
+		oss = random % 4;
+		UT = (uint16_t)(sCal.ac6 + (random >> 8) % 16000 - 8000);
+		random = random * 1664525 + 1013904223;
+		UP = random & ((1u << (16 + oss)) - 1);
+
+		if(!ReferencePressure(&sCal, UT, UP, oss, &ref)){
+			continue;
+		}
+		BMP180ConvertBatch(&sCal, oss, &UT, &UP, &p, 0, 1);
+		tried++;
+		if(p != ref){
+			mismatches++;
+		}
+	}
+
+	CHECK(mismatches == 0);
+	CHECK(tried > 1900000);
+}
+
+// Altitude and sea level pressure against the double precision barometric formula, for 300 to
+// 1100 hPa at sea level pressures of 950 to 1050 hPa. The sea level check uses the exact altitude
+// of each reading
+static void CheckAltitude(void){
+	static const float pfAltLimit[2] = {2.0f, 0.11f};		// m, FAST then FINE
+	static const float pfSeaLimit[2] = {7.5f, 0.11f};		// Pa
+	double altErr, seaErr, exact, err;
+	float seaLevel;
+	int32_t p;
+	uint8_t mode;
+
+	for(mode = BMP180_ALT_FAST; mode <= BMP180_ALT_FINE; mode++){
+		altErr = 0.0;
+		seaErr = 0.0;
+		for(seaLevel = 95000.0f; seaLevel <= 105000.0f; seaLevel += 500.0f){
+			for(p = 30000; p <= 110000; p += 7){
+				g_sBmp.pressure = p;
+				exact = 44330.0 * (1.0 - pow(p / (double)seaLevel, 1.0 / 5.255));
+
+				err = fabs(BMP180GetAltitude(&g_sBmp, seaLevel, mode) - exact);
+				altErr = (err > altErr) ? err : altErr;
+				err = fabs(BMP180GetSeaLevel(&g_sBmp, (float)exact, mode) - p / pow(1.0 - exact / 44330.0, 5.255));
+				seaErr = (err > seaErr) ? err : seaErr;
+			}
+		}
+
+		printf("altitude %s: worst %.2f m, sea level worst %.2f Pa\n", mode ? "FINE" : "FAST", altErr, seaErr);
+		CHECK(altErr < pfAltLimit[mode]);
+		CHECK(seaErr < pfSeaLimit[mode]);
+	}
+}
+
+#ifdef BMP180_DIV_FREE
+// BMP180DivB4 against the divide for every B4 the formula can give (AC4 is 16 bit and X3 + 32768
+// stays below 65536, so B4 < 2^17). n covers the ends of the range and the values either side of
+// multiples of B4, where a short estimate shows up
+static void CheckDivB4(void){
+	static const uint32_t pui32Edges[8] = {0, 1, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFD, 0xFFFFFFFE, 0xFFFFFFFF, 0xC0000001};
+	tBMP180PresTerms sTerms;
+	uint32_t n, q, qMax, random = 1, mismatches = 0, tried = 0;
+	uint32_t B4, i;
+
+	for(B4 = 1; B4 < (1 << 17); B4++){
+		sTerms.B4 = B4;
+		sTerms.B4Recip = 0xFFFFFFFF / B4;
+		qMax = 0xFFFFFFFF / B4;
+
+		for(i = 0; i < 8 + 3 * 16; i++){
+			if(i < 8){
+				n = pui32Edges[i];
+			} else{
+				// Quotients at both ends and spread between them
+				random = random * 1664525 + 1013904223;
+				q = (i < 14) ? qMax - (i - 8) : (i < 20) ? i - 13 : random % qMax + 1;
+				n = q * B4 + ((i % 3) == 0 ? 0 : (i % 3) == 1 ? B4 - 1 : (uint32_t)-1);
+			}
+			tried++;
+			if(BMP180DivB4(n, &sTerms) != n / B4){
+				mismatches++;
+			}
+		}
+	}
+
+	CHECK(mismatches == 0);
+	CHECK(tried > 7000000);
+
+	// B4 of zero behaves like the hardware divide
+	sTerms.B4 = 0;
+	sTerms.B4Recip = 0;
+	CHECK(BMP180DivB4(12345, &sTerms) == 0);
+}
+#endif
+
+int main(void){
+	HostInit();
+
+	CheckCal();
+	CheckBlocking();
+	CheckNonBlocking();
+	CheckTempCache();
+	CheckBatch();
+	CheckReference();
+	CheckAltitude();
+#ifdef BMP180_DIV_FREE
+	CheckDivB4();
+#endif
+
+#ifdef BMP180_DIV_FREE
+	return HostResult("bmpTestDivFree");
+#else
+	return HostResult("bmpTest");
+#endif
+}
@@ -0,0 +1,235 @@
+// devTest.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	None
+//
+// Requirements:
+// 	See host.h
+//
+// Description:
+// 	Checks the i2cLib device layer on the host backend, and the three drivers sharing one bus
+//	through it
+//
+// Notes:
+//	The primitives are checked against a plain register file slave. The drivers are linked as
+//	they are built for the target, so only their public API and the bus log are visible
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include "host.h"
+#include "inc/hw_memmap.h"
+#include "i2cLib.h"
+#include "bmpLib.h"
+#include "shtLib.h"
+#include "islLib.h"
+#include "i2cModel.h"
+#include "sensorModel.h"
+
+
+// Defines -------------------------------------------------------------------------------------------
+#define REG_ADDR 0x50
+#define REG_COUNT 16
+#define MISSING_ADDR 0x51		// No slave answers here
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+
+// Register file: the first byte written sets the pointer, the rest are stored from it. Reads
+// continue from the pointer. Both wrap
+typedef struct
+{
+	tHostSlave slave;
+	uint8_t reg;
+	uint8_t regs[REG_COUNT];
+} tRegModel;
+
+static const int16_t g_pi16ExampleCal[11] = {408, -72, -14383, (int16_t)32741, (int16_t)32757, (int16_t)23153, 6190, 4, -32768, -8711, 2868};
+
+static tI2CBus g_sTestBus;
+static tRegModel g_sRegModel;
+
+
+
+// Functions -----------------------------------------------------------------------------------------
+
+static bool RegModelWrite(tHostSlave *psSlave, const uint8_t *data, uint8_t len){
+	tRegModel *psModel = (tRegModel *)psSlave;
+	uint8_t i;
+
+	psModel->reg = data[0] % REG_COUNT;
+	for(i = 1; i < len; i++){
+		psModel->regs[psModel->reg] = data[i];
+		psModel->reg = (psModel->reg + 1) % REG_COUNT;
+	}
+	return true;
+}
+
+static bool RegModelRead(tHostSlave *psSlave, uint8_t *data, uint8_t len){
+	tRegModel *psModel = (tRegModel *)psSlave;
+	uint8_t i;
+
+	for(i = 0; i < len; i++){
+		data[i] = psModel->regs[psModel->reg];
+		psModel->reg = (psModel->reg + 1) % REG_COUNT;
+	}
+	return true;
+}
+
+// A fresh bus with the register file on it, registers numbered by their index
+static void Setup(void){
+	uint8_t i;
+
+	HostBusReset();
+	I2CLibBusInit(&g_sTestBus, I2C3_BASE, &g_sHostBackend);
+	g_sRegModel.slave.addr = REG_ADDR;
+	g_sRegModel.slave.write = RegModelWrite;
+	g_sRegModel.slave.read = RegModelRead;
+	g_sRegModel.reg = 0;
+	for(i = 0; i < REG_COUNT; i++){
+		g_sRegModel.regs[i] = i;
+	}
+	HostSlaveAdd(&g_sRegModel.slave);
+}
+
+
+
+// Checks --------------------------------------------------------------------------------------------
+
+// Each primitive is one transaction of the expected shape, and the device counts its bytes
+static void CheckPrimitives(void){
+	static const uint8_t pui8Write[I2C_WRITE_MAX + 1] = {0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8};
+	tI2CDevice sDev;
+	const tHostTrans *psLast;
+	uint8_t pui8Read[4];
+
+	Setup();
+	I2CLibDevInit(&sDev, &g_sTestBus, REG_ADDR);
+	CHECK(sDev.bus == &g_sTestBus && sDev.addr == REG_ADDR && sDev.speed == I2C_SPEED_FAST);
+
+	// Register address, restart, read
+	CHECK(I2CLibDevReadRegs(&sDev, 5, pui8Read, 3) == I2C_STATUS_DONE);
+	psLast = HostBusLast(0);
+	CHECK(g_ui32HostLogCount == 1 && psLast->addr == REG_ADDR && psLast->txLen == 1 && psLast->tx[0] == 5 && psLast->rxLen == 3);
+	CHECK(pui8Read[0] == 5 && pui8Read[1] == 6 && pui8Read[2] == 7);
+
+	// Register address and data in one write
+	CHECK(I2CLibDevWriteRegs(&sDev, 2, pui8Write, 2) == I2C_STATUS_DONE);
+	psLast = HostBusLast(0);
+	CHECK(g_ui32HostLogCount == 2 && psLast->txLen == 3 && psLast->tx[0] == 2 && psLast->tx[1] == 0xA0 && psLast->tx[2] == 0xA1 && psLast->rxLen == 0);
+	CHECK(g_sRegModel.regs[1] == 1 && g_sRegModel.regs[2] == 0xA0 && g_sRegModel.regs[3] == 0xA1 && g_sRegModel.regs[4] == 4);
+
+	// Up to I2C_WRITE_MAX data bytes, more is refused without touching the bus
+	CHECK(I2CLibDevWriteRegs(&sDev, 8, pui8Write, I2C_WRITE_MAX) == I2C_STATUS_DONE);
+	CHECK(HostBusLast(0)->txLen == I2C_WRITE_MAX + 1 && g_sRegModel.regs[8 + I2C_WRITE_MAX - 1] == 0xA0 + I2C_WRITE_MAX - 1);
+	CHECK(I2CLibDevWriteRegs(&sDev, 0, pui8Write, I2C_WRITE_MAX + 1) == I2C_STATUS_ERROR);
+	CHECK(g_ui32HostLogCount == 3);
+
+	// A single command byte, then a read with no register address
+	CHECK(I2CLibDevCommand(&sDev, 3) == I2C_STATUS_DONE);
+	psLast = HostBusLast(0);
+	CHECK(psLast->txLen == 1 && psLast->tx[0] == 3 && psLast->rxLen == 0);
+	CHECK(I2CLibDevRead(&sDev, pui8Read, 2) == I2C_STATUS_DONE);
+	psLast = HostBusLast(0);
+	CHECK(psLast->txLen == 0 && psLast->rxLen == 2 && pui8Read[0] == 0xA1 && pui8Read[1] == 4);
+
+	// An empty transfer is refused
+	CHECK(I2CLibDevTransfer(&sDev, 0, 0, 0, 0) == I2C_STATUS_ERROR);
+	CHECK(g_ui32HostLogCount == 5);
+
+	CHECK(sDev.bytes == 4 + 3 + (I2C_WRITE_MAX + 1) + 1 + 2 && sDev.bytes == g_sRegModel.slave.bytes);
+	CHECK(sDev.nacks == 0 && sDev.timeouts == 0 && sDev.arbLost == 0);
+}
+
+// Devices on one bus keep their own address and counters. A NACK isn't retried, timeouts and lost
+// arbitration are, up to I2C_RETRIES times
+static void CheckDevices(void){
+	tI2CDevice sDev, sMissing;
+	uint8_t data;
+
+	Setup();
+	I2CLibDevInit(&sDev, &g_sTestBus, REG_ADDR);
+	I2CLibDevInit(&sMissing, &g_sTestBus, MISSING_ADDR);
+
+	data = 0x77;
+	CHECK(I2CLibDevReadRegs(&sMissing, 1, &data, 1) == I2C_STATUS_ERROR);
+	CHECK(g_ui32HostLogCount == 1 && HostBusLast(0)->addr == MISSING_ADDR);
+	CHECK(sMissing.nacks == 1 && sMissing.bytes == 0 && sDev.nacks == 0);
+	CHECK(I2CLibDevCommand(&sDev, 1) == I2C_STATUS_DONE && HostBusLast(0)->addr == REG_ADDR);
+	CHECK(sDev.bytes == 1 && sMissing.bytes == 0);
+
+	// One timeout, then the retry goes through
+	HostBusFault(I2C_STATUS_TIMEOUT, 0, 1);
+	CHECK(I2CLibDevReadRegs(&sDev, 1, &data, 1) == I2C_STATUS_DONE && data == 1);
+	CHECK(g_ui32HostLogCount == 4 && sDev.timeouts == 1 && sDev.bytes == 3);
+
+	// Lost arbitration on every attempt
+	HostBusFault(I2C_STATUS_ARB_LOST, 0, I2C_RETRIES + 1);
+	CHECK(I2CLibDevCommand(&sDev, 1) == I2C_STATUS_ARB_LOST);
+	CHECK(g_ui32HostLogCount == 5 + I2C_RETRIES && sDev.arbLost == I2C_RETRIES + 1);
+
+	// A NACK from a slave that is there
+	HostBusFault(I2C_STATUS_ERROR, 0, 1);
+	CHECK(I2CLibDevCommand(&sDev, 1) == I2C_STATUS_ERROR);
+	CHECK(g_ui32HostLogCount == 6 + I2C_RETRIES && sDev.nacks == 1);
+}
+
+// The three drivers share the bus. Each only talks to its own address through its own device,
+// whose byte count matches what its slave saw
+static void CheckDrivers(void){
+	tBmpModel sBmpModel;
+	tShtModel sShtModel;
+	tIslModel sIslModel;
+	tBMP180 sBmp;
+	tBMP180Cals sCals;
+	tSHT2x sSht;
+	tISL29023 sIsl;
+	uint32_t i, count;
+
+	Setup();
+	BmpModelInit(&sBmpModel, g_pi16ExampleCal, 27898, 23843);
+	ShtModelInit(&sShtModel, 0x6A3C, 0x6060);
+	IslModelInit(&sIslModel, 500, 0);
+	HostSlaveAdd(&sBmpModel.slave);
+	HostSlaveAdd(&sShtModel.slave);
+	HostSlaveAdd(&sIslModel.slave);
+
+	BMP180Initialize(&sBmp, &g_sTestBus, 0);
+	SHT21Initialize(&sSht, &g_sTestBus);
+	ISL29023Initialize(&sIsl, &g_sTestBus);
+	CHECK(sBmp.dev.bus == &g_sTestBus && sSht.dev.bus == &g_sTestBus && sIsl.dev.bus == &g_sTestBus);
+	CHECK(sBmp.dev.addr == BMP180_I2C_ADDRESS && sSht.dev.addr == SHT21_I2C_ADDRESS && sIsl.dev.addr == ISL29023_I2C_ADDRESS);
+
+	CHECK(BMP180GetCalVals(&sBmp, &sCals) == BMP180_STATUS_OK && HostBusLast(0)->addr == BMP180_I2C_ADDRESS);
+	CHECK(SHT21ReadTemperature(&sSht) == SHT21_STATUS_OK && HostBusLast(0)->addr == SHT21_I2C_ADDRESS);
+	ISL29023ChangeSettings(ISL29023_COMMANDII_RANGE64k, ISL29023_COMMANDII_RES16, &sIsl);
+	CHECK(HostBusLast(0)->addr == ISL29023_I2C_ADDRESS);
+	CHECK(BMP180GetTemp(&sBmp, &sCals) == BMP180_STATUS_OK && HostBusLast(0)->addr == BMP180_I2C_ADDRESS);
+	ISL29023GetRawALS(&sIsl);
+	CHECK(HostBusLast(0)->addr == ISL29023_I2C_ADDRESS);
+	CHECK(SHT21ReadHumidity(&sSht) == SHT21_STATUS_OK && HostBusLast(0)->addr == SHT21_I2C_ADDRESS);
+
+	// Nothing strayed onto the register file, and nothing was dropped from the log
+	count = g_ui32HostLogCount;
+	CHECK(count <= HOST_LOG_LEN && g_sRegModel.slave.bytes == 0);
+	for(i = 0; i < count; i++){
+		CHECK(HostBusLast(i)->status == I2C_STATUS_DONE && HostBusLast(i)->addr != REG_ADDR);
+	}
+	CHECK(sBmp.dev.bytes == sBmpModel.slave.bytes && sBmp.dev.bytes > 0);
+	CHECK(sSht.dev.bytes == sShtModel.slave.bytes && sSht.dev.bytes > 0);
+	CHECK(sIsl.dev.bytes == sIslModel.slave.bytes && sIsl.dev.bytes > 0);
+}
+
+int main(void){
+	HostInit();
+	CheckPrimitives();
+	CheckDevices();
+	CheckDrivers();
+	return HostResult("devTest");
+}
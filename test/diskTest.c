@@ -0,0 +1,552 @@
+// diskTest.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	None
+//
+// Requirements:
+// 	See host.h
+//
+// Description:
+// 	Checks diskio against the SD card model on SSI0
+//
+// Notes:
+//	diskio.c is included so the checks can reach its state. Built three times by the Makefile, as
+//	diskTest, with SDC_NO_DMA as diskTestNoDma, and with SDC_CACHE_SECTORS 0 as diskTestNoCache.
+//	All must put the same bytes on the wire
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include <string.h>
+
+#include "host.h"
+#include "../SD Card/diskio.c"
+#include "sdModel.h"
+
+
+// Defines -------------------------------------------------------------------------------------------
+
+// 1MB card
+#define CARD_SECTORS 2048
+
+// Frames each SSI FIFO holds on the TM4C123
+#define FIFO_DEPTH 8
+
+// Longest stream of MOSI bytes kept
+#define MOSI_LEN 4096
+
+// Time of a 512 byte block at 12.5MHz
+#define BLOCK_NS (512 * 640)
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+static uint8_t g_pui8Mosi[MOSI_LEN];
+static uint8_t g_pui8Expect[MOSI_LEN];
+static uint32_t g_ui32ExpectLen;
+
+// Idle hook
+static uint64_t g_ui64HookWorkNs;		// Application work before each sleep
+static uint32_t g_ui32HookCalls;
+static uint32_t g_ui32HookUnmasked;		// Calls with interrupts unmasked
+static uint32_t g_ui32HookPending;		// Sleeps with an interrupt already pending
+
+
+
+// Functions -----------------------------------------------------------------------------------------
+
+// A blank card, initialised
+static void Setup(void){
+	SdModelInit(CARD_SECTORS, disk_timerproc, disk_dmaproc);
+	disk_idle_set(0);
+	CHECK(disk_initialize(0) == 0);
+	CHECK(CardType == 6);
+}
+
+// Idle hook like sd.c's, with some work of the application's first
+static void Idle(void){
+	g_ui32HookCalls++;
+	if(!g_bHostMasked){
+		g_ui32HookUnmasked++;
+	}
+	SdModelRun(g_ui64HookWorkNs);
+	if(SdModelPending()){
+		g_ui32HookPending++;
+	}
+	ROM_SysCtlSleep();
+}
+
+static void HookReset(uint64_t ui64WorkNs){
+	g_ui64HookWorkNs = ui64WorkNs;
+	g_ui32HookCalls = 0;
+	g_ui32HookUnmasked = 0;
+	g_ui32HookPending = 0;
+	g_ui64SdSleptNs = 0;
+}
+
+// Sleep through the next tick, so the one after is 10ms away
+static void Tick(void){
+	ROM_SysCtlSleep();
+}
+
+// Distinct bytes for each sector
+static void Fill(uint8_t *buff, DWORD sector){
+	uint32_t i;
+
+	for(i = 0; i < 512; i++){
+		buff[i] = (uint8_t)(i * 7 + sector * 13 + (i >> 8));
+	}
+}
+
+// Start keeping what the card receives, and an empty expected stream
+static void Capture(void){
+	g_pui8SdMosi = g_pui8Mosi;
+	g_ui32SdMosiMax = MOSI_LEN;
+	g_ui32SdMosiCount = 0;
+	g_ui32ExpectLen = 0;
+}
+
+static void Expect(uint8_t data, uint32_t count){
+	while(count--){
+		g_pui8Expect[g_ui32ExpectLen++] = data;
+	}
+}
+
+static void ExpectData(const uint8_t *data, uint32_t len){
+	memcpy(&g_pui8Expect[g_ui32ExpectLen], data, len);
+	g_ui32ExpectLen += len;
+}
+
+// A command as send_cmd sends it to a card that isn't busy: two ready polls, the command, and
+// two polls for the response
+static void ExpectCmd(uint8_t cmd, DWORD arg){
+	Expect(0xFF, 2);
+	Expect(cmd, 1);
+	Expect(arg >> 24, 1);
+	Expect(arg >> 16, 1);
+	Expect(arg >> 8, 1);
+	Expect(arg, 1);
+	Expect(0xFF, 3);
+}
+
+// The card got exactly the expected stream
+static bool Matches(void){
+	return g_ui32SdMosiCount == g_ui32ExpectLen && memcmp(g_pui8Mosi, g_pui8Expect, g_ui32ExpectLen) == 0;
+}
+
+
+
+// Checks --------------------------------------------------------------------------------------------
+
+// The card comes up as SDHC and the CSD, moved by the FIFO path in either build, gives its size.
+// The FIFO path keeps a FIFO's worth of frames in flight and never more
+static void CheckInit(void){
+	DWORD sectors = 0;
+
+	Setup();
+	CHECK(SdModelCount(0) == 1 && SdModelCount(8) == 1 && SdModelCount(41) == 1 && SdModelCount(58) == 1);
+	g_ui32SdMaxDepth = 0;
+	CHECK(disk_ioctl(0, GET_SECTOR_COUNT, &sectors) == RES_OK && sectors == CARD_SECTORS);
+	CHECK(g_ui32SdMaxDepth == FIFO_DEPTH);
+	CHECK(g_ui32SdOverruns == 0 && g_ui32SdEmptyReads == 0);
+}
+
+// A single block read: the command, one dummy byte for each byte the card sends, data in order
+static void CheckReadStream(void){
+	uint8_t pui8Buff[512];
+
+	Setup();
+	Fill(g_ppui8SdDisk[5], 5);
+	g_ui32SdMaxDepth = 0;
+	Capture();
+	CHECK(disk_read(0, pui8Buff, 5, 1) == RES_OK);
+	CHECK(memcmp(pui8Buff, g_ppui8SdDisk[5], 512) == 0);
+
+	// Token poll, data and CRC are all clocked with 0xFF
+	ExpectCmd(CMD17, 5);
+	Expect(0xFF, 2 + 512 + 2);
+	CHECK(Matches());
+	CHECK(SdModelLast(0)->cmd == 17 && SdModelLast(0)->blocks == 1);
+#ifdef SDC_NO_DMA
+	CHECK(g_ui32SdMaxDepth == FIFO_DEPTH);
+#else
+	CHECK(g_ui32SdMaxDepth == 1);
+#endif
+	CHECK(g_ui32SdOverruns == 0 && g_ui32SdEmptyReads == 0);
+}
+
+// A single block write goes out in order with its token, dummy CRC and response poll. With the
+// cache it goes at the sync, and either way the sync ends with a ready check
+static void CheckWriteStream(void){
+	uint8_t pui8Buff[512];
+
+	Setup();
+	Fill(pui8Buff, 9);
+	g_ui32SdMaxDepth = 0;
+	Capture();
+	CHECK(disk_write(0, pui8Buff, 9, 1) == RES_OK);
+	CHECK(disk_ioctl(0, CTRL_SYNC, 0) == RES_OK);
+	CHECK(memcmp(pui8Buff, g_ppui8SdDisk[9], 512) == 0);
+
+	ExpectCmd(CMD24, 9);
+	Expect(0xFF, 2);
+	Expect(0xFE, 1);
+	ExpectData(pui8Buff, 512);
+	Expect(0xFF, 2 + 1);
+	Expect(0xFF, 2);
+	CHECK(Matches());
+	CHECK(SdModelLast(0)->cmd == 24 && SdModelLast(0)->blocks == 1 && g_ui32SdBlocksWritten == 1);
+#ifdef SDC_NO_DMA
+	CHECK(g_ui32SdMaxDepth == FIFO_DEPTH);
+#endif
+	CHECK(g_ui32SdOverruns == 0 && g_ui32SdEmptyReads == 0);
+}
+
+// Multiple blocks each way arrive intact and in order, as one command each
+static void CheckMultiBlock(void){
+	static uint8_t pui8Buff[8 * 512], pui8Back[8 * 512];
+	DWORD i;
+
+	Setup();
+	for(i = 0; i < 8; i++){
+		Fill(&pui8Buff[i * 512], 100 + i);
+	}
+	CHECK(disk_write(0, pui8Buff, 100, 8) == RES_OK);
+	CHECK(SdModelLast(0)->cmd == 25 && SdModelLast(0)->arg == 100 && SdModelLast(0)->blocks == 8);
+	CHECK(SdModelLast(1)->cmd == 23 && SdModelLast(1)->arg == 8);
+	CHECK(memcmp(pui8Buff, g_ppui8SdDisk[100], sizeof(pui8Buff)) == 0);
+
+	CHECK(disk_read(0, pui8Back, 100, 8) == RES_OK);
+	CHECK(SdModelLast(1)->cmd == 18 && SdModelLast(1)->blocks == 8 && SdModelLast(0)->cmd == 12);
+	CHECK(memcmp(pui8Buff, pui8Back, sizeof(pui8Buff)) == 0);
+	CHECK(g_ui32SdBlocksRead == 8 && g_ui32SdBlocksWritten == 8);
+	CHECK(g_ui32SdOverruns == 0 && g_ui32SdEmptyReads == 0);
+}
+
+// The uDMA wait runs the hook masked. A completion that lands during the hook's own work is
+// still pending when it sleeps, so the sleep returns at once and the block ends well inside a tick
+// instead of at the next one. A block that never completes times out after 5 ticks
+#ifndef SDC_NO_DMA
+static void CheckIdleDma(void){
+	static uint8_t pui8Buff[4 * 512], pui8Back[4 * 512];
+	uint64_t start;
+	uint32_t i;
+
+	Setup();
+	disk_idle_set(Idle);
+	Fill(g_ppui8SdDisk[5], 5);
+
+	// Work longer than the block, so it finishes before the sleep
+	Tick();
+	HookReset(400000);
+	start = HostNs();
+	CHECK(disk_read(0, pui8Buff, 5, 1) == RES_OK && memcmp(pui8Buff, g_ppui8SdDisk[5], 512) == 0);
+	CHECK(HostNs() - start < 1000000);
+	CHECK(g_ui32HookCalls == 1 && g_ui32HookUnmasked == 0 && g_ui32HookPending == 1 && g_ui64SdSleptNs == 0);
+
+	// No work, the hook sleeps until the block ends
+	Tick();
+	HookReset(0);
+	start = HostNs();
+	CHECK(disk_read(0, pui8Buff, 5, 1) == RES_OK && memcmp(pui8Buff, g_ppui8SdDisk[5], 512) == 0);
+	CHECK(HostNs() - start < 1000000);
+	CHECK(g_ui32HookCalls == 1 && g_ui32HookUnmasked == 0 && g_ui32HookPending == 0);
+	CHECK(g_ui64SdSleptNs > BLOCK_NS - 10000 && g_ui64SdSleptNs <= BLOCK_NS);
+
+	// A 4 block write, one wait for each block
+	for(i = 0; i < 4; i++){
+		Fill(&pui8Buff[i * 512], 200 + i);
+	}
+	Tick();
+	HookReset(400000);
+	start = HostNs();
+	CHECK(disk_write(0, pui8Buff, 200, 4) == RES_OK);
+	CHECK(HostNs() - start < 4000000);
+	CHECK(g_ui32HookCalls == 4 && g_ui32HookUnmasked == 0 && g_ui32HookPending == 4);
+	CHECK(disk_read(0, pui8Back, 200, 4) == RES_OK && memcmp(pui8Buff, pui8Back, sizeof(pui8Buff)) == 0);
+
+	// Stalled, the read fails after 5 ticks with interrupts enabled
+	Tick();
+	HookReset(0);
+	g_bSdDmaStall = true;
+	start = HostNs();
+	CHECK(disk_read(0, pui8Back, 5, 1) == RES_ERROR);
+	CHECK(HostNs() - start > 40000000 && HostNs() - start < 51000000);
+	CHECK(g_ui32HookCalls == 5 && g_ui32HookUnmasked == 0 && !g_bHostMasked);
+	g_bSdDmaStall = false;
+	CHECK(disk_initialize(0) == 0);
+	CHECK(disk_read(0, pui8Back, 5, 1) == RES_OK && memcmp(pui8Back, g_ppui8SdDisk[5], 512) == 0);
+	CHECK(g_ui32SdOverruns == 0 && g_ui32SdEmptyReads == 0);
+}
+#endif
+
+// The card-busy wait runs the hook masked too. A hook that sleeps polls the card once a tick, and
+// the wait ends at the first tick after the card is ready
+static void CheckIdleBusy(void){
+	uint8_t pui8Buff[512];
+	uint64_t start;
+
+	Setup();
+	disk_idle_set(Idle);
+	g_ui64SdBusyNs = 35000000;
+	Fill(pui8Buff, 30);
+
+	Tick();
+	HookReset(100000);
+	start = HostNs();
+	CHECK(disk_write(0, pui8Buff, 30, 1) == RES_OK);
+	CHECK(disk_ioctl(0, CTRL_SYNC, 0) == RES_OK);
+	CHECK(HostNs() - start > 40000000 && HostNs() - start < 41000000);
+	CHECK(memcmp(pui8Buff, g_ppui8SdDisk[30], 512) == 0);
+	CHECK(g_ui32HookUnmasked == 0 && !g_bHostMasked);
+#ifdef SDC_NO_DMA
+	CHECK(g_ui32HookCalls == 4);
+#else
+	CHECK(g_ui32HookCalls == 1 + 4);
+#endif
+}
+
+// Each card-busy wait lands in the bin for its length in ticks. A card still busy after 500ms is a
+// timeout in the last bin, and the wait leaves interrupts enabled
+static void CheckBusyHist(void){
+	// Busy time and the bin it lands in. Each write starts just after a tick and a sleeping hook
+	// polls once a tick, so a wait counts the ticks begun while the card was busy. The first wait
+	// spins with no hook and ends before a tick
+	static const struct
+	{
+		uint32_t busyMs;
+		uint8_t bin;
+	} psCases[] = {{1, 0}, {5, 1}, {15, 2}, {35, 3}, {75, 4}, {155, 5}, {400, 6}, {600, BUSY_HIST_BINS - 1}};
+	uint8_t pui8Buff[512];
+	DWORD pui32Before[BUSY_HIST_BINS], pui32After[BUSY_HIST_BINS];
+	uint32_t i, b;
+	DRESULT res;
+
+	Setup();
+	Fill(pui8Buff, 40);
+	for(i = 0; i < sizeof(psCases) / sizeof(psCases[0]); i++){
+		disk_idle_set(i ? Idle : 0);
+		HookReset(0);
+		g_ui64SdBusyNs = (uint64_t)psCases[i].busyMs * 1000000;
+		CHECK(disk_ioctl(0, MMC_GET_BUSYHIST, pui32Before) == RES_OK);
+		Tick();
+		CHECK(disk_write(0, pui8Buff, 40 + i, 1) == RES_OK);
+		res = disk_ioctl(0, CTRL_SYNC, 0);
+		CHECK(disk_ioctl(0, MMC_GET_BUSYHIST, pui32After) == RES_OK);
+		for(b = 0; b < BUSY_HIST_BINS; b++){
+			CHECK(pui32After[b] - pui32Before[b] == (b == psCases[i].bin));
+		}
+		CHECK(res == (psCases[i].bin == BUSY_HIST_BINS - 1 ? RES_ERROR : RES_OK));
+		CHECK(g_ui32HookUnmasked == 0 && !g_bHostMasked);
+	}
+	CHECK(memcmp(pui8Buff, g_ppui8SdDisk[40 + i - 1], 512) == 0);
+}
+
+// Sectors passed to disk_write and sent to the card since the last call
+static void Writes(DWORD *pui32Logical, DWORD *pui32Physical){
+	static DWORD pui32Last[2];
+	DWORD pui32Now[2];
+
+	CHECK(disk_ioctl(0, MMC_GET_WRITES, pui32Now) == RES_OK);
+	*pui32Logical = pui32Now[0] - pui32Last[0];
+	*pui32Physical = pui32Now[1] - pui32Last[1];
+	pui32Last[0] = pui32Now[0];
+	pui32Last[1] = pui32Now[1];
+}
+
+#if SDC_CACHE_SECTORS
+// Small writes stay in RAM until CTRL_SYNC. It sends each run of adjacent sectors as one CMD25,
+// other sectors on their own, and a sector rewritten while cached goes out once
+static void CheckCacheSync(void){
+	uint8_t pui8Buff[512];
+	DWORD logical, physical, i;
+
+	Setup();
+	Writes(&logical, &physical);
+	for(i = 0; i < 3; i++){
+		Fill(pui8Buff, 50 + i);
+		CHECK(disk_write(0, pui8Buff, 50 + i, 1) == RES_OK);
+	}
+	CHECK(g_ui32SdBlocksWritten == 0);
+	CHECK(disk_ioctl(0, CTRL_SYNC, 0) == RES_OK);
+	CHECK(SdModelCount(25) == 1 && SdModelCount(24) == 0);
+	CHECK(SdModelLast(0)->cmd == 25 && SdModelLast(0)->arg == 50 && SdModelLast(0)->blocks == 3);
+	for(i = 0; i < 3; i++){
+		Fill(pui8Buff, 50 + i);
+		CHECK(memcmp(pui8Buff, g_ppui8SdDisk[50 + i], 512) == 0);
+	}
+	Writes(&logical, &physical);
+	CHECK(logical == 3 && physical == 3);
+
+	// Apart, and one of them rewritten
+	for(i = 0; i < 5; i++){
+		Fill(pui8Buff, 60 + i);
+		CHECK(disk_write(0, pui8Buff, 60, 1) == RES_OK);
+	}
+	Fill(pui8Buff, 62);
+	CHECK(disk_write(0, pui8Buff, 62, 1) == RES_OK);
+	CHECK(disk_ioctl(0, CTRL_SYNC, 0) == RES_OK);
+	CHECK(SdModelCount(24) == 2 && g_ui32SdBlocksWritten == 3 + 2);
+	Fill(pui8Buff, 64);
+	CHECK(memcmp(pui8Buff, g_ppui8SdDisk[60], 512) == 0);
+	Writes(&logical, &physical);
+	CHECK(logical == 6 && physical == 2);
+
+	// Nothing dirty, nothing sent
+	CHECK(disk_ioctl(0, CTRL_SYNC, 0) == RES_OK && disk_ioctl(0, MMC_FLUSH_CACHE, 0) == RES_OK);
+	CHECK(g_ui32SdBlocksWritten == 5);
+}
+
+// With MMC_SYNC_DEFER set CTRL_SYNC leaves the cache alone, MMC_FLUSH_CACHE still writes it. Once
+// cleared CTRL_SYNC writes again
+static void CheckCacheDefer(void){
+	uint8_t pui8Buff[512];
+	BYTE defer;
+
+	Setup();
+	Fill(pui8Buff, 70);
+	defer = 1;
+	CHECK(disk_ioctl(0, MMC_SYNC_DEFER, &defer) == RES_OK);
+	CHECK(disk_write(0, pui8Buff, 70, 1) == RES_OK);
+	CHECK(disk_ioctl(0, CTRL_SYNC, 0) == RES_OK && g_ui32SdBlocksWritten == 0);
+	CHECK(disk_ioctl(0, MMC_FLUSH_CACHE, 0) == RES_OK && g_ui32SdBlocksWritten == 1);
+
+	CHECK(disk_write(0, pui8Buff, 71, 1) == RES_OK);
+	CHECK(disk_ioctl(0, CTRL_SYNC, 0) == RES_OK && g_ui32SdBlocksWritten == 1);
+	defer = 0;
+	CHECK(disk_ioctl(0, MMC_SYNC_DEFER, &defer) == RES_OK);
+	CHECK(g_ui32SdBlocksWritten == 1);
+	CHECK(disk_ioctl(0, CTRL_SYNC, 0) == RES_OK && g_ui32SdBlocksWritten == 2);
+	CHECK(memcmp(pui8Buff, g_ppui8SdDisk[71], 512) == 0);
+}
+
+// Dirty data goes out at the first service call SDC_CACHE_AGE ticks after it was first written,
+// and a full cache makes room by writing everything
+static void CheckCacheAge(void){
+	uint8_t pui8Buff[512];
+	uint32_t i;
+
+	Setup();
+	Fill(pui8Buff, 75);
+	Tick();
+	CHECK(disk_write(0, pui8Buff, 75, 1) == RES_OK);
+	for(i = 0; i < SDC_CACHE_AGE - 1; i++){
+		Tick();
+		disk_cache_service();
+	}
+	CHECK(disk_write(0, pui8Buff, 76, 1) == RES_OK);
+	CHECK(g_ui32SdBlocksWritten == 0);
+	Tick();
+	disk_cache_service();
+	CHECK(g_ui32SdBlocksWritten == 2 && SdModelLast(0)->cmd == 25);
+	CHECK(memcmp(pui8Buff, g_ppui8SdDisk[76], 512) == 0);
+
+	for(i = 0; i < SDC_CACHE_SECTORS; i++){
+		CHECK(disk_write(0, pui8Buff, 300 + 2 * i, 1) == RES_OK);
+	}
+	CHECK(g_ui32SdBlocksWritten == 2);
+	CHECK(disk_write(0, pui8Buff, 400, 1) == RES_OK);
+	CHECK(g_ui32SdBlocksWritten == 2 + SDC_CACHE_SECTORS);
+	CHECK(disk_ioctl(0, CTRL_SYNC, 0) == RES_OK && g_ui32SdBlocksWritten == 3 + SDC_CACHE_SECTORS);
+}
+
+// Reads see cached sectors over the card's, alone or inside a longer read. A write too large for
+// the cache goes to the card and drops the cached copies it replaces
+static void CheckCacheRead(void){
+	static uint8_t pui8Buff[4 * 512], pui8Back[4 * 512];
+	uint32_t i;
+
+	Setup();
+	for(i = 0; i < 3; i++){
+		Fill(g_ppui8SdDisk[79 + i], 79 + i);
+	}
+	Fill(pui8Buff, 1000);
+	CHECK(disk_write(0, pui8Buff, 80, 1) == RES_OK);
+	CHECK(disk_read(0, pui8Back, 80, 1) == RES_OK && memcmp(pui8Back, pui8Buff, 512) == 0);
+	CHECK(g_ui32SdBlocksRead == 0);
+	CHECK(disk_read(0, pui8Back, 79, 3) == RES_OK && g_ui32SdBlocksRead == 3);
+	CHECK(memcmp(pui8Back, g_ppui8SdDisk[79], 512) == 0 && memcmp(&pui8Back[512], pui8Buff, 512) == 0);
+	CHECK(memcmp(&pui8Back[1024], g_ppui8SdDisk[81], 512) == 0);
+
+	for(i = 0; i < 4; i++){
+		Fill(&pui8Buff[i * 512], 2000 + i);
+	}
+	CHECK(disk_write(0, pui8Buff, 78, 4) == RES_OK);
+	CHECK(g_ui32SdBlocksWritten == 4 && SdModelLast(0)->cmd == 25 && SdModelLast(0)->arg == 78);
+	CHECK(disk_read(0, pui8Back, 80, 1) == RES_OK && memcmp(pui8Back, &pui8Buff[2 * 512], 512) == 0);
+	CHECK(disk_ioctl(0, CTRL_SYNC, 0) == RES_OK && g_ui32SdBlocksWritten == 4);
+	CHECK(memcmp(g_ppui8SdDisk[78], pui8Buff, sizeof(pui8Buff)) == 0);
+}
+
+// disk_initialize writes the cache out before resetting the card. While the card refuses writes
+// it fails and keeps the sectors, and a later call writes them
+static void CheckCacheInit(void){
+	uint8_t pui8Buff[512];
+
+	Setup();
+	Fill(pui8Buff, 95);
+	CHECK(disk_write(0, pui8Buff, 95, 1) == RES_OK);
+	g_ui32SdRejects = 1000;
+	CHECK(disk_initialize(0) & STA_NOINIT);
+	CHECK(disk_initialize(0) & STA_NOINIT);
+	CHECK(g_ui32SdBlocksWritten == 0 && SdModelCount(0) == 1);
+	g_ui32SdRejects = 0;
+	CHECK(disk_initialize(0) == 0);
+	CHECK(g_ui32SdBlocksWritten == 1 && memcmp(pui8Buff, g_ppui8SdDisk[95], 512) == 0);
+	CHECK(SdModelCount(0) == 2);
+	CHECK(disk_ioctl(0, CTRL_SYNC, 0) == RES_OK && g_ui32SdBlocksWritten == 1);
+}
+#else
+// Every write goes straight to the card
+static void CheckWriteThrough(void){
+	uint8_t pui8Buff[512];
+	DWORD logical, physical;
+
+	Setup();
+	Writes(&logical, &physical);
+	Fill(pui8Buff, 50);
+	CHECK(disk_write(0, pui8Buff, 50, 1) == RES_OK && g_ui32SdBlocksWritten == 1);
+	CHECK(disk_write(0, pui8Buff, 50, 1) == RES_OK && g_ui32SdBlocksWritten == 2);
+	CHECK(disk_write(0, pui8Buff, 51, 1) == RES_OK && g_ui32SdBlocksWritten == 3);
+	CHECK(memcmp(pui8Buff, g_ppui8SdDisk[51], 512) == 0);
+	CHECK(disk_ioctl(0, MMC_FLUSH_CACHE, 0) == RES_OK && g_ui32SdBlocksWritten == 3);
+	Writes(&logical, &physical);
+	CHECK(logical == 3 && physical == 3);
+}
+#endif
+
+int main(void){
+	HostInit();
+
+	CheckInit();
+	CheckReadStream();
+	CheckWriteStream();
+	CheckMultiBlock();
+#ifndef SDC_NO_DMA
+	CheckIdleDma();
+#endif
+	CheckIdleBusy();
+	CheckBusyHist();
+#if SDC_CACHE_SECTORS
+	CheckCacheSync();
+	CheckCacheDefer();
+	CheckCacheAge();
+	CheckCacheRead();
+	CheckCacheInit();
+#else
+	CheckWriteThrough();
+#endif
+
+#ifdef SDC_NO_DMA
+	return HostResult("diskTestNoDma");
+#elif !SDC_CACHE_SECTORS
+	return HostResult("diskTestNoCache");
+#else
+	return HostResult("diskTest");
+#endif
+}
@@ -0,0 +1,38 @@
+// ffTypes.h
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	Type list from ChaN's integer.h
+//
+// Requirements:
+// 	None
+//
+// Description:
+// 	FatFs integer types with their target sizes, for building the SD Card sources on the host
+//
+// Notes:
+//	integer.h makes DWORD an unsigned long, which is 64 bits on the host. The Makefile forces this
+//	file in ahead of the SD Card sources, and _FF_INTEGER keeps integer.h from defining the types
+//	again
+//
+//****************************************************************************************************
+
+#ifndef _FF_INTEGER
+#define _FF_INTEGER
+
+#include <stdint.h>
+
+typedef uint8_t BYTE;
+typedef int16_t SHORT;
+typedef uint16_t WORD;
+typedef uint16_t WCHAR;
+typedef int INT;
+typedef unsigned int UINT;
+typedef int32_t LONG;
+typedef uint32_t DWORD;
+typedef enum { FALSE = 0, TRUE } BOOL;
+
+#endif
@@ -0,0 +1,216 @@
+// host.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	None
+//
+// Requirements:
+// 	A host gcc on a Linux system that allows fixed mappings at the peripheral addresses
+//
+// Description:
+// 	Virtual clock, peripheral memory and default TivaWare functions for the host tests
+//
+// Notes:
+//	See host.h
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include "inc/hw_types.h"
+#include "driverlib/rom.h"
+#include "host.h"
+
+
+// Defines -------------------------------------------------------------------------------------------
+
+// Peripheral and private peripheral bus regions the libraries touch
+#define HOST_PERIPH_BASE 0x40000000
+#define HOST_PERIPH_SIZE 0x100000
+#define HOST_PPB_BASE 0xE0000000
+#define HOST_PPB_SIZE 0x10000
+#define HOST_DWT_CYCCNT 0xE0001004
+
+// Defaults are replaced by any definition in a test
+#define HOST_WEAK __attribute__((weak))
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+uint32_t g_ui32HostFails;
+bool g_bHostMasked;
+void (*g_pfnHostRegHook)(uintptr_t addr);
+
+static uint64_t g_ui64Ns;		// Virtual time since HostInit
+static uint64_t g_ui64CycleNs;		// Part of g_ui64Ns already counted into the cycle counter
+
+
+
+// Functions -----------------------------------------------------------------------------------------
+
+// Map fresh peripheral memory and restart the clock. Exits if the mapping isn't allowed
+void HostInit(void){
+	if(mmap((void *)HOST_PERIPH_BASE, HOST_PERIPH_SIZE, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) == MAP_FAILED ||
+			mmap((void *)HOST_PPB_BASE, HOST_PPB_SIZE, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) == MAP_FAILED){
+		perror("peripheral mapping");
+		exit(2);
+	}
+
+	g_ui64Ns = 0;
+	g_ui64CycleNs = 0;
+	g_bHostMasked = false;
+	g_pfnHostRegHook = 0;
+}
+
+// Every HWREG access, see g_pfnHostRegHook
+volatile uint32_t *HostReg(uintptr_t addr){
+	if(g_pfnHostRegHook){
+		g_pfnHostRegHook(addr);
+	}
+	return (volatile uint32_t *)addr;
+}
+
+uint64_t HostNs(void){
+	return g_ui64Ns;
+}
+
+uint32_t HostMs(void){
+	return (uint32_t)(g_ui64Ns / 1000000);
+}
+
+// Move the virtual clock on. The DWT cycle counter runs whether or not it was enabled
+void HostAdvance(uint64_t ns){
+	uint64_t cycles;
+
+	g_ui64Ns += ns;
+	cycles = (g_ui64Ns - g_ui64CycleNs) * (HOST_CLOCK_HZ / 1000000) / 1000;
+	g_ui64CycleNs += cycles * 1000 / (HOST_CLOCK_HZ / 1000000);
+	HWREG(HOST_DWT_CYCCNT) += (uint32_t)cycles;
+}
+
+// Print the outcome and give the exit status for main
+int HostResult(const char *name){
+	if(g_ui32HostFails){
+		printf("%s: %u checks failed\n", name, g_ui32HostFails);
+		return 1;
+	}
+	printf("%s: all checks passed\n", name);
+	return 0;
+}
+
+
+
+// TivaWare defaults ---------------------------------------------------------------------------------
+
+HOST_WEAK uint32_t ROM_SysCtlClockGet(void){ return HOST_CLOCK_HZ; }
+HOST_WEAK void ROM_SysCtlDelay(uint32_t count){ HostAdvance((uint64_t)count * 3 * 1000000000 / HOST_CLOCK_HZ); }
+HOST_WEAK void ROM_SysCtlClockSet(uint32_t config){}
+HOST_WEAK void ROM_SysCtlPeripheralEnable(uint32_t periph){}
+HOST_WEAK void ROM_SysCtlPeripheralReset(uint32_t periph){}
+HOST_WEAK void ROM_SysCtlSleep(void){}
+
+HOST_WEAK bool ROM_IntMasterDisable(void){ bool was = g_bHostMasked; g_bHostMasked = true; return was; }
+HOST_WEAK bool ROM_IntMasterEnable(void){ bool was = g_bHostMasked; g_bHostMasked = false; return was; }
+HOST_WEAK void ROM_IntEnable(uint32_t interrupt){}
+HOST_WEAK void ROM_IntDisable(uint32_t interrupt){}
+HOST_WEAK void ROM_IntPendSet(uint32_t interrupt){}
+HOST_WEAK void ROM_IntPrioritySet(uint32_t interrupt, uint8_t priority){}
+HOST_WEAK void ROM_FPUEnable(void){}
+HOST_WEAK void ROM_FPULazyStackingEnable(void){}
+HOST_WEAK void ROM_SysTickPeriodSet(uint32_t period){}
+HOST_WEAK void ROM_SysTickIntEnable(void){}
+HOST_WEAK void ROM_SysTickEnable(void){}
+HOST_WEAK void ROM_TimerIntClear(uint32_t base, uint32_t flags){}
+
+HOST_WEAK void ROM_GPIOPinTypeGPIOOutput(uint32_t port, uint8_t pins){}
+HOST_WEAK void ROM_GPIOPinTypeGPIOOutputOD(uint32_t port, uint8_t pins){}
+HOST_WEAK void ROM_GPIOPinTypeGPIOInput(uint32_t port, uint8_t pins){}
+HOST_WEAK void ROM_GPIOPinTypeUART(uint32_t port, uint8_t pins){}
+HOST_WEAK void ROM_GPIOPinTypeI2C(uint32_t port, uint8_t pins){}
+HOST_WEAK void ROM_GPIOPinTypeI2CSCL(uint32_t port, uint8_t pins){}
+HOST_WEAK void ROM_GPIOPinTypeSSI(uint32_t port, uint8_t pins){}
+HOST_WEAK void ROM_GPIOPinConfigure(uint32_t config){}
+HOST_WEAK void ROM_GPIOPinWrite(uint32_t port, uint8_t pins, uint8_t value){}
+HOST_WEAK int32_t ROM_GPIOPinRead(uint32_t port, uint8_t pins){ return pins; }
+HOST_WEAK void ROM_GPIOIntTypeSet(uint32_t port, uint8_t pins, uint32_t type){}
+HOST_WEAK void ROM_GPIOPinIntEnable(uint32_t port, uint8_t pins){}
+HOST_WEAK void ROM_GPIOPinIntClear(uint32_t port, uint8_t pins){}
+HOST_WEAK uint32_t ROM_GPIOPinIntStatus(uint32_t port, bool masked){ return 0; }
+HOST_WEAK void ROM_GPIOPadConfigSet(uint32_t port, uint8_t pins, uint32_t strength, uint32_t type){}
+HOST_WEAK void GPIOPinConfigure(uint32_t config){}
+HOST_WEAK void GPIOIntEnable(uint32_t port, uint32_t flags){}
+HOST_WEAK void GPIOIntDisable(uint32_t port, uint32_t flags){}
+HOST_WEAK void GPIOIntClear(uint32_t port, uint32_t flags){}
+HOST_WEAK uint32_t GPIOIntStatus(uint32_t port, bool masked){ return 0; }
+HOST_WEAK void GPIOIntTypeSet(uint32_t port, uint8_t pins, uint32_t type){}
+
+HOST_WEAK void ROM_I2CMasterSlaveAddrSet(uint32_t base, uint8_t addr, bool receive){}
+HOST_WEAK void ROM_I2CMasterDataPut(uint32_t base, uint8_t data){}
+HOST_WEAK uint32_t ROM_I2CMasterDataGet(uint32_t base){ return 0; }
+HOST_WEAK void ROM_I2CMasterControl(uint32_t base, uint32_t command){}
+HOST_WEAK bool ROM_I2CMasterBusy(uint32_t base){ return false; }
+HOST_WEAK bool ROM_I2CMasterBusBusy(uint32_t base){ return false; }
+HOST_WEAK uint32_t ROM_I2CMasterErr(uint32_t base){ return 0; }
+HOST_WEAK void ROM_I2CMasterInitExpClk(uint32_t base, uint32_t clock, bool fast){}
+HOST_WEAK void ROM_I2CMasterIntEnable(uint32_t base){}
+HOST_WEAK void ROM_I2CMasterIntEnableEx(uint32_t base, uint32_t flags){}
+HOST_WEAK void ROM_I2CMasterIntDisable(uint32_t base){}
+HOST_WEAK void ROM_I2CMasterIntClear(uint32_t base){}
+HOST_WEAK bool ROM_I2CMasterIntStatus(uint32_t base, bool masked){ return false; }
+HOST_WEAK void ROM_I2CMasterEnable(uint32_t base){}
+HOST_WEAK void ROM_I2CMasterDisable(uint32_t base){}
+HOST_WEAK void ROM_I2CMasterTimeoutSet(uint32_t base, uint32_t value){}
+HOST_WEAK void I2CMasterIntEnable(uint32_t base){}
+HOST_WEAK void I2CMasterIntEnableEx(uint32_t base, uint32_t flags){}
+HOST_WEAK void I2CMasterIntClear(uint32_t base){}
+HOST_WEAK void I2CMasterTimeoutSet(uint32_t base, uint32_t value){}
+
+HOST_WEAK void ROM_SSIDataPut(uint32_t base, uint32_t data){}
+HOST_WEAK void ROM_SSIDataGet(uint32_t base, uint32_t *data){ *data = 0xFF; }
+HOST_WEAK int32_t ROM_SSIDataPutNonBlocking(uint32_t base, uint32_t data){ return 1; }
+HOST_WEAK int32_t ROM_SSIDataGetNonBlocking(uint32_t base, uint32_t *data){ *data = 0xFF; return 1; }
+HOST_WEAK void ROM_SSIConfigSetExpClk(uint32_t base, uint32_t clock, uint32_t protocol, uint32_t mode, uint32_t rate, uint32_t width){}
+HOST_WEAK void ROM_SSIEnable(uint32_t base){}
+HOST_WEAK void ROM_SSIDisable(uint32_t base){}
+HOST_WEAK void ROM_SSIDMAEnable(uint32_t base, uint32_t flags){}
+HOST_WEAK void ROM_SSIDMADisable(uint32_t base, uint32_t flags){}
+HOST_WEAK void ROM_SSIIntEnable(uint32_t base, uint32_t flags){}
+HOST_WEAK void ROM_SSIIntClear(uint32_t base, uint32_t flags){}
+HOST_WEAK uint32_t ROM_SSIIntStatus(uint32_t base, bool masked){ return 0; }
+HOST_WEAK bool ROM_SSIBusy(uint32_t base){ return false; }
+
+HOST_WEAK void ROM_uDMAEnable(void){}
+HOST_WEAK void ROM_uDMAControlBaseSet(void *table){}
+HOST_WEAK void ROM_uDMAChannelAssign(uint32_t mapping){}
+HOST_WEAK void ROM_uDMAChannelAttributeDisable(uint32_t channel, uint32_t attr){}
+HOST_WEAK void ROM_uDMAChannelAttributeEnable(uint32_t channel, uint32_t attr){}
+HOST_WEAK void ROM_uDMAChannelControlSet(uint32_t channel, uint32_t control){}
+HOST_WEAK void ROM_uDMAChannelTransferSet(uint32_t channel, uint32_t mode, void *src, void *dst, uint32_t size){}
+HOST_WEAK void ROM_uDMAChannelEnable(uint32_t channel){}
+HOST_WEAK void ROM_uDMAChannelDisable(uint32_t channel){}
+HOST_WEAK bool ROM_uDMAChannelIsEnabled(uint32_t channel){ return false; }
+HOST_WEAK uint32_t ROM_uDMAChannelModeGet(uint32_t channel){ return 0; }
+HOST_WEAK uint32_t ROM_uDMAErrorStatusGet(void){ return 0; }
+HOST_WEAK void ROM_uDMAErrorStatusClear(void){}
+
+HOST_WEAK void UARTClockSourceSet(uint32_t base, uint32_t source){}
+HOST_WEAK void UARTStdioConfig(uint32_t port, uint32_t baud, uint32_t clock){}
+
+// The formats the tree uses (%d, %u, %x, %s, %c) mean the same to printf
+HOST_WEAK void UARTprintf(const char *format, ...){
+	va_list args;
+
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+}
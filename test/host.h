@@ -0,0 +1,59 @@
+// host.h
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	None
+//
+// Requirements:
+// 	A host gcc on a Linux system that allows fixed mappings at the peripheral addresses
+//
+// Description:
+// 	Support for running the libraries on a PC: checks, a virtual clock and the peripheral memory
+//	the libraries write through HWREG
+//
+// Notes:
+//	Every ROM_ function in stub/driverlib/rom.h has a do-nothing default in host.c. A test that
+//	needs a function to behave like the hardware defines its own, which replaces the default
+//	Time only passes when something advances the virtual clock. ROM_SysCtlDelay advances it by 3
+//	cycles per loop at HOST_CLOCK_HZ, the DWT cycle counter follows it
+//	g_pfnHostRegHook, if set, is called with the address before every HWREG access. It is how a
+//	register model answers software that polls a register
+//
+//****************************************************************************************************
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+// Defines -------------------------------------------------------------------------------------------
+
+// System clock reported by ROM_SysCtlClockGet, the SensorHub examples run at 40 MHz
+#define HOST_CLOCK_HZ 40000000
+
+// Count a failed check and say where it was, then carry on
+#define CHECK(c) do{ if(!(c)){ printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #c); g_ui32HostFails++; } }while(0)
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+extern uint32_t g_ui32HostFails;
+extern bool g_bHostMasked;		// Interrupts masked with ROM_IntMasterDisable
+extern void (*g_pfnHostRegHook)(uintptr_t addr);
+
+
+
+// Function Prototypes -------------------------------------------------------------------------------
+extern void HostInit(void);
+extern uint64_t HostNs(void);
+extern uint32_t HostMs(void);
+extern void HostAdvance(uint64_t ns);
+extern int HostResult(const char *name);
+
+#endif
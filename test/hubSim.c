@@ -0,0 +1,299 @@
+// hubSim.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	Example BMP180 calibration from the Bosch datasheet
+//
+// Requirements:
+// 	See host.h
+//
+// Description:
+// 	Runs the SensorHub firmware on the host against the three sensor models and checks its sample
+//	stream, achieved rates and stats lines
+//
+// Notes:
+//	sensorhub.c is included with its main renamed, so the firmware's setup, schedule and stats
+//	code run unchanged on i2cLib's interrupt engine, with the I2C3 master model in i2cModel.c
+//	behind it. ROM_SysCtlSleep stands in for WFI: it moves the virtual clock to the next I2C3 or
+//	SysTick interrupt and runs its handler. Code between interrupts takes no time
+//	Every line the firmware prints is checked as it is printed. The summary and the last S and T
+//	lines are the report
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include <math.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+
+#define main SensorHubMain
+#include "../SensorHub/sensorhub.c"
+#undef main
+
+#include "i2cModel.h"
+#include "sensorModel.h"
+
+
+// Defines -------------------------------------------------------------------------------------------
+
+// Virtual time the firmware runs for, a whole number of stats periods
+#define SIM_MS 60000
+
+// Model readings: about 26.1 C and 41.1 %RH, and 500 lux
+#define SIM_SHT_TEMP 0x6A3C
+#define SIM_SHT_HUM 0x6060
+#define SIM_LUX 500
+
+// Widest spread allowed around each period between printed samples, in ms. A pressure sample
+// that refreshes its temperature first takes a temperature conversion longer
+#define SIM_PRES_JITTER 6
+#define SIM_HUM_JITTER 2
+#define SIM_LIGHT_JITTER 2
+
+#define SIM_LINE_LEN 128
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+static const int16_t g_pi16SimCal[11] = {408, -72, -14383, (int16_t)32741, (int16_t)32757, (int16_t)23153, 6190, 4, -32768, -8711, 2868};
+
+static tBmpModel g_sBmpModel;
+static tShtModel g_sShtModel;
+static tIslModel g_sIslModel;
+
+static jmp_buf g_sSimEnd;
+static uint64_t g_ui64SimEndNs;
+static bool g_bSysTick;
+static uint64_t g_ui64NextTick;
+
+static char g_pcLine[SIM_LINE_LEN];
+static uint32_t g_ui32LineLen;
+
+// Per sensor, in scheduler order
+static uint32_t g_pui32Lines[SENSOR_COUNT];		// Sample lines since the last S line
+static uint32_t g_pui32Total[SENSOR_COUNT];
+static uint32_t g_pui32LastMs[SENSOR_COUNT];
+static int32_t g_pi32WorstJitter[SENSOR_COUNT];
+
+// At the last S line
+static uint32_t g_ui32StatsMs;
+static uint32_t g_ui32StatsTrans;
+static uint64_t g_ui64StatsBusyNs;
+static uint32_t g_ui32StatsLines;
+static char g_pcLastS[SIM_LINE_LEN];
+static char g_pcLastT[SIM_LINE_LEN];
+
+
+
+// Function Prototypes -------------------------------------------------------------------------------
+static void Line(const char *line);
+
+
+
+// Hardware stand-ins --------------------------------------------------------------------------------
+void ROM_SysTickEnable(void){
+	g_bSysTick = true;
+	g_ui64NextTick = HostNs() + 1000000;
+	g_ui64SimEndNs = HostNs() + (SIM_MS + 1) * 1000000ULL;
+
+	// The firmware starts its first stats window here
+	g_ui32StatsTrans = g_ui32HostMasterStarts;
+	g_ui64StatsBusyNs = g_ui64HostMasterBusyNs;
+}
+
+// Sleep until the next interrupt and run it. The run ends here once its time is up
+void ROM_SysCtlSleep(void){
+	uint64_t byteEnd = HostMasterNext();
+
+	if(HostNs() >= g_ui64SimEndNs){
+		longjmp(g_sSimEnd, 1);
+	}
+
+	if(byteEnd && (!g_bSysTick || byteEnd <= g_ui64NextTick)){
+		HostAdvance(byteEnd - HostNs());
+		HostMasterRun();
+		I2CLibIntHandler();
+	} else if(g_bSysTick){
+		HostAdvance(g_ui64NextTick - HostNs());
+		g_ui64NextTick += 1000000;
+		SysTickIntHandler();
+	} else{
+		// Nothing would ever wake the core
+		CHECK(false);
+		longjmp(g_sSimEnd, 1);
+	}
+}
+
+// Collects the firmware's output a line at a time
+void UARTprintf(const char *format, ...){
+	va_list args;
+	int len;
+
+	va_start(args, format);
+	len = vsnprintf(g_pcLine + g_ui32LineLen, SIM_LINE_LEN - g_ui32LineLen, format, args);
+	va_end(args);
+	g_ui32LineLen += (len > 0) ? len : 0;
+	CHECK(g_ui32LineLen < SIM_LINE_LEN);
+
+	if(g_ui32LineLen && g_pcLine[g_ui32LineLen - 1] == '\n'){
+		g_pcLine[g_ui32LineLen - 1] = 0;
+		g_ui32LineLen = 0;
+		Line(g_pcLine);
+	}
+}
+
+
+
+// Functions -----------------------------------------------------------------------------------------
+
+// Comma separated field n of a line, 0 if it has fewer
+static const char *Field(const char *line, uint8_t n){
+	while(n--){
+		line = strchr(line, ',');
+		if(line == 0){
+			return 0;
+		}
+		line++;
+	}
+	return line;
+}
+
+static double FieldNum(const char *line, uint8_t n){
+	const char *field = Field(line, n);
+
+	CHECK(field != 0);
+	return field ? strtod(field, 0) : 0;
+}
+
+// A sample line: its value and the time since the last one of its sensor
+static void Sample(uint8_t sensor, uint32_t ms){
+	int32_t jitter;
+
+	if(g_pui32Total[sensor]){
+		jitter = abs((int32_t)(ms - g_pui32LastMs[sensor]) - (int32_t)g_pui32Period[sensor]);
+		g_pi32WorstJitter[sensor] = (jitter > g_pi32WorstJitter[sensor]) ? jitter : g_pi32WorstJitter[sensor];
+	}
+	g_pui32LastMs[sensor] = ms;
+	g_pui32Lines[sensor]++;
+	g_pui32Total[sensor]++;
+}
+
+// S line: the counts match the sample lines printed, the transactions and busy time match what the
+// master model put on the bus, each sensor kept to its rate and nothing failed
+static void Stats(const char *line, uint32_t ms){
+	uint32_t elapsed = ms - g_ui32StatsMs;
+	uint32_t busyPermille = (uint32_t)((g_ui64HostMasterBusyNs - g_ui64StatsBusyNs) / 1000 / elapsed);
+	uint8_t sensor;
+
+	CHECK(elapsed == STATS_PERIOD_MS);
+	for(sensor = 0; sensor < SENSOR_COUNT; sensor++){
+		CHECK(FieldNum(line, 2 + sensor) == g_pui32Lines[sensor]);
+		if(g_ui32StatsLines || sensor != SENSOR_LIGHT){
+			CHECK(g_pui32Lines[sensor] == STATS_PERIOD_MS / g_pui32Period[sensor]);
+		} else{
+			// Light starts a period late
+			CHECK(g_pui32Lines[sensor] == STATS_PERIOD_MS / g_pui32Period[sensor] - 1);
+		}
+		g_pui32Lines[sensor] = 0;
+	}
+	// The firmware counts a transaction when it starts, the one just queued included
+	HostMasterNext();
+	CHECK(FieldNum(line, 5) == g_ui32HostMasterStarts - g_ui32StatsTrans);
+	CHECK(fabs(FieldNum(line, 6) * 10 - busyPermille) <= 1);
+	for(sensor = 7; sensor <= 10; sensor++){
+		CHECK(FieldNum(line, sensor) == 0);
+	}
+
+	g_ui32StatsMs = ms;
+	g_ui32StatsTrans = g_ui32HostMasterStarts;
+	g_ui64StatsBusyNs = g_ui64HostMasterBusyNs;
+	g_ui32StatsLines++;
+	strcpy(g_pcLastS, line);
+}
+
+// One line of firmware output
+static void Line(const char *line){
+	const char *type = Field(line, 1);
+	uint32_t ms = strtoul(line, 0, 10);
+	double shtTemp = -46.85 + 175.72 * (SIM_SHT_TEMP & 0xFFFC) / 65536;
+	double shtHum = -6 + 125.0 * (SIM_SHT_HUM & 0xFFFC) / 65536;
+
+	if(type == 0 || type[1] != ','){
+		// Startup messages
+		CHECK(g_ui32StatsLines == 0 && strcmp(line, "SensorHub Example") == 0);
+		return;
+	}
+
+	switch(type[0]){
+		case 'P':
+			Sample(SENSOR_PRES, ms);
+			CHECK(fabs(FieldNum(line, 2) - 69964) <= 2 && fabs(FieldNum(line, 3) - 15.0) <= 0.1);
+			break;
+		case 'H':
+			Sample(SENSOR_HUM, ms);
+			CHECK(fabs(FieldNum(line, 2) - shtHum) <= 0.01 && fabs(FieldNum(line, 3) - shtTemp) <= 0.01);
+			break;
+		case 'L':
+			Sample(SENSOR_LIGHT, ms);
+			CHECK(fabs(FieldNum(line, 2) - SIM_LUX) <= 64000.0 / 65536);
+			break;
+		case 'S':
+			Stats(line, ms);
+			break;
+		case 'T':
+			// Bytes moved so far by each sensor at 400 kHz
+			CHECK(FieldNum(line, 2) == g_sBmpModel.slave.bytes && FieldNum(line, 3) == I2C_SPEED_FAST);
+			CHECK(FieldNum(line, 4) == g_sShtModel.slave.bytes && FieldNum(line, 5) == I2C_SPEED_FAST);
+			CHECK(FieldNum(line, 6) == g_sIslModel.slave.bytes && FieldNum(line, 7) == I2C_SPEED_FAST);
+			strcpy(g_pcLastT, line);
+			break;
+		default:
+			printf("hubSim: unexpected line %s\n", line);
+			CHECK(false);
+			break;
+	}
+}
+
+int main(void){
+	uint8_t sensor;
+
+	HostInit();
+	HostBusReset();
+	BmpModelInit(&g_sBmpModel, g_pi16SimCal, 27898, 23843 << 3);
+	ShtModelInit(&g_sShtModel, SIM_SHT_TEMP, SIM_SHT_HUM);
+	IslModelInit(&g_sIslModel, SIM_LUX, 0);
+	HostSlaveAdd(&g_sBmpModel.slave);
+	HostSlaveAdd(&g_sShtModel.slave);
+	HostSlaveAdd(&g_sIslModel.slave);
+
+	// Ends SIM_MS after SysTick starts, just after the last stats line
+	g_ui64SimEndNs = ~0ULL;
+	if(!setjmp(g_sSimEnd)){
+		SensorHubMain();
+	}
+
+	CHECK(g_ui32StatsLines == SIM_MS / STATS_PERIOD_MS);
+	CHECK(g_pi32WorstJitter[SENSOR_PRES] <= SIM_PRES_JITTER);
+	CHECK(g_pi32WorstJitter[SENSOR_HUM] <= SIM_HUM_JITTER);
+	CHECK(g_pi32WorstJitter[SENSOR_LIGHT] <= SIM_LIGHT_JITTER);
+	CHECK(g_sShtModel.nackedReads == 0 && g_sBmpModel.earlyReads == 0 && g_sShtModel.reservedWrites == 0);
+	CHECK(g_sIslModel.earlyReads == 0);
+
+	printf("hubSim: %u s, pressure %.2f Hz, humidity %.2f Hz, light %.2f Hz, bus %.2f %% busy over %u transactions\n", SIM_MS / 1000,
+			g_pui32Total[SENSOR_PRES] * 1000.0 / SIM_MS, g_pui32Total[SENSOR_HUM] * 1000.0 / SIM_MS, g_pui32Total[SENSOR_LIGHT] * 1000.0 / SIM_MS,
+			g_ui64HostMasterBusyNs / (SIM_MS * 10000.0), g_ui32HostLogCount);
+	for(sensor = 0; sensor < SENSOR_COUNT; sensor++){
+		printf("hubSim: sensor %u, period %u ms, worst jitter %d ms\n", sensor, g_pui32Period[sensor], g_pi32WorstJitter[sensor]);
+	}
+	printf("hubSim: %s\nhubSim: %s\n", g_pcLastS, g_pcLastT);
+
+	return HostResult("hubSim");
+}
@@ -0,0 +1,366 @@
+// i2cModel.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	None
+//
+// Requirements:
+// 	host.c, i2cLib.c
+//
+// Description:
+// 	Host I2C backend and I2C3 master model for the driver tests
+//
+// Notes:
+//	See i2cModel.h
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "inc/hw_i2c.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+
+#include "host.h"
+#include "i2cLib.h"
+#include "i2cModel.h"
+
+
+// Defines -------------------------------------------------------------------------------------------
+
+// Start, address, restart and stop cost about one byte each at 400 kHz, 9 clocks per byte
+#define HOST_BUS_BYTE_NS 22500
+
+// MCS command bits
+#define HOST_MCS_RUN 0x01
+#define HOST_MCS_START 0x02
+#define HOST_MCS_STOP 0x04
+#define HOST_MCS_ACK 0x08
+
+// SCL low and high periods in system clocks per MTPR step, as I2CMasterInitExpClk assumes
+#define HOST_SCL_CLOCKS 20
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+tHostTrans g_psHostLog[HOST_LOG_LEN];
+uint32_t g_ui32HostLogCount;
+bool g_bHostBusDefer;
+
+static tHostSlave *g_psSlaves;
+static tI2CTransaction *g_ppsPending[HOST_BUS_DEPTH];
+static uint8_t g_ui8Pending;
+static uint8_t g_ui8FaultStatus;
+static uint8_t g_ui8FaultSkip;
+static uint8_t g_ui8FaultCount;
+
+// Master model
+uint64_t g_ui64HostMasterBusyNs;
+uint32_t g_ui32HostMasterStarts;
+static uint32_t g_ui32MasterStatus;		// Last status left in MCS, anything else is a command
+static uint32_t g_ui32MasterCommand;		// Command being carried out
+static uint64_t g_ui64MasterEnd;		// Virtual time it finishes, 0 if the master is idle
+static bool g_bMasterHeld;			// Between a start and its stop
+static bool g_bMasterReading;
+static tHostSlave *g_psMasterSlave;
+static tHostTrans g_sMasterTrans;		// Transaction on the bus, logged at its stop
+static uint8_t g_pui8MasterTx[I2C_WRITE_MAX + 1];
+static uint8_t g_pui8MasterRx[HOST_MASTER_READ];
+
+
+
+// "Private" Functions ------------------------------------------------------------------------------
+
+static tHostSlave *HostSlaveFind(uint8_t addr){
+	tHostSlave *psSlave;
+
+	for(psSlave = g_psSlaves; psSlave; psSlave = psSlave->next){
+		if(psSlave->addr == addr){
+			return psSlave;
+		}
+	}
+	return 0;
+}
+
+// Put one transaction on the modelled bus and report it like the real backends do
+static void HostBusFinish(tI2CTransaction *psTrans){
+	tHostSlave *psSlave = HostSlaveFind(psTrans->addr);
+	tHostTrans *psLog = &g_psHostLog[g_ui32HostLogCount % HOST_LOG_LEN];
+	tI2CDevice *psDev = psTrans->dev;
+	uint8_t status = I2C_STATUS_DONE;
+	uint8_t i;
+
+	HostAdvance((uint64_t)(psTrans->txLen + psTrans->rxLen + (psTrans->rxLen ? 4 : 2)) * HOST_BUS_BYTE_NS);
+
+	// Skipped transactions still reach their slave
+	if(g_ui8FaultSkip){
+		g_ui8FaultSkip--;
+	} else if(g_ui8FaultCount){
+		g_ui8FaultCount--;
+		status = g_ui8FaultStatus;
+	}
+
+	if(status == I2C_STATUS_DONE){
+		if(psSlave == 0){
+			status = I2C_STATUS_ERROR;
+		} else if(psTrans->txLen && !psSlave->write(psSlave, psTrans->txBuf, psTrans->txLen)){
+			status = I2C_STATUS_ERROR;
+		} else if(psTrans->rxLen && !psSlave->read(psSlave, psTrans->rxBuf, psTrans->rxLen)){
+			status = I2C_STATUS_ERROR;
+		}
+	}
+
+	psLog->ns = HostNs();
+	psLog->addr = psTrans->addr;
+	psLog->txLen = psTrans->txLen;
+	psLog->rxLen = psTrans->rxLen;
+	psLog->status = status;
+	for(i = 0; i < psTrans->txLen && i < sizeof(psLog->tx); i++){
+		psLog->tx[i] = psTrans->txBuf[i];
+	}
+	g_ui32HostLogCount++;
+	if(status == I2C_STATUS_DONE){
+		psSlave->bytes += psTrans->txLen + psTrans->rxLen;
+	}
+
+	if(psDev){
+		switch(status){
+			case I2C_STATUS_DONE:
+				psDev->bytes += psTrans->txLen + psTrans->rxLen;
+				break;
+			case I2C_STATUS_ERROR:
+				psDev->nacks++;
+				break;
+			case I2C_STATUS_ARB_LOST:
+				psDev->arbLost++;
+				break;
+			default:
+				psDev->timeouts++;
+				break;
+		}
+	}
+
+	psTrans->status = status;
+	if(psTrans->callback){
+		psTrans->callback(psTrans);
+	}
+}
+
+// Log a transaction the master model has finished
+static void HostMasterLog(uint8_t status){
+	tHostTrans *psLog = &g_psHostLog[g_ui32HostLogCount % HOST_LOG_LEN];
+
+	g_sMasterTrans.ns = HostNs();
+	g_sMasterTrans.status = status;
+	if(status == I2C_STATUS_DONE && g_psMasterSlave){
+		g_psMasterSlave->bytes += g_sMasterTrans.txLen + g_sMasterTrans.rxLen;
+	}
+	*psLog = g_sMasterTrans;
+	g_ui32HostLogCount++;
+	g_bMasterHeld = false;
+}
+
+// Hand a finished write phase to the slave. False if it refused it
+static bool HostMasterWrite(void){
+	uint8_t len = g_sMasterTrans.txLen;
+
+	if(g_bMasterReading || len == 0){
+		return true;
+	}
+	return g_psMasterSlave && g_psMasterSlave->write(g_psMasterSlave, g_pui8MasterTx, (len > I2C_WRITE_MAX + 1) ? I2C_WRITE_MAX + 1 : len);
+}
+
+static void HostBusInit(tI2CBus *psBus){
+}
+
+static bool HostBusQueue(tI2CBus *psBus, tI2CTransaction *psTrans){
+	if((psTrans->txLen == 0 && psTrans->rxLen == 0) || g_ui8Pending == HOST_BUS_DEPTH){
+		return false;
+	}
+
+	psTrans->status = I2C_STATUS_PENDING;
+	if(g_bHostBusDefer){
+		g_ppsPending[g_ui8Pending++] = psTrans;
+	} else{
+		HostBusFinish(psTrans);
+	}
+	return true;
+}
+
+static uint8_t HostBusWait(tI2CBus *psBus, tI2CTransaction *psTrans){
+	HostBusRun();
+	return psTrans->status;
+}
+
+
+
+// Functions -----------------------------------------------------------------------------------------
+const tI2CBackend g_sHostBackend = {HostBusInit, HostBusQueue, HostBusWait};
+
+// Forget the slaves, the log, pending transactions and faults
+void HostBusReset(void){
+	g_psSlaves = 0;
+	g_ui32HostLogCount = 0;
+	g_ui8Pending = 0;
+	g_ui8FaultSkip = 0;
+	g_ui8FaultCount = 0;
+	g_bHostBusDefer = false;
+	g_ui64HostMasterBusyNs = 0;
+	g_ui32HostMasterStarts = 0;
+	g_ui32MasterStatus = 0;
+	g_ui64MasterEnd = 0;
+	g_bMasterHeld = false;
+	g_pfnHostRegHook = 0;
+}
+
+void HostSlaveAdd(tHostSlave *psSlave){
+	psSlave->bytes = 0;
+	psSlave->next = g_psSlaves;
+	g_psSlaves = psSlave;
+}
+
+// After skip more transactions, the next count finish with status without reaching a slave
+void HostBusFault(uint8_t status, uint8_t skip, uint8_t count){
+	g_ui8FaultStatus = status;
+	g_ui8FaultSkip = skip;
+	g_ui8FaultCount = count;
+}
+
+// Finish the pending transactions in queue order, including any queued from their callbacks
+void HostBusRun(void){
+	uint8_t i;
+
+	while(g_ui8Pending){
+		tI2CTransaction *psTrans = g_ppsPending[0];
+
+		g_ui8Pending--;
+		for(i = 0; i < g_ui8Pending; i++){
+			g_ppsPending[i] = g_ppsPending[i + 1];
+		}
+		HostBusFinish(psTrans);
+	}
+}
+
+uint32_t HostBusPending(void){
+	return g_ui8Pending;
+}
+
+// A logged transaction, 0 for the most recent. 0 if it's no longer logged
+const tHostTrans *HostBusLast(uint32_t back){
+	if(back >= g_ui32HostLogCount || back >= HOST_LOG_LEN){
+		return 0;
+	}
+	return &g_psHostLog[(g_ui32HostLogCount - 1 - back) % HOST_LOG_LEN];
+}
+
+// Virtual time the master finishes its command, 0 if it has none. A command written to MCS since
+// the last status is taken up here
+uint64_t HostMasterNext(void){
+	uint32_t mcs = HWREG(I2C3_BASE + I2C_O_MCS);
+	uint64_t bitNs;
+	uint8_t bits;
+
+	if(g_ui64MasterEnd || mcs == g_ui32MasterStatus){
+		return g_ui64MasterEnd;
+	}
+
+	// Address and data bytes are 9 clocks with their acknowledge, start and stop about one
+	g_ui32MasterCommand = mcs;
+	g_ui32HostMasterStarts += ((mcs & HOST_MCS_START) && !g_bMasterHeld) ? 1 : 0;
+	bits = (mcs & HOST_MCS_RUN) ? 9 : 0;
+	bits += (mcs & HOST_MCS_START) ? 10 : 0;
+	bits += (mcs & HOST_MCS_STOP) ? 1 : 0;
+	bitNs = (uint64_t)HOST_SCL_CLOCKS * (1 + HWREG(I2C3_BASE + I2C_O_MTPR)) * 1000000000 / HOST_CLOCK_HZ;
+	g_ui64MasterEnd = HostNs() + bits * bitNs;
+	g_ui64HostMasterBusyNs += bits * bitNs;
+	return g_ui64MasterEnd;
+}
+
+// Carry out the command on the slaves and leave its status in MCS. Call at the time HostMasterNext
+// gave, then run the interrupt handler
+void HostMasterRun(void){
+	uint32_t command = g_ui32MasterCommand;
+	uint32_t msa = HWREG(I2C3_BASE + I2C_O_MSA);
+	uint32_t status = 0;
+	uint8_t i;
+
+	g_ui64MasterEnd = 0;
+
+	// Address phase. A restart first hands the slave its write phase
+	if(command & HOST_MCS_START){
+		if(g_bMasterHeld && !HostMasterWrite()){
+			status = I2C_MCS_ERROR | I2C_MCS_ADRACK;
+		} else{
+			if(!g_bMasterHeld){
+				g_sMasterTrans.addr = msa >> 1;
+				g_sMasterTrans.txLen = 0;
+				g_sMasterTrans.rxLen = 0;
+				g_psMasterSlave = HostSlaveFind(msa >> 1);
+			}
+			g_bMasterHeld = true;
+			g_bMasterReading = msa & 1;
+			if(g_psMasterSlave == 0 || (g_bMasterReading && !g_psMasterSlave->read(g_psMasterSlave, g_pui8MasterRx, HOST_MASTER_READ))){
+				status = I2C_MCS_ERROR | I2C_MCS_ADRACK;
+			}
+		}
+	}
+
+	// Data byte
+	if((command & HOST_MCS_RUN) && status == 0 && g_bMasterHeld){
+		if(g_bMasterReading){
+			i = g_sMasterTrans.rxLen++;
+			HWREG(I2C3_BASE + I2C_O_MDR) = (i < HOST_MASTER_READ) ? g_pui8MasterRx[i] : 0xFF;
+		} else{
+			i = g_sMasterTrans.txLen++;
+			if(i < sizeof(g_pui8MasterTx)){
+				g_pui8MasterTx[i] = HWREG(I2C3_BASE + I2C_O_MDR);
+				if(i < sizeof(g_sMasterTrans.tx)){
+					g_sMasterTrans.tx[i] = g_pui8MasterTx[i];
+				}
+			}
+		}
+	}
+
+	// A stop ends the transaction, so does a NACK on a single byte command. A NACK in a burst
+	// holds the bus until the engine sends its error stop
+	if(g_bMasterHeld && (command & HOST_MCS_STOP)){
+		if(status == 0 && (command & HOST_MCS_RUN) && !HostMasterWrite()){
+			status = I2C_MCS_ERROR | I2C_MCS_DATACK;
+		}
+		HostMasterLog((status || !(command & HOST_MCS_RUN)) ? I2C_STATUS_ERROR : I2C_STATUS_DONE);
+	}
+
+	g_ui32MasterStatus = status;
+	HWREG(I2C3_BASE + I2C_O_MCS) = status;
+}
+
+// Register hook for a polled master. A command finishes, with its time on the clock, the first
+// time MCS is touched after it was written
+static void HostMasterPoll(uintptr_t addr){
+	static bool bInside;		// The model's own register accesses
+	uint64_t end;
+
+	if(bInside || addr != I2C3_BASE + I2C_O_MCS){
+		return;
+	}
+
+	bInside = true;
+	end = HostMasterNext();
+	if(end){
+		HostAdvance(end - HostNs());
+		HostMasterRun();
+	}
+	bInside = false;
+}
+
+// Run the master model from the software polling it, as g_sI2CPollBackend does, instead of from
+// HostMasterNext and HostMasterRun
+void HostMasterPolled(bool bPolled){
+	g_pfnHostRegHook = bPolled ? HostMasterPoll : 0;
+}
@@ -0,0 +1,101 @@
+// i2cModel.h
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	None
+//
+// Requirements:
+// 	host.h, i2cLib.h
+//
+// Description:
+// 	Host I2C backend for the driver tests. Transactions go straight to slave models registered by
+//	address, with a log of everything put on the bus and injectable failures. A register level
+//	model of the I2C3 master runs the same slaves under i2cLib's own interrupt engine
+//
+// Notes:
+//	Include i2cLib.h before this file
+//	A slave's write gets the whole write phase and its read the whole read phase of a transaction.
+//	Returning false is a NACK. A transaction to an address with no slave is NACKed
+//	By default a transaction finishes inside the queue call, like g_sI2CPollBackend. With
+//	g_bHostBusDefer set it stays pending until HostBusRun, so the non-blocking driver APIs can be
+//	stepped. The blocking wait always runs the bus
+//	Each transaction moves the virtual clock by its time on a 400 kHz bus
+//	Only bytes, nacks, arbLost and timeouts of the device are counted; the speed fallback is
+//	left to the real backends
+//	The master model takes the command the engine wrote to MCS when HostMasterNext is called and
+//	finishes it at the time that returns, at the SCL rate MTPR sets. HostMasterRun then leaves the
+//	status in MCS and the caller runs I2CLibIntHandler, as the I2C3 interrupt would. A slave's
+//	write gets the write phase when it ends; its read is asked for HOST_MASTER_READ bytes at the
+//	restart and the master clocks as many as the engine asks for, so a model must not mind being
+//	read past the end of a phase. Faults aren't injected
+//	With HostMasterPolled set a command instead finishes as soon as software touches MCS again,
+//	which is what g_sI2CPollBackend waits for
+//
+//****************************************************************************************************
+
+#ifndef I2CMODEL_H
+#define I2CMODEL_H
+
+
+// Defines -------------------------------------------------------------------------------------------
+
+// Transactions kept in g_psHostLog, older ones are counted but dropped
+#define HOST_LOG_LEN 64
+
+// Transactions that may be pending at once with g_bHostBusDefer
+#define HOST_BUS_DEPTH 8
+
+// Bytes a slave is asked for at the start of a read phase on the master model, more than the
+// longest read the drivers make (the BMP180 calibration)
+#define HOST_MASTER_READ 24
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+
+typedef struct tHostSlave tHostSlave;
+
+struct tHostSlave
+{
+	uint8_t addr;
+	bool (*write)(tHostSlave *psSlave, const uint8_t *data, uint8_t len);
+	bool (*read)(tHostSlave *psSlave, uint8_t *data, uint8_t len);
+	uint32_t bytes;			// Moved in transactions that finished, counted by the bus
+	tHostSlave *next;
+};
+
+// One finished transaction
+typedef struct
+{
+	uint64_t ns;			// Virtual time it finished
+	uint8_t addr;
+	uint8_t tx[I2C_WRITE_MAX + 1];	// First bytes of the write phase
+	uint8_t txLen;
+	uint8_t rxLen;
+	uint8_t status;
+} tHostTrans;
+
+extern tHostTrans g_psHostLog[HOST_LOG_LEN];
+extern uint32_t g_ui32HostLogCount;		// Transactions since HostBusReset
+extern bool g_bHostBusDefer;
+extern const tI2CBackend g_sHostBackend;
+extern uint64_t g_ui64HostMasterBusyNs;		// Time the master model has held the bus
+extern uint32_t g_ui32HostMasterStarts;		// Transactions the master model has started
+
+
+
+// Function Prototypes -------------------------------------------------------------------------------
+extern void HostBusReset(void);
+extern void HostSlaveAdd(tHostSlave *psSlave);
+extern void HostBusFault(uint8_t status, uint8_t skip, uint8_t count);
+extern void HostBusRun(void);
+extern uint32_t HostBusPending(void);
+extern const tHostTrans *HostBusLast(uint32_t back);
+extern uint64_t HostMasterNext(void);
+extern void HostMasterRun(void);
+extern void HostMasterPolled(bool bPolled);
+
+#endif
@@ -0,0 +1,337 @@
+// i2cTest.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	None
+//
+// Requirements:
+// 	See host.h
+//
+// Description:
+// 	Drives the i2cLib interrupt engine by hand against the I2C3 registers in mapped memory
+//
+// Notes:
+//	i2cLib.c is included so the checks can see the engine's state. Each call to Byte() is one I2C3
+//	interrupt with MCS holding the given status
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include "host.h"
+#include "../Common/i2cLib.c"
+
+#include "driverlib/gpio.h"
+#include "driverlib/pin_map.h"
+
+
+// Defines -------------------------------------------------------------------------------------------
+#define MCS HWREG(I2C3_BASE + I2C_O_MCS)
+#define MSA HWREG(I2C3_BASE + I2C_O_MSA)
+#define MDR HWREG(I2C3_BASE + I2C_O_MDR)
+#define CYCCNT HWREG(I2C_DWT_CYCCNT)
+
+#define LOG_LEN 32
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+static tI2CBus g_sTestBus;
+static tI2CDevice g_sDev1, g_sDev2;
+
+// Completion callbacks in the order they ran, with the status each one saw
+static tI2CTransaction *g_ppsDone[LOG_LEN];
+static uint8_t g_pui8DoneStatus[LOG_LEN];
+static uint32_t g_ui32DoneCount;
+static tI2CTransaction g_sLate;		// Queued from a callback
+static bool g_bLateQueued;
+
+static uint32_t g_ui32GpioCalls, g_ui32PendSet, g_ui32Resets, g_ui32Sleeps;
+static bool g_bSleepAcks;		// ROM_SysCtlSleep finishes the byte on the bus
+
+
+
+// Hardware stand-ins --------------------------------------------------------------------------------
+void ROM_SysCtlPeripheralReset(uint32_t periph){ g_ui32Resets++; }
+void ROM_IntPendSet(uint32_t interrupt){ g_ui32PendSet++; }
+void ROM_GPIOPinWrite(uint32_t port, uint8_t pins, uint8_t value){ g_ui32GpioCalls++; }
+void ROM_GPIOPinTypeGPIOOutputOD(uint32_t port, uint8_t pins){ g_ui32GpioCalls++; }
+void ROM_GPIOPinTypeGPIOInput(uint32_t port, uint8_t pins){ g_ui32GpioCalls++; }
+
+// One I2C3 interrupt
+static void Byte(uint32_t status){
+	MCS = status;
+	I2CLibIntHandler();
+}
+
+// The interrupt that wakes I2CLibWait
+void ROM_SysCtlSleep(void){
+	g_ui32Sleeps++;
+	if(g_bSleepAcks){
+		Byte(0);
+	}
+}
+
+static void Done(tI2CTransaction *psTrans){
+	if(g_ui32DoneCount < LOG_LEN){
+		g_ppsDone[g_ui32DoneCount] = psTrans;
+		g_pui8DoneStatus[g_ui32DoneCount] = psTrans->status;
+	}
+	g_ui32DoneCount++;
+}
+
+// Queues g_sLate from interrupt context, as a driver chaining its next step would
+static void DoneQueueLate(tI2CTransaction *psTrans){
+	Done(psTrans);
+	g_bLateQueued = I2CLibQueue(&g_sLate);
+}
+
+
+
+// Checks --------------------------------------------------------------------------------------------
+
+// Transactions go on the bus in queue order, the ring holds I2C_QUEUE_SIZE - 1 behind the active
+// one, and every completion runs its callback once with the final status
+static void CheckFifo(void){
+	static const uint8_t txByte = 0x5A;
+	tI2CTransaction psTrans[I2C_QUEUE_SIZE + 1];
+	uint8_t i;
+
+	g_ui32DoneCount = 0;
+	for(i = 0; i <= I2C_QUEUE_SIZE; i++){
+		I2CLibTransactionSet(&psTrans[i], 0x10 + i, &txByte, 1, 0, 0, (i == 2) ? DoneQueueLate : Done);
+	}
+	for(i = 0; i < I2C_QUEUE_SIZE; i++){
+		CHECK(I2CLibQueue(&psTrans[i]));
+	}
+	CHECK(!I2CLibQueue(&psTrans[I2C_QUEUE_SIZE]));
+	CHECK(psTrans[I2C_QUEUE_SIZE].status == I2C_STATUS_IDLE);
+
+	// Empty transactions are refused
+	I2CLibTransactionSet(&g_sLate, 0x30, 0, 0, 0, 0, Done);
+	CHECK(!I2CLibQueue(&g_sLate));
+	I2CLibTransactionSet(&g_sLate, 0x30, &txByte, 1, 0, 0, Done);
+
+	for(i = 0; i < I2C_QUEUE_SIZE; i++){
+		CHECK((MSA >> 1) == 0x10 + i && MCS == I2C_MASTER_CMD_SINGLE_SEND && MDR == txByte);
+		CHECK(psTrans[i].status == I2C_STATUS_PENDING);
+		Byte(0);
+	}
+
+	// Queued from the third callback into the slot its completion freed, so it runs last
+	CHECK(g_bLateQueued && (MSA >> 1) == 0x30 && g_sLate.status == I2C_STATUS_PENDING);
+	Byte(0);
+
+	CHECK(I2CLibIdle() && g_ui32DoneCount == I2C_QUEUE_SIZE + 1);
+	for(i = 0; i < I2C_QUEUE_SIZE; i++){
+		CHECK(g_ppsDone[i] == &psTrans[i] && g_pui8DoneStatus[i] == I2C_STATUS_DONE);
+	}
+	CHECK(g_ppsDone[I2C_QUEUE_SIZE] == &g_sLate && g_pui8DoneStatus[I2C_QUEUE_SIZE] == I2C_STATUS_DONE);
+}
+
+// A NACK part way through a write burst, and one in a read burst. The error stop holds the bus,
+// the next transaction starts from the stop's interrupt and runs normally
+static void CheckNack(void){
+	static const uint8_t txData[3] = {0xF4, 0x2E, 0x01};
+	uint8_t rxData[3];
+	tI2CTransaction sTrans1, sTrans2, sTrans3;
+
+	g_ui32DoneCount = 0;
+	I2CLibTransactionSet(&sTrans1, 0x77, txData, 3, 0, 0, Done);
+	I2CLibTransactionSet(&sTrans2, 0x40, txData, 1, rxData, 3, Done);
+	I2CLibTransactionSet(&sTrans3, 0x44, txData, 1, 0, 0, Done);
+	sTrans1.dev = &g_sDev1;
+	CHECK(I2CLibQueue(&sTrans1) && I2CLibQueue(&sTrans2));
+	CHECK(MCS == I2C_MASTER_CMD_BURST_SEND_START && MDR == txData[0]);
+
+	// Second byte NACKed
+	Byte(0);
+	CHECK(MCS == I2C_MASTER_CMD_BURST_SEND_CONT && MDR == txData[1]);
+	Byte(I2C_MCS_ERROR | I2C_MCS_DATACK);
+	CHECK(MCS == I2C_MASTER_CMD_BURST_SEND_ERROR_STOP);
+	CHECK(sTrans1.status == I2C_STATUS_ERROR && g_sDev1.nacks == 1);
+	CHECK(sTrans2.status == I2C_STATUS_PENDING && (MSA >> 1) == 0x77 && I2CLibIdle());
+
+	// Queued while the stop is running, waits behind sTrans2
+	CHECK(I2CLibQueue(&sTrans3) && (MSA >> 1) == 0x77);
+
+	// Stop finished, sTrans2 writes its register then reads three bytes, NACKed on the second
+	Byte(0);
+	CHECK((MSA >> 1) == 0x40 && MCS == I2C_MASTER_CMD_BURST_SEND_START);
+	Byte(0);
+	CHECK((MSA & 1) && MCS == I2C_MASTER_CMD_BURST_RECEIVE_START);
+	MDR = 0x11;
+	Byte(0);
+	CHECK(MCS == I2C_MASTER_CMD_BURST_RECEIVE_CONT && rxData[0] == 0x11);
+	Byte(I2C_MCS_ERROR | I2C_MCS_DATACK);
+	CHECK(MCS == I2C_MASTER_CMD_BURST_RECEIVE_ERROR_STOP && sTrans2.status == I2C_STATUS_ERROR);
+	CHECK(sTrans3.status == I2C_STATUS_PENDING);
+
+	// Then sTrans3 as usual
+	Byte(0);
+	CHECK((MSA >> 1) == 0x44 && MCS == I2C_MASTER_CMD_SINGLE_SEND);
+	Byte(0);
+	CHECK(sTrans3.status == I2C_STATUS_DONE && I2CLibIdle() && !g_bStopping);
+
+	CHECK(g_ui32DoneCount == 3 && g_ppsDone[0] == &sTrans1 && g_ppsDone[1] == &sTrans2 && g_ppsDone[2] == &sTrans3);
+	CHECK(g_pui8DoneStatus[0] == I2C_STATUS_ERROR && g_pui8DoneStatus[1] == I2C_STATUS_ERROR && g_pui8DoneStatus[2] == I2C_STATUS_DONE);
+}
+
+// An error stop whose interrupt never comes is abandoned by I2CLibTick
+static void CheckLostStop(void){
+	static const uint8_t txData[2] = {1, 2};
+	tI2CTransaction sTrans1, sTrans2;
+	uint8_t i;
+
+	g_ui32PendSet = 0;
+	CHECK(I2CLibDevQueue(&g_sDev1, &sTrans1, txData, 2, 0, 0));
+	CHECK(I2CLibDevQueue(&g_sDev2, &sTrans2, txData, 1, 0, 0));
+	Byte(I2C_MCS_ERROR | I2C_MCS_ADRACK);
+	CHECK(sTrans1.status == I2C_STATUS_ERROR && sTrans2.status == I2C_STATUS_PENDING);
+
+	for(i = 0; i < I2C_TIMEOUT_MS - 1; i++){
+		I2CLibTick();
+	}
+	CHECK(g_ui32PendSet == 0);
+	I2CLibTick();
+	CHECK(g_ui32PendSet == 1);
+
+	// The pended interrupt ends the stop and starts the next transaction
+	Byte(0);
+	CHECK((MSA >> 1) == 0x40 && MCS == I2C_MASTER_CMD_SINGLE_SEND);
+	Byte(0);
+	CHECK(sTrans2.status == I2C_STATUS_DONE && I2CLibIdle());
+}
+
+// A timeout with pins set holds the whole queue until I2CLibService has cleared the bus. Nothing
+// queued meanwhile may start, from I2CLibQueue, a stray interrupt or I2CLibTick
+static void CheckRecoverGate(void){
+	static const uint8_t txData[2] = {1, 2};
+	tI2CTransaction sTrans1, sTrans2, sTrans3;
+	uint8_t i;
+
+	I2CLibBusPinsSet(&g_sTestBus, GPIO_PORTD_BASE, GPIO_PIN_0, GPIO_PIN_1, GPIO_PD0_I2C3SCL, GPIO_PD1_I2C3SDA);
+	g_ui32GpioCalls = 0;
+	g_ui32Resets = 0;
+	g_ui32PendSet = 0;
+	g_ui32DoneCount = 0;
+
+	CHECK(I2CLibDevQueue(&g_sDev1, &sTrans1, txData, 2, 0, 0));
+	CHECK(I2CLibDevQueue(&g_sDev2, &sTrans2, txData, 1, 0, 0));
+	Byte(I2C_MCS_CLKTO);
+	CHECK(sTrans1.status == I2C_STATUS_TIMEOUT && g_sDev1.timeouts == 1);
+
+	// Master reset in the interrupt, the 9 clock clear is left for the main loop
+	CHECK(g_bRecoverPending && g_ui32Resets == 1 && g_ui32GpioCalls == 0);
+	CHECK(I2CLibIdle() && sTrans2.status == I2C_STATUS_PENDING && (MSA >> 1) == 0x77);
+
+	// Queued behind the held queue, even though the bus is idle
+	CHECK(I2CLibDevQueue(&g_sDev1, &sTrans3, txData, 1, 0, 0));
+	CHECK(sTrans3.status == I2C_STATUS_PENDING && I2CLibIdle() && (MSA >> 1) == 0x77);
+
+	// Neither a stray interrupt nor the tick starts anything or times out the held queue
+	Byte(0);
+	for(i = 0; i < 2 * I2C_TIMEOUT_MS; i++){
+		I2CLibTick();
+	}
+	CHECK(g_ui32PendSet == 0 && I2CLibIdle() && g_bRecoverPending);
+	CHECK(sTrans2.status == I2C_STATUS_PENDING && sTrans3.status == I2C_STATUS_PENDING);
+
+	// The clear runs here and the queue restarts in order
+	I2CLibService();
+	CHECK(!g_bRecoverPending && g_ui32GpioCalls > 0 && g_sTestBus.recoveries == 1 && g_ui32Resets == 2);
+	CHECK((MSA >> 1) == 0x40 && MCS == I2C_MASTER_CMD_SINGLE_SEND);
+	Byte(0);
+	CHECK(sTrans2.status == I2C_STATUS_DONE && (MSA >> 1) == 0x77);
+	Byte(0);
+	CHECK(sTrans3.status == I2C_STATUS_DONE && I2CLibIdle());
+
+	// With nothing pending I2CLibService does nothing
+	I2CLibService();
+	CHECK(g_sTestBus.recoveries == 1);
+
+	// A blocking transfer started while a clear is pending runs it from I2CLibWait
+	CHECK(I2CLibDevQueue(&g_sDev1, &sTrans1, txData, 2, 0, 0));
+	Byte(I2C_MCS_ARBLST);
+	CHECK(sTrans1.status == I2C_STATUS_ARB_LOST && g_bRecoverPending);
+	g_bSleepAcks = true;
+	g_ui32Sleeps = 0;
+	CHECK(I2CLibDevCommand(&g_sDev2, 0xFE) == I2C_STATUS_DONE);
+	g_bSleepAcks = false;
+	CHECK(!g_bRecoverPending && g_sTestBus.recoveries == 2 && g_ui32Sleeps == 1 && I2CLibIdle());
+
+	// Without pins the master reset is all there is, the queue moves on at once
+	g_sTestBus.gpioBase = 0;
+	CHECK(I2CLibDevQueue(&g_sDev1, &sTrans1, txData, 2, 0, 0));
+	CHECK(I2CLibDevQueue(&g_sDev2, &sTrans2, txData, 1, 0, 0));
+	Byte(I2C_MCS_CLKTO);
+	CHECK(!g_bRecoverPending && (MSA >> 1) == 0x40 && sTrans2.status == I2C_STATUS_PENDING);
+	Byte(0);
+	CHECK(sTrans2.status == I2C_STATUS_DONE && I2CLibIdle());
+}
+
+// Faults reported from the main loop mask interrupts and step the speed down
+static void CheckFallback(void){
+	uint8_t i;
+
+	for(i = 0; i < I2C_FALLBACK_ERRORS; i++){
+		CHECK(!g_bHostMasked);
+		I2CLibDevFault(&g_sDev2);
+	}
+	CHECK(g_sDev2.speed == I2C_SPEED_STD && g_sDev2.faults == I2C_FALLBACK_ERRORS);
+	I2CLibDevSpeedSet(&g_sDev2, I2C_SPEED_FAST);
+	CHECK(g_sDev2.speed == I2C_SPEED_FAST && g_sDev2.failStreak == 0 && g_sDev2.faultStreak == 0 && !g_bHostMasked);
+}
+
+// Busy time runs from start to stop, an error stop counts until its own interrupt, and a wrap of
+// the cycle counter mid-transaction is harmless
+static void CheckBusyCycles(void){
+	static const uint8_t txData[2] = {1, 2};
+	tI2CTransaction sTrans;
+	uint32_t busy0 = I2CLibBusyCycles();
+
+	CHECK((HWREG(I2C_DWT_CTRL) & I2C_DWT_CTRL_CYCCNTENA) && (HWREG(I2C_DEMCR) & I2C_DEMCR_TRCENA));
+	CYCCNT = 1000;
+	CHECK(I2CLibDevQueue(&g_sDev1, &sTrans, txData, 1, 0, 0));
+	CYCCNT = 1500;
+	Byte(0);
+	CHECK(sTrans.status == I2C_STATUS_DONE && I2CLibBusyCycles() - busy0 == 500);
+
+	CYCCNT = 2000;
+	CHECK(I2CLibDevQueue(&g_sDev1, &sTrans, txData, 2, 0, 0));
+	CYCCNT = 2300;
+	Byte(I2C_MCS_ERROR);
+	CHECK(I2CLibBusyCycles() - busy0 == 500);
+	CYCCNT = 2400;
+	Byte(0);
+	CHECK(I2CLibBusyCycles() - busy0 == 900);
+
+	CYCCNT = 0xFFFFFF00;
+	CHECK(I2CLibDevQueue(&g_sDev1, &sTrans, txData, 1, 0, 0));
+	CYCCNT = 0x100;
+	Byte(0);
+	CHECK(I2CLibBusyCycles() - busy0 == 900 + 0x200);
+}
+
+
+
+// Main ----------------------------------------------------------------------------------------------
+int main(void){
+	HostInit();
+
+	I2CLibBusInit(&g_sTestBus, I2C3_BASE, &g_sI2CIntBackend);
+	I2CLibDevInit(&g_sDev1, &g_sTestBus, 0x77);
+	I2CLibDevInit(&g_sDev2, &g_sTestBus, 0x40);
+
+	CheckFifo();
+	CheckNack();
+	CheckLostStop();
+	CheckRecoverGate();
+	CheckFallback();
+	CheckBusyCycles();
+
+	return HostResult("i2cTest");
+}
@@ -0,0 +1,519 @@
+// islTest.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	Range, resolution and IR scale values from the Intersil ISL29023 datasheet and the TI driver
+//
+// Requirements:
+// 	See host.h
+//
+// Description:
+// 	Checks islLib against the ISL29023 model on the host I2C backend
+//
+// Notes:
+//	islLib.c is included so the checks can reach its helpers. Built twice by the Makefile, as
+//	islTest and with ISL29023_FIXED_POINT as islTestFixed
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include <math.h>
+#include <string.h>
+
+#include "host.h"
+#include "../ISL29023/islLib.c"
+#include "i2cModel.h"
+#include "sensorModel.h"
+
+
+// Defines -------------------------------------------------------------------------------------------
+
+// Lux results of either build
+#ifdef ISL29023_FIXED_POINT
+#define ALS(p) ((p)->alsMilli / 1000.0)
+#define IR(p) ((p)->irMilli / 1000.0)
+#else
+#define ALS(p) ((double)(p)->alsVal)
+#define IR(p) ((double)(p)->irVal)
+#endif
+
+// Light trace for CheckContinuous, in seconds
+#define TRACE_LEN 3600
+#define TRACE_STEP_START 1800
+#define TRACE_STEP_LEN 60
+
+// Readings in the day trace for CheckDay, one a minute
+#define DAY_LEN 1440
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+
+// IR counts per unit at 16 bit as the float build holds them, and exact for the fixed build
+static const float g_pfFloatBeta[ISL29023_RANGE_COUNT] = {95.238f, 23.810f, 5.952f, 1.486f};
+#ifdef ISL29023_FIXED_POINT
+static const double g_pdDatasheetBeta[ISL29023_RANGE_COUNT] = {95.238, 23.810, 5.952, 1.486};
+#endif
+
+static tI2CBus g_sBus;
+static tIslModel g_sModel;
+static tISL29023 g_sIsl;
+
+static uint64_t g_ui64TraceStart;
+
+
+
+// Functions -----------------------------------------------------------------------------------------
+
+// Fresh bus and instance
+static void Setup(void){
+	HostBusReset();
+	IslModelInit(&g_sModel, 0, 0);
+	HostSlaveAdd(&g_sModel.slave);
+	I2CLibBusInit(&g_sBus, I2C3_BASE, &g_sHostBackend);
+	ISL29023Initialize(&g_sIsl, &g_sBus);
+}
+
+// The transaction skip transactions from now fails with status, on every retry
+static void Fault(uint8_t status, uint8_t skip){
+	HostBusFault(status, skip, (status == I2C_STATUS_ERROR) ? 1 : I2C_RETRIES + 1);
+}
+
+// Results are as they were in psBefore
+static bool Unchanged(const tISL29023 *psBefore){
+	return psBefore->rawVals[0] == g_sIsl.rawVals[0] && psBefore->rawVals[1] == g_sIsl.rawVals[1] &&
+			ALS(psBefore) == ALS(&g_sIsl) && IR(psBefore) == IR(&g_sIsl) && psBefore->clipCount == g_sIsl.clipCount;
+}
+
+// The range and resolution the instance converts with are the ones the sensor has
+static bool InSync(void){
+	return g_sModel.regs[ISL29023_REG_COMMANDII] == (g_pui8RangeCodes[g_sIsl.rangeIndex] | g_pui8ResCodes[(g_sIsl.resShift >> 2) - 1]);
+}
+
+// Every reading at every range and resolution through the conversions. The float path is checked
+// against itself worked in float, as the default build does. The integer path is checked against
+// the exact formulas within one count, and against the float path within one count plus a float
+// step, since above about 8000 units a float step is coarser than a thousandth
+static void CheckConvert(void){
+	uint32_t raw, misses = 0;
+	uint8_t r, s;
+	float alpha, beta, lux, ir;
+#ifdef ISL29023_FIXED_POINT
+	double exactLux, exactIR;
+#endif
+
+	Setup();
+	for(r = 0; r < ISL29023_RANGE_COUNT; r++){
+		for(s = 0; s < 4; s++){
+			ISL29023ChangeSettings(g_pui8RangeCodes[r], g_pui8ResCodes[s], &g_sIsl);
+			alpha = (float)g_sIsl.rangeSetting / (float)g_sIsl.resSetting;
+			beta = g_pfFloatBeta[r] * (float)g_sIsl.resSetting / 65536.0f;
+			CHECK(g_sIsl.resSetting == (16UL << 4*s) && (1UL << g_sIsl.resShift) == g_sIsl.resSetting);
+
+			for(raw = 0; raw < g_sIsl.resSetting; raw++){
+				ISL29023ConvertALS(&g_sIsl, raw);
+				ISL29023ConvertIR(&g_sIsl, raw);
+				lux = alpha * (float)raw;
+				ir = (float)raw / beta;
+#ifdef ISL29023_FIXED_POINT
+				exactLux = 1000.0 * g_sIsl.rangeSetting * raw / g_sIsl.resSetting;
+				exactIR = 1000.0 * raw * 65536.0 / (g_pdDatasheetBeta[r] * g_sIsl.resSetting);
+				misses += fabs(g_sIsl.alsMilli - exactLux) > 1.0;
+				misses += fabs(g_sIsl.irMilli - exactIR) > 1.0;
+				misses += fabs(g_sIsl.alsMilli - 1000.0 * lux) > 1.0 + 1000.0 * (nextafterf(lux, INFINITY) - lux);
+				misses += fabs(g_sIsl.irMilli - 1000.0 * ir) > 1.0 + 1000.0 * (nextafterf(ir, INFINITY) - ir);
+#else
+				misses += (g_sIsl.alsVal != lux) + (g_sIsl.irVal != ir);
+#endif
+			}
+		}
+	}
+	CHECK(misses == 0);
+}
+
+// Indoor light drifting 20 lux either side of 300 over the hour, with a lamp switched on for a
+// minute at the half hour
+static double Trace(uint64_t ns){
+	double t = (ns - g_ui64TraceStart) / 1e9;
+	double lux = 300 + 20 * sin(2 * M_PI * t / TRACE_LEN);
+
+	return (t >= TRACE_STEP_START && t < TRACE_STEP_START + TRACE_STEP_LEN) ? lux + 400 : lux;
+}
+
+// Continuous mode raises INT only after the persistence count of readings outside the window, and
+// with a band follows the light with a handful of transactions where polling every conversion
+// would keep the bus busy. INT is polled every millisecond in place of the GPIO interrupt
+static void CheckContinuous(void){
+	const tHostTrans *psTrans;
+	uint32_t ms, count, ints = 0, polled;
+	uint64_t start;
+	double alpha, slope, worst = 0, bound, t;
+
+	// Steady light inside a fixed window: no INT and no bus traffic at all
+	Setup();
+	g_sModel.lux = 300;
+	ISL29023SetThresholds(&g_sIsl, 19000, 20400);
+	psTrans = HostBusLast(0);
+	CHECK(psTrans->txLen == 5 && psTrans->tx[0] == ISL29023_REG_LOWINTLSB);
+	CHECK(psTrans->tx[1] == (19000 & 0xFF) && psTrans->tx[2] == (19000 >> 8) && psTrans->tx[3] == (20400 & 0xFF) && psTrans->tx[4] == (20400 >> 8));
+	ISL29023StartContinuous(&g_sIsl, ISL29023_COMMANDI_PERSIST4, 0);
+	count = g_ui32HostLogCount;
+	for(ms = 0; ms < 60000; ms++){
+		ints += IslModelInt(&g_sModel);
+		HostAdvance(1000000);
+	}
+	CHECK(ints == 0 && g_ui32HostLogCount == count && g_sModel.conversions == 60000 / 90);
+
+	// A call without the flag set only reads
+	CHECK(ISL29023HandleInterrupt(&g_sIsl) == ISL29023_EVENT_NONE && g_ui32HostLogCount == count + 1);
+
+	// Light leaving the window raises INT on the fourth reading outside, and the handler clears it
+	g_sModel.lux = 400;
+	start = HostNs();
+	while(!IslModelInt(&g_sModel) && HostNs() - start < 1000000000){
+		HostAdvance(1000000);
+	}
+	CHECK(HostNs() - start > 3 * 90000000ULL && HostNs() - start <= 4 * 90000000ULL + 1000000);
+	count = g_ui32HostLogCount;
+	CHECK(ISL29023HandleInterrupt(&g_sIsl) == ISL29023_EVENT_ALS);
+	CHECK(g_ui32HostLogCount == count + 2 && !IslModelInt(&g_sModel));
+	CHECK(fabs(ALS(&g_sIsl) - 400) <= 1000.0 / 65536);
+
+	// Tracking a light trace with a band of 64 counts. The reading may lag the light by the band,
+	// the window edge, a truncated count, and what the light does over the persistence count of
+	// conversions and one more
+	Setup();
+	g_sModel.trace = Trace;
+	g_ui64TraceStart = HostNs();
+	ISL29023SetThresholds(&g_sIsl, 0, 0);
+	ISL29023StartContinuous(&g_sIsl, ISL29023_COMMANDI_PERSIST4, 64);
+	count = g_ui32HostLogCount;
+	alpha = 1000.0 / 65536;
+	slope = 20 * 2 * M_PI / TRACE_LEN;
+	bound = 66 * alpha + 5 * 0.09 * slope;
+	ints = 0;
+	for(ms = 0; ms < TRACE_LEN * 1000; ms++){
+		if(IslModelInt(&g_sModel)){
+			CHECK(ISL29023HandleInterrupt(&g_sIsl) == ISL29023_EVENT_ALS);
+			ints++;
+		}
+
+		// Away from the lamp switching, once the first reading is in
+		t = ms / 1000.0;
+		if(ints && fabs(t - TRACE_STEP_START) > 1 && fabs(t - TRACE_STEP_START - TRACE_STEP_LEN) > 1){
+			worst = fmax(worst, fabs(ALS(&g_sIsl) - Trace(HostNs())));
+		}
+		HostAdvance(1000000);
+	}
+	count = g_ui32HostLogCount - count;
+	polled = 2 * TRACE_LEN * 1000 / 90;
+	CHECK(worst <= bound);
+	CHECK(count * 50 < polled);
+	CHECK(g_sModel.earlyReads == 0);
+	printf("islTest: 1 h light trace, %u interrupts, %u transactions against %u polling every conversion, lag %.2f lux (limit %.2f)\n", ints, count, polled, worst, bound);
+}
+
+// Initialize sets every field the other calls read, whatever the memory held before
+static void CheckInit(void){
+	HostBusReset();
+	IslModelInit(&g_sModel, 500, 0);
+	HostSlaveAdd(&g_sModel.slave);
+	I2CLibBusInit(&g_sBus, I2C3_BASE, &g_sHostBackend);
+	memset(&g_sIsl, 0xA5, sizeof(g_sIsl));
+	ISL29023Initialize(&g_sIsl, &g_sBus);
+
+	CHECK(g_sIsl.commandI == ISL29023_COMMANDI_NOPOW && g_sIsl.band == 0 && !g_sIsl.reading);
+	CHECK(g_sIsl.irResolution == ISL29023_COMMANDII_RES8 && g_sIsl.irWeight == 0);
+	CHECK(g_sIsl.precisionMilli == 0 && g_sIsl.clipCount == 0);
+	CHECK(g_sIsl.rangeIndex == 0 && g_sIsl.resSetting == 65536 && g_sIsl.resShift == 16);
+
+	// With no weight the compensated result is the plain reading
+	ISL29023GetCompensatedALS(&g_sIsl);
+	CHECK(fabs(ALS(&g_sIsl) - 500) <= 1000.0 / 65536);
+	CHECK(g_sIsl.resSetting == 65536);
+
+	// Auto-ranging before SetAutoRange picks the finest resolution
+	ISL29023AutoApply(&g_sIsl, 0);
+	CHECK(g_sIsl.resSetting == 65536);
+}
+
+// IR results at every range don't depend on the resolution beyond a count, and the compensated
+// lux removes the weighted IR at the cost of one short IR conversion
+static void CheckIR(void){
+	static const uint8_t pui8IRRes[3] = {ISL29023_COMMANDII_RES12, ISL29023_COMMANDII_RES8, ISL29023_COMMANDII_RES4};
+	uint8_t r, s;
+	uint64_t start, plainNs, compNs;
+	double ir, step, expect;
+
+	Setup();
+	for(r = 0; r < ISL29023_RANGE_COUNT; r++){
+		for(s = 0; s < 3; s++){
+			// A fifth of full scale
+			g_sModel.ir = 0.2 * 65536 / g_pfFloatBeta[r];
+			ISL29023ChangeSettings(g_pui8RangeCodes[r], g_pui8ResCodes[3 - s], &g_sIsl);
+			ISL29023GetIR(&g_sIsl);
+			step = 65536.0 / g_sIsl.resSetting / g_pfFloatBeta[r];
+			CHECK(fabs(IR(&g_sIsl) - g_sModel.ir) <= step + 0.002);
+		}
+	}
+
+	// Half the IR taken off, with IR at each of the faster resolutions. IR in ALS counts is only
+	// as fine as the IR conversion
+	g_sModel.lux = 500;
+	g_sModel.ir = 2;
+	for(s = 0; s < 3; s++){
+		ISL29023ChangeSettings(ISL29023_COMMANDII_RANGE1k, ISL29023_COMMANDII_RES16, &g_sIsl);
+		start = HostNs();
+		ISL29023GetALS(&g_sIsl);
+		plainNs = HostNs() - start;
+
+		ISL29023SetIRCompensation(&g_sIsl, pui8IRRes[s], 128);
+		start = HostNs();
+		ISL29023GetCompensatedALS(&g_sIsl);
+		compNs = HostNs() - start;
+		ir = g_sModel.ir * g_pfFloatBeta[0];
+		expect = 500 - 0.5 * ir * 1000 / 65536;
+		step = 1000.0 / 65536 * (1 + 0.5 * (65536 >> (12 - 4*s)));
+		CHECK(fabs(ALS(&g_sIsl) - expect) <= step);
+		CHECK(fabs(IR(&g_sIsl) - g_sModel.ir) <= 65536.0 / (4096 >> 4*s) / g_pfFloatBeta[0] + 0.002);
+
+		// Still at the caller's settings, with the plain ALS reading in rawVals
+		CHECK(g_sIsl.resSetting == 65536 && g_sIsl.rangeIndex == 0);
+		CHECK(ISL29023Raw(&g_sIsl) == (uint32_t)(500 * 65.536));
+
+		// The IR conversion adds its own time, not another ALS conversion
+		CHECK(compNs < plainNs + ((s == 0) ? 7000000 : 5000000));
+	}
+	CHECK(g_sModel.earlyReads == 0);
+}
+
+// Lux per count at the current settings
+static double Step(tISL29023 *psInst){
+	return (double)psInst->rangeSetting / psInst->resSetting;
+}
+
+// Auto-ranging through a sweep from 0.5 to 50000 lux and back. The range only moves with the light,
+// every unclipped reading is within a count of it, the step is never coarser than asked for, and a
+// level held on either range threshold doesn't bounce between ranges
+static void CheckAutoRange(void){
+	uint32_t changes = 0, clips = 0, moves;
+	uint8_t r, dir, last;
+	uint16_t i;
+	double pre, post;
+	uint8_t status;
+
+	// The ladder relies on the range codes being in datasheet order
+	for(r = 0; r < ISL29023_RANGE_COUNT; r++){
+		CHECK((g_pui8RangeCodes[r] & 3) == r);
+	}
+
+	Setup();
+	ISL29023SetAutoRange(&g_sIsl, 1000);
+	CHECK(g_sIsl.rangeIndex == ISL29023_RANGE_COUNT - 1);
+	g_sModel.lux = 0.5;
+	for(i = 0; i < 4; i++){
+		ISL29023GetALSAuto(&g_sIsl);
+	}
+	CHECK(g_sIsl.rangeIndex == 0);
+
+	last = g_sIsl.rangeIndex;
+	for(dir = 0; dir < 2; dir++){
+		for(i = 0; i <= 400; i++){
+			g_sModel.lux = 0.5 * pow(10, (dir ? 400 - i : i) / 80.0);
+			pre = Step(&g_sIsl);
+			status = ISL29023GetALSAuto(&g_sIsl);
+			post = Step(&g_sIsl);
+			if(status == ISL29023_STATUS_SATURATED){
+				clips++;
+			} else{
+				CHECK(status == ISL29023_STATUS_OK);
+				CHECK(fabs(ALS(&g_sIsl) - g_sModel.lux) <= fmax(pre, post) + 0.002 + g_sModel.lux * 1e-6);
+			}
+			if(g_sIsl.rangeIndex != last){
+				CHECK(dir ? g_sIsl.rangeIndex < last : g_sIsl.rangeIndex > last);
+				changes++;
+				last = g_sIsl.rangeIndex;
+			}
+			CHECK(post <= 1.0 || g_sIsl.rangeIndex == 0);
+		}
+	}
+	CHECK(changes == 2 * (ISL29023_RANGE_COUNT - 1) && clips == 0);
+
+	for(r = 0; r < ISL29023_RANGE_COUNT - 1; r++){
+		for(dir = 0; dir < 2; dir++){
+			g_sModel.lux = dir ? g_pui16RangeLux[r + 1] * 3.0 / 16 : g_pui16RangeLux[r] * 15.0 / 16;
+			ISL29023SetAutoRange(&g_sIsl, 1000);
+			moves = 0;
+			for(i = 0; i < 20; i++){
+				last = g_sIsl.rangeIndex;
+				ISL29023GetALSAuto(&g_sIsl);
+				moves += (i > 4 && g_sIsl.rangeIndex != last);
+			}
+			CHECK(moves == 0);
+		}
+	}
+	CHECK(g_sModel.earlyReads == 0);
+}
+
+// Daylight at minute m: half a lux at night, up to 80000 lux at noon so the brightest readings
+// clip even at 64k, and passing clouds
+static double Daylight(uint32_t m){
+	double h = m / 60.0, sun;
+
+	if(h < 6 || h >= 20){
+		return 0.5;
+	}
+	sun = sin(M_PI * (h - 6) / 14);
+	return 0.5 + 80000 * sun * sun * (((m / 23) % 4 == 0) ? 0.3 : 1.0);
+}
+
+// A day of readings, one a minute, with auto-ranging at 1 lux precision against a fixed 64k range
+// at 16 bit. Auto-ranging must clip exactly where the light is past 15/16 of the 64k range, be
+// as accurate as asked everywhere else, and spend less time converting
+static void CheckDay(void){
+	uint32_t m, autoClips = 0, fixedClips = 0, expectClips = 0;
+	uint64_t start, autoNs = 0, fixedNs = 0;
+	uint8_t status;
+
+	Setup();
+	ISL29023SetAutoRange(&g_sIsl, 1000);
+	for(m = 0; m < DAY_LEN; m++){
+		g_sModel.lux = Daylight(m);
+		start = HostNs();
+		status = ISL29023GetALSAuto(&g_sIsl);
+		autoNs += HostNs() - start;
+		if(status == ISL29023_STATUS_SATURATED){
+			autoClips++;
+		} else{
+			CHECK(status == ISL29023_STATUS_OK);
+			CHECK(fabs(ALS(&g_sIsl) - g_sModel.lux) <= 1.0 + g_sModel.lux * 1e-6);
+		}
+		expectClips += (uint32_t)(g_sModel.lux * 65536 / 64000) >= 65536 - 4096;
+	}
+	CHECK(autoClips == expectClips && g_sIsl.clipCount == expectClips);
+
+	ISL29023ChangeSettings(ISL29023_COMMANDII_RANGE64k, ISL29023_COMMANDII_RES16, &g_sIsl);
+	for(m = 0; m < DAY_LEN; m++){
+		g_sModel.lux = Daylight(m);
+		start = HostNs();
+		ISL29023GetALS(&g_sIsl);
+		fixedNs += HostNs() - start;
+		fixedClips += ISL29023Raw(&g_sIsl) == 0xFFFF;
+	}
+	CHECK(autoNs < fixedNs);
+	CHECK(g_sModel.earlyReads == 0);
+	printf("islTest: day trace, %u readings, auto-range %.1f s converting with %u clipped, fixed 64k 16 bit %.1f s with %u clipped\n", DAY_LEN, autoNs / 1e9, autoClips, fixedNs / 1e9, fixedClips);
+}
+
+// A NACK or timeout on any transaction of a blocking call is returned, leaves the results as they
+// were and the settings matching the sensor. The interrupt flag is only acted on, or cleared,
+// after a good read, and stays set when handling fails so the next call can finish the job
+static void CheckFaults(void){
+	static const uint8_t pui8Status[2] = {I2C_STATUS_ERROR, I2C_STATUS_TIMEOUT};
+	tISL29023 sBefore;
+	uint32_t count;
+	uint8_t f, skip;
+
+	for(f = 0; f < 2; f++){
+		Setup();
+		g_sModel.lux = 300;
+		g_sModel.ir = 20;
+		CHECK(ISL29023ChangeSettings(ISL29023_COMMANDII_RANGE4k, ISL29023_COMMANDII_RES16, &g_sIsl) == ISL29023_STATUS_OK);
+		CHECK(ISL29023GetALS(&g_sIsl) == ISL29023_STATUS_OK && ISL29023GetIR(&g_sIsl) == ISL29023_STATUS_OK);
+		g_sModel.lux = 600;
+		g_sModel.ir = 40;
+
+		// Trigger write or result read
+		for(skip = 0; skip < 2; skip++){
+			sBefore = g_sIsl;
+			Fault(pui8Status[f], skip);
+			CHECK(ISL29023GetALS(&g_sIsl) == ISL29023_STATUS_BUS_ERROR && Unchanged(&sBefore));
+			Fault(pui8Status[f], skip);
+			CHECK(ISL29023GetIR(&g_sIsl) == ISL29023_STATUS_BUS_ERROR && Unchanged(&sBefore));
+		}
+
+		// A settings write the sensor never saw changes nothing
+		sBefore = g_sIsl;
+		Fault(pui8Status[f], 0);
+		CHECK(ISL29023ChangeSettings(ISL29023_COMMANDII_RANGE64k, ISL29023_COMMANDII_RES8, &g_sIsl) == ISL29023_STATUS_BUS_ERROR);
+		CHECK(g_sIsl.rangeIndex == 1 && g_sIsl.resSetting == 65536 && InSync() && Unchanged(&sBefore));
+
+		// IR settings, IR trigger, IR read, ALS settings, ALS trigger, ALS read. Only a failed
+		// restore of the ALS settings leaves the IR resolution in place
+		ISL29023SetIRCompensation(&g_sIsl, ISL29023_COMMANDII_RES8, 128);
+		for(skip = 0; skip < 6; skip++){
+			sBefore = g_sIsl;
+			Fault(pui8Status[f], skip);
+			CHECK(ISL29023GetCompensatedALS(&g_sIsl) == ISL29023_STATUS_BUS_ERROR && Unchanged(&sBefore) && InSync());
+			CHECK(g_sIsl.resSetting == ((skip == 3) ? 256 : 65536));
+			CHECK(ISL29023ChangeSettings(ISL29023_COMMANDII_RANGE4k, ISL29023_COMMANDII_RES16, &g_sIsl) == ISL29023_STATUS_OK);
+		}
+		CHECK(ISL29023GetCompensatedALS(&g_sIsl) == ISL29023_STATUS_OK && fabs(ALS(&g_sIsl) - (600 - 0.5 * 40 * g_pfFloatBeta[1] * 4000 / 65536)) <= 4000.0 / 65536 * (1 + 0.5 * 256));
+
+		// Auto-ranging at 64k reads dim light, then steps down a range. A failed trigger or read
+		// is an error, a failed step down leaves the range for the next reading
+		for(skip = 0; skip < 3; skip++){
+			CHECK(ISL29023SetAutoRange(&g_sIsl, 1000) == ISL29023_STATUS_OK);
+			sBefore = g_sIsl;
+			Fault(pui8Status[f], skip);
+			if(skip < 2){
+				CHECK(ISL29023GetALSAuto(&g_sIsl) == ISL29023_STATUS_BUS_ERROR && Unchanged(&sBefore));
+			} else{
+				CHECK(ISL29023GetALSAuto(&g_sIsl) == ISL29023_STATUS_OK && fabs(ALS(&g_sIsl) - 600) <= 1);
+			}
+			CHECK(g_sIsl.rangeIndex == ISL29023_RANGE_COUNT - 1 && InSync());
+		}
+
+		// Continuous with a band, light jumps out of the window. Read, window move and flag clear
+		Setup();
+		g_sModel.lux = 300;
+		CHECK(ISL29023SetThresholds(&g_sIsl, 0, 0) == ISL29023_STATUS_OK);
+		CHECK(ISL29023StartContinuous(&g_sIsl, ISL29023_COMMANDI_PERSIST1, 64) == ISL29023_STATUS_OK);
+		while(!IslModelInt(&g_sModel)){
+			HostAdvance(1000000);
+		}
+		for(skip = 0; skip < 3; skip++){
+			sBefore = g_sIsl;
+			count = g_ui32HostLogCount;
+			Fault(pui8Status[f], skip);
+			CHECK(ISL29023HandleInterrupt(&g_sIsl) == ISL29023_EVENT_ERROR && Unchanged(&sBefore));
+			CHECK(IslModelInt(&g_sModel));
+
+			// Nothing is written after a failed read
+			if(skip == 0){
+				CHECK(g_ui32HostLogCount - count == ((pui8Status[f] == I2C_STATUS_ERROR) ? 1 : I2C_RETRIES + 1));
+			}
+		}
+		CHECK(ISL29023HandleInterrupt(&g_sIsl) == ISL29023_EVENT_ALS && !IslModelInt(&g_sModel));
+		CHECK(fabs(ALS(&g_sIsl) - 300) <= 1000.0 / 65536);
+
+		// A failed start leaves the sensor powered down
+		Setup();
+		Fault(pui8Status[f], 0);
+		CHECK(ISL29023StartContinuous(&g_sIsl, ISL29023_COMMANDI_PERSIST1, 0) == ISL29023_STATUS_BUS_ERROR);
+		CHECK(g_sModel.regs[ISL29023_REG_COMMANDI] == ISL29023_COMMANDI_NOPOW);
+	}
+	CHECK(g_sModel.earlyReads == 0);
+}
+
+int main(void){
+	HostInit();
+
+	CheckInit();
+	CheckConvert();
+	CheckIR();
+	CheckContinuous();
+	CheckAutoRange();
+	CheckDay();
+	CheckFaults();
+
+#ifdef ISL29023_FIXED_POINT
+	return HostResult("islTestFixed");
+#else
+	return HostResult("islTest");
+#endif
+}
@@ -0,0 +1,185 @@
+// logBench.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	None
+//
+// Requirements:
+// 	See host.h
+//
+// Description:
+// 	Records per second and write amplification of logLib against an f_write per record, with
+//	FatFs and diskio on the SD card model
+//
+// Notes:
+//	Run with 'make bench'. Times are on the model's virtual clock at the SD example's 12.5MHz
+//	SPI rate, with BENCH_BUSY_NS of card busy after each block, so they count bus and card time
+//	and none of the CPU's. Write amplification is the bytes sent to the card over the record
+//	bytes. The card counts cover the run from opening the file to closing it. Built plain and with SDC_CACHE_SECTORS=0
+//	'logBench image' also saves the card of the last run to the file image, a FAT16 volume with
+//	no partition table, so it can be looked at with mtools (mdir -i image)
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include <string.h>
+
+#include "host.h"
+#include "../SD Card/diskio.c"
+#include "ff.h"
+#include "logLib.h"
+#include "sdModel.h"
+
+
+// Defines -------------------------------------------------------------------------------------------
+#define BENCH_SECTORS 16384
+#define BENCH_RECORDS 10000
+#define BENCH_RECORD_LEN 32
+#define BENCH_SYNC_EVERY 100		// Records between syncs
+#define BENCH_BUSY_NS 250000
+
+#define BENCH_PATH "LOG.BIN"
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+typedef enum
+{
+	BENCH_FWRITE,			// f_write each record, f_sync
+	BENCH_LOG_FLUSH,		// LogAppend and LogService each record, LogFlush
+	BENCH_LOG_SYNC			// The same with LogSync
+} tBenchMode;
+
+// One run, from opening the file to closing it
+typedef struct
+{
+	uint64_t ns;
+	uint32_t logical;		// Sectors FatFs wrote
+	uint32_t physical;		// Sectors sent to the card
+	uint32_t reads;			// Sectors read from the card
+} tBenchResult;
+
+static const char *g_ppcModeName[3] = {"f_write, f_sync", "logLib, LogFlush", "logLib, LogSync"};
+
+static FATFS g_sFs;
+static FIL g_sFile;
+static tLog g_sLog;
+
+
+
+// Functions -----------------------------------------------------------------------------------------
+
+static void MakeRecord(uint8_t *pui8Record, uint32_t seq){
+	uint32_t i;
+
+	for(i = 0; i < BENCH_RECORD_LEN; i++){
+		pui8Record[i] = (uint8_t)(seq * 31 + i);
+	}
+}
+
+// Log BENCH_RECORDS records to a freshly formatted card and close the file. Returns false on a
+// FatFs or logger error, or if the file doesn't read back
+static bool Run(tBenchMode mode, tBenchResult *psResult){
+	uint8_t pui8Record[BENCH_RECORD_LEN], pui8Read[BENCH_RECORD_LEN];
+	DWORD pui32Before[2], pui32After[2];
+	uint64_t start;
+	uint32_t i, reads;
+	bool ok = true;
+	UINT bw;
+
+	SdModelInit(BENCH_SECTORS, disk_timerproc, disk_dmaproc);
+	SdModelFormat();
+	g_ui64SdBusyNs = BENCH_BUSY_NS;
+	disk_idle_set(0);
+	if(disk_initialize(0) != 0 || f_mount(&g_sFs, "", 1) != FR_OK){
+		return false;
+	}
+	disk_ioctl(0, MMC_GET_WRITES, pui32Before);
+	start = HostNs();
+	reads = g_ui32SdBlocksRead;
+
+	if(mode == BENCH_FWRITE){
+		ok = f_open(&g_sFile, BENCH_PATH, FA_WRITE | FA_CREATE_ALWAYS) == FR_OK;
+		for(i = 0; ok && i < BENCH_RECORDS; i++){
+			MakeRecord(pui8Record, i);
+			ok = f_write(&g_sFile, pui8Record, BENCH_RECORD_LEN, &bw) == FR_OK && bw == BENCH_RECORD_LEN;
+			if(ok && i % BENCH_SYNC_EVERY == BENCH_SYNC_EVERY - 1){
+				ok = f_sync(&g_sFile) == FR_OK;
+			}
+		}
+		ok = f_close(&g_sFile) == FR_OK && ok;
+	} else{
+		ok = LogOpen(&g_sLog, BENCH_PATH) == LOG_STATUS_OK;
+		for(i = 0; ok && i < BENCH_RECORDS; i++){
+			MakeRecord(pui8Record, i);
+			ok = LogAppend(&g_sLog, pui8Record, BENCH_RECORD_LEN) == LOG_STATUS_OK
+					&& LogService(&g_sLog) == LOG_STATUS_OK;
+			if(ok && i % BENCH_SYNC_EVERY == BENCH_SYNC_EVERY - 1){
+				ok = (mode == BENCH_LOG_SYNC ? LogSync(&g_sLog) : LogFlush(&g_sLog)) == LOG_STATUS_OK;
+			}
+		}
+		ok = LogClose(&g_sLog) == LOG_STATUS_OK && ok;
+	}
+
+	psResult->ns = HostNs() - start;
+	psResult->reads = g_ui32SdBlocksRead - reads;
+	disk_ioctl(0, MMC_GET_WRITES, pui32After);
+	psResult->logical = pui32After[0] - pui32Before[0];
+	psResult->physical = pui32After[1] - pui32Before[1];
+
+	// Read it back
+	if(ok && f_open(&g_sFile, BENCH_PATH, FA_READ) == FR_OK){
+		ok = f_size(&g_sFile) == (DWORD)BENCH_RECORDS * BENCH_RECORD_LEN;
+		for(i = 0; ok && i < BENCH_RECORDS; i++){
+			MakeRecord(pui8Record, i);
+			ok = f_read(&g_sFile, pui8Read, BENCH_RECORD_LEN, &bw) == FR_OK && bw == BENCH_RECORD_LEN
+					&& memcmp(pui8Read, pui8Record, BENCH_RECORD_LEN) == 0;
+		}
+		f_close(&g_sFile);
+	} else{
+		ok = false;
+	}
+
+	return ok;
+}
+
+int main(int argc, char **argv){
+	tBenchResult sResult;
+	tBenchMode mode;
+	FILE *psImage;
+
+	HostInit();
+#if SDC_CACHE_SECTORS == 0
+	printf("logBenchNoCache: ");
+#else
+	printf("logBench: ");
+#endif
+	printf("%u records of %u bytes, synced every %u, %uus card busy per block\n",
+			BENCH_RECORDS, BENCH_RECORD_LEN, BENCH_SYNC_EVERY, BENCH_BUSY_NS / 1000);
+	printf("  %-18s %10s %14s %13s %11s %14s\n", "", "records/s", "FatFs writes", "card writes",
+			"card reads", "amplification");
+	for(mode = BENCH_FWRITE; mode <= BENCH_LOG_SYNC; mode++){
+		if(!Run(mode, &sResult)){
+			printf("FAIL: %s run didn't log every record\n", g_ppcModeName[mode]);
+			return 1;
+		}
+		printf("  %-18s %10.0f %14u %13u %11u %14.2f\n", g_ppcModeName[mode], BENCH_RECORDS * 1e9 / sResult.ns,
+				sResult.logical, sResult.physical, sResult.reads,
+				sResult.physical * 512.0 / (BENCH_RECORDS * BENCH_RECORD_LEN));
+	}
+
+	if(argc > 1){
+		psImage = fopen(argv[1], "wb");
+		if(!psImage || fwrite(g_ppui8SdDisk, 512, BENCH_SECTORS, psImage) != BENCH_SECTORS){
+			printf("FAIL: couldn't write %s\n", argv[1]);
+			return 1;
+		}
+		fclose(psImage);
+	}
+
+	return 0;
+}
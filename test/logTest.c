@@ -0,0 +1,218 @@
+// logTest.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	None
+//
+// Requirements:
+// 	See host.h
+//
+// Description:
+// 	Checks logLib on FatFs and diskio against the SD card model
+//
+// Notes:
+//	diskio.c is included so the checks can drop its write-behind cache and see what the card alone
+//	holds. ff.c and logLib.c are linked as they are built for the target
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include <string.h>
+
+#include "host.h"
+#include "../SD Card/diskio.c"
+#include "ff.h"
+#include "logLib.h"
+#include "sdModel.h"
+
+
+// Defines -------------------------------------------------------------------------------------------
+
+// 8MB card, FAT16
+#define CARD_SECTORS 16384
+
+#define LOG_PATH "LOG.BIN"
+
+// Main loop time between records
+#define RECORD_NS 1000000
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+typedef struct
+{
+	uint32_t seq;
+	uint8_t data[20];
+} tRecord;
+
+static FATFS g_sFs;
+static tLog g_sLog;
+static uint32_t g_ui32Appended;
+
+
+
+// Functions -----------------------------------------------------------------------------------------
+
+static void MakeRecord(tRecord *psRecord, uint32_t seq){
+	uint32_t i;
+
+	psRecord->seq = seq;
+	for(i = 0; i < sizeof(psRecord->data); i++){
+		psRecord->data[i] = (uint8_t)(seq * 31 + i);
+	}
+}
+
+// A freshly formatted card, mounted, with an empty log open
+static void Setup(void){
+	SdModelInit(CARD_SECTORS, disk_timerproc, disk_dmaproc);
+	SdModelFormat();
+	disk_idle_set(0);
+	CHECK(disk_initialize(0) == 0);
+	CHECK(f_mount(&g_sFs, "", 1) == FR_OK);
+	CHECK(LogOpen(&g_sLog, LOG_PATH) == LOG_STATUS_OK);
+	g_ui32Appended = 0;
+}
+
+// The next record from the main loop, as a sampling loop would
+static void Append(void){
+	tRecord sRecord;
+
+	MakeRecord(&sRecord, g_ui32Appended++);
+	CHECK(LogAppend(&g_sLog, &sRecord, sizeof(sRecord)) == LOG_STATUS_OK);
+	CHECK(LogService(&g_sLog) == LOG_STATUS_OK);
+	SdModelRun(RECORD_NS);
+}
+
+// A record from a sampling interrupt
+static void AppendIsr(void){
+	tRecord sRecord;
+
+	MakeRecord(&sRecord, g_ui32Appended++);
+	CHECK(LogAppend(&g_sLog, &sRecord, sizeof(sRecord)) == LOG_STATUS_OK);
+}
+
+// Records in the log as the card alone holds it, as after a power loss. The driver's cache is
+// dropped unwritten and the volume mounted again, so the log can't be used after this
+static uint32_t CardRecords(void){
+	FIL sFile;
+	tRecord sRecord, sExpect;
+	uint32_t count = 0;
+	UINT br;
+
+#if SDC_CACHE_SECTORS
+	memset(CacheState, 0, sizeof(CacheState));
+	CacheDirty = FALSE;
+#endif
+	CHECK(f_mount(0, "", 0) == FR_OK);
+	CHECK(f_mount(&g_sFs, "", 1) == FR_OK);
+	if(f_open(&sFile, LOG_PATH, FA_READ) != FR_OK){
+		return 0;
+	}
+	while(f_read(&sFile, &sRecord, sizeof(sRecord), &br) == FR_OK && br == sizeof(sRecord)){
+		MakeRecord(&sExpect, count);
+		if(memcmp(&sRecord, &sExpect, sizeof(sRecord)) != 0){
+			break;
+		}
+		count++;
+	}
+	CHECK(f_size(&sFile) == count * sizeof(tRecord));
+	f_close(&sFile);
+	return count;
+}
+
+
+
+// Checks --------------------------------------------------------------------------------------------
+
+// 1000 records with a LogSync, or a LogFlush, every 50. Returns the card blocks written, and the
+// most written by one sync
+static uint32_t SyncRun(bool flush, uint32_t *pui32SyncMax){
+	uint32_t i, before;
+
+	Setup();
+	*pui32SyncMax = 0;
+	for(i = 0; i < 1000; i++){
+		Append();
+		if(i % 50 == 49){
+			before = g_ui32SdBlocksWritten;
+			CHECK((flush ? LogFlush(&g_sLog) : LogSync(&g_sLog)) == LOG_STATUS_OK);
+			if(g_ui32SdBlocksWritten - before > *pui32SyncMax){
+				*pui32SyncMax = g_ui32SdBlocksWritten - before;
+			}
+#if SDC_CACHE_SECTORS
+			CHECK(flush != CacheDirty);
+#endif
+		}
+	}
+	CHECK(g_sLog.records == 1000 && g_sLog.dropped == 0);
+	return g_ui32SdBlocksWritten;
+}
+
+// LogSync leaves the sectors it updates in the driver's cache. The card only sees what they push
+// out of a full cache, so it writes less than syncing with LogFlush. LogFlush puts every record on
+// the card
+static void CheckSync(void){
+	uint32_t syncBlocks, syncMax, flushBlocks, flushMax;
+
+	syncBlocks = SyncRun(false, &syncMax);
+	CHECK(syncMax <= SDC_CACHE_SECTORS);
+	CHECK(LogFlush(&g_sLog) == LOG_STATUS_OK);
+	CHECK(CardRecords() == 1000);
+
+	flushBlocks = SyncRun(true, &flushMax);
+	CHECK(CardRecords() == 1000);
+	CHECK(syncBlocks < flushBlocks);
+	printf("logTest: 20 syncs in 1000 records, %u card blocks with LogSync (at most %u in one), "
+			"%u with LogFlush (at most %u)\n", syncBlocks, syncMax, flushBlocks, flushMax);
+}
+
+// After a LogSync the tail of the log reaches the card at the age flush, with no further call
+// into the log. Before it, the card is still behind
+static void CheckAgeFlush(void){
+	uint32_t i;
+
+	Setup();
+	for(i = 0; i < 300; i++){
+		Append();
+	}
+	CHECK(LogSync(&g_sLog) == LOG_STATUS_OK);
+	for(i = 0; i < SDC_CACHE_AGE + 1; i++){
+		ROM_SysCtlSleep();
+		disk_cache_service();
+	}
+	CHECK(CardRecords() == 300);
+
+	Setup();
+	for(i = 0; i < 300; i++){
+		Append();
+	}
+	CHECK(LogSync(&g_sLog) == LOG_STATUS_OK);
+	CHECK(CardRecords() < 300);
+}
+
+// A record that fills the buffer, appended by an interrupt after LogFlush has serviced the log but
+// before it takes the partial buffer. The full buffer has to reach the card ahead of the partial
+static void CheckFlushRace(void){
+	Setup();
+	while(g_sLog.fill + sizeof(tRecord) < LOG_BUF_SIZE){
+		Append();
+	}
+	SdModelIrq(AppendIsr);
+	CHECK(LogFlush(&g_sLog) == LOG_STATUS_OK);
+	CHECK(!g_sLog.full && g_sLog.sectors == 1);
+	CHECK(CardRecords() == g_ui32Appended);
+}
+
+int main(void){
+	HostInit();
+
+	CheckSync();
+	CheckAgeFlush();
+	CheckFlushRace();
+
+	return HostResult("logTest");
+}
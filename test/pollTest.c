@@ -0,0 +1,199 @@
+// pollTest.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	Example BMP180 calibration from the Bosch datasheet
+//
+// Requirements:
+// 	See host.h
+//
+// Description:
+// 	Runs g_sI2CPollBackend's register sequence against the I2C3 master model
+//
+// Notes:
+//	The master model runs polled, so each command the backend writes to MCS finishes when the
+//	backend next reads MCS. Transactions come out of the model's log as the slaves saw them, and
+//	the time each one held the bus shows how many commands it took
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include "host.h"
+#include "inc/hw_memmap.h"
+#include "driverlib/gpio.h"
+#include "driverlib/pin_map.h"
+#include "i2cLib.h"
+#include "bmpLib.h"
+#include "shtLib.h"
+#include "i2cModel.h"
+#include "sensorModel.h"
+
+
+// Defines -------------------------------------------------------------------------------------------
+#define MISSING_ADDR 0x51		// No slave answers here
+
+// One SCL period at 400 kHz with the 40 MHz clock, MTPR 4
+#define BIT_NS 2500
+
+// Datasheet example results at oss 0
+#define EXAMPLE_UT 27898
+#define EXAMPLE_UP 23843
+#define EXAMPLE_P 69964
+
+#define SHT_TEMP_RAW 0x6A3C
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+static const int16_t g_pi16ExampleCal[11] = {408, -72, -14383, (int16_t)32741, (int16_t)32757, (int16_t)23153, 6190, 4, -32768, -8711, 2868};
+
+static tI2CBus g_sTestBus;
+static tBmpModel g_sBmpModel;
+static tShtModel g_sShtModel;
+static tI2CDevice g_sBmpDev, g_sShtDev, g_sMissingDev;
+
+
+
+// Functions -----------------------------------------------------------------------------------------
+
+// A fresh polled bus with both models on it
+static void Setup(void){
+	HostBusReset();
+	I2CLibBusInit(&g_sTestBus, I2C3_BASE, &g_sI2CPollBackend);
+	BmpModelInit(&g_sBmpModel, g_pi16ExampleCal, EXAMPLE_UT, EXAMPLE_UP);
+	ShtModelInit(&g_sShtModel, SHT_TEMP_RAW, 0x6060);
+	HostSlaveAdd(&g_sBmpModel.slave);
+	HostSlaveAdd(&g_sShtModel.slave);
+	I2CLibDevInit(&g_sBmpDev, &g_sTestBus, BMP180_I2C_ADDRESS);
+	I2CLibDevInit(&g_sShtDev, &g_sTestBus, SHT21_I2C_ADDRESS);
+	I2CLibDevInit(&g_sMissingDev, &g_sTestBus, MISSING_ADDR);
+	HostMasterPolled(true);
+}
+
+// Bus time of a transaction: 9 clocks for every byte and address, one more for each start and
+// the stop
+static uint64_t BusNs(uint8_t bytes, uint8_t starts){
+	return (uint64_t)(9 * (bytes + starts) + starts + 1) * BIT_NS;
+}
+
+// The last logged transaction, and that it took exactly its own bus time
+static bool Last(uint8_t addr, uint8_t txLen, uint8_t rxLen, uint8_t status, uint64_t busyNs){
+	const tHostTrans *psLast = HostBusLast(0);
+
+	return psLast && psLast->addr == addr && psLast->txLen == txLen && psLast->rxLen == rxLen && psLast->status == status && g_ui64HostMasterBusyNs == busyNs;
+}
+
+
+
+// Checks --------------------------------------------------------------------------------------------
+
+// Every transaction shape the drivers use: a burst read after a register address (the BMP180
+// calibration), a burst write, a single byte write, a single byte read and a read with no write
+// phase (the SHT21 result). Data arrives intact and each byte is one command
+static void CheckShapes(void){
+	static const uint8_t pui8Command[1] = {0x2E};
+	uint8_t pui8Cal[22], pui8Sht[3];
+	uint64_t busyNs = 0;
+	uint8_t i, data;
+
+	Setup();
+
+	CHECK(I2CLibDevReadRegs(&g_sBmpDev, 0xAA, pui8Cal, 22) == I2C_STATUS_DONE);
+	busyNs += BusNs(23, 2);
+	CHECK(Last(BMP180_I2C_ADDRESS, 1, 22, I2C_STATUS_DONE, busyNs) && HostBusLast(0)->tx[0] == 0xAA);
+	CHECK(g_ui32HostLogCount == 1);
+	for(i = 0; i < 11; i++){
+		CHECK((int16_t)((pui8Cal[2 * i] << 8) | pui8Cal[2 * i + 1]) == g_pi16ExampleCal[i]);
+	}
+
+	CHECK(I2CLibDevWriteRegs(&g_sBmpDev, 0xF4, pui8Command, 1) == I2C_STATUS_DONE);
+	busyNs += BusNs(2, 1);
+	CHECK(Last(BMP180_I2C_ADDRESS, 2, 0, I2C_STATUS_DONE, busyNs));
+	CHECK(g_ui32HostLogCount == 2 && HostBusLast(0)->tx[0] == 0xF4 && HostBusLast(0)->tx[1] == 0x2E);
+
+	// The chip id register after the conversion
+	HostAdvance(5000000);
+	CHECK(I2CLibDevReadRegs(&g_sBmpDev, 0xD0, &data, 1) == I2C_STATUS_DONE && data == 0x55);
+	busyNs += BusNs(2, 2);
+	CHECK(Last(BMP180_I2C_ADDRESS, 1, 1, I2C_STATUS_DONE, busyNs));
+
+	// SHT21 temperature without hold, then its result once converted
+	CHECK(I2CLibDevCommand(&g_sShtDev, 0xF3) == I2C_STATUS_DONE);
+	busyNs += BusNs(1, 1);
+	CHECK(Last(SHT21_I2C_ADDRESS, 1, 0, I2C_STATUS_DONE, busyNs) && HostBusLast(0)->tx[0] == 0xF3);
+	HostAdvance(100000000);
+	CHECK(I2CLibDevRead(&g_sShtDev, pui8Sht, 3) == I2C_STATUS_DONE);
+	busyNs += BusNs(3, 1);
+	CHECK(Last(SHT21_I2C_ADDRESS, 0, 3, I2C_STATUS_DONE, busyNs));
+	CHECK(((pui8Sht[0] << 8) | pui8Sht[1]) == (SHT_TEMP_RAW & 0xFFFC) && pui8Sht[2] == ShtModelCrc(pui8Sht, 2));
+
+	CHECK(g_sBmpDev.bytes == g_sBmpModel.slave.bytes && g_sShtDev.bytes == g_sShtModel.slave.bytes);
+	CHECK(g_ui32HostMasterStarts == 5 && g_ui32HostLogCount == 5);
+	CHECK(g_sBmpModel.earlyReads == 0 && g_sShtModel.nackedReads == 0);
+}
+
+// An address NACK on a single byte command and in a burst. The burst's error stop frees the bus
+// and the next transaction runs normally. NACKs aren't retried
+static void CheckNack(void){
+	uint8_t pui8Data[2];
+
+	Setup();
+
+	CHECK(I2CLibDevCommand(&g_sMissingDev, 0x01) == I2C_STATUS_ERROR);
+	CHECK(g_ui32HostLogCount == 1 && Last(MISSING_ADDR, 0, 0, I2C_STATUS_ERROR, BusNs(1, 1)));
+
+	CHECK(I2CLibDevReadRegs(&g_sMissingDev, 0xAA, pui8Data, 2) == I2C_STATUS_ERROR);
+	CHECK(g_ui32HostLogCount == 1);
+
+	// The error stop is on the bus before the next start. With the address it stopped, it takes as
+	// long as the single byte command
+	CHECK(I2CLibDevReadRegs(&g_sBmpDev, 0xAA, pui8Data, 2) == I2C_STATUS_DONE);
+	CHECK(g_ui32HostLogCount == 3);
+	CHECK(HostBusLast(1) && HostBusLast(1)->addr == MISSING_ADDR && HostBusLast(1)->status == I2C_STATUS_ERROR);
+	CHECK(Last(BMP180_I2C_ADDRESS, 1, 2, I2C_STATUS_DONE, 2 * BusNs(1, 1) + BusNs(3, 2)));
+	CHECK((int16_t)((pui8Data[0] << 8) | pui8Data[1]) == g_pi16ExampleCal[0]);
+	CHECK(g_sMissingDev.nacks == 2 && g_sBmpDev.nacks == 0);
+}
+
+// The blocking drivers on the polled bus give the datasheet example results
+static void CheckDrivers(void){
+	tBMP180 sBmp;
+	tBMP180Cals sCals;
+	tSHT2x sSht;
+
+	Setup();
+	BMP180Initialize(&sBmp, &g_sTestBus, 0);
+	SHT21Initialize(&sSht, &g_sTestBus);
+
+	CHECK(BMP180GetCalVals(&sBmp, &sCals) == BMP180_STATUS_OK);
+	CHECK(BMP180GetTemp(&sBmp, &sCals) == BMP180_STATUS_OK && sBmp.temp >= 15.0f && sBmp.temp < 15.1f);
+	CHECK(BMP180GetPressure(&sBmp, &sCals) == BMP180_STATUS_OK && sBmp.pressure == EXAMPLE_P + 1);
+	CHECK(SHT21ReadTemperature(&sSht) == SHT21_STATUS_OK);
+	CHECK(g_sBmpModel.earlyReads == 0 && g_sShtModel.nackedReads == 0);
+	CHECK(sBmp.dev.bytes == g_sBmpModel.slave.bytes && sSht.dev.bytes == g_sShtModel.slave.bytes);
+}
+
+// A master that never finishes a command. Each attempt gives up after I2C_POLL_LOOPS checks and
+// clears the bus, and the device layer retries I2C_RETRIES times
+static void CheckTimeout(void){
+	Setup();
+	I2CLibBusPinsSet(&g_sTestBus, GPIO_PORTD_BASE, GPIO_PIN_0, GPIO_PIN_1, GPIO_PD0_I2C3SCL, GPIO_PD1_I2C3SDA);
+	HostMasterPolled(false);
+
+	CHECK(I2CLibDevCommand(&g_sShtDev, 0xF3) == I2C_STATUS_TIMEOUT);
+	CHECK(g_sShtDev.timeouts == I2C_RETRIES + 1 && g_sTestBus.recoveries == I2C_RETRIES + 1);
+	CHECK(g_ui32HostLogCount == 0);
+}
+
+int main(void){
+	HostInit();
+	CheckShapes();
+	CheckNack();
+	CheckDrivers();
+	CheckTimeout();
+	return HostResult("pollTest");
+}
@@ -0,0 +1,772 @@
+// sdModel.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	SPI mode protocol from the SD Physical Layer Simplified Specification
+//
+// Requirements:
+// 	host.c
+//
+// Description:
+// 	SDHC card on SSI0 for the diskio tests
+//
+// Notes:
+//	See sdModel.h
+//	Software that touches SSI0 DR directly is followed by leaving a marker in DR before each
+//	access. If the marker is still there at the next model call the access was a read, otherwise
+//	it was a write of the value found
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "inc/hw_memmap.h"
+#include "inc/hw_ssi.h"
+#include "inc/hw_types.h"
+#include "driverlib/gpio.h"
+#include "driverlib/rom.h"
+#include "driverlib/ssi.h"
+#include "driverlib/udma.h"
+
+#include "host.h"
+#include "sdModel.h"
+
+
+// Defines -------------------------------------------------------------------------------------------
+
+// Left in DR's top byte before software touches it
+#define SD_DR_MARK 0xA5000000
+#define SD_DR_MARK_MASK 0xFF000000
+
+#define SD_FIFO_DEPTH 8
+#define SD_CS_PIN GPIO_PIN_3
+
+// Register accesses with no frame moving before software is taken to be stuck
+#define SD_STUCK_POLLS 1000000
+
+// R1 bits
+#define SD_R1_IDLE 0x01
+#define SD_R1_ILLEGAL 0x04
+#define SD_R1_PARAM 0x40
+
+// Data tokens and data responses
+#define SD_TOKEN_SINGLE 0xFE
+#define SD_TOKEN_MULTI 0xFC
+#define SD_TOKEN_STOP 0xFD
+#define SD_DATA_ACCEPTED 0x05
+#define SD_DATA_WRITE_ERROR 0x0D
+
+// Card states
+#define SD_STATE_READY 0		// Taking commands
+#define SD_STATE_WRITE_TOKEN 1		// Waiting for a data or stop token
+#define SD_STATE_WRITE_DATA 2		// Taking a data block and its CRC
+#define SD_STATE_READ_MULTI 3		// Sending blocks until CMD12
+
+// Volume laid down by SdModelFormat: one reserved sector, two FATs, 512 root entries and one sector
+// per cluster
+#define SD_FAT_RESERVED 1
+#define SD_FAT_COPIES 2
+#define SD_FAT_ROOT_ENTRIES 512
+#define SD_FAT_ROOT_SECTORS (SD_FAT_ROOT_ENTRIES * 32 / 512)
+
+// Bytes the card can have queued to send, a data block with its token and CRC and then some
+#define SD_OUT_LEN 1024
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+uint8_t g_ppui8SdDisk[SD_MODEL_MAX_SECTORS][512];
+uint64_t g_ui64SdBusyNs;
+uint32_t g_ui32SdRejects;
+bool g_bSdDmaStall;
+
+tSdCmd g_psSdLog[SD_LOG_LEN];
+uint32_t g_ui32SdLogCount;
+uint32_t g_ui32SdBlocksRead;
+uint32_t g_ui32SdBlocksWritten;
+uint32_t g_ui32SdFrames;
+uint32_t g_ui32SdOverruns;
+uint32_t g_ui32SdEmptyReads;
+uint32_t g_ui32SdMaxDepth;
+uint32_t g_ui32SdTicks;
+uint32_t g_ui32SdSleeps;
+uint64_t g_ui64SdSleptNs;
+
+uint8_t *g_pui8SdMosi;
+uint32_t g_ui32SdMosiMax;
+uint32_t g_ui32SdMosiCount;
+
+static uint32_t g_ui32Sectors;
+static void (*g_pfnTick)(void);
+static void (*g_pfnDma)(void);
+static uint64_t g_ui64NextTick;
+static bool g_bInHandler;
+
+// Card
+static bool g_bSelected;
+static uint8_t g_ui8State;
+static bool g_bIdle;				// From CMD0 until ACMD41
+static bool g_bAppCmd;				// Last command was CMD55
+static uint8_t g_pui8Cmd[6];
+static uint8_t g_ui8CmdLen;
+static uint8_t g_pui8Out[SD_OUT_LEN];
+static uint32_t g_ui32OutHead, g_ui32OutCount;
+static bool g_bMultiWrite;
+static uint32_t g_ui32Block;			// Next block of the data phase
+static uint8_t g_pui8Data[514];			// Block being written, with its CRC
+static uint32_t g_ui32DataLen;
+static uint32_t g_ui32DataCmd;			// Log entry of the command moving data
+static uint64_t g_ui64BusyEnd;
+
+// SSI0
+static uint64_t g_ui64FrameNs = 8000000000ULL / 400000;
+static uint8_t g_pui8Rx[SD_FIFO_DEPTH];
+static uint8_t g_ui8RxHead, g_ui8RxCount;
+static bool g_bDrTouched;
+static uint32_t g_ui32Polls;			// Register accesses since a frame moved
+
+// uDMA channels, SSI0 RX then TX
+typedef struct
+{
+	uint32_t control;
+	uint8_t *src;
+	uint8_t *dst;
+	uint32_t size;
+	bool enabled;
+} tSdDma;
+
+static tSdDma g_psDma[2];
+static uint64_t g_ui64DmaEnd;			// Virtual time the block finishes, 0 if none is running
+static bool g_bDmaPending;			// SSI0 interrupt raised and not taken
+static void (*g_pfnIrq)(void);			// Interrupt from SdModelIrq, 0 once taken
+
+
+
+// "Private" Functions ------------------------------------------------------------------------------
+
+// The card ------------------------------------------------------------------------------------------
+
+static void SdOut(uint8_t data){
+	if(g_ui32OutCount < SD_OUT_LEN){
+		g_pui8Out[(g_ui32OutHead + g_ui32OutCount) % SD_OUT_LEN] = data;
+		g_ui32OutCount++;
+	}
+}
+
+static uint8_t SdR1(void){
+	return g_bIdle ? SD_R1_IDLE : 0;
+}
+
+// A data block after one byte of access time, with its token and a CRC that isn't checked
+static void SdOutBlock(const uint8_t *data, uint32_t len){
+	uint32_t i;
+
+	SdOut(0xFF);
+	SdOut(SD_TOKEN_SINGLE);
+	for(i = 0; i < len; i++){
+		SdOut(data[i]);
+	}
+	SdOut(0xFF);
+	SdOut(0xFF);
+}
+
+static void SdReadBlock(void){
+	SdOutBlock(g_ppui8SdDisk[g_ui32Block++], 512);
+	g_psSdLog[g_ui32DataCmd % SD_LOG_LEN].blocks++;
+	g_ui32SdBlocksRead++;
+}
+
+// Data response to a block once its CRC is in, then busy while it programs
+static void SdWriteDone(void){
+	if(g_ui32SdRejects || g_ui32Block >= g_ui32Sectors){
+		if(g_ui32SdRejects){
+			g_ui32SdRejects--;
+		}
+		SdOut(SD_DATA_WRITE_ERROR);
+	}else{
+		memcpy(g_ppui8SdDisk[g_ui32Block++], g_pui8Data, 512);
+		g_psSdLog[g_ui32DataCmd % SD_LOG_LEN].blocks++;
+		g_ui32SdBlocksWritten++;
+		SdOut(SD_DATA_ACCEPTED);
+		g_ui64BusyEnd = HostNs() + g_ui64SdBusyNs;
+	}
+	g_ui8State = g_bMultiWrite ? SD_STATE_WRITE_TOKEN : SD_STATE_READY;
+}
+
+static void SdCommand(void){
+	uint8_t cmd = g_pui8Cmd[0] & 0x3F;
+	uint32_t arg = ((uint32_t)g_pui8Cmd[1] << 24) | ((uint32_t)g_pui8Cmd[2] << 16) | ((uint32_t)g_pui8Cmd[3] << 8) | g_pui8Cmd[4];
+	bool bApp = g_bAppCmd;
+	tSdCmd *psLog = &g_psSdLog[g_ui32SdLogCount % SD_LOG_LEN];
+	uint8_t pui8Reg[16];
+	uint32_t size;
+
+	psLog->ns = HostNs();
+	psLog->cmd = cmd;
+	psLog->arg = arg;
+	psLog->blocks = 0;
+	g_ui32SdLogCount++;
+
+	g_bAppCmd = false;
+	if(cmd == 12){
+		g_ui32OutCount = 0;			// Stops the block being sent
+		g_ui8State = SD_STATE_READY;
+	}
+	SdOut(0xFF);					// One byte before the response
+
+	switch(cmd){
+		case 0:
+			g_bIdle = true;
+			g_ui8State = SD_STATE_READY;
+			SdOut(SdR1());
+			break;
+
+		case 8:
+			SdOut(SdR1());
+			SdOut(0x00);
+			SdOut(0x00);
+			SdOut((arg >> 8) & 0x0F);
+			SdOut(arg & 0xFF);
+			break;
+
+		case 9:
+			// CSD version 2, C_SIZE in 512kB units less one
+			memset(pui8Reg, 0, sizeof(pui8Reg));
+			size = g_ui32Sectors / 1024 - 1;
+			pui8Reg[0] = 0x40;
+			pui8Reg[7] = (size >> 16) & 0x3F;
+			pui8Reg[8] = (size >> 8) & 0xFF;
+			pui8Reg[9] = size & 0xFF;
+			SdOut(SdR1());
+			SdOutBlock(pui8Reg, 16);
+			break;
+
+		case 10:
+			memset(pui8Reg, 0, sizeof(pui8Reg));
+			SdOut(SdR1());
+			SdOutBlock(pui8Reg, 16);
+			break;
+
+		case 17:
+		case 18:
+			if(arg >= g_ui32Sectors){
+				SdOut(SdR1() | SD_R1_PARAM);
+				break;
+			}
+			SdOut(SdR1());
+			g_ui32Block = arg;
+			g_ui32DataCmd = g_ui32SdLogCount - 1;
+			if(cmd == 17){
+				SdReadBlock();
+			}else{
+				g_ui8State = SD_STATE_READ_MULTI;
+			}
+			break;
+
+		case 24:
+		case 25:
+			if(arg >= g_ui32Sectors){
+				SdOut(SdR1() | SD_R1_PARAM);
+				break;
+			}
+			SdOut(SdR1());
+			g_ui32Block = arg;
+			g_ui32DataCmd = g_ui32SdLogCount - 1;
+			g_bMultiWrite = (cmd == 25);
+			g_ui8State = SD_STATE_WRITE_TOKEN;
+			break;
+
+		case 41:
+			if(!bApp){
+				SdOut(SdR1() | SD_R1_ILLEGAL);
+				break;
+			}
+			g_bIdle = false;
+			SdOut(SdR1());
+			break;
+
+		case 55:
+			g_bAppCmd = true;
+			SdOut(SdR1());
+			break;
+
+		case 58:
+			// Powered up, CCS set for block addressing
+			SdOut(SdR1());
+			SdOut(0xC0);
+			SdOut(0xFF);
+			SdOut(0x80);
+			SdOut(0x00);
+			break;
+
+		case 12:
+		case 16:
+		case 23:
+			SdOut(SdR1());
+			break;
+
+		default:
+			SdOut(SdR1() | SD_R1_ILLEGAL);
+			break;
+	}
+}
+
+// One frame on the wire, the byte the card sends back
+static uint8_t SdCard(uint8_t mosi){
+	uint8_t miso;
+
+	if(!g_bSelected){
+		return 0xFF;
+	}
+	g_ui32SdFrames++;
+	if(g_pui8SdMosi && g_ui32SdMosiCount < g_ui32SdMosiMax){
+		g_pui8SdMosi[g_ui32SdMosiCount] = mosi;
+	}
+	g_ui32SdMosiCount++;
+
+	// What the card drives during the frame. It doesn't start another block once a command is
+	// coming in
+	if(g_ui8State == SD_STATE_READ_MULTI && !g_ui32OutCount && g_ui32Block < g_ui32Sectors && !g_ui8CmdLen && (mosi & 0xC0) != 0x40){
+		SdReadBlock();
+	}
+	if(g_ui32OutCount){
+		miso = g_pui8Out[g_ui32OutHead];
+		g_ui32OutHead = (g_ui32OutHead + 1) % SD_OUT_LEN;
+		g_ui32OutCount--;
+	}else if(HostNs() < g_ui64BusyEnd){
+		miso = 0x00;
+	}else{
+		miso = 0xFF;
+	}
+
+	// What it makes of the frame it got
+	switch(g_ui8State){
+		case SD_STATE_WRITE_TOKEN:
+			if(mosi == (g_bMultiWrite ? SD_TOKEN_MULTI : SD_TOKEN_SINGLE)){
+				g_ui8State = SD_STATE_WRITE_DATA;
+				g_ui32DataLen = 0;
+			}else if(mosi == SD_TOKEN_STOP && g_bMultiWrite){
+				g_ui8State = SD_STATE_READY;
+			}
+			break;
+
+		case SD_STATE_WRITE_DATA:
+			g_pui8Data[g_ui32DataLen++] = mosi;
+			if(g_ui32DataLen == sizeof(g_pui8Data)){
+				SdWriteDone();
+			}
+			break;
+
+		default:
+			if(g_ui8CmdLen || (mosi & 0xC0) == 0x40){
+				g_pui8Cmd[g_ui8CmdLen++] = mosi;
+				if(g_ui8CmdLen == sizeof(g_pui8Cmd)){
+					g_ui8CmdLen = 0;
+					SdCommand();
+				}
+			}
+			break;
+	}
+
+	return miso;
+}
+
+
+
+// SSI0 ----------------------------------------------------------------------------------------------
+
+// A frame written to the TX FIFO goes out at once, and its answer waits in the RX FIFO
+static void SdFrame(uint8_t mosi){
+	uint8_t miso;
+
+	HostAdvance(g_ui64FrameNs);
+	g_ui32Polls = 0;
+	miso = SdCard(mosi);
+	if(g_ui8RxCount == SD_FIFO_DEPTH){
+		g_ui32SdOverruns++;
+		return;
+	}
+	g_pui8Rx[(g_ui8RxHead + g_ui8RxCount) % SD_FIFO_DEPTH] = miso;
+	g_ui8RxCount++;
+	if(g_ui8RxCount > g_ui32SdMaxDepth){
+		g_ui32SdMaxDepth = g_ui8RxCount;
+	}
+}
+
+static uint8_t SdRxPop(void){
+	uint8_t data;
+
+	if(!g_ui8RxCount){
+		g_ui32SdEmptyReads++;
+		return 0xFF;
+	}
+	g_ui32Polls = 0;
+	data = g_pui8Rx[g_ui8RxHead];
+	g_ui8RxHead = (g_ui8RxHead + 1) % SD_FIFO_DEPTH;
+	g_ui8RxCount--;
+	return data;
+}
+
+// Act on the last direct DR access
+static void SdSettle(void){
+	uint32_t data;
+
+	if(!g_bDrTouched){
+		return;
+	}
+	g_bDrTouched = false;
+	data = *(volatile uint32_t *)(SSI0_BASE + SSI_O_DR);
+	if((data & SD_DR_MARK_MASK) == SD_DR_MARK){
+		SdRxPop();
+	}else{
+		SdFrame(data & 0xFF);
+	}
+}
+
+
+
+// Interrupts ----------------------------------------------------------------------------------------
+
+// Hardware that runs whether or not interrupts are masked
+static void SdUpdate(void){
+	if(g_ui64DmaEnd && HostNs() >= g_ui64DmaEnd){
+		g_ui64DmaEnd = 0;
+		g_psDma[0].enabled = false;
+		g_psDma[1].enabled = false;
+		g_bDmaPending = true;
+	}
+}
+
+// Take what is due, unless masked or already in a handler
+static void SdService(void){
+	void (*pfnIrq)(void);
+
+	SdUpdate();
+	if(g_bHostMasked || g_bInHandler){
+		return;
+	}
+	g_bInHandler = true;
+	if(g_pfnIrq){
+		pfnIrq = g_pfnIrq;
+		g_pfnIrq = 0;
+		pfnIrq();
+	}
+	if(g_bDmaPending){
+		g_bDmaPending = false;
+		if(g_pfnDma){
+			g_pfnDma();
+		}
+	}
+	while(HostNs() >= g_ui64NextTick){
+		g_ui64NextTick += SD_MODEL_TICK_NS;
+		g_ui32SdTicks++;
+		if(g_pfnTick){
+			g_pfnTick();
+		}
+	}
+	g_bInHandler = false;
+}
+
+static void SdModelReg(uintptr_t addr){
+	volatile uint32_t *pui32Reg = (volatile uint32_t *)addr;
+
+	SdSettle();
+	SdService();
+	if(++g_ui32Polls == SD_STUCK_POLLS){
+		printf("FAIL: polling SSI0 with nothing moving, a frame was lost\n");
+		exit(1);
+	}
+	if(addr == SSI0_BASE + SSI_O_DR){
+		*pui32Reg = SD_DR_MARK | (g_ui8RxCount ? g_pui8Rx[g_ui8RxHead] : 0);
+		g_bDrTouched = true;
+	}else if(addr == SSI0_BASE + SSI_O_SR){
+		*pui32Reg = SSI_SR_TFE | SSI_SR_TNF | (g_ui8RxCount ? SSI_SR_RNE : 0);
+	}
+}
+
+static tSdDma *SdDmaChannel(uint32_t channel){
+	switch(channel & ~UDMA_ALT_SELECT){
+		case UDMA_CHANNEL_SSI0RX:
+			return &g_psDma[0];
+		case UDMA_CHANNEL_SSI0TX:
+			return &g_psDma[1];
+		default:
+			return 0;
+	}
+}
+
+
+
+// "Public" Functions -------------------------------------------------------------------------------
+
+// A blank card of ui32Sectors (a multiple of 1024), powered up and deselected. pfnTick is run
+// every SD_MODEL_TICK_NS and pfnDma on the SSI0 interrupt, either may be 0
+void SdModelInit(uint32_t ui32Sectors, void (*pfnTick)(void), void (*pfnDma)(void)){
+	memset(g_ppui8SdDisk, 0, sizeof(g_ppui8SdDisk));
+	g_ui32Sectors = ui32Sectors > SD_MODEL_MAX_SECTORS ? SD_MODEL_MAX_SECTORS : ui32Sectors;
+	g_ui64SdBusyNs = 0;
+	g_ui32SdRejects = 0;
+	g_bSdDmaStall = false;
+
+	g_ui32SdLogCount = 0;
+	g_ui32SdBlocksRead = 0;
+	g_ui32SdBlocksWritten = 0;
+	g_ui32SdFrames = 0;
+	g_ui32SdOverruns = 0;
+	g_ui32SdEmptyReads = 0;
+	g_ui32SdMaxDepth = 0;
+	g_ui32SdTicks = 0;
+	g_ui32SdSleeps = 0;
+	g_ui64SdSleptNs = 0;
+	g_pui8SdMosi = 0;
+	g_ui32SdMosiCount = 0;
+
+	g_pfnTick = pfnTick;
+	g_pfnDma = pfnDma;
+	g_ui64NextTick = HostNs() + SD_MODEL_TICK_NS;
+	g_bInHandler = false;
+
+	g_bSelected = false;
+	g_ui8State = SD_STATE_READY;
+	g_bIdle = true;
+	g_bAppCmd = false;
+	g_ui8CmdLen = 0;
+	g_ui32OutCount = 0;
+	g_ui64BusyEnd = 0;
+
+	g_ui8RxCount = 0;
+	g_bDrTouched = false;
+	g_ui32Polls = 0;
+	memset(g_psDma, 0, sizeof(g_psDma));
+	g_ui64DmaEnd = 0;
+	g_bDmaPending = false;
+	g_pfnIrq = 0;
+
+	g_pfnHostRegHook = SdModelReg;
+}
+
+// A logged command, 0 the last one. 0 if it was dropped or never happened
+const tSdCmd *SdModelLast(uint32_t back){
+	if(back >= g_ui32SdLogCount || back >= SD_LOG_LEN){
+		return 0;
+	}
+	return &g_psSdLog[(g_ui32SdLogCount - 1 - back) % SD_LOG_LEN];
+}
+
+// Application work: the clock moves on ns, and what fell due is taken at the end unless masked
+void SdModelRun(uint64_t ns){
+	SdSettle();
+	HostAdvance(ns);
+	SdService();
+}
+
+// An interrupt is waiting to be taken
+bool SdModelPending(void){
+	SdUpdate();
+	return g_pfnIrq || g_bDmaPending || HostNs() >= g_ui64NextTick;
+}
+
+// Raise an interrupt that runs pfnIrq once, from the next model call with interrupts unmasked
+void SdModelIrq(void (*pfnIrq)(void)){
+	g_pfnIrq = pfnIrq;
+}
+
+static void SdPut16(uint8_t *dst, uint16_t val){
+	dst[0] = val & 0xFF;
+	dst[1] = val >> 8;
+}
+
+// An empty FAT16 volume over the whole card with no partition table, as FatFs's f_mkfs would lay
+// it down (ffconf.h leaves f_mkfs out). The card must be at least 4MB for the clusters to need
+// FAT16
+void SdModelFormat(void){
+	uint8_t *pui8Boot = g_ppui8SdDisk[0];
+	uint32_t fatSize, i, j;
+
+	// Two bytes per sector is more than the clusters need
+	fatSize = (g_ui32Sectors * 2 + 511) / 512;
+	for(i = 0; i < SD_FAT_RESERVED + SD_FAT_COPIES * fatSize + SD_FAT_ROOT_SECTORS; i++){
+		memset(g_ppui8SdDisk[i], 0, 512);
+	}
+
+	pui8Boot[0] = 0xEB;
+	pui8Boot[1] = 0x3C;
+	pui8Boot[2] = 0x90;
+	memcpy(&pui8Boot[3], "MSDOS5.0", 8);
+	SdPut16(&pui8Boot[11], 512);
+	pui8Boot[13] = 1;
+	SdPut16(&pui8Boot[14], SD_FAT_RESERVED);
+	pui8Boot[16] = SD_FAT_COPIES;
+	SdPut16(&pui8Boot[17], SD_FAT_ROOT_ENTRIES);
+	SdPut16(&pui8Boot[19], g_ui32Sectors);
+	pui8Boot[21] = 0xF8;
+	SdPut16(&pui8Boot[22], fatSize);
+	SdPut16(&pui8Boot[24], 63);
+	SdPut16(&pui8Boot[26], 255);
+	pui8Boot[36] = 0x80;
+	pui8Boot[38] = 0x29;
+	memcpy(&pui8Boot[43], "NO NAME    FAT16   ", 19);
+	pui8Boot[510] = 0x55;
+	pui8Boot[511] = 0xAA;
+
+	// Media byte and end of chain in the first two entries of each FAT
+	for(j = 0; j < SD_FAT_COPIES; j++){
+		i = SD_FAT_RESERVED + j * fatSize;
+		g_ppui8SdDisk[i][0] = 0xF8;
+		g_ppui8SdDisk[i][1] = 0xFF;
+		g_ppui8SdDisk[i][2] = 0xFF;
+		g_ppui8SdDisk[i][3] = 0xFF;
+	}
+}
+
+// How many of the logged commands were cmd
+uint32_t SdModelCount(uint8_t cmd){
+	uint32_t i, count = 0;
+	const tSdCmd *psCmd;
+
+	for(i = 0; (psCmd = SdModelLast(i)) != 0; i++){
+		if(psCmd->cmd == cmd){
+			count++;
+		}
+	}
+	return count;
+}
+
+
+
+// TivaWare ------------------------------------------------------------------------------------------
+
+// Whatever is due is taken before the mask goes on, as it would be just ahead of CPSID
+bool ROM_IntMasterDisable(void){
+	bool was = g_bHostMasked;
+
+	SdSettle();
+	SdService();
+	g_bHostMasked = true;
+	return was;
+}
+
+bool ROM_IntMasterEnable(void){
+	bool was = g_bHostMasked;
+
+	g_bHostMasked = false;
+	HostAdvance(SD_MODEL_SPIN_NS);
+	SdSettle();
+	SdService();
+	return was;
+}
+
+// Wait for an interrupt. A pending one, masked or not, wakes the core at once
+void ROM_SysCtlSleep(void){
+	uint64_t wake;
+
+	g_ui32SdSleeps++;
+	SdSettle();
+	SdUpdate();
+	if(!g_pfnIrq && !g_bDmaPending && HostNs() < g_ui64NextTick){
+		wake = g_ui64NextTick;
+		if(g_ui64DmaEnd && g_ui64DmaEnd < wake){
+			wake = g_ui64DmaEnd;
+		}
+		g_ui64SdSleptNs += wake - HostNs();
+		HostAdvance(wake - HostNs());
+	}
+	SdService();
+}
+
+// Deselecting drops whatever the card was still sending
+void ROM_GPIOPinWrite(uint32_t port, uint8_t pins, uint8_t value){
+	if(port == GPIO_PORTA_BASE && (pins & SD_CS_PIN)){
+		g_bSelected = !(value & SD_CS_PIN);
+		if(!g_bSelected){
+			g_ui32OutCount = 0;
+		}
+	}
+}
+
+void ROM_SSIConfigSetExpClk(uint32_t base, uint32_t clock, uint32_t protocol, uint32_t mode, uint32_t rate, uint32_t width){
+	g_ui64FrameNs = 8000000000ULL / rate;
+}
+
+void ROM_SSIDataPut(uint32_t base, uint32_t data){
+	SdSettle();
+	SdService();
+	SdFrame(data & 0xFF);
+}
+
+void ROM_SSIDataGet(uint32_t base, uint32_t *data){
+	SdSettle();
+	SdService();
+	*data = SdRxPop();
+}
+
+// Both channels move the block now, and it finishes when the wire would have taken it
+void ROM_SSIDMAEnable(uint32_t base, uint32_t flags){
+	tSdDma *psRx = &g_psDma[0], *psTx = &g_psDma[1];
+	uint32_t i;
+	uint8_t miso;
+
+	SdSettle();
+	if(g_bSdDmaStall || flags != (SSI_DMA_RX | SSI_DMA_TX) || !psRx->enabled || !psTx->enabled){
+		return;
+	}
+	for(i = 0; i < psTx->size; i++){
+		miso = SdCard(psTx->src[(psTx->control & UDMA_SRC_INC_NONE) == UDMA_SRC_INC_NONE ? 0 : i]);
+		psRx->dst[(psRx->control & UDMA_DST_INC_NONE) == UDMA_DST_INC_NONE ? 0 : i] = miso;
+	}
+	g_ui64DmaEnd = HostNs() + psTx->size * g_ui64FrameNs;
+}
+
+void ROM_uDMAChannelControlSet(uint32_t channel, uint32_t control){
+	tSdDma *psDma = SdDmaChannel(channel);
+
+	if(psDma){
+		psDma->control = control;
+	}
+}
+
+void ROM_uDMAChannelTransferSet(uint32_t channel, uint32_t mode, void *src, void *dst, uint32_t size){
+	tSdDma *psDma = SdDmaChannel(channel);
+
+	if(psDma){
+		psDma->src = src;
+		psDma->dst = dst;
+		psDma->size = size;
+	}
+}
+
+void ROM_uDMAChannelEnable(uint32_t channel){
+	tSdDma *psDma = SdDmaChannel(channel);
+
+	if(psDma){
+		psDma->enabled = true;
+	}
+}
+
+// Stopping both channels abandons the block without an interrupt
+void ROM_uDMAChannelDisable(uint32_t channel){
+	tSdDma *psDma = SdDmaChannel(channel);
+
+	if(psDma){
+		psDma->enabled = false;
+	}
+	if(!g_psDma[0].enabled && !g_psDma[1].enabled){
+		g_ui64DmaEnd = 0;
+	}
+}
+
+bool ROM_uDMAChannelIsEnabled(uint32_t channel){
+	tSdDma *psDma = SdDmaChannel(channel);
+
+	SdUpdate();
+	return psDma && psDma->enabled;
+}
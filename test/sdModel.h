@@ -0,0 +1,105 @@
+// sdModel.h
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	SPI mode protocol from the SD Physical Layer Simplified Specification
+//
+// Requirements:
+// 	host.h
+//
+// Description:
+// 	SDHC card on SSI0 for the diskio tests: the card's SPI protocol over a RAM disk, the SSI0
+//	FIFOs, the two uDMA channels diskio uses, and the 10ms tick and SSI0 interrupts
+//
+// Notes:
+//	The card answers CMD0, 8, 9, 10, 12, 16, 17, 18, 24, 25, 55, 58 and ACMD23 and 41 as a
+//	block addressed SDHC card. It ignores the bus while CS (PA3) is high, and raising CS drops
+//	what it was still sending. Each data block it accepts leaves it busy for g_ui64SdBusyNs,
+//	holding DO low. While g_ui32SdRejects is non-zero each data block written is answered with a
+//	write error and counted down instead of stored
+//	Every frame on the wire takes 8 bits of the rate ROM_SSIConfigSetExpClk set on the virtual
+//	clock. The TX FIFO drains at once, so the frames in flight are the ones in the RX FIFO.
+//	Software that reads and writes SSI0 DR directly is followed through g_pfnHostRegHook, and a
+//	frame written with the RX FIFO full is counted as an overrun. Software still polling SSI0
+//	SD_STUCK_POLLS accesses after the last frame moved has lost one, and the test is stopped
+//	A uDMA block moves when ROM_SSIDMAEnable starts it and finishes at the time the wire would
+//	take. Its channels stay enabled until then, and then the SSI0 interrupt is raised. With
+//	g_bSdDmaStall set a block never starts
+//	The tick and SSI0 handlers given to SdModelInit are run, like interrupts, from the next model
+//	call with interrupts unmasked once they are due. ROM_SysCtlSleep returns at once if one is
+//	pending, even masked, and otherwise moves the clock on to the next. Unmasking takes
+//	SD_MODEL_SPIN_NS, so a wait that spins with no idle hook still sees time pass
+//	SdModelIrq raises a one-off interrupt the same way. ROM_IntMasterDisable takes what is due
+//	before masking, as an interrupt arriving just ahead of it would be
+//	SdModelRun stands for application work in an idle hook. An interrupt that falls due during
+//	it is taken then if interrupts are unmasked, which is what loses a wakeup before a sleep
+//	SdModelFormat lays an empty FAT16 volume, with no partition table, over the whole card
+//
+//****************************************************************************************************
+
+#ifndef SDMODEL_H
+#define SDMODEL_H
+
+
+// Defines -------------------------------------------------------------------------------------------
+
+// Largest card, 8MB. Cards come in whole 512kB units of the CSD size field
+#define SD_MODEL_MAX_SECTORS 16384
+
+// Tick period and CPU time of one unmask
+#define SD_MODEL_TICK_NS 10000000
+#define SD_MODEL_SPIN_NS 1000
+
+// Commands kept in g_psSdLog, older ones are counted but dropped
+#define SD_LOG_LEN 256
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+
+// One command as the card took it
+typedef struct
+{
+	uint64_t ns;			// Virtual time it was taken
+	uint8_t cmd;			// Command index, 41 for ACMD41
+	uint32_t arg;
+	uint16_t blocks;		// Data blocks moved by it
+} tSdCmd;
+
+extern uint8_t g_ppui8SdDisk[SD_MODEL_MAX_SECTORS][512];
+extern uint64_t g_ui64SdBusyNs;
+extern uint32_t g_ui32SdRejects;
+extern bool g_bSdDmaStall;
+
+extern tSdCmd g_psSdLog[SD_LOG_LEN];
+extern uint32_t g_ui32SdLogCount;		// Commands since SdModelInit
+extern uint32_t g_ui32SdBlocksRead;		// Data blocks sent and stored by the card
+extern uint32_t g_ui32SdBlocksWritten;
+extern uint32_t g_ui32SdFrames;			// Frames on the wire with CS low
+extern uint32_t g_ui32SdOverruns;		// Frames lost to a full RX FIFO
+extern uint32_t g_ui32SdEmptyReads;		// Reads of an empty RX FIFO
+extern uint32_t g_ui32SdMaxDepth;		// Most frames in flight
+extern uint32_t g_ui32SdTicks;
+extern uint32_t g_ui32SdSleeps;			// ROM_SysCtlSleep calls
+extern uint64_t g_ui64SdSleptNs;		// Time they slept
+
+// If set, the first g_ui32SdMosiMax bytes the card receives from here on are kept
+extern uint8_t *g_pui8SdMosi;
+extern uint32_t g_ui32SdMosiMax;
+extern uint32_t g_ui32SdMosiCount;
+
+
+
+// Function Prototypes -------------------------------------------------------------------------------
+extern void SdModelInit(uint32_t ui32Sectors, void (*pfnTick)(void), void (*pfnDma)(void));
+extern const tSdCmd *SdModelLast(uint32_t back);
+extern uint32_t SdModelCount(uint8_t cmd);
+extern void SdModelRun(uint64_t ns);
+extern bool SdModelPending(void);
+extern void SdModelIrq(void (*pfnIrq)(void));
+extern void SdModelFormat(void);
+
+#endif
@@ -0,0 +1,410 @@
+// sensorModel.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	Register maps and timings from the Bosch BMP180, Sensirion SHT21 and Intersil ISL29023 datasheets
+//
+// Requirements:
+// 	host.c, i2cModel.c
+//
+// Description:
+// 	I2C slave models of the SensorHub BoosterPack sensors for the host tests
+//
+// Notes:
+//	See sensorModel.h
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "host.h"
+#include "i2cLib.h"
+#include "i2cModel.h"
+#include "sensorModel.h"
+
+
+// Defines -------------------------------------------------------------------------------------------
+#define BMP_MODEL_ADDR 0x77
+#define BMP_MODEL_CAL 0xAA
+#define BMP_MODEL_CHIPID 0xD0
+#define BMP_MODEL_CONTROL 0xF4
+#define BMP_MODEL_OUT 0xF6
+#define BMP_MODEL_SCO 0x20		// Start of conversion bit, set until the conversion finishes
+
+#define SHT_MODEL_ADDR 0x40
+#define SHT_MODEL_TEMP 0xF3
+#define SHT_MODEL_HUM 0xF5
+#define SHT_MODEL_WRITE_USER 0xE6
+#define SHT_MODEL_READ_USER 0xE7
+#define SHT_MODEL_RESET 0xFE
+#define SHT_MODEL_RESERVED 0x38		// User register bits 3 to 5
+#define SHT_MODEL_USER_DEFAULT 0x3A	// Power on value, reserved bits and OTP reload disable set
+
+#define ISL_MODEL_ADDR 0x44
+#define ISL_MODEL_COMMANDI 0
+#define ISL_MODEL_COMMANDII 1
+#define ISL_MODEL_MODE 0xE0		// Command I operation mode
+#define ISL_MODEL_ONEALS 0x20
+#define ISL_MODEL_ONEIR 0x40
+#define ISL_MODEL_CONTALS 0xA0
+#define ISL_MODEL_CONTIR 0xC0
+#define ISL_MODEL_INTFLAG 0x04
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+
+// BMP180 pressure conversion times in ns for oss 0 to 3
+static const uint32_t g_pui32BmpPresNs[4] = {4500000, 7500000, 13500000, 25500000};
+
+// SHT21 maximum measurement times in ms, indexed by user register bits 7 and 0
+static const uint8_t g_pui8ShtTempMs[4] = {85, 22, 43, 11};		// 14, 12, 13, 11 bit
+static const uint8_t g_pui8ShtHumMs[4] = {29, 4, 9, 15};		// 12, 8, 10, 11 bit
+
+// ISL29023 full scale lux, counts, IR counts per unit at 16 bit and conversion ns, indexed by the
+// command II range and resolution fields
+static const uint32_t g_pui32IslRange[4] = {1000, 4000, 16000, 64000};
+static const uint32_t g_pui32IslCounts[4] = {65536, 4096, 256, 16};
+static const double g_pdIslBeta[4] = {95.238, 23.810, 5.952, 1.486};
+static const uint32_t g_pui32IslConvNs[4] = {90000000, 5600000, 350000, 22000};
+
+// Readings outside the window before INT, indexed by the command I persistence field
+static const uint8_t g_pui8IslPersist[4] = {1, 4, 8, 16};
+
+
+
+// BMP180 --------------------------------------------------------------------------------------------
+
+// Latch a finished conversion into the result registers
+static void BmpModelUpdate(tBmpModel *psModel){
+	if(psModel->convEnd && HostNs() >= psModel->convEnd){
+		psModel->out[0] = psModel->next[0];
+		psModel->out[1] = psModel->next[1];
+		psModel->out[2] = psModel->next[2];
+		psModel->control &= ~BMP_MODEL_SCO;
+		psModel->convEnd = 0;
+	}
+}
+
+static void BmpModelCommand(tBmpModel *psModel, uint8_t command){
+	uint8_t oss = command >> 6;
+	uint32_t raw;
+
+	BmpModelUpdate(psModel);
+	psModel->control = command;
+	if(command == 0x2E){
+		psModel->next[0] = psModel->ut >> 8;
+		psModel->next[1] = psModel->ut;
+		psModel->next[2] = 0;
+		psModel->convEnd = HostNs() + BMP_MODEL_TEMP_NS;
+	} else if((command & 0x3F) == 0x34){
+		raw = psModel->up << (8 - oss);
+		psModel->next[0] = raw >> 16;
+		psModel->next[1] = raw >> 8;
+		psModel->next[2] = raw;
+		psModel->convEnd = HostNs() + g_pui32BmpPresNs[oss];
+	} else{
+		return;
+	}
+	psModel->control |= BMP_MODEL_SCO;
+	psModel->conversions++;
+}
+
+static uint8_t BmpModelReg(tBmpModel *psModel, uint8_t reg){
+	if(reg >= BMP_MODEL_CAL && reg < BMP_MODEL_CAL + 22){
+		uint16_t word = psModel->cal[(reg - BMP_MODEL_CAL) / 2];
+
+		return ((reg - BMP_MODEL_CAL) & 1) ? (uint8_t)word : (uint8_t)(word >> 8);
+	}
+	switch(reg){
+		case BMP_MODEL_CHIPID:
+			return 0x55;
+		case BMP_MODEL_CONTROL:
+			return psModel->control;
+		case BMP_MODEL_OUT:
+		case BMP_MODEL_OUT + 1:
+		case BMP_MODEL_OUT + 2:
+			return psModel->out[reg - BMP_MODEL_OUT];
+		default:
+			return 0;
+	}
+}
+
+// First byte sets the register pointer, the rest are written from there
+static bool BmpModelWrite(tHostSlave *psSlave, const uint8_t *data, uint8_t len){
+	tBmpModel *psModel = (tBmpModel *)psSlave;
+	uint8_t i;
+
+	psModel->reg = data[0];
+	for(i = 1; i < len; i++, psModel->reg++){
+		if(psModel->reg == BMP_MODEL_CONTROL){
+			BmpModelCommand(psModel, data[i]);
+		}
+	}
+	return true;
+}
+
+static bool BmpModelRead(tHostSlave *psSlave, uint8_t *data, uint8_t len){
+	tBmpModel *psModel = (tBmpModel *)psSlave;
+	uint8_t i;
+
+	BmpModelUpdate(psModel);
+	if(psModel->convEnd && psModel->reg >= BMP_MODEL_OUT && psModel->reg <= BMP_MODEL_OUT + 2){
+		psModel->earlyReads++;
+	}
+	for(i = 0; i < len; i++, psModel->reg++){
+		data[i] = BmpModelReg(psModel, psModel->reg);
+	}
+	return true;
+}
+
+// cal holds AC1 to MD in datasheet order
+void BmpModelInit(tBmpModel *psModel, const int16_t *cal, uint16_t ut, uint32_t up){
+	uint8_t i;
+
+	psModel->slave.addr = BMP_MODEL_ADDR;
+	psModel->slave.write = BmpModelWrite;
+	psModel->slave.read = BmpModelRead;
+	for(i = 0; i < 11; i++){
+		psModel->cal[i] = (uint16_t)cal[i];
+	}
+	psModel->ut = ut;
+	psModel->up = up;
+	psModel->reg = 0;
+	psModel->control = 0;
+	psModel->out[0] = 0x80;
+	psModel->out[1] = 0;
+	psModel->out[2] = 0;
+	psModel->convEnd = 0;
+	psModel->conversions = 0;
+	psModel->earlyReads = 0;
+}
+
+
+
+// SHT21 ---------------------------------------------------------------------------------------------
+
+// Datasheet CRC-8, polynomial 0x31 and initial value 0, one bit at a time
+uint8_t ShtModelCrc(const uint8_t *data, uint8_t len){
+	uint8_t crc = 0;
+	uint8_t i, bit;
+
+	for(i = 0; i < len; i++){
+		crc ^= data[i];
+		for(bit = 0; bit < 8; bit++){
+			crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+		}
+	}
+	return crc;
+}
+
+static bool ShtModelWrite(tHostSlave *psSlave, const uint8_t *data, uint8_t len){
+	tShtModel *psModel = (tShtModel *)psSlave;
+	uint8_t res = ((psModel->userReg >> 6) & 0x02) | (psModel->userReg & 0x01);
+
+	psModel->userRead = false;
+	switch(data[0]){
+		case SHT_MODEL_TEMP:
+		case SHT_MODEL_HUM:
+			psModel->command = data[0];
+			psModel->convEnd = HostNs() + 1000000ULL * ((data[0] == SHT_MODEL_TEMP) ? g_pui8ShtTempMs[res] : g_pui8ShtHumMs[res]);
+			psModel->conversions++;
+			return len == 1;
+		case SHT_MODEL_READ_USER:
+			psModel->userRead = true;
+			return len == 1;
+		case SHT_MODEL_WRITE_USER:
+			if(len != 2){
+				return false;
+			}
+			if((data[1] ^ psModel->userReg) & SHT_MODEL_RESERVED){
+				psModel->reservedWrites++;
+			}
+			psModel->userReg = data[1];
+			return true;
+		case SHT_MODEL_RESET:
+			psModel->userReg = SHT_MODEL_USER_DEFAULT;
+			psModel->command = 0;
+			return len == 1;
+		default:
+			return false;
+	}
+}
+
+static bool ShtModelRead(tHostSlave *psSlave, uint8_t *data, uint8_t len){
+	tShtModel *psModel = (tShtModel *)psSlave;
+	uint8_t result[3];
+	uint16_t raw;
+	uint8_t i;
+
+	if(psModel->userRead){
+		for(i = 0; i < len; i++){
+			data[i] = psModel->userReg;
+		}
+		return true;
+	}
+
+	if(psModel->command == 0 || HostNs() < psModel->convEnd){
+		psModel->nackedReads++;
+		return false;
+	}
+
+	// Status bit 1 is set for humidity, bit 0 is unused
+	raw = (psModel->command == SHT_MODEL_TEMP) ? (psModel->tempRaw & 0xFFFC) : ((psModel->humRaw & 0xFFFC) | 0x02);
+	result[0] = raw >> 8;
+	result[1] = raw;
+	result[2] = ShtModelCrc(result, 2);
+	if(psModel->badCrcs){
+		psModel->badCrcs--;
+		result[2] ^= 0x01;
+	}
+	psModel->command = 0;
+
+	for(i = 0; i < len && i < 3; i++){
+		data[i] = result[i];
+	}
+	return true;
+}
+
+void ShtModelInit(tShtModel *psModel, uint16_t tempRaw, uint16_t humRaw){
+	psModel->slave.addr = SHT_MODEL_ADDR;
+	psModel->slave.write = ShtModelWrite;
+	psModel->slave.read = ShtModelRead;
+	psModel->tempRaw = tempRaw;
+	psModel->humRaw = humRaw;
+	psModel->userReg = SHT_MODEL_USER_DEFAULT;
+	psModel->command = 0;
+	psModel->userRead = false;
+	psModel->convEnd = 0;
+	psModel->badCrcs = 0;
+	psModel->conversions = 0;
+	psModel->nackedReads = 0;
+	psModel->reservedWrites = 0;
+}
+
+
+
+// ISL29023 ------------------------------------------------------------------------------------------
+
+static uint32_t IslModelConvNs(tIslModel *psModel){
+	return g_pui32IslConvNs[(psModel->regs[ISL_MODEL_COMMANDII] >> 2) & 3];
+}
+
+// Reading of the conversion finishing at ns, clipped to full scale
+static uint16_t IslModelReading(tIslModel *psModel, uint64_t ns){
+	uint8_t range = psModel->regs[ISL_MODEL_COMMANDII] & 3;
+	uint32_t counts = g_pui32IslCounts[(psModel->regs[ISL_MODEL_COMMANDII] >> 2) & 3];
+	uint8_t mode = psModel->regs[ISL_MODEL_COMMANDI] & ISL_MODEL_MODE;
+	double reading;
+
+	if(mode == ISL_MODEL_ONEIR || mode == ISL_MODEL_CONTIR){
+		reading = psModel->ir * g_pdIslBeta[range] * counts / 65536.0;
+	} else{
+		reading = (psModel->trace ? psModel->trace(ns) : psModel->lux) * counts / g_pui32IslRange[range];
+	}
+	return (reading >= counts - 1) ? counts - 1 : (reading > 0 ? (uint16_t)reading : 0);
+}
+
+// Finish every conversion due by now. One-shot modes power down after their conversion.
+// Continuous ALS readings outside the window for the persistence count set the interrupt flag
+static void IslModelUpdate(tIslModel *psModel){
+	uint8_t *regs = psModel->regs;
+	uint16_t reading, low, high;
+
+	while(psModel->convEnd && HostNs() >= psModel->convEnd){
+		reading = IslModelReading(psModel, psModel->convEnd);
+		regs[2] = reading;
+		regs[3] = reading >> 8;
+		psModel->conversions++;
+
+		if(!(regs[ISL_MODEL_COMMANDI] & 0x80)){
+			regs[ISL_MODEL_COMMANDI] &= ~ISL_MODEL_MODE;
+			psModel->convEnd = 0;
+			break;
+		}
+
+		low = regs[4] | (regs[5] << 8);
+		high = regs[6] | (regs[7] << 8);
+		if(reading < low || reading > high){
+			if(psModel->outside < 0xFF){
+				psModel->outside++;
+			}
+		} else{
+			psModel->outside = 0;
+		}
+		if(psModel->outside >= g_pui8IslPersist[regs[ISL_MODEL_COMMANDI] & 3]){
+			regs[ISL_MODEL_COMMANDI] |= ISL_MODEL_INTFLAG;
+		}
+		psModel->convEnd += IslModelConvNs(psModel);
+	}
+}
+
+// First byte sets the register pointer, the rest are written from there. Writing command I
+// starts the mode written and clears the interrupt flag if its bit is written as 0
+static bool IslModelWrite(tHostSlave *psSlave, const uint8_t *data, uint8_t len){
+	tIslModel *psModel = (tIslModel *)psSlave;
+	uint8_t i;
+
+	IslModelUpdate(psModel);
+	psModel->reg = data[0];
+	for(i = 1; i < len; i++, psModel->reg++){
+		if(psModel->reg > 7){
+			return false;
+		}
+		psModel->regs[psModel->reg] = data[i];
+		if(psModel->reg == ISL_MODEL_COMMANDI){
+			psModel->outside = 0;
+			psModel->convEnd = (data[i] & ISL_MODEL_MODE) ? HostNs() + IslModelConvNs(psModel) : 0;
+		}
+	}
+	return true;
+}
+
+static bool IslModelRead(tHostSlave *psSlave, uint8_t *data, uint8_t len){
+	tIslModel *psModel = (tIslModel *)psSlave;
+	uint8_t i;
+
+	IslModelUpdate(psModel);
+	if(psModel->convEnd && !(psModel->regs[ISL_MODEL_COMMANDI] & 0x80) && psModel->reg <= 3 && psModel->reg + len > 2){
+		psModel->earlyReads++;
+	}
+	for(i = 0; i < len; i++, psModel->reg++){
+		data[i] = (psModel->reg < 8) ? psModel->regs[psModel->reg] : 0;
+	}
+	return true;
+}
+
+void IslModelInit(tIslModel *psModel, double lux, double ir){
+	uint8_t i;
+
+	psModel->slave.addr = ISL_MODEL_ADDR;
+	psModel->slave.write = IslModelWrite;
+	psModel->slave.read = IslModelRead;
+	psModel->lux = lux;
+	psModel->ir = ir;
+	psModel->trace = 0;
+	psModel->reg = 0;
+	for(i = 0; i < 8; i++){
+		psModel->regs[i] = 0;
+	}
+
+	// Power on window is the whole scale
+	psModel->regs[6] = 0xFF;
+	psModel->regs[7] = 0xFF;
+	psModel->convEnd = 0;
+	psModel->outside = 0;
+	psModel->conversions = 0;
+	psModel->earlyReads = 0;
+}
+
+// State of the INT pin after every conversion due by now, true when pulled low
+bool IslModelInt(tIslModel *psModel){
+	IslModelUpdate(psModel);
+	return (psModel->regs[ISL_MODEL_COMMANDI] & ISL_MODEL_INTFLAG) != 0;
+}
@@ -0,0 +1,105 @@
+// sensorModel.h
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	Register maps and timings from the Bosch BMP180, Sensirion SHT21 and Intersil ISL29023 datasheets
+//
+// Requirements:
+// 	host.h, i2cModel.h
+//
+// Description:
+// 	I2C slave models of the SensorHub BoosterPack sensors for the host tests
+//
+// Notes:
+//	Include i2cLib.h and i2cModel.h before this file
+//	Register each model with HostSlaveAdd after its init function
+//	Conversions take the datasheet maximum time on the virtual clock. A BMP180 result read before
+//	its conversion has finished returns the previous result and is counted in earlyReads. The
+//	SHT21 NACKs a no-hold result read until the conversion has finished, as the part does
+//	The ISL29023 converts only when its registers are touched or IslModelInt is called, catching
+//	up on every continuous conversion since. Poll IslModelInt in place of the INT GPIO
+//
+//****************************************************************************************************
+
+#ifndef SENSORMODEL_H
+#define SENSORMODEL_H
+
+
+// Defines -------------------------------------------------------------------------------------------
+
+// BMP180 temperature conversion time in ns
+#define BMP_MODEL_TEMP_NS 4500000
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+
+// BMP180. ut and up are returned by the next temperature and pressure conversions, up as the
+// datasheet UP for the oversampling setting that was asked for
+typedef struct
+{
+	tHostSlave slave;
+	uint16_t cal[11];		// AC1 to MD as read from the part
+	uint16_t ut;
+	uint32_t up;
+
+	uint8_t reg;			// Register pointer
+	uint8_t control;
+	uint8_t out[3];			// Result registers 0xF6 to 0xF8
+	uint8_t next[3];		// Result of the running conversion
+	uint64_t convEnd;		// Virtual time the running conversion finishes
+	uint32_t conversions;
+	uint32_t earlyReads;
+} tBmpModel;
+
+
+// SHT21, no-hold measurements only. tempRaw and humRaw are the results of the next measurements,
+// the status bits are filled in by the model
+typedef struct
+{
+	tHostSlave slave;
+	uint16_t tempRaw;
+	uint16_t humRaw;
+	uint8_t userReg;
+
+	uint8_t command;		// Measurement running or finished but not read, 0 if none
+	bool userRead;			// Next read returns the user register
+	uint64_t convEnd;
+	uint8_t badCrcs;		// Results still to be sent with a corrupted CRC
+	uint32_t conversions;
+	uint32_t nackedReads;		// Result reads refused because the conversion hadn't finished
+	uint32_t reservedWrites;	// User register writes that changed a reserved bit
+} tShtModel;
+
+
+
+// ISL29023. lux and ir are the light the next conversions see, ir in the units of the driver's IR
+// result. If trace is set it gives lux at the virtual time a conversion finishes instead
+typedef struct
+{
+	tHostSlave slave;
+	double lux;
+	double ir;
+	double (*trace)(uint64_t ns);
+
+	uint8_t reg;			// Register pointer
+	uint8_t regs[8];
+	uint64_t convEnd;		// Virtual time the running conversion finishes, 0 if none
+	uint8_t outside;		// Consecutive continuous readings outside the window
+	uint32_t conversions;
+	uint32_t earlyReads;		// One-shot result reads before the conversion had finished
+} tIslModel;
+
+
+
+// Function Prototypes -------------------------------------------------------------------------------
+extern void BmpModelInit(tBmpModel *psModel, const int16_t *cal, uint16_t ut, uint32_t up);
+extern void ShtModelInit(tShtModel *psModel, uint16_t tempRaw, uint16_t humRaw);
+extern uint8_t ShtModelCrc(const uint8_t *data, uint8_t len);
+extern void IslModelInit(tIslModel *psModel, double lux, double ir);
+extern bool IslModelInt(tIslModel *psModel);
+
+#endif
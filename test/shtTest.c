@@ -0,0 +1,309 @@
+// shtTest.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	CRC check values from the Sensirion SHT21 datasheet and CRC application note
+//
+// Requirements:
+// 	See host.h
+//
+// Description:
+// 	Checks shtLib against the SHT21 model on the host I2C backend
+//
+// Notes:
+//	shtLib.c is included so the checks can reach its helpers. Built twice by the Makefile, as
+//	shtTest and with SHT21_FIXED_POINT as shtTestFixed
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include <math.h>
+#include <stdlib.h>
+
+#include "host.h"
+#include "../SHT21/shtLib.c"
+#include "bmpLib.h"
+#include "i2cModel.h"
+#include "sensorModel.h"
+
+
+// Defines -------------------------------------------------------------------------------------------
+
+// About 24.7 C and 42.5 %RH
+#define MODEL_TEMP 0x6A3C
+#define MODEL_HUM 0x6060
+
+// User register with an unusual reserved pattern, so a write of the defaults would show
+#define MODEL_USER 0x12
+#define USER_RESERVED 0x38
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+// The conversion result of either build, for checks that only compare it with itself
+#ifdef SHT21_FIXED_POINT
+#define TEMP(p) ((p)->tempCenti)
+#else
+#define TEMP(p) ((p)->temp)
+#endif
+
+// Datasheet maximum measurement times in ms, indexed by SHT21ResIndex
+static const uint8_t g_pui8DatasheetTempMs[4] = {85, 22, 43, 11};
+static const uint8_t g_pui8DatasheetHumMs[4] = {29, 4, 9, 15};
+
+static tI2CBus g_sBus;
+static tShtModel g_sModel;
+static tSHT2x g_sSht;
+
+static const int16_t g_pi16BmpCal[11] = {408, -72, -14383, (int16_t)32741, (int16_t)32757, (int16_t)23153, 6190, 4, -32768, -8711, 2868};
+static tBmpModel g_sBmpModel;
+static tBMP180 g_sBmp;
+
+
+
+// Functions -----------------------------------------------------------------------------------------
+
+// Fresh bus, model and instance
+static void Setup(void){
+	HostBusReset();
+	ShtModelInit(&g_sModel, MODEL_TEMP, MODEL_HUM);
+	HostSlaveAdd(&g_sModel.slave);
+	I2CLibBusInit(&g_sBus, I2C3_BASE, &g_sHostBackend);
+	SHT21Initialize(&g_sSht, &g_sBus);
+}
+
+// The table against the datasheet vectors and a bit at a time CRC over every two byte reading
+static void CheckCrc(void){
+	uint8_t pui8Data[2];
+	uint32_t i, mismatches = 0;
+
+	CHECK(g_pui8Crc8Table[0xDC] == 0x79);
+	CHECK(SHT21Crc(0x68, 0x3A) == 0x7C);
+	CHECK(SHT21Crc(0x4E, 0x85) == 0x6B);
+
+	for(i = 0; i < 0x10000; i++){
+		pui8Data[0] = i >> 8;
+		pui8Data[1] = i;
+		if(SHT21Crc(pui8Data[0], pui8Data[1]) != ShtModelCrc(pui8Data, 2)){
+			mismatches++;
+		}
+	}
+	CHECK(mismatches == 0);
+}
+
+// A corrupted reading is measured again. After SHT21_RETRIES more failures the last good value is
+// kept. Every mismatch is reported to the device layer
+static void CheckCrcRetry(void){
+	double temp;
+
+	Setup();
+	CHECK(SHT21ReadTemperature(&g_sSht) == SHT21_STATUS_OK);
+	CHECK(g_sSht.tempRaw == (MODEL_TEMP & 0xFFFC) && g_sModel.conversions == 1);
+	temp = TEMP(&g_sSht);
+
+	g_sModel.tempRaw = MODEL_TEMP + 0x100;
+	g_sModel.badCrcs = 1;
+	CHECK(SHT21ReadTemperature(&g_sSht) == SHT21_STATUS_OK);
+	CHECK(g_sModel.conversions == 3 && g_sSht.dev.faults == 1);
+	CHECK(g_sSht.tempRaw == ((MODEL_TEMP + 0x100) & 0xFFFC));
+
+	TEMP(&g_sSht) = temp;
+	g_sModel.badCrcs = SHT21_RETRIES + 1;
+	CHECK(SHT21ReadTemperature(&g_sSht) == SHT21_STATUS_CRC_ERROR);
+	CHECK(g_sModel.conversions == 3 + SHT21_RETRIES + 1 && g_sSht.dev.faults == 1 + SHT21_RETRIES + 1);
+	CHECK(TEMP(&g_sSht) == temp);
+
+	// Humidity takes the same path
+	g_sModel.badCrcs = 1;
+	CHECK(SHT21ReadHumidity(&g_sSht) == SHT21_STATUS_OK);
+	CHECK(g_sSht.humRaw == ((MODEL_HUM & 0xFFFC) | 0x02));
+
+	// No reading was NACKed, the waits cover the conversions
+	CHECK(g_sModel.nackedReads == 0);
+}
+
+// Service the SHT21, and the BMP180 when bBmp is set, every 100 us with the bus finishing queued
+// transactions in between, until the SHT21 reports humidity or an error. Returns that event and
+// counts the other events
+static uint8_t RunSample(bool bBmp, uint8_t *pui8Temps, uint8_t *pui8Pressures){
+	static tBMP180Cals sCal = {408, -72, -14383, 32741, 32757, 23153, 6190, 4, -32768, -8711, 2868};
+	uint32_t start = HostMs();
+	uint8_t event;
+
+	*pui8Temps = 0;
+	*pui8Pressures = 0;
+	while(HostMs() - start < 1000){
+		HostBusRun();
+		if(bBmp && BMP180Service(&g_sBmp, &sCal, HostMs()) == BMP180_EVENT_PRESSURE){
+			(*pui8Pressures)++;
+		}
+		event = SHT21Service(&g_sSht, HostMs());
+		if(event == SHT21_EVENT_TEMP){
+			(*pui8Temps)++;
+		} else if(event != SHT21_EVENT_NONE){
+			return event;
+		}
+		HostAdvance(100000);
+	}
+	return SHT21_EVENT_NONE;
+}
+
+// The split-phase sample puts F3, a 3 byte read, F5 and a 3 byte read on the bus, never reads
+// before the conversion has finished and reads within a tick and a service period of the wait.
+// The bus stays free for other sensors meanwhile
+static void CheckSplitPhase(void){
+	const tHostTrans *psTrans[4];
+	uint64_t start, alone;
+	uint8_t temps, pressures, i;
+
+	Setup();
+	g_bHostBusDefer = true;
+	start = HostNs();
+	CHECK(SHT21StartSample(&g_sSht));
+	CHECK(!SHT21StartSample(&g_sSht) && !SHT21StartTemp(&g_sSht) && !SHT21StartHumidity(&g_sSht));
+	CHECK(RunSample(false, &temps, &pressures) == SHT21_EVENT_HUMIDITY && temps == 1);
+	alone = HostNs() - start;
+	CHECK(g_sSht.tempRaw == (MODEL_TEMP & 0xFFFC) && g_sSht.humRaw == ((MODEL_HUM & 0xFFFC) | 0x02));
+
+	CHECK(g_ui32HostLogCount == 4);
+	for(i = 0; i < 4; i++){
+		psTrans[i] = HostBusLast(3 - i);
+	}
+	CHECK(psTrans[0]->txLen == 1 && psTrans[0]->tx[0] == SHT21_TEMP_NOBLOCK && psTrans[0]->rxLen == 0);
+	CHECK(psTrans[1]->txLen == 0 && psTrans[1]->rxLen == 3);
+	CHECK(psTrans[2]->txLen == 1 && psTrans[2]->tx[0] == SHT21_HUM_NOBLOCK && psTrans[2]->rxLen == 0);
+	CHECK(psTrans[3]->txLen == 0 && psTrans[3]->rxLen == 3);
+	CHECK(g_sModel.nackedReads == 0);
+	CHECK(psTrans[1]->ns - psTrans[0]->ns <= (g_pui8TempWaitMs[0] + 1) * 1000000ULL + 200000);
+	CHECK(psTrans[3]->ns - psTrans[2]->ns <= (g_pui8HumWaitMs[0] + 1) * 1000000ULL + 200000);
+
+	// A BMP180 sample started alongside finishes inside the temperature conversion and doesn't
+	// hold up the SHT21
+	Setup();
+	g_bHostBusDefer = true;
+	BmpModelInit(&g_sBmpModel, g_pi16BmpCal, 27898, 23843 << 3);
+	HostSlaveAdd(&g_sBmpModel.slave);
+	BMP180Initialize(&g_sBmp, &g_sBus, 3);
+	start = HostNs();
+	CHECK(SHT21StartSample(&g_sSht));
+	CHECK(BMP180StartSample(&g_sBmp, HostMs()));
+	CHECK(RunSample(true, &temps, &pressures) == SHT21_EVENT_HUMIDITY && temps == 1 && pressures == 1);
+	CHECK(HostNs() - start <= alone + 1000000);
+	CHECK(g_ui32HostLogCount == 8 && g_psHostLog[0].addr == SHT21_I2C_ADDRESS);
+	for(i = 1; i < 5; i++){
+		CHECK(g_psHostLog[i].addr == BMP180_I2C_ADDRESS);
+	}
+	CHECK(g_psHostLog[4].rxLen == 3 && g_psHostLog[5].addr == SHT21_I2C_ADDRESS && g_psHostLog[5].rxLen == 3);
+	CHECK(g_psHostLog[5].ns - g_psHostLog[0].ns <= (g_pui8TempWaitMs[0] + 1) * 1000000ULL + 200000);
+	CHECK(g_sBmpModel.earlyReads == 0 && g_sModel.nackedReads == 0);
+
+	// A bad CRC is measured again without an event, a failed read ends the sample
+	Setup();
+	g_bHostBusDefer = true;
+	g_sModel.badCrcs = 1;
+	CHECK(SHT21StartSample(&g_sSht));
+	CHECK(RunSample(false, &temps, &pressures) == SHT21_EVENT_HUMIDITY && temps == 1);
+	CHECK(g_sModel.conversions == 3 && g_sSht.dev.faults == 1);
+	g_sModel.badCrcs = SHT21_RETRIES + 1;
+	CHECK(SHT21StartSample(&g_sSht));
+	CHECK(RunSample(false, &temps, &pressures) == SHT21_EVENT_ERROR && temps == 0);
+	CHECK(g_sSht.state == SHT21_STATE_IDLE && !g_sSht.chainHum);
+	HostBusFault(I2C_STATUS_ERROR, 1, 1);
+	CHECK(SHT21StartSample(&g_sSht));
+	CHECK(RunSample(false, &temps, &pressures) == SHT21_EVENT_ERROR && temps == 0);
+	CHECK(SHT21StartSample(&g_sSht));
+	CHECK(RunSample(false, &temps, &pressures) == SHT21_EVENT_HUMIDITY && temps == 1);
+	CHECK(g_sModel.nackedReads == 0);
+}
+
+// SHT21SetUserReg keeps the reserved bits through a read-modify-write, and at every resolution the
+// waits cover the conversion without NACKed reads and with at most a millisecond to spare
+static void CheckUserReg(void){
+	static const uint8_t pui8Res[4] = {SHT21_RES_RH12_T14, SHT21_RES_RH8_T12, SHT21_RES_RH10_T13, SHT21_RES_RH11_T11};
+	const tHostTrans *psCmd, *psRead;
+	uint8_t r, index, heater;
+
+	Setup();
+	g_sModel.userReg = MODEL_USER;
+	for(r = 0; r < 4; r++){
+		for(heater = 0; heater < 2; heater++){
+			CHECK(SHT21SetUserReg(&g_sSht, pui8Res[r], heater) == SHT21_STATUS_OK);
+			CHECK(HostBusLast(1)->txLen == 1 && HostBusLast(1)->tx[0] == SHT21_READ_USER_REG && HostBusLast(1)->rxLen == 1);
+			CHECK(HostBusLast(0)->txLen == 2 && HostBusLast(0)->tx[0] == SHT21_WRITE_USER_REG);
+			CHECK((g_sModel.userReg & USER_RESERVED) == (MODEL_USER & USER_RESERVED));
+			CHECK((g_sModel.userReg & SHT21_RES_MASK) == pui8Res[r] && g_sSht.resolution == pui8Res[r]);
+			CHECK(((g_sModel.userReg & SHT21_HEATER) != 0) == heater);
+			CHECK((g_sModel.userReg & 0x02) == (MODEL_USER & 0x02));
+		}
+		CHECK(g_sModel.reservedWrites == 0);
+
+		index = SHT21ResIndex(&g_sSht);
+		CHECK(SHT21ReadTemperature(&g_sSht) == SHT21_STATUS_OK);
+		psCmd = HostBusLast(1);
+		psRead = HostBusLast(0);
+		CHECK(psCmd->tx[0] == SHT21_TEMP_NOBLOCK && psRead->rxLen == 3);
+		CHECK(psRead->ns - psCmd->ns <= (g_pui8DatasheetTempMs[index] + 1) * 1000000ULL + 200000);
+		CHECK(SHT21ReadHumidity(&g_sSht) == SHT21_STATUS_OK);
+		psCmd = HostBusLast(1);
+		psRead = HostBusLast(0);
+		CHECK(psCmd->tx[0] == SHT21_HUM_NOBLOCK && psRead->rxLen == 3);
+		CHECK(psRead->ns - psCmd->ns <= (g_pui8DatasheetHumMs[index] + 1) * 1000000ULL + 200000);
+		CHECK(g_sModel.nackedReads == 0);
+	}
+
+	// A failed read leaves the register and the waits alone
+	HostBusFault(I2C_STATUS_ERROR, 0, 1);
+	CHECK(SHT21SetUserReg(&g_sSht, SHT21_RES_RH12_T14, false) == SHT21_STATUS_BUS_ERROR);
+	CHECK(g_sSht.resolution == SHT21_RES_RH11_T11 && (g_sModel.userReg & SHT21_RES_MASK) == SHT21_RES_RH11_T11);
+}
+
+#ifdef SHT21_FIXED_POINT
+// Every reading through the integer conversions against the float formulas of the default build,
+// which round to within one count
+static void CheckFixed(void){
+	uint32_t raw;
+	int32_t diff, worstTemp = 0, worstHum = 0;
+
+	for(raw = 0; raw < 0x10000; raw += 4){
+		g_sSht.i2cData[0] = raw >> 8;
+		g_sSht.i2cData[1] = raw;
+		SHT21ConvertTemp(&g_sSht);
+		diff = labs(g_sSht.tempCenti - lroundf(100.0f * (-46.85f + 175.72f * ((float)raw/65536.0f))));
+		worstTemp = (diff > worstTemp) ? diff : worstTemp;
+
+		g_sSht.i2cData[1] = raw | 0x02;
+		SHT21ConvertHum(&g_sSht);
+		diff = labs(g_sSht.humCenti - lroundf(100.0f * (-6.0f + 125.0f * ((float)raw/65536.0f))));
+		worstHum = (diff > worstHum) ? diff : worstHum;
+	}
+	CHECK(worstTemp <= 1 && worstHum <= 1);
+
+	// Status bits are not part of the reading
+	g_sSht.i2cData[0] = 0;
+	g_sSht.i2cData[1] = 0x03;
+	SHT21ConvertTemp(&g_sSht);
+	CHECK(g_sSht.tempCenti == -4685);
+}
+#endif
+
+int main(void){
+	HostInit();
+
+	CheckCrc();
+	CheckCrcRetry();
+	CheckSplitPhase();
+	CheckUserReg();
+#ifdef SHT21_FIXED_POINT
+	CheckFixed();
+#endif
+
+#ifdef SHT21_FIXED_POINT
+	return HostResult("shtTestFixed");
+#else
+	return HostResult("shtTest");
+#endif
+}
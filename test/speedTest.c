@@ -0,0 +1,256 @@
+// speedTest.c
+//
+//****************************************************************************************************
+// Author:
+// 	Nipun Gunawardena
+//
+// Credits:
+//	None
+//
+// Requirements:
+// 	See host.h
+//
+// Description:
+// 	Checks per device bus speeds, the retiming between devices and the speed fallback on both
+//	real backends, run against the I2C3 master model
+//
+// Notes:
+//	The master model clocks each command at the rate MTPR sets, so a transaction's time on the bus
+//	shows the speed it ran at. ROM_SysCtlSleep stands in for WFI in I2CLibWait: it finishes the
+//	master's command and runs the I2C3 interrupt handler. The polling backend runs the master
+//	from its own MCS accesses
+//
+//****************************************************************************************************
+
+
+// Includes ------------------------------------------------------------------------------------------
+#include <stdlib.h>
+
+#include "host.h"
+#include "inc/hw_types.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_i2c.h"
+#include "i2cLib.h"
+#include "bmpLib.h"
+#include "shtLib.h"
+#include "islLib.h"
+#include "i2cModel.h"
+#include "sensorModel.h"
+
+
+// Defines -------------------------------------------------------------------------------------------
+#define MISSING_ADDR 0x51		// No slave answers here
+
+// MTPR and SCL period of each speed with the 40 MHz clock
+#define FAST_TPR 4
+#define STD_TPR 19
+#define FAST_NS 2500
+#define STD_NS 10000
+
+
+
+// Variables -----------------------------------------------------------------------------------------
+static const int16_t g_pi16ExampleCal[11] = {408, -72, -14383, (int16_t)32741, (int16_t)32757, (int16_t)23153, 6190, 4, -32768, -8711, 2868};
+
+static tI2CBus g_sTestBus;
+static tBmpModel g_sBmpModel;
+static tShtModel g_sShtModel;
+static tIslModel g_sIslModel;
+static tI2CDevice g_sBmpDev, g_sShtDev, g_sIslDev, g_sMissingDev;
+
+
+
+// Functions -----------------------------------------------------------------------------------------
+
+// WFI in I2CLibWait. The engine always has a command on the bus while it waits
+void ROM_SysCtlSleep(void){
+	uint64_t end = HostMasterNext();
+
+	if(end == 0){
+		CHECK(false);
+		exit(HostResult("speedTest"));
+	}
+	HostAdvance(end - HostNs());
+	HostMasterRun();
+	I2CLibIntHandler();
+}
+
+// A fresh bus on the backend with the three models on it, every device at its default speed
+static void Setup(const tI2CBackend *psBackend){
+	HostBusReset();
+	HostMasterPolled(false);
+	I2CLibBusInit(&g_sTestBus, I2C3_BASE, psBackend);
+	BmpModelInit(&g_sBmpModel, g_pi16ExampleCal, 27898, 23843);
+	ShtModelInit(&g_sShtModel, 0x6A3C, 0x6060);
+	IslModelInit(&g_sIslModel, 500, 0);
+	HostSlaveAdd(&g_sBmpModel.slave);
+	HostSlaveAdd(&g_sShtModel.slave);
+	HostSlaveAdd(&g_sIslModel.slave);
+	I2CLibDevInit(&g_sBmpDev, &g_sTestBus, BMP180_I2C_ADDRESS);
+	I2CLibDevInit(&g_sShtDev, &g_sTestBus, SHT21_I2C_ADDRESS);
+	I2CLibDevInit(&g_sIslDev, &g_sTestBus, ISL29023_I2C_ADDRESS);
+	I2CLibDevInit(&g_sMissingDev, &g_sTestBus, MISSING_ADDR);
+	HostMasterPolled(psBackend == &g_sI2CPollBackend);
+}
+
+// Bus time of a transaction: 9 clocks for every byte and address, one more for each start and
+// the stop
+static uint64_t BusNs(uint8_t bytes, uint8_t starts, uint64_t bitNs){
+	return (uint64_t)(9 * (bytes + starts) + starts + 1) * bitNs;
+}
+
+// Let an error stop still on the bus finish, so it isn't timed with the next transaction. The
+// polled master finishes it as soon as MCS is read
+static void Settle(void){
+	uint64_t end = HostMasterNext();
+
+	if(end){
+		HostAdvance(end - HostNs());
+		HostMasterRun();
+		I2CLibIntHandler();
+	}
+}
+
+// Read one register of the device, checking the rate it went at by its time on the bus
+static bool ReadAt(tI2CDevice *psDev, uint8_t reg, uint32_t tpr, uint64_t bitNs){
+	uint64_t busyNs;
+	uint8_t data;
+
+	Settle();
+	busyNs = g_ui64HostMasterBusyNs;
+
+	return I2CLibDevReadRegs(psDev, reg, &data, 1) == I2C_STATUS_DONE && HWREG(I2C3_BASE + I2C_O_MTPR) == tpr && g_ui64HostMasterBusyNs - busyNs == BusNs(2, 2, bitNs);
+}
+
+// A command byte that is NACKed, at the expected rate
+static bool NackAt(tI2CDevice *psDev, uint32_t tpr, uint64_t bitNs){
+	uint64_t busyNs;
+
+	Settle();
+	busyNs = g_ui64HostMasterBusyNs;
+
+	return I2CLibDevCommand(psDev, 0x01) == I2C_STATUS_ERROR && HWREG(I2C3_BASE + I2C_O_MTPR) == tpr && g_ui64HostMasterBusyNs - busyNs == BusNs(1, 1, bitNs);
+}
+
+
+
+// Checks --------------------------------------------------------------------------------------------
+
+// Devices at different speeds share the bus, each transaction runs at its own device's rate
+// whatever ran before it. A device left at I2C_SPEED_KEEP runs at whatever rate the bus has
+static void CheckRetime(const tI2CBackend *psBackend){
+	uint8_t i;
+
+	Setup(psBackend);
+	I2CLibDevSpeedSet(&g_sShtDev, I2C_SPEED_STD);
+	I2CLibDevSpeedSet(&g_sIslDev, I2C_SPEED_KEEP);
+
+	for(i = 0; i < 3; i++){
+		CHECK(ReadAt(&g_sBmpDev, 0xD0, FAST_TPR, FAST_NS));
+		CHECK(ReadAt(&g_sIslDev, 0x00, FAST_TPR, FAST_NS));
+		CHECK(ReadAt(&g_sShtDev, 0xE7, STD_TPR, STD_NS));
+		CHECK(ReadAt(&g_sIslDev, 0x00, STD_TPR, STD_NS));
+		CHECK(ReadAt(&g_sShtDev, 0xE7, STD_TPR, STD_NS));
+	}
+
+	// Every byte is counted against the device that moved it
+	CHECK(g_sBmpDev.bytes == 3 * 2 && g_sShtDev.bytes == 6 * 2 && g_sIslDev.bytes == 6 * 2);
+	CHECK(g_sBmpDev.bytes == g_sBmpModel.slave.bytes && g_sShtDev.bytes == g_sShtModel.slave.bytes && g_sIslDev.bytes == g_sIslModel.slave.bytes);
+	CHECK(g_ui32HostMasterStarts == 15 && g_ui32HostLogCount == 15);
+}
+
+// I2C_FALLBACK_ERRORS NACKs in a row slow a device down, once per run and never below 100 kHz.
+// A transaction that finishes ends the run, and other devices keep their speed
+static void CheckNackFallback(const tI2CBackend *psBackend){
+	uint8_t i, data[3];
+
+	Setup(psBackend);
+
+	for(i = 0; i < I2C_FALLBACK_ERRORS - 1; i++){
+		CHECK(NackAt(&g_sMissingDev, FAST_TPR, FAST_NS));
+		CHECK(ReadAt(&g_sBmpDev, 0xD0, FAST_TPR, FAST_NS));
+	}
+	CHECK(g_sMissingDev.speed == I2C_SPEED_FAST && g_sMissingDev.failStreak == I2C_FALLBACK_ERRORS - 1);
+	CHECK(NackAt(&g_sMissingDev, FAST_TPR, FAST_NS));
+	CHECK(g_sMissingDev.speed == I2C_SPEED_STD && g_sMissingDev.failStreak == 0);
+
+	// The next transaction is retimed, the device after it put back
+	CHECK(NackAt(&g_sMissingDev, STD_TPR, STD_NS));
+	CHECK(ReadAt(&g_sBmpDev, 0xD0, FAST_TPR, FAST_NS));
+	for(i = 0; i < 2 * I2C_FALLBACK_ERRORS; i++){
+		CHECK(NackAt(&g_sMissingDev, STD_TPR, STD_NS));
+	}
+	CHECK(g_sMissingDev.speed == I2C_SPEED_STD && g_sMissingDev.nacks == 3 * I2C_FALLBACK_ERRORS + 1);
+	CHECK(g_sBmpDev.speed == I2C_SPEED_FAST && g_sBmpDev.nacks == 0);
+
+	// The SHT21 NACKs result reads until its conversion is done. A read that gets through between
+	// NACKs starts the count again
+	CHECK(I2CLibDevCommand(&g_sShtDev, 0xF3) == I2C_STATUS_DONE);
+	for(i = 0; i < I2C_FALLBACK_ERRORS - 1; i++){
+		CHECK(I2CLibDevRead(&g_sShtDev, data, 3) == I2C_STATUS_ERROR);
+	}
+	HostAdvance(100000000);
+	CHECK(I2CLibDevRead(&g_sShtDev, data, 3) == I2C_STATUS_DONE && g_sShtDev.failStreak == 0);
+	CHECK(I2CLibDevCommand(&g_sShtDev, 0xF3) == I2C_STATUS_DONE);
+	for(i = 0; i < I2C_FALLBACK_ERRORS - 1; i++){
+		CHECK(I2CLibDevRead(&g_sShtDev, data, 3) == I2C_STATUS_ERROR);
+	}
+	CHECK(g_sShtDev.speed == I2C_SPEED_FAST && g_sShtDev.nacks == 2 * (I2C_FALLBACK_ERRORS - 1));
+
+	// Put back by the application
+	I2CLibDevSpeedSet(&g_sMissingDev, I2C_SPEED_FAST);
+	CHECK(NackAt(&g_sMissingDev, FAST_TPR, FAST_NS));
+	CHECK(g_sMissingDev.bytes == 0);
+	Settle();
+	CHECK(g_sBmpDev.bytes == g_sBmpModel.slave.bytes && g_sShtDev.bytes == g_sShtModel.slave.bytes);
+}
+
+// CRC mismatches reported by shtLib slow the SHT21 down when the retries of one reading all fail,
+// although the transfers around them go through. A good reading ends the run
+static void CheckCrcFallback(const tI2CBackend *psBackend){
+	tSHT2x sSht;
+	uint8_t event;
+
+	Setup(psBackend);
+	SHT21Initialize(&sSht, &g_sTestBus);
+
+	g_sShtModel.badCrcs = SHT21_RETRIES;
+	CHECK(SHT21ReadTemperature(&sSht) == SHT21_STATUS_OK);
+	g_sShtModel.badCrcs = SHT21_RETRIES;
+	CHECK(SHT21ReadHumidity(&sSht) == SHT21_STATUS_OK);
+	CHECK(sSht.dev.speed == I2C_SPEED_FAST && sSht.dev.faults == 2 * SHT21_RETRIES && sSht.dev.faultStreak == 0);
+
+	g_sShtModel.badCrcs = SHT21_RETRIES + 1;
+	CHECK(SHT21ReadTemperature(&sSht) == SHT21_STATUS_CRC_ERROR);
+	CHECK(sSht.dev.speed == I2C_SPEED_STD && sSht.dev.faults == 3 * SHT21_RETRIES + 1);
+	CHECK(ReadAt(&sSht.dev, 0xE7, STD_TPR, STD_NS));
+
+	// Split-phase, with the interrupt engine's bus run to completion between calls
+	I2CLibDevSpeedSet(&sSht.dev, I2C_SPEED_FAST);
+	g_sShtModel.badCrcs = SHT21_RETRIES + 1;
+	CHECK(SHT21StartTemp(&sSht));
+	do{
+		while(HostMasterNext()){
+			HostAdvance(HostMasterNext() - HostNs());
+			HostMasterRun();
+			I2CLibIntHandler();
+		}
+		HostAdvance(1000000);
+		event = SHT21Service(&sSht, HostMs());
+	} while(event == SHT21_EVENT_NONE);
+	CHECK(event == SHT21_EVENT_ERROR && sSht.dev.speed == I2C_SPEED_STD);
+	CHECK(sSht.dev.bytes == g_sShtModel.slave.bytes && sSht.dev.nacks == g_sShtModel.nackedReads);
+}
+
+int main(void){
+	HostInit();
+
+	CheckRetime(&g_sI2CIntBackend);
+	CheckRetime(&g_sI2CPollBackend);
+	CheckNackFallback(&g_sI2CIntBackend);
+	CheckNackFallback(&g_sI2CPollBackend);
+	CheckCrcFallback(&g_sI2CIntBackend);
+	CheckCrcFallback(&g_sI2CPollBackend);
+
+	return HostResult("speedTest");
+}
@@ -0,0 +1 @@
+// Host stand-in for TivaWare's driverlib/fpu.h, only what this tree uses
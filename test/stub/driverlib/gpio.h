@@ -0,0 +1,22 @@
+// Host stand-in for TivaWare's driverlib/gpio.h, only what this tree uses
+#define GPIO_PIN_0 0x01
+#define GPIO_PIN_1 0x02
+#define GPIO_PIN_2 0x04
+#define GPIO_PIN_3 0x08
+#define GPIO_PIN_4 0x10
+#define GPIO_PIN_5 0x20
+#define GPIO_FALLING_EDGE 0
+#define GPIO_LOW_LEVEL 2
+#define GPIO_STRENGTH_4MA 1
+#define GPIO_PIN_TYPE_STD_WPU 1
+#define GPIO_PIN_TYPE_STD 0
+#define GPIO_PIN_TYPE_OD 2
+extern void GPIOPinConfigure(uint32_t);
+#define GPIO_INT_PIN_5 0x20
+#define GPIO_STRENGTH_2MA 0
+#define GPIO_BOTH_EDGES 1
+extern void GPIOIntEnable(uint32_t, uint32_t);
+extern void GPIOIntDisable(uint32_t, uint32_t);
+extern void GPIOIntClear(uint32_t, uint32_t);
+extern uint32_t GPIOIntStatus(uint32_t, bool);
+extern void GPIOIntTypeSet(uint32_t, uint8_t, uint32_t);
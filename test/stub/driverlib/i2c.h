@@ -0,0 +1,22 @@
+// Host stand-in for TivaWare's driverlib/i2c.h, only what this tree uses
+#define I2C_MASTER_CMD_SINGLE_SEND 0x7
+#define I2C_MASTER_CMD_SINGLE_RECEIVE 0x7
+#define I2C_MASTER_CMD_BURST_SEND_START 0x3
+#define I2C_MASTER_CMD_BURST_SEND_CONT 0x1
+#define I2C_MASTER_CMD_BURST_SEND_FINISH 0x5
+#define I2C_MASTER_CMD_BURST_SEND_ERROR_STOP 0x4
+#define I2C_MASTER_CMD_BURST_RECEIVE_START 0xb
+#define I2C_MASTER_CMD_BURST_RECEIVE_CONT 0x9
+#define I2C_MASTER_CMD_BURST_RECEIVE_FINISH 0x5
+#define I2C_MASTER_CMD_BURST_RECEIVE_ERROR_STOP 0x4
+#define I2C_MASTER_ERR_NONE 0
+#define I2C_MASTER_ERR_ADDR_ACK 0x4
+#define I2C_MASTER_ERR_DATA_ACK 0x8
+#define I2C_MASTER_ERR_ARB_LOST 0x10
+#define I2C_MASTER_ERR_CLK_TOUT 0x80
+#define I2C_MASTER_INT_DATA 0x1
+#define I2C_MASTER_INT_TIMEOUT 0x2
+extern void I2CMasterIntEnable(uint32_t);
+extern void I2CMasterIntEnableEx(uint32_t, uint32_t);
+extern void I2CMasterIntClear(uint32_t);
+extern void I2CMasterTimeoutSet(uint32_t, uint32_t);
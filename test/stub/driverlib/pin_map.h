@@ -0,0 +1,5 @@
+// Host stand-in for TivaWare's driverlib/pin_map.h, only what this tree uses
+#define GPIO_PA0_U0RX 1
+#define GPIO_PA1_U0TX 2
+#define GPIO_PD0_I2C3SCL 3
+#define GPIO_PD1_I2C3SDA 4
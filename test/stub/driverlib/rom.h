@@ -0,0 +1,77 @@
+// Host stand-in for TivaWare's driverlib/rom.h, only what this tree uses
+extern void ROM_I2CMasterSlaveAddrSet(uint32_t, uint8_t, bool);
+extern void ROM_I2CMasterDataPut(uint32_t, uint8_t);
+extern uint32_t ROM_I2CMasterDataGet(uint32_t);
+extern void ROM_I2CMasterControl(uint32_t, uint32_t);
+extern bool ROM_I2CMasterBusy(uint32_t);
+extern bool ROM_I2CMasterBusBusy(uint32_t);
+extern uint32_t ROM_I2CMasterErr(uint32_t);
+extern void ROM_I2CMasterInitExpClk(uint32_t, uint32_t, bool);
+extern void ROM_I2CMasterIntEnable(uint32_t);
+extern void ROM_I2CMasterIntDisable(uint32_t);
+extern void ROM_I2CMasterIntClear(uint32_t);
+extern bool ROM_I2CMasterIntStatus(uint32_t, bool);
+extern void ROM_I2CMasterEnable(uint32_t);
+extern void ROM_I2CMasterDisable(uint32_t);
+extern void ROM_SysCtlDelay(uint32_t);
+extern uint32_t ROM_SysCtlClockGet(void);
+extern void ROM_SysCtlClockSet(uint32_t);
+extern void ROM_SysCtlPeripheralEnable(uint32_t);
+extern void ROM_SysCtlSleep(void);
+extern void ROM_IntEnable(uint32_t);
+extern void ROM_IntDisable(uint32_t);
+extern bool ROM_IntMasterEnable(void);
+extern bool ROM_IntMasterDisable(void);
+extern void ROM_IntPrioritySet(uint32_t, uint8_t);
+extern void ROM_FPUEnable(void);
+extern void ROM_FPULazyStackingEnable(void);
+extern void ROM_GPIOPinTypeGPIOOutput(uint32_t, uint8_t);
+extern void ROM_GPIOPinTypeGPIOOutputOD(uint32_t, uint8_t);
+extern void ROM_GPIOPinTypeGPIOInput(uint32_t, uint8_t);
+extern void ROM_GPIOPinTypeUART(uint32_t, uint8_t);
+extern void ROM_GPIOPinTypeI2C(uint32_t, uint8_t);
+extern void ROM_GPIOPinTypeI2CSCL(uint32_t, uint8_t);
+extern void ROM_GPIOPinTypeSSI(uint32_t, uint8_t);
+extern void ROM_GPIOPinConfigure(uint32_t);
+extern void ROM_GPIOPinWrite(uint32_t, uint8_t, uint8_t);
+extern int32_t ROM_GPIOPinRead(uint32_t, uint8_t);
+extern void ROM_GPIOIntTypeSet(uint32_t, uint8_t, uint32_t);
+extern void ROM_GPIOPinIntEnable(uint32_t, uint8_t);
+extern void ROM_GPIOPinIntClear(uint32_t, uint8_t);
+extern uint32_t ROM_GPIOPinIntStatus(uint32_t, bool);
+extern void ROM_GPIOPadConfigSet(uint32_t, uint8_t, uint32_t, uint32_t);
+extern void ROM_SSIDataPut(uint32_t, uint32_t);
+extern void ROM_SSIDataGet(uint32_t, uint32_t *);
+extern int32_t ROM_SSIDataPutNonBlocking(uint32_t, uint32_t);
+extern int32_t ROM_SSIDataGetNonBlocking(uint32_t, uint32_t *);
+extern void ROM_SSIConfigSetExpClk(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
+extern void ROM_SSIEnable(uint32_t);
+extern void ROM_SSIDisable(uint32_t);
+extern void ROM_SSIDMAEnable(uint32_t, uint32_t);
+extern void ROM_SSIDMADisable(uint32_t, uint32_t);
+extern void ROM_SSIIntEnable(uint32_t, uint32_t);
+extern void ROM_SSIIntClear(uint32_t, uint32_t);
+extern uint32_t ROM_SSIIntStatus(uint32_t, bool);
+extern bool ROM_SSIBusy(uint32_t);
+extern void ROM_SysTickPeriodSet(uint32_t);
+extern void ROM_SysTickIntEnable(void);
+extern void ROM_SysTickEnable(void);
+extern void ROM_uDMAEnable(void);
+extern void ROM_uDMAControlBaseSet(void *);
+extern void ROM_uDMAChannelAssign(uint32_t);
+extern void ROM_uDMAChannelAttributeDisable(uint32_t, uint32_t);
+extern void ROM_uDMAChannelAttributeEnable(uint32_t, uint32_t);
+extern void ROM_uDMAChannelControlSet(uint32_t, uint32_t);
+extern void ROM_uDMAChannelTransferSet(uint32_t, uint32_t, void *, void *, uint32_t);
+extern void ROM_uDMAChannelEnable(uint32_t);
+extern void ROM_uDMAChannelDisable(uint32_t);
+extern bool ROM_uDMAChannelIsEnabled(uint32_t);
+extern uint32_t ROM_uDMAChannelModeGet(uint32_t);
+extern uint32_t ROM_uDMAErrorStatusGet(void);
+extern void ROM_uDMAErrorStatusClear(void);
+extern void ROM_TimerIntClear(uint32_t, uint32_t);
+#define MAP_GPIOPadConfigSet ROM_GPIOPadConfigSet
+extern void ROM_SysCtlPeripheralReset(uint32_t);
+extern void ROM_IntPendSet(uint32_t);
+extern void ROM_I2CMasterIntEnableEx(uint32_t, uint32_t);
+extern void ROM_I2CMasterTimeoutSet(uint32_t, uint32_t);
@@ -0,0 +1,2 @@
+// Host stand-in for TivaWare's driverlib/rom_map.h, only what this tree uses
+#include "rom.h"
@@ -0,0 +1,5 @@
+// Host stand-in for TivaWare's driverlib/ssi.h, only what this tree uses
+#define SSI_FRF_MOTO_MODE_0 0
+#define SSI_MODE_MASTER 0
+#define SSI_DMA_TX 0x2
+#define SSI_DMA_RX 0x1
@@ -0,0 +1,16 @@
+// Host stand-in for TivaWare's driverlib/sysctl.h, only what this tree uses
+#define SYSCTL_PERIPH_GPIOA 1
+#define SYSCTL_PERIPH_GPIOD 2
+#define SYSCTL_PERIPH_GPIOE 3
+#define SYSCTL_PERIPH_GPIOF 4
+#define SYSCTL_PERIPH_I2C3 5
+#define SYSCTL_PERIPH_UART0 6
+#define SYSCTL_PERIPH_SSI0 7
+#define SYSCTL_PERIPH_UDMA 8
+#define SYSCTL_SYSDIV_5 0
+#define SYSCTL_USE_PLL 0
+#define SYSCTL_XTAL_16MHZ 0
+#define SYSCTL_OSC_MAIN 0
+#define SYSCTL_PERIPH_I2C0 0xf0002000
+#define SYSCTL_PERIPH_I2C1 0xf0002001
+#define SYSCTL_PERIPH_I2C2 0xf0002002
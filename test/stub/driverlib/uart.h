@@ -0,0 +1,3 @@
+// Host stand-in for TivaWare's driverlib/uart.h, only what this tree uses
+#define UART_CLOCK_PIOSC 5
+extern void UARTClockSourceSet(uint32_t, uint32_t);
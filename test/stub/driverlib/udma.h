@@ -0,0 +1,20 @@
+// Host stand-in for TivaWare's driverlib/udma.h, only what this tree uses
+#define UDMA_CHANNEL_SSI0RX 10
+#define UDMA_CHANNEL_SSI0TX 11
+#define UDMA_CH10_SSI0RX 10
+#define UDMA_CH11_SSI0TX 11
+#define UDMA_PRI_SELECT 0
+#define UDMA_ALT_SELECT 0x20
+#define UDMA_SIZE_8 0
+#define UDMA_SRC_INC_8 0
+#define UDMA_SRC_INC_NONE 0xc000000
+#define UDMA_DST_INC_8 0
+#define UDMA_DST_INC_NONE 0xc0000000
+#define UDMA_ARB_4 0x8000
+#define UDMA_MODE_BASIC 1
+#define UDMA_MODE_STOP 0
+#define UDMA_ATTR_ALL 0xf
+#define UDMA_ATTR_USEBURST 1
+#define UDMA_ATTR_ALTSELECT 2
+#define UDMA_ATTR_HIGH_PRIORITY 4
+#define UDMA_ATTR_REQMASK 8
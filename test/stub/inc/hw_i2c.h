@@ -0,0 +1,20 @@
+// Host stand-in for TivaWare's inc/hw_i2c.h, only what this tree uses
+#define I2C_O_MSA 0x0
+#define I2C_O_MCS 0x4
+#define I2C_O_MDR 0x8
+#define I2C_O_MTPR 0xC
+#define I2C_O_MIMR 0x10
+#define I2C_O_MRIS 0x14
+#define I2C_O_MMIS 0x18
+#define I2C_O_MICR 0x1C
+#define I2C_O_MCR 0x20
+#define I2C_MCS_BUSY 0x1
+#define I2C_MCS_ERROR 0x2
+#define I2C_MCS_ADRACK 0x4
+#define I2C_MCS_DATACK 0x8
+#define I2C_MCS_ARBLST 0x10
+#define I2C_MCS_BUSBSY 0x40
+#define I2C_MCS_CLKTO 0x80
+#define I2C_MICR_IC 0x1
+#define I2C_O_MCLKOCNT 0x24
+#define I2C_MICR_CLKIC 0x2
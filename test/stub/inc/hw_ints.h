@@ -0,0 +1,5 @@
+// Host stand-in for TivaWare's inc/hw_ints.h, only what this tree uses
+#define INT_I2C3 84
+#define INT_GPIOE 20
+#define INT_SSI0 23
+#define INT_UDMAERR 63
@@ -0,0 +1,11 @@
+// Host stand-in for TivaWare's inc/hw_memmap.h, only what this tree uses
+#define I2C3_BASE 0x40023000
+#define I2C0_BASE 0x40020000
+#define GPIO_PORTA_BASE 0x40004000
+#define GPIO_PORTD_BASE 0x40007000
+#define GPIO_PORTE_BASE 0x40024000
+#define GPIO_PORTF_BASE 0x40025000
+#define SSI0_BASE 0x40008000
+#define UART0_BASE 0x4000C000
+#define TIMER0_BASE 0x40030000
+#define UDMA_BASE 0x400FF000
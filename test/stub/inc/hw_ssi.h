@@ -0,0 +1,8 @@
+// Host stand-in for TivaWare's inc/hw_ssi.h, only what this tree uses
+#define SSI_O_DR 0x8
+#define SSI_O_SR 0xC
+#define SSI_O_DMACTL 0x24
+#define SSI_SR_TNF 0x2
+#define SSI_SR_RNE 0x4
+#define SSI_SR_BSY 0x10
+#define SSI_SR_TFE 0x1
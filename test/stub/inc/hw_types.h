@@ -0,0 +1,10 @@
+// Host stand-in for TivaWare's inc/hw_types.h, only what this tree uses. Addresses are widened
+// first so they can be used as pointers on a 64 bit host. Word accesses go through HostReg in
+// host.c, so a model can follow them
+#include <stdint.h>
+
+extern volatile uint32_t *HostReg(uintptr_t addr);
+
+#define HWREG(x) (*HostReg((uintptr_t)(x)))
+#define HWREGB(x) (*((volatile uint8_t *)(uintptr_t)(x)))
+#define HWREGBITW(x,b) (*((volatile uint32_t *)(uintptr_t)(x)))
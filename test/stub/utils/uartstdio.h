@@ -0,0 +1,2 @@
+// Host stand-in for TivaWare's utils/uartstdio.h, only what this tree uses
+extern void UARTprintf(const char *, ...); extern void UARTStdioConfig(uint32_t,uint32_t,uint32_t);